@@ -0,0 +1,44 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_AUDIOBACKEND_H
+#define NATIVEFEEDBACK_AUDIOBACKEND_H
+
+// 16-bit signed little endian interleaved PCM
+struct StreamFormat {
+    int sampleRate;
+    int channels;
+};
+
+// A player or recorder with Android simple buffer queue semantics: the
+// device works through enqueued buffers in order and calls the callback
+// each time it finishes one. Players read the buffers, recorders fill them.
+class AudioStream {
+public:
+    typedef void (*Callback)(AudioStream *stream, void *context);
+
+    virtual ~AudioStream() {}
+
+    virtual bool registerCallback(Callback callback, void *context) = 0;
+    // false when the queue is already full
+    virtual bool enqueue(const void *buffer, unsigned bytes) = 0;
+    // drops everything enqueued without calling back
+    virtual bool clear() = 0;
+    virtual bool start() = 0;
+    virtual bool stop() = 0;
+};
+
+// Creates streams on one audio device: OpenSL ES on Android, a simulated
+// device clock on the host.
+class AudioBackend {
+public:
+    virtual ~AudioBackend() {}
+
+    // queueDepth is the number of buffers the stream can hold at once.
+    // The caller owns the returned stream, NULL on failure.
+    virtual AudioStream *createPlayer(const StreamFormat &format, int queueDepth) = 0;
+    virtual AudioStream *createRecorder(const StreamFormat &format, int queueDepth) = 0;
+};
+
+#endif //NATIVEFEEDBACK_AUDIOBACKEND_H
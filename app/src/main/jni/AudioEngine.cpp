@@ -0,0 +1,600 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "AudioEngine.h"
+
+#include <cassert>
+#include <cstring>
+
+#define LOG_TAG "NativeAudioEngine"
+
+#include "Log.h"
+#include "Resampler.h"
+#include "RtLog.h"
+
+AudioEngine::AudioEngine(AudioBackend *backend)
+        : pool_(backend), recorder_(NULL), player_(NULL), recorderReady_(false),
+          state_(STATE_IDLE),
+          commands_(ENGINE_COMMAND_QUEUE_DEPTH),
+          playSession_(0),
+          latencySeq_(0), latencyValid_(false), latencyFrames_(0), latencyMs_(0),
+          latencyConfidence_(0),
+          captureStream_(1, RECORDER_POOL_BUFFERS),
+          playbackStream_(1, PLAYER_POOL_BUFFERS),
+          monitor_(&pool_),
+          monitorProcessor_(NULL),
+          monitorContext_(NULL),
+          suppressFeedback_(false),
+          mixer_(&pool_),
+          mixerStopped_(NULL),
+          mixerStoppedContext_(NULL),
+          framesPerBurst_(DEFAULT_FRAMES_PER_BURST),
+          fastPath_(false),
+          playerSourceMode_(PlaybackStream::SOURCE_MAPPED),
+          playFinished_(true),
+          counter_(0) {
+    format_.sampleRate = FILE_SAMPLE_RATE;
+    format_.channels = 1;
+    playbackStream_.setSampleRates(FILE_SAMPLE_RATE, FILE_SAMPLE_RATE);
+    captureStream_.setSampleRates(FILE_SAMPLE_RATE, FILE_SAMPLE_RATE);
+    // the optional stages give way when the callbacks run late
+    captureStream_.setBudget(&budget_);
+    playbackStream_.setBudget(&budget_);
+    monitor_.setBudget(&budget_);
+    for (int tap = 0; tap < TAP_COUNT; tap++) {
+        analyzers_[tap].setBudget(&budget_);
+    }
+    // the callbacks log through RtLog, never straight to logd
+    RtLog::start();
+    sem_init(&commandReady_, 0, 0);
+    control_ = std::thread(&AudioEngine::controlLoop, this);
+}
+
+AudioEngine::~AudioEngine() {
+    LOGI("shutDown");
+    // whatever is still queued behind the quit is dropped; the control
+    // thread is gone before anything it could be touching is torn down
+    EngineCommand quit;
+    quit.type = COMMAND_QUIT;
+    while (!commands_.push(quit)) {
+        std::this_thread::yield();
+    }
+    sem_post(&commandReady_);
+    control_.join();
+    sem_destroy(&commandReady_);
+
+    // deleting a stream waits for its callback to return, so after this
+    // nothing runs on the audio threads. Hand back the recorder and player
+    // of a session still running, and destroy them with the rest of the
+    // pool, before the streams feeding them go away
+    if (recorder_ != NULL) {
+        recorder_->stop();
+        delete recorder_;
+        recorder_ = NULL;
+    }
+    if (player_ != NULL) {
+        player_->stop();
+        delete player_;
+        player_ = NULL;
+    }
+    monitor_.stop();
+    mixer_.stop();
+    captureStream_.close();
+    playbackStream_.close();
+    pool_.trim();
+    RtLog::stop();
+}
+
+bool AudioEngine::configure(int nativeSampleRate, int framesPerBurst) {
+    LOGI("configure native rate %d, frames per burst %d", nativeSampleRate, framesPerBurst);
+    if (nativeSampleRate <= 0 || framesPerBurst <= 0 || !claim(STATE_IDLE, STATE_CONFIGURING)) {
+        return false;
+    }
+    framesPerBurst_ = framesPerBurst;
+    // files keep their rate; if ours can't convert to the native one the
+    // platform resamples and the player takes the normal mixer path
+    Resampler probe;
+    fastPath_ = nativeSampleRate == FILE_SAMPLE_RATE
+                || probe.init(FILE_SAMPLE_RATE, nativeSampleRate, format_.channels);
+    format_.sampleRate = fastPath_ ? nativeSampleRate : FILE_SAMPLE_RATE;
+    playbackStream_.setSampleRates(FILE_SAMPLE_RATE, format_.sampleRate);
+    captureStream_.setSampleRates(format_.sampleRate, FILE_SAMPLE_RATE);
+    // the idle streams are of the old format; build the recorder again if
+    // it was asked for, so its queue matches the new buffers
+    pool_.trim();
+    if (recorderReady_) {
+        pool_.prewarm(true, format_, RECORDER_QUEUE_DEPTH);
+    }
+    warmUp();
+    state_.store(STATE_IDLE, std::memory_order_release);
+    return fastPath_;
+}
+
+bool AudioEngine::warmUp() {
+    // the monitor and the latency probe share the player with playback
+    return pool_.prewarm(false, format_, playerQueueDepth())
+           && pool_.prewarm(true, format_, MONITOR_RECORDER_QUEUE_DEPTH);
+}
+
+int AudioEngine::recorderFramesPerBuffer() const {
+    int bursts = (RECORDER_TARGET_FRAMES + framesPerBurst_ / 2) / framesPerBurst_;
+    return framesPerBurst_ * (bursts > 0 ? bursts : 1);
+}
+
+bool AudioEngine::createAudioRecorder() {
+    LOGI("createAudioRecorder");
+    // every recording takes it from the pool and hands it back on stop
+    if (recorderReady_) {
+        return true;
+    }
+    if (!claim(STATE_IDLE, STATE_CONFIGURING)) {
+        return false;
+    }
+    recorderReady_ = pool_.prewarm(true, format_, RECORDER_QUEUE_DEPTH);
+    state_.store(STATE_IDLE, std::memory_order_release);
+    return recorderReady_;
+}
+
+void AudioEngine::recorderCallback(AudioStream *stream, void *context) {
+    static_cast<AudioEngine *>(context)->onRecorderBuffer();
+}
+
+// this callback handler is called every time a buffer finishes recording
+void AudioEngine::onRecorderBuffer() {
+    unsigned long long begin = recorderStats_.begin();
+    // hand the filled buffer to the writer thread and give the recorder the
+    // next one straight away, so there is never a gap between buffers.
+    // 写文件在writer线程里做, 回调里不做任何IO
+    const short *filled = captureStream_.filledBuffer();
+    if (filled != NULL) {
+        analyzers_[TAP_CAPTURE].feed(filled, captureStream_.bufferBytes() / sizeof(short)
+                                             / format_.channels);
+    }
+    short *next = captureStream_.onBufferFilled();
+    bool enqueued = recorder_->enqueue(next, captureStream_.bufferBytes());
+    // the queue holds RECORDER_QUEUE_DEPTH buffers and we just got one back,
+    // so a full queue would indicate a programming error
+    (void)enqueued;
+    budget_.record(recorderStats_.end(begin, captureStream_.pendingBuffers()));
+}
+
+bool AudioEngine::startRecord(const char *path) {
+    LOGI("startRecord path is %s", path);
+    unsigned long long requested = CallbackStats::nowNs();
+    if (!recorderReady_ || !claim(STATE_IDLE, STATE_RECORDING)) {
+        return false;
+    }
+
+    // drains whatever a previous session left behind and starts the writer
+    if (!captureStream_.open(path, recorderFramesPerBuffer())) {
+        LOGI("startRecord open %s failed", path);
+        state_.store(STATE_IDLE, std::memory_order_release);
+        return false;
+    }
+
+    recorderStats_.reset(1000000000ULL * recorderFramesPerBuffer() / format_.sampleRate, requested);
+    resetBudget(1000000000ULL * recorderFramesPerBuffer() / format_.sampleRate);
+
+    recorder_ = pool_.createRecorder(format_, RECORDER_QUEUE_DEPTH);
+    if (recorder_ == NULL || !recorder_->registerCallback(recorderCallback, this)) {
+        delete recorder_;
+        recorder_ = NULL;
+        captureStream_.close();
+        state_.store(STATE_IDLE, std::memory_order_release);
+        return false;
+    }
+
+    // enqueue empty buffers to be filled by the recorder; the callback keeps
+    // the queue this deep for the whole session
+    for (int i = 0; i < RECORDER_QUEUE_DEPTH; i++) {
+        recorder_->enqueue(captureStream_.primeBuffer(), captureStream_.bufferBytes());
+    }
+
+    // start recording
+    if (!recorder_->start()) {
+        delete recorder_;
+        recorder_ = NULL;
+        captureStream_.close();
+        state_.store(STATE_IDLE, std::memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+void AudioEngine::stopRecord() {
+    LOGI("stopRecord");
+    if (!claim(STATE_RECORDING, STATE_STOPPING)) {
+        return;
+    }
+    if (recorder_->stop()) {
+        LOGI("stop success");
+    }
+    // back to the pool once its last callback has returned, so nothing
+    // touches the capture stream while it closes
+    delete recorder_;
+    recorder_ = NULL;
+    // flush everything captured so far to disk before releasing the engine
+    if (!captureStream_.close()) {
+        LOGI("stopRecord: the recording didn't make it to disk in full");
+    }
+    LOGI("stopRecord done, overruns %u", captureStream_.overruns());
+    state_.store(STATE_IDLE, std::memory_order_release);
+}
+
+void AudioEngine::playerCallback(AudioStream *stream, void *context) {
+    static_cast<AudioEngine *>(context)->onPlayerBuffer();
+}
+
+// this callback handler is called every time a buffer finishes playing
+void AudioEngine::onPlayerBuffer() {
+    unsigned long long begin = playerStats_.begin();
+    RTLOGD("bqPlayerCallback");
+    bool ok = true;
+    // the buffer that just finished goes back to the reader thread, and the
+    // next prefetched one is enqueued. Buffers belong to playbackStream's pool,
+    // so they stay valid for as long as the player queue holds them.
+    playbackStream_.onBufferPlayed();
+    unsigned size;
+    const short *buffer = playbackStream_.nextBuffer(&size);
+    if (buffer != NULL) {
+        counter_++;
+        RTLOGD("size of buffer is %lld, counter is %lld", size, counter_);
+        analyzers_[TAP_PLAYBACK].feed(buffer, size / sizeof(short) / format_.channels);
+        ok = player_->enqueue(buffer, size);
+    } else if (playbackStream_.drained()) {
+        RTLOGI("play done, underruns %lld", playbackStream_.underruns());
+        ok = player_->stop();
+    }
+
+    // played out, or the enqueue failed on a full queue, which would
+    // indicate a programming error: either way the control thread ends the
+    // session
+    if ((buffer == NULL && playbackStream_.drained()) || !ok) {
+        EngineCommand done;
+        done.type = COMMAND_PLAY_DONE;
+        done.session = playSession_.load(std::memory_order_relaxed);
+        if (commands_.push(done)) {
+            sem_post(&commandReady_);
+        }
+    }
+    RTLOGD("read buffer to play done");
+    budget_.record(playerStats_.end(begin, playbackStream_.readyBuffers()));
+}
+
+bool AudioEngine::startPlay(const char *path, unsigned long long startFrame) {
+    return startPlay(path, startFrame, playerSourceMode_);
+}
+
+bool AudioEngine::startPlay(const char *path, unsigned long long startFrame,
+                            PlaybackStream::SourceMode mode) {
+    LOGI("startPlay srcFilePath' value is %s from frame %llu", path, startFrame);
+    unsigned long long requested = CallbackStats::nowNs();
+    if (!claim(STATE_IDLE, STATE_PLAYING)) {
+        return false;
+    }
+
+    // prefetches the head of the file, the reader thread takes it from there
+    bool opened = playbackStream_.open(path, framesPerBurst_, mode, 0, startFrame);
+    LOGI("openSrcFile %s, buffer size is %u, zero copy %d", opened ? "success" : "failed",
+         playbackStream_.bufferBytes(), playbackStream_.zeroCopy());
+    if (!opened) {
+        state_.store(STATE_IDLE, std::memory_order_release);
+        return false;
+    }
+
+    resetBudget(1000000000ULL * framesPerBurst_ / format_.sampleRate);
+    player_ = pool_.createPlayer(format_, playerQueueDepth());
+    if (player_ == NULL) {
+        playbackStream_.close();
+        state_.store(STATE_IDLE, std::memory_order_release);
+        return false;
+    }
+    player_->registerCallback(playerCallback, this);
+    playerStats_.reset(1000000000ULL * framesPerBurst_ / format_.sampleRate, requested);
+    playSession_.fetch_add(1, std::memory_order_relaxed);
+
+    // prime the player queue with prefetched buffers, the callback keeps it
+    // this deep until the file runs out
+    for (int i = 0; i < playerQueueDepth(); i++) {
+        unsigned size;
+        const short *buffer = playbackStream_.nextBuffer(&size);
+        if (buffer == NULL || !player_->enqueue(buffer, size)) {
+            break;
+        }
+    }
+
+    // set the player's state to playing
+    playFinished_.store(false, std::memory_order_release);
+    counter_ = 0;
+    if (!player_->start()) {
+        delete player_;
+        player_ = NULL;
+        playbackStream_.close();
+        playFinished_.store(true, std::memory_order_release);
+        state_.store(STATE_IDLE, std::memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+void AudioEngine::stopPlay() {
+    LOGI("stop play");
+    if (!claim(STATE_PLAYING, STATE_STOPPING)) {
+        return;
+    }
+    // the player goes back to the pool stopped and cleared once its last
+    // callback has returned; only then can the stream unmap the file
+    delete player_;
+    player_ = NULL;
+    playbackStream_.close();
+    LOGI("stop play, underruns %u", playbackStream_.underruns());
+    state_.store(STATE_IDLE, std::memory_order_release);
+    playFinished_.store(true, std::memory_order_release);
+}
+
+bool AudioEngine::seekPlay(unsigned long long frame) {
+    // playing, and stays so: stopPlay runs on this thread too
+    return state() == STATE_PLAYING && playbackStream_.seek(frame);
+}
+
+bool AudioEngine::setPlayLoop(unsigned long long start, unsigned long long end) {
+    if (state() != STATE_PLAYING) {
+        return false;
+    }
+    playbackStream_.setLoop(start, end);
+    return true;
+}
+
+bool AudioEngine::queuePlay(const char *path) {
+    LOGI("queuePlay %s", path);
+    if (state() == STATE_PLAYING) {
+        // the reader opens it now and splices it in at the end of the file
+        return playbackStream_.enqueue(path);
+    }
+    return startPlay(path, 0, PlaybackStream::SOURCE_STREAM);
+}
+
+void AudioEngine::finishPlay(unsigned session) {
+    if (session == playSession_.load(std::memory_order_relaxed)) {
+        stopPlay();
+    }
+}
+
+void AudioEngine::resetBudget(unsigned long long periodNs) {
+    // the stops hand their streams back before they close anything, so no
+    // callback of the last session can still be in record()
+    assert(recorder_ == NULL && player_ == NULL && !monitor_.running());
+    budget_.reset(periodNs);
+}
+
+bool AudioEngine::startMonitor() {
+    LOGI("startMonitor");
+    if (!claim(STATE_IDLE, STATE_DUPLEX)) {
+        return false;
+    }
+    if (suppressFeedback_ && !suppressor_.init(format_.sampleRate, format_.channels)) {
+        state_.store(STATE_IDLE, std::memory_order_release);
+        return false;
+    }
+    if (suppressFeedback_) {
+        monitor_.setProcessor(processMonitor, this);
+    } else {
+        monitor_.setProcessor(monitorProcessor_, monitorContext_);
+    }
+    resetBudget(1000000000ULL * framesPerBurst_ / format_.sampleRate);
+    if (!monitor_.start(format_, framesPerBurst_, playerQueueDepth(), MONITOR_JITTER_BURSTS)) {
+        state_.store(STATE_IDLE, std::memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+void AudioEngine::processMonitor(short *samples, unsigned frames, int channels, void *context) {
+    AudioEngine *engine = static_cast<AudioEngine *>(context);
+    if (engine->monitorProcessor_ != NULL) {
+        engine->monitorProcessor_(samples, frames, channels, engine->monitorContext_);
+    }
+    engine->suppressor_.process(samples, frames);
+}
+
+void AudioEngine::stopMonitor() {
+    LOGI("stopMonitor");
+    if (!claim(STATE_DUPLEX, STATE_STOPPING)) {
+        return;
+    }
+    monitor_.stop();
+    MonitorStats stats = monitor_.stats();
+    LOGI("stopMonitor done, latency %.1fms (max %.1fms), underruns %u, overruns %u",
+         stats.latencyMs, stats.maxLatencyMs, stats.underruns, stats.overruns);
+    // LOGI is compiled out on the host
+    (void)stats;
+    if (suppressFeedback_) {
+        LOGI("feedback suppression: %u howls, %u notches left",
+             suppressor_.detections(), suppressor_.activeNotches());
+    }
+    state_.store(STATE_IDLE, std::memory_order_release);
+}
+
+bool AudioEngine::startMixer() {
+    LOGI("startMixer");
+    if (!claim(STATE_IDLE, STATE_MIXING)) {
+        return false;
+    }
+    if (!mixer_.start(format_.sampleRate, framesPerBurst_, playerQueueDepth())) {
+        state_.store(STATE_IDLE, std::memory_order_release);
+        return false;
+    }
+    return true;
+}
+
+void AudioEngine::stopMixer() {
+    LOGI("stopMixer");
+    if (!claim(STATE_MIXING, STATE_STOPPING)) {
+        return;
+    }
+    mixer_.stop();
+    MixerStats stats = mixer_.stats();
+    LOGI("stopMixer done, %llu bursts, %llu limited", stats.bursts, stats.limitedBursts);
+    (void)stats;
+    if (mixerStopped_ != NULL) {
+        mixerStopped_(mixerStoppedContext_);
+    }
+    state_.store(STATE_IDLE, std::memory_order_release);
+}
+
+bool AudioEngine::measureLatency(LatencyResult *result) {
+    LOGI("measureLatency");
+    if (!claim(STATE_IDLE, STATE_MEASURING)) {
+        return false;
+    }
+    LatencyProbe probe(&pool_);
+    bool measured = probe.measure(format_, framesPerBurst_, playerQueueDepth(), result);
+    if (measured) {
+        unsigned seq = latencySeq_.load(std::memory_order_relaxed);
+        latencySeq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        latencyValid_.store(result->valid, std::memory_order_relaxed);
+        latencyFrames_.store(result->frames, std::memory_order_relaxed);
+        latencyMs_.store(result->latencyMs, std::memory_order_relaxed);
+        latencyConfidence_.store(result->confidence, std::memory_order_relaxed);
+        latencySeq_.store(seq + 2, std::memory_order_release);
+    }
+    state_.store(STATE_IDLE, std::memory_order_release);
+    return measured;
+}
+
+bool AudioEngine::lastLatency(LatencyResult *result) const {
+    unsigned seq;
+    do {
+        seq = latencySeq_.load(std::memory_order_acquire);
+        result->valid = latencyValid_.load(std::memory_order_relaxed);
+        result->frames = latencyFrames_.load(std::memory_order_relaxed);
+        result->latencyMs = latencyMs_.load(std::memory_order_relaxed);
+        result->confidence = latencyConfidence_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) != 0 || seq != latencySeq_.load(std::memory_order_relaxed));
+    return seq != 0;
+}
+
+bool AudioEngine::claim(EngineState from, EngineState to) {
+    int expected = from;
+    return state_.compare_exchange_strong(expected, to, std::memory_order_acq_rel);
+}
+
+bool AudioEngine::post(EngineCommandType type, const char *path, unsigned long long from,
+                       unsigned long long to) {
+    EngineCommand command;
+    command.type = type;
+    command.session = 0;
+    command.path[0] = '\0';
+    command.from = from;
+    command.to = to;
+    if (path != NULL) {
+        size_t length = strlen(path);
+        if (length >= sizeof(command.path)) {
+            LOGI("post: path of %zu bytes is too long", length);
+            return false;
+        }
+        memcpy(command.path, path, length + 1);
+    }
+    if (!commands_.push(command)) {
+        LOGI("post: command queue full, dropping %d", type);
+        return false;
+    }
+    sem_post(&commandReady_);
+    return true;
+}
+
+void AudioEngine::controlLoop() {
+    for (;;) {
+        sem_wait(&commandReady_);
+        EngineCommand command;
+        while (commands_.pop(&command)) {
+            if (command.type == COMMAND_QUIT) {
+                return;
+            }
+            run(command);
+        }
+    }
+}
+
+void AudioEngine::run(const EngineCommand &command) {
+    LatencyResult result;
+    switch (command.type) {
+        case COMMAND_CONFIGURE:
+            configure(static_cast<int>(command.from), static_cast<int>(command.to));
+            break;
+        case COMMAND_CREATE_RECORDER:
+            createAudioRecorder();
+            break;
+        case COMMAND_START_RECORD:
+            startRecord(command.path);
+            break;
+        case COMMAND_STOP_RECORD:
+            stopRecord();
+            break;
+        case COMMAND_START_PLAY:
+            startPlay(command.path, command.from);
+            break;
+        case COMMAND_STOP_PLAY:
+            stopPlay();
+            break;
+        case COMMAND_SEEK_PLAY:
+            seekPlay(command.from);
+            break;
+        case COMMAND_SET_PLAY_LOOP:
+            setPlayLoop(command.from, command.to);
+            break;
+        case COMMAND_QUEUE_PLAY:
+            queuePlay(command.path);
+            break;
+        case COMMAND_PLAY_DONE:
+            finishPlay(command.session);
+            break;
+        case COMMAND_START_MONITOR:
+            startMonitor();
+            break;
+        case COMMAND_STOP_MONITOR:
+            stopMonitor();
+            break;
+        case COMMAND_MEASURE_LATENCY:
+            measureLatency(&result);
+            break;
+        case COMMAND_START_MIXER:
+            startMixer();
+            break;
+        case COMMAND_STOP_MIXER:
+            stopMixer();
+            break;
+        case COMMAND_QUIT:
+            break;
+    }
+}
+
+bool AudioEngine::startAnalysis(AnalysisTap tap, void *memory, size_t bytes, unsigned fftSize) {
+    return tap >= 0 && tap < TAP_COUNT
+           && analyzers_[tap].start(memory, bytes, format_.sampleRate, format_.channels, fftSize);
+}
+
+void AudioEngine::stopAnalysis(AnalysisTap tap) {
+    if (tap >= 0 && tap < TAP_COUNT) {
+        analyzers_[tap].stop();
+    }
+}
+
+void AudioEngine::setMappedPlayback(bool mapped) {
+    // takes effect on the next startPlay
+    playerSourceMode_ = mapped ? PlaybackStream::SOURCE_MAPPED : PlaybackStream::SOURCE_STREAM;
+}
+
+void AudioEngine::getStats(long long *snapshot) const {
+    long long *recorder = snapshot;
+    recorderStats_.snapshot(recorder);
+    recorder[STATS_OVERRUNS] = captureStream_.overruns();
+    recorder[STATS_BYTES] = captureStream_.bytesWritten();
+
+    long long *player = snapshot + STATS_FIELD_COUNT;
+    playerStats_.snapshot(player);
+    player[STATS_UNDERRUNS] = playbackStream_.underruns();
+    player[STATS_BYTES] = playbackStream_.bytesRead();
+}
@@ -0,0 +1,329 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_AUDIOENGINE_H
+#define NATIVEFEEDBACK_AUDIOENGINE_H
+
+#include <semaphore.h>
+
+#include <atomic>
+#include <thread>
+
+#include "AudioBackend.h"
+#include "AudioStats.h"
+#include "CaptureStream.h"
+#include "CpuBudget.h"
+#include "DuplexMonitor.h"
+#include "FeedbackSuppressor.h"
+#include "LatencyProbe.h"
+#include "Mixer.h"
+#include "MpscQueue.h"
+#include "PlaybackStream.h"
+#include "SpectrumAnalyzer.h"
+#include "StreamPool.h"
+
+// recordings are 44.1 kHz mono, 16-bit signed little endian. Every buffer is
+// a whole number of device bursts; DEFAULT_FRAMES_PER_BURST stands in until
+// configure() gets the real one.
+#define FILE_SAMPLE_RATE 44100
+#define DEFAULT_FRAMES_PER_BURST 256
+
+// streaming capture: RECORDER_QUEUE_DEPTH buffers of about
+// RECORDER_TARGET_FRAMES (~23ms) stay enqueued on the recorder while the rest
+// of the pool gives the writer thread ~0.6s of slack to get them to disk
+#define RECORDER_TARGET_FRAMES 1024
+#define RECORDER_QUEUE_DEPTH 4
+#define RECORDER_POOL_BUFFERS 32
+
+// prefetching playback: the player queue holds one-burst buffers while the
+// reader thread keeps the pool filled ahead. The fast mixer pulls a burst
+// at a time so double buffering is enough there; the normal mixer pulls
+// bigger chunks and gets a deeper queue.
+#define PLAYER_QUEUE_DEPTH 4
+#define PLAYER_QUEUE_DEPTH_FAST 2
+#define PLAYER_POOL_BUFFERS 64
+
+// monitoring: bursts of slack the jitter buffer keeps between the recorder
+// and the player, on top of the burst the player is about to take
+#define MONITOR_JITTER_BURSTS 1
+
+// commands queued for the control thread; paths longer than this are refused
+#define ENGINE_COMMAND_QUEUE_DEPTH 16
+#define ENGINE_PATH_MAX 512
+
+// One session at a time: recording, playing and the duplex modes exclude
+// each other. A session is claimed by moving the state out of STATE_IDLE
+// with a compare-and-swap and handed back through STATE_STOPPING, so
+// whichever thread ends it, nothing is ever unlocked by a thread that
+// didn't lock it and a request that loses the race fails instead of
+// waiting.
+enum EngineState {
+    STATE_IDLE = 0,
+    STATE_RECORDING,
+    STATE_PLAYING,
+    // the monitor
+    STATE_DUPLEX,
+    // the latency probe
+    STATE_MEASURING,
+    // a session is being torn down
+    STATE_STOPPING,
+    // the mixer
+    STATE_MIXING,
+    // configure() or createAudioRecorder() is rebuilding the streams
+    STATE_CONFIGURING,
+};
+
+enum EngineCommandType {
+    // from and to carry the native rate and the frames per burst
+    COMMAND_CONFIGURE,
+    COMMAND_CREATE_RECORDER,
+    COMMAND_START_RECORD,
+    COMMAND_STOP_RECORD,
+    COMMAND_START_PLAY,
+    COMMAND_STOP_PLAY,
+    COMMAND_SEEK_PLAY,
+    COMMAND_SET_PLAY_LOOP,
+    COMMAND_QUEUE_PLAY,
+    // posted by the player callback when the file has played out
+    COMMAND_PLAY_DONE,
+    COMMAND_START_MONITOR,
+    COMMAND_STOP_MONITOR,
+    COMMAND_MEASURE_LATENCY,
+    COMMAND_START_MIXER,
+    COMMAND_STOP_MIXER,
+    COMMAND_QUIT,
+};
+
+// where an analyzer listens: what the recorder captured, before the record
+// gain, or what the player is about to play
+enum AnalysisTap {
+    TAP_CAPTURE = 0,
+    TAP_PLAYBACK,
+    TAP_COUNT,
+};
+
+struct EngineCommand {
+    EngineCommandType type;
+    // COMMAND_PLAY_DONE: the playback it is about
+    unsigned session;
+    char path[ENGINE_PATH_MAX];
+    // file frames: where COMMAND_START_PLAY starts, where COMMAND_SEEK_PLAY
+    // goes, the loop of COMMAND_SET_PLAY_LOOP
+    unsigned long long from;
+    unsigned long long to;
+};
+
+// Record and playback sessions on top of an AudioBackend. Everything here
+// is platform independent; the JNI layer drives it with the OpenSL ES
+// backend, host tests and benchmarks with HostBackend. Streams come from a
+// StreamPool over the backend, so a session starts on a stream that's
+// already realized instead of building one.
+//
+// The session calls below open and close files, join threads and wait for
+// devices, so the JNI layer doesn't make them itself: it post()s commands
+// to a control thread that runs them in order, and returns straight away.
+// The audio callbacks only ever post, never block.
+class AudioEngine {
+public:
+    // takes ownership of backend
+    explicit AudioEngine(AudioBackend *backend);
+    ~AudioEngine();
+
+    // queues a command for the control thread, path for the start commands
+    // and file frames for the playback ones. False if the queue is full or
+    // the path too long; whether the command then succeeds shows in state().
+    bool post(EngineCommandType type, const char *path = NULL, unsigned long long from = 0,
+              unsigned long long to = 0);
+    EngineState state() const { return static_cast<EngineState>(state_.load(std::memory_order_acquire)); }
+
+    // builds the recorder the recordings start on; startRecord fails
+    // until it has been called
+    bool createAudioRecorder();
+    bool startRecord(const char *path);
+    void stopRecord();
+
+    // startFrame of the file is the first one played, so a stopped
+    // playback resumes from its playPosition()
+    bool startPlay(const char *path, unsigned long long startFrame = 0);
+    void stopPlay();
+    // jump and loop while playing, false otherwise; see PlaybackStream
+    bool seekPlay(unsigned long long frame);
+    bool setPlayLoop(unsigned long long start, unsigned long long end);
+    // from any thread: plays at speed times the file's pace with the pitch
+    // unchanged, now and in later playbacks. A zero-copy playback keeps to
+    // 1 until it's started again; see PlaybackStream.
+    void setPlaySpeed(float speed) { playbackStream_.setSpeed(speed); }
+    float playSpeed() const { return playbackStream_.speed(); }
+    // plays path right after what's queued before it, with no gap and on
+    // the same player. When idle it starts a playback that can be queued
+    // behind, which reads the file rather than playing the mapping. False
+    // behind a zero-copy playback, or once the last file has played out.
+    bool queuePlay(const char *path);
+    // files of the playback played to the end before the one playing
+    unsigned playTrack() const { return playbackStream_.track(); }
+    // in frames of the file playing or last played, from any thread
+    unsigned long long playPosition() const { return playbackStream_.position(); }
+    unsigned long long playLength() const { return playbackStream_.frames(); }
+    // true once a started playback has played to the end or been stopped
+    // and the engine is idle again
+    bool playFinished() const { return playFinished_.load(std::memory_order_acquire); }
+
+    // recorder block then player block, STATS_FIELD_COUNT fields each
+    static const int STATS_SNAPSHOT_SIZE = 2 * STATS_FIELD_COUNT;
+    void getStats(long long *snapshot) const;
+
+    // takes the device's native output rate and frames per burst (AudioManager
+    // PROPERTY_OUTPUT_SAMPLE_RATE / PROPERTY_OUTPUT_FRAMES_PER_BUFFER) and
+    // sizes every queue from them. The streams then run at the native rate,
+    // resampling to and from FILE_SAMPLE_RATE on the reader and writer
+    // threads, which together with burst-sized buffers puts the player on the
+    // fast mixer path. Returns false if the rate is out of the resampler's
+    // reach and the streams stay at FILE_SAMPLE_RATE, or if a session is
+    // running; the engine is claimed for the whole of it.
+    bool configure(int nativeSampleRate, int framesPerBurst);
+    bool fastPath() const { return fastPath_; }
+    int sampleRate() const { return format_.sampleRate; }
+    int framesPerBurst() const { return framesPerBurst_; }
+    // recorder buffers: the burst multiple closest to RECORDER_TARGET_FRAMES
+    int recorderFramesPerBuffer() const;
+    int playerQueueDepth() const { return fastPath_ ? PLAYER_QUEUE_DEPTH_FAST : PLAYER_QUEUE_DEPTH; }
+    // builds the player and the monitor's recorder for the configured
+    // format ahead of the first session; configure() does it already
+    bool warmUp();
+
+    // full duplex: the mic goes through the monitor processor straight to
+    // the speaker at the native rate. Excludes recording and playback like
+    // they exclude each other.
+    bool startMonitor();
+    void stopMonitor();
+    // call while the monitor is stopped; NULL passes the mic through as is
+    void setMonitorProcessor(DuplexMonitor::Processor processor, void *context) {
+        monitorProcessor_ = processor;
+        monitorContext_ = context;
+    }
+    // notches out feedback howl after the monitor processor, from the next
+    // startMonitor
+    void setFeedbackSuppression(bool enabled) { suppressFeedback_ = enabled; }
+    const DuplexMonitor &monitor() const { return monitor_; }
+    const FeedbackSuppressor &feedbackSuppressor() const { return suppressor_; }
+
+    // plays a test sequence and finds it in the mic: the round trip at the
+    // configured rate and burst size. Blocks for under a second and, like
+    // the monitor, excludes recording and playback. False while busy.
+    bool measureLatency(LatencyResult *result);
+    // the last measurement, from any thread; false if there's none yet
+    bool lastLatency(LatencyResult *result) const;
+
+    // the mixer: any number of files, memory blocks and the mic summed
+    // into one stereo player at the native rate. Sources are added and
+    // removed through mixer() while it runs.
+    bool startMixer();
+    void stopMixer();
+    Mixer &mixer() { return mixer_; }
+    // called by stopMixer() once the mixer has stopped and let go of its
+    // sources, on whichever thread stopped it. Set before the first
+    // startMixer.
+    typedef void (*MixerStopped)(void *context);
+    void setMixerStopped(MixerStopped listener, void *context) {
+        mixerStopped_ = listener;
+        mixerStoppedContext_ = context;
+    }
+
+    void setMappedPlayback(bool mapped);
+    // the device the engine's streams run on, for streams it doesn't
+    // manage; they're pooled like the engine's own
+    StreamPool *backend() { return &pool_; }
+    // linear gain on everything recorded from now on
+    void setRecordGain(float gain) { captureStream_.setGain(gain); }
+    // drops or shortens the silence in recordings from the next startRecord,
+    // see SilenceTrimmer
+    void setSilenceTrimming(const VadConfig &config) { captureStream_.setSilenceTrimming(config); }
+
+    // level meter and spectrum of a stream of the recording and playback
+    // sessions, published into memory as SpectrumAnalyzer describes; runs
+    // across sessions until stopped. Takes the rate configure() set, so
+    // start it again after configuring.
+    bool startAnalysis(AnalysisTap tap, void *memory, size_t bytes, unsigned fftSize);
+    void stopAnalysis(AnalysisTap tap);
+    const SpectrumAnalyzer &analyzer(AnalysisTap tap) const { return analyzers_[tap]; }
+
+    // how close the record, play and monitor callbacks run to their
+    // deadlines, reset with each of those sessions. While it's degraded the
+    // analyzers shrink their FFT and the streams resample at low quality;
+    // configure() it from any thread. The mixer and the latency probe
+    // aren't measured.
+    CpuBudget &budget() { return budget_; }
+    const CpuBudget &budget() const { return budget_; }
+
+    const CaptureStream &capture() const { return captureStream_; }
+    const PlaybackStream &playback() const { return playbackStream_; }
+
+private:
+    static void recorderCallback(AudioStream *stream, void *context);
+    static void playerCallback(AudioStream *stream, void *context);
+    void onRecorderBuffer();
+    void onPlayerBuffer();
+    // the monitor processor followed by the feedback suppressor
+    static void processMonitor(short *samples, unsigned frames, int channels, void *context);
+
+    bool claim(EngineState from, EngineState to);
+    void controlLoop();
+    void run(const EngineCommand &command);
+    // startPlay, with the file read in mode
+    bool startPlay(const char *path, unsigned long long startFrame, PlaybackStream::SourceMode mode);
+    // stopPlay for the session the player callback saw finish
+    void finishPlay(unsigned session);
+    // budget_.reset for a session about to start, before any of its
+    // streams exist
+    void resetBudget(unsigned long long periodNs);
+
+    StreamPool pool_;
+    StreamFormat format_;
+    // a session's, taken from the pool by its start and handed back by its
+    // stop
+    AudioStream *recorder_;
+    AudioStream *player_;
+    // createAudioRecorder() was called, so recordings can start
+    bool recorderReady_;
+
+    // an EngineState
+    std::atomic<int> state_;
+    MpscQueue<EngineCommand> commands_;
+    sem_t commandReady_;
+    std::thread control_;
+    // bumped by every startPlay, so a late COMMAND_PLAY_DONE can't stop
+    // the playback after it
+    std::atomic<unsigned> playSession_;
+
+    // the last LatencyResult as a seqlock, odd while it's being written
+    std::atomic<unsigned> latencySeq_;
+    std::atomic<bool> latencyValid_;
+    std::atomic<int> latencyFrames_;
+    std::atomic<double> latencyMs_;
+    std::atomic<double> latencyConfidence_;
+
+    CaptureStream captureStream_;
+    PlaybackStream playbackStream_;
+    DuplexMonitor monitor_;
+    DuplexMonitor::Processor monitorProcessor_;
+    void *monitorContext_;
+    bool suppressFeedback_;
+    FeedbackSuppressor suppressor_;
+    Mixer mixer_;
+    MixerStopped mixerStopped_;
+    void *mixerStoppedContext_;
+    SpectrumAnalyzer analyzers_[TAP_COUNT];
+    CallbackStats recorderStats_;
+    CallbackStats playerStats_;
+    CpuBudget budget_;
+    int framesPerBurst_;
+    bool fastPath_;
+    // mmap the file and enqueue slices of it in place, no copies or read()
+    // calls on the way to the player
+    PlaybackStream::SourceMode playerSourceMode_;
+    std::atomic<bool> playFinished_;
+    int counter_;
+};
+
+#endif //NATIVEFEEDBACK_AUDIOENGINE_H
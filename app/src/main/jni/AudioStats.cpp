@@ -0,0 +1,113 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "AudioStats.h"
+
+#include <time.h>
+
+#include <climits>
+
+CallbackStats::CallbackStats() {
+    reset(0);
+}
+
+unsigned long long CallbackStats::nowNs() {
+    // vDSO on Linux and Android, no syscall
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+int CallbackStats::bucket(unsigned long long ns) {
+    unsigned long long us = ns >> 10;
+    if (us == 0) {
+        return 0;
+    }
+    int b = 64 - __builtin_clzll(us);
+    return b < STATS_HISTOGRAM_BUCKETS ? b : STATS_HISTOGRAM_BUCKETS - 1;
+}
+
+void CallbackStats::reset(unsigned long long periodNs, unsigned long long startNs) {
+    periodNs_ = periodNs;
+    lastBeginNs_ = 0;
+    startNs_ = startNs != 0 ? startNs : nowNs();
+    firstCallbackNs_.store(0, std::memory_order_relaxed);
+    callbacks_.store(0, std::memory_order_relaxed);
+    totalNs_.store(0, std::memory_order_relaxed);
+    maxNs_.store(0, std::memory_order_relaxed);
+    deadlineMisses_.store(0, std::memory_order_relaxed);
+    maxJitterNs_.store(0, std::memory_order_relaxed);
+    queueDepth_.store(0, std::memory_order_relaxed);
+    queueDepthMin_.store(UINT_MAX, std::memory_order_relaxed);
+    queueDepthMax_.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < STATS_HISTOGRAM_BUCKETS; i++) {
+        durationHistogram_[i].store(0, std::memory_order_relaxed);
+        jitterHistogram_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+// only the audio thread writes these, so a load and a store is enough and
+// cheaper than a compare-exchange loop
+template <typename T>
+static void storeMax(std::atomic<T> &target, T value) {
+    if (value > target.load(std::memory_order_relaxed)) {
+        target.store(value, std::memory_order_relaxed);
+    }
+}
+
+template <typename T>
+static void storeMin(std::atomic<T> &target, T value) {
+    if (value < target.load(std::memory_order_relaxed)) {
+        target.store(value, std::memory_order_relaxed);
+    }
+}
+
+unsigned long long CallbackStats::begin() {
+    unsigned long long now = nowNs();
+    if (lastBeginNs_ != 0) {
+        unsigned long long interval = now - lastBeginNs_;
+        unsigned long long jitter = interval > periodNs_ ? interval - periodNs_
+                                                         : periodNs_ - interval;
+        storeMax(maxJitterNs_, jitter);
+        jitterHistogram_[bucket(jitter)].fetch_add(1, std::memory_order_relaxed);
+    } else {
+        firstCallbackNs_.store(now - startNs_, std::memory_order_relaxed);
+    }
+    lastBeginNs_ = now;
+    return now;
+}
+
+unsigned long long CallbackStats::end(unsigned long long beginNs, unsigned queueDepth) {
+    unsigned long long duration = nowNs() - beginNs;
+    callbacks_.fetch_add(1, std::memory_order_relaxed);
+    totalNs_.fetch_add(duration, std::memory_order_relaxed);
+    storeMax(maxNs_, duration);
+    if (periodNs_ != 0 && duration > periodNs_) {
+        deadlineMisses_.fetch_add(1, std::memory_order_relaxed);
+    }
+    durationHistogram_[bucket(duration)].fetch_add(1, std::memory_order_relaxed);
+    queueDepth_.store(queueDepth, std::memory_order_relaxed);
+    storeMin(queueDepthMin_, queueDepth);
+    storeMax(queueDepthMax_, queueDepth);
+    return duration;
+}
+
+void CallbackStats::snapshot(long long *fields) const {
+    fields[STATS_CALLBACKS] = callbacks_.load(std::memory_order_relaxed);
+    fields[STATS_TOTAL_NS] = totalNs_.load(std::memory_order_relaxed);
+    fields[STATS_MAX_NS] = maxNs_.load(std::memory_order_relaxed);
+    fields[STATS_DEADLINE_MISSES] = deadlineMisses_.load(std::memory_order_relaxed);
+    fields[STATS_MAX_JITTER_NS] = maxJitterNs_.load(std::memory_order_relaxed);
+    fields[STATS_UNDERRUNS] = 0;
+    fields[STATS_OVERRUNS] = 0;
+    fields[STATS_QUEUE_DEPTH] = queueDepth_.load(std::memory_order_relaxed);
+    unsigned depthMin = queueDepthMin_.load(std::memory_order_relaxed);
+    fields[STATS_QUEUE_DEPTH_MIN] = depthMin == UINT_MAX ? 0 : depthMin;
+    fields[STATS_QUEUE_DEPTH_MAX] = queueDepthMax_.load(std::memory_order_relaxed);
+    fields[STATS_BYTES] = 0;
+    fields[STATS_FIRST_CALLBACK_NS] = firstCallbackNs_.load(std::memory_order_relaxed);
+    for (int i = 0; i < STATS_HISTOGRAM_BUCKETS; i++) {
+        fields[STATS_DURATION_HISTOGRAM + i] = durationHistogram_[i].load(std::memory_order_relaxed);
+        fields[STATS_JITTER_HISTOGRAM + i] = jitterHistogram_[i].load(std::memory_order_relaxed);
+    }
+}
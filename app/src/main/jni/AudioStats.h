@@ -0,0 +1,82 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_AUDIOSTATS_H
+#define NATIVEFEEDBACK_AUDIOSTATS_H
+
+#include <atomic>
+
+// Layout of one stream's block in a stats snapshot, the long[] returned by
+// OpenSLEngine.getStats(). Durations are in nanoseconds. Histogram bucket 0
+// counts values under 1us and bucket k values under 2^k us (in 1024ns units),
+// the last bucket everything above.
+static const int STATS_HISTOGRAM_BUCKETS = 16;
+
+enum StatsField {
+    STATS_CALLBACKS = 0,
+    STATS_TOTAL_NS,
+    STATS_MAX_NS,
+    // callbacks that ran longer than one buffer period
+    STATS_DEADLINE_MISSES,
+    // |interval between callbacks - buffer period|
+    STATS_MAX_JITTER_NS,
+    STATS_UNDERRUNS,
+    STATS_OVERRUNS,
+    // buffers waiting between the callback and the reader/writer thread
+    STATS_QUEUE_DEPTH,
+    STATS_QUEUE_DEPTH_MIN,
+    STATS_QUEUE_DEPTH_MAX,
+    // bytes read from the file for playback, written to the file for capture
+    STATS_BYTES,
+    STATS_DURATION_HISTOGRAM,
+    STATS_JITTER_HISTOGRAM = STATS_DURATION_HISTOGRAM + STATS_HISTOGRAM_BUCKETS,
+    // from the start request to the first callback, 0 until there's been one
+    STATS_FIRST_CALLBACK_NS = STATS_JITTER_HISTOGRAM + STATS_HISTOGRAM_BUCKETS,
+    STATS_FIELD_COUNT,
+};
+
+// Timing and health counters for one buffer queue callback. begin()/end()
+// run on the audio thread and only do relaxed atomic updates: no locks, no
+// allocation and no syscalls, so it stays on in release builds. snapshot()
+// may run on any thread at any time.
+class CallbackStats {
+public:
+    CallbackStats();
+
+    // starts a new session; periodNs is the duration of one buffer and
+    // startNs the nowNs() the session was asked for, 0 for now.
+    // Only call while the stream's callback isn't running.
+    void reset(unsigned long long periodNs, unsigned long long startNs = 0);
+
+    // call first thing in the callback, pass the result to end(), which
+    // returns how long the callback took
+    unsigned long long begin();
+    unsigned long long end(unsigned long long beginNs, unsigned queueDepth);
+
+    void snapshot(long long *fields) const;
+
+    static unsigned long long nowNs();
+
+private:
+    static int bucket(unsigned long long ns);
+
+    unsigned long long periodNs_;
+    // previous callback start, only touched by the audio thread
+    unsigned long long lastBeginNs_;
+    unsigned long long startNs_;
+
+    std::atomic<unsigned long long> callbacks_;
+    std::atomic<unsigned long long> totalNs_;
+    std::atomic<unsigned long long> maxNs_;
+    std::atomic<unsigned long long> deadlineMisses_;
+    std::atomic<unsigned long long> maxJitterNs_;
+    std::atomic<unsigned long long> firstCallbackNs_;
+    std::atomic<unsigned> queueDepth_;
+    std::atomic<unsigned> queueDepthMin_;
+    std::atomic<unsigned> queueDepthMax_;
+    std::atomic<unsigned long long> durationHistogram_[STATS_HISTOGRAM_BUCKETS];
+    std::atomic<unsigned long long> jitterHistogram_[STATS_HISTOGRAM_BUCKETS];
+};
+
+#endif //NATIVEFEEDBACK_AUDIOSTATS_H
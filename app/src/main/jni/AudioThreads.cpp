@@ -0,0 +1,128 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "AudioThreads.h"
+
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+
+#define LOG_TAG "NativeAudioThreads"
+
+#include "Log.h"
+
+// the writer and the reader feed the callbacks, so they get the audio
+// threads' priority wherever they run; analysis is only for display and
+// stays off the big cores
+static ThreadPolicy policies[THREAD_ROLE_COUNT] = {
+        {-16, CORES_ANY},
+        {-16, CORES_ANY},
+        {0, CORES_LITTLE},
+};
+static std::mutex policyMutex;
+
+bool CpuTopology::load(const char *root) {
+    maxFreq_.clear();
+    for (int cpu = 0;; cpu++) {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/cpu%d", root, cpu);
+        if (access(path, F_OK) != 0) {
+            break;
+        }
+        unsigned long khz = 0;
+        snprintf(path, sizeof(path), "%s/cpu%d/cpufreq/cpuinfo_max_freq", root, cpu);
+        FILE *file = fopen(path, "r");
+        if (file != NULL) {
+            if (fscanf(file, "%lu", &khz) != 1) {
+                khz = 0;
+            }
+            fclose(file);
+        }
+        maxFreq_.push_back(khz);
+    }
+    return !maxFreq_.empty();
+}
+
+bool CpuTopology::big(int cpu) const {
+    return maxFreq_[cpu] == *std::max_element(maxFreq_.begin(), maxFreq_.end());
+}
+
+bool CpuTopology::little(int cpu) const {
+    return maxFreq_[cpu] == *std::min_element(maxFreq_.begin(), maxFreq_.end());
+}
+
+bool CpuTopology::mask(CoreClass cores, cpu_set_t *set) const {
+    CPU_ZERO(set);
+    bool any = false;
+    for (int cpu = 0; cpu < cpus() && cpu < CPU_SETSIZE; cpu++) {
+        if (cores == CORES_ANY || (cores == CORES_BIG && big(cpu))
+            || (cores == CORES_LITTLE && little(cpu))) {
+            CPU_SET(cpu, set);
+            any = true;
+        }
+    }
+    return any;
+}
+
+void AudioThreads::setPolicy(ThreadRole role, const ThreadPolicy &policy) {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    policies[role] = policy;
+}
+
+ThreadPolicy AudioThreads::policy(ThreadRole role) {
+    std::lock_guard<std::mutex> lock(policyMutex);
+    return policies[role];
+}
+
+const CpuTopology &AudioThreads::topology() {
+    static CpuTopology cpus;
+    static std::once_flag loaded;
+    std::call_once(loaded, [] { cpus.load(); });
+    return cpus;
+}
+
+const char *AudioThreads::roleName(ThreadRole role) {
+    switch (role) {
+        case THREAD_WRITER:
+            return "writer";
+        case THREAD_PREFETCH:
+            return "prefetch";
+        case THREAD_ANALYSIS:
+            return "analysis";
+        default:
+            return "unknown";
+    }
+}
+
+bool AudioThreads::enter(ThreadRole role) {
+    ThreadPolicy p = policy(role);
+    bool ok = true;
+
+    // at most 15 characters
+    char name[16];
+    snprintf(name, sizeof(name), "nf-%s", roleName(role));
+    pthread_setname_np(pthread_self(), name);
+
+    // nice is per thread on Linux, addressed by the kernel thread id
+    pid_t tid = static_cast<pid_t>(syscall(SYS_gettid));
+    if (setpriority(PRIO_PROCESS, tid, p.nice) != 0) {
+        LOGI("%s: nice %d refused", name, p.nice);
+        ok = false;
+    }
+
+    // CORES_ANY leaves the affinity the thread was started with alone, so a
+    // process already confined to some CPUs stays there
+    if (p.cores != CORES_ANY) {
+        cpu_set_t set;
+        if (!topology().mask(p.cores, &set) || sched_setaffinity(0, sizeof(set), &set) != 0) {
+            LOGI("%s: affinity to %s cores refused", name, p.cores == CORES_BIG ? "big" : "little");
+            ok = false;
+        }
+    }
+    return ok;
+}
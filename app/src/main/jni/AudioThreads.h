@@ -0,0 +1,79 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_AUDIOTHREADS_H
+#define NATIVEFEEDBACK_AUDIOTHREADS_H
+
+#include <sched.h>
+
+#include <vector>
+
+// the engine's helper threads, each with its own ThreadPolicy
+enum ThreadRole {
+    // CaptureStream's writer: resampling, encoding and the file
+    THREAD_WRITER = 0,
+    // PlaybackStream's reader or read-ahead
+    THREAD_PREFETCH,
+    // SpectrumAnalyzer's worker
+    THREAD_ANALYSIS,
+    THREAD_ROLE_COUNT,
+};
+
+enum CoreClass {
+    // wherever the scheduler likes
+    CORES_ANY = 0,
+    // the cores with the highest maximum frequency
+    CORES_BIG,
+    // the cores with the lowest
+    CORES_LITTLE,
+};
+
+struct ThreadPolicy {
+    // setpriority() nice value, -20 to 19; Android's audio threads sit at
+    // -16 (ANDROID_PRIORITY_AUDIO)
+    int nice;
+    CoreClass cores;
+};
+
+// The CPUs and which of them are big or little, from the cpufreq maximum
+// frequency of each under a sysfs root. A CPU with no cpufreq reads as 0, so
+// where there's none at all every CPU is both big and little.
+class CpuTopology {
+public:
+    CpuTopology() : maxFreq_() {}
+
+    // false if root has no CPUs
+    bool load(const char *root = "/sys/devices/system/cpu");
+
+    int cpus() const { return static_cast<int>(maxFreq_.size()); }
+    unsigned long maxFreqKhz(int cpu) const { return maxFreq_[cpu]; }
+    bool big(int cpu) const;
+    bool little(int cpu) const;
+    // the CPUs of cores into set, false if there are none
+    bool mask(CoreClass cores, cpu_set_t *set) const;
+
+private:
+    std::vector<unsigned long> maxFreq_;
+};
+
+// Scheduling for the engine's helper threads. The audio callbacks run on
+// threads the platform owns and schedules; everything the engine starts
+// itself calls enter() first thing, which gives the thread its role's nice
+// value, pins it to its cores and names it so it shows in systrace and top.
+// Policies are process wide and picked up by threads started after
+// setPolicy(); the streams and analyzers start theirs with each session.
+class AudioThreads {
+public:
+    static void setPolicy(ThreadRole role, const ThreadPolicy &policy);
+    static ThreadPolicy policy(ThreadRole role);
+    // applies role's policy to the calling thread. False if any of it was
+    // refused, say a negative nice without the permission; the rest still
+    // applies and the thread runs on either way.
+    static bool enter(ThreadRole role);
+    // the device's, read once
+    static const CpuTopology &topology();
+    static const char *roleName(ThreadRole role);
+};
+
+#endif //NATIVEFEEDBACK_AUDIOTHREADS_H
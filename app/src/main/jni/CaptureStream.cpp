@@ -0,0 +1,212 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "CaptureStream.h"
+
+#include <algorithm>
+
+#include "AudioThreads.h"
+#include "PcmConvert.h"
+
+CaptureStream::CaptureStream(int channels, int bufferCount)
+        : channels_(channels),
+          bufferCount_(bufferCount),
+          samplesPerBuffer_(0),
+          freeQueue_(bufferCount),
+          filledQueue_(bufferCount),
+          inFlight_(bufferCount + 1),
+          inFlightHead_(0),
+          inFlightCount_(0),
+          running_(false),
+          overruns_(0),
+          bytesWritten_(0),
+          compressing_(false),
+          trimming_(false),
+          streamRate_(0),
+          fileRate_(0),
+          resampling_(false),
+          budget_(NULL),
+          gain_(1.0f),
+          gains_(channels, 1.0f) {
+    sem_init(&dataReady_, 0, 0);
+}
+
+CaptureStream::~CaptureStream() {
+    close();
+    sem_destroy(&dataReady_);
+}
+
+bool CaptureStream::open(const char *path, int framesPerBuffer) {
+    close();
+    resampling_ = streamRate_ != fileRate_;
+    if (resampling_ && !resampler_.init(streamRate_, fileRate_, channels_)) {
+        return false;
+    }
+    compressing_ = LosslessWriter::isLosslessPath(path);
+    if (compressing_ ? !lossless_.open(path, fileRate_, channels_)
+                     : !writer_.open(path, fileRate_, channels_, WavWriter::isWavPath(path))) {
+        return false;
+    }
+    trimming_ = vad_.enabled;
+    if (trimming_ && !trimmer_.open(SilenceTrimmer::indexPathFor(path).c_str(), fileRate_,
+                                    channels_, vad_, &CaptureStream::trimmed, this)) {
+        if (compressing_) {
+            lossless_.close();
+        } else {
+            writer_.close();
+        }
+        return false;
+    }
+
+    unsigned samples = framesPerBuffer * channels_;
+    if (samples != samplesPerBuffer_) {
+        samplesPerBuffer_ = samples;
+        storage_.assign((bufferCount_ + 1) * samples, 0);
+    }
+    if (resampling_) {
+        resampled_.resize(resampler_.outputFramesFor(framesPerBuffer) * channels_);
+        silence_.assign(resampler_.latencyFrames() * channels_, 0);
+    }
+
+    freeQueue_.reset();
+    filledQueue_.reset();
+    for (int i = 0; i < bufferCount_; i++) {
+        freeQueue_.push(i);
+    }
+    inFlightHead_ = 0;
+    inFlightCount_ = 0;
+    overruns_.store(0, std::memory_order_relaxed);
+    bytesWritten_.store(0, std::memory_order_relaxed);
+
+    running_.store(true, std::memory_order_release);
+    writerThread_ = std::thread(&CaptureStream::writerLoop, this);
+    return true;
+}
+
+bool CaptureStream::close() {
+    if (!writerThread_.joinable()) {
+        return true;
+    }
+    running_.store(false, std::memory_order_release);
+    sem_post(&dataReady_);
+    writerThread_.join();
+    // the trimmer still holds up to a window and its pre-roll
+    bool indexed = !trimming_ || trimmer_.close();
+    bool written = compressing_ ? lossless_.close() : writer_.close();
+    return indexed && written;
+}
+
+void CaptureStream::setSampleRates(int streamRate, int fileRate) {
+    streamRate_ = streamRate;
+    fileRate_ = fileRate;
+}
+
+short *CaptureStream::takeFreeBuffer() {
+    int index;
+    if (!freeQueue_.pop(&index)) {
+        // writer is behind: keep the recorder running on the scratch buffer,
+        // whatever lands in it is dropped
+        index = bufferCount_;
+        overruns_.fetch_add(1, std::memory_order_relaxed);
+    }
+    inFlight_[(inFlightHead_ + inFlightCount_) % inFlight_.size()] = index;
+    inFlightCount_++;
+    return buffer(index);
+}
+
+short *CaptureStream::primeBuffer() {
+    return takeFreeBuffer();
+}
+
+short *CaptureStream::onBufferFilled() {
+    if (inFlightCount_ > 0) {
+        int filled = inFlight_[inFlightHead_];
+        inFlightHead_ = (inFlightHead_ + 1) % inFlight_.size();
+        inFlightCount_--;
+        if (filled != bufferCount_) {
+            // cannot fail: at most bufferCount_ pool buffers exist
+            filledQueue_.push(filled);
+            sem_post(&dataReady_);
+        }
+    }
+    return takeFreeBuffer();
+}
+
+const short *CaptureStream::filledBuffer() const {
+    if (inFlightCount_ == 0) {
+        return NULL;
+    }
+    return &storage_[inFlight_[inFlightHead_] * samplesPerBuffer_];
+}
+
+void CaptureStream::writerLoop() {
+    AudioThreads::enter(THREAD_WRITER);
+    for (;;) {
+        sem_wait(&dataReady_);
+        // the recorder is stopped before close(), so once running_ drops the
+        // drain below picks up the last of its buffers
+        bool stopping = !running_.load(std::memory_order_acquire);
+        int index;
+        while (filledQueue_.pop(&index)) {
+            float gain = gain_.load(std::memory_order_relaxed);
+            if (gain != 1.0f) {
+                // the writer owns the buffer until it goes back on the free queue
+                std::fill(gains_.begin(), gains_.end(), gain);
+                PcmKernels::best().applyGain(buffer(index), samplesPerBuffer_ / channels_,
+                                             channels_, &gains_[0]);
+            }
+            write(buffer(index), samplesPerBuffer_ / channels_);
+            freeQueue_.push(index);
+        }
+        if (stopping) {
+            break;
+        }
+    }
+    if (resampling_) {
+        // push the tail of the last buffer through the filter
+        write(&silence_[0], silence_.size() / channels_);
+        resampler_.reset();
+    }
+}
+
+void CaptureStream::write(const short *samples, size_t frames) {
+    if (!resampling_) {
+        trim(samples, frames);
+        return;
+    }
+    if (budget_ != NULL) {
+        resampler_.setQuality(budget_->level() >= CPU_BUDGET_RESAMPLER_LEVEL ? Resampler::QUALITY_LOW
+                                                                             : Resampler::QUALITY_HIGH);
+    }
+    while (frames > 0) {
+        size_t consumed;
+        size_t n = resampler_.process(samples, frames, &consumed, &resampled_[0],
+                                      resampled_.size() / channels_);
+        trim(&resampled_[0], n);
+        samples += consumed * channels_;
+        frames -= consumed;
+    }
+}
+
+void CaptureStream::trim(const short *samples, size_t frames) {
+    if (trimming_) {
+        // the trimmer calls back into writeFile with what it keeps
+        trimmer_.write(samples, frames);
+    } else {
+        writeFile(samples, frames);
+    }
+}
+
+void CaptureStream::trimmed(const short *samples, size_t frames, void *context) {
+    static_cast<CaptureStream *>(context)->writeFile(samples, frames);
+}
+
+void CaptureStream::writeFile(const short *samples, size_t frames) {
+    if (compressing_) {
+        // encoding happens here, on the writer thread, a block at a time
+        lossless_.write(samples, frames);
+    } else {
+        writer_.write(samples, frames * channels_ * sizeof(short));
+    }
+    bytesWritten_.fetch_add(frames * channels_ * sizeof(short), std::memory_order_relaxed);
+}
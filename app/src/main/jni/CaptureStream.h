@@ -0,0 +1,132 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_CAPTURESTREAM_H
+#define NATIVEFEEDBACK_CAPTURESTREAM_H
+
+#include <semaphore.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "CpuBudget.h"
+#include "LosslessFile.h"
+#include "Resampler.h"
+#include "SpscQueue.h"
+#include "VoiceActivity.h"
+#include "WavFile.h"
+
+// Streaming capture for the buffer queue recorder.
+//
+// A fixed pool of small buffers rotates between the recorder queue and a
+// writer thread: the recorder callback hands each filled buffer to the writer
+// and immediately gets the next empty one to enqueue, so recording can run
+// for any length with constant memory and no file I/O on the audio thread.
+// If the writer falls so far behind that the pool is empty, the callback
+// keeps the recorder fed with a scratch buffer and counts an overrun.
+//
+// When the recorder runs at a different rate than the files, the writer
+// thread resamples each buffer on its way to disk. A path ending in .wav
+// gets a WAV (RF64 past 4 GB) file whose header stays valid while it's
+// being written, one ending in .nfla is compressed losslessly by the writer
+// thread (see LosslessCodec.h), anything else gets raw PCM.
+//
+// With silence trimming on, the writer thread also runs every buffer through
+// a SilenceTrimmer: stretches without voice are dropped or shortened before
+// they reach the file, and path + ".vad" gets the index that maps the file's
+// frames back to when they were captured.
+class CaptureStream {
+public:
+    CaptureStream(int channels, int bufferCount);
+    ~CaptureStream();
+
+    // opens the destination file and starts the writer thread; the recorder
+    // gets buffers of framesPerBuffer
+    bool open(const char *path, int framesPerBuffer);
+    // drains everything already captured to disk, stops the writer thread
+    // and finishes the file; the recorder must be stopped first. False if
+    // any of it didn't make it to disk.
+    bool close();
+    // rate of the recorder and of the files, used from the next open()
+    void setSampleRates(int streamRate, int fileRate);
+    // linear gain the writer applies before anything reaches the file,
+    // clipping; can change while recording
+    void setGain(float gain) { gain_.store(gain, std::memory_order_relaxed); }
+    // voice activity gating of what's written, used from the next open()
+    void setSilenceTrimming(const VadConfig &config) { vad_ = config; }
+    // the writer resamples at low quality while budget is degraded past
+    // CPU_BUDGET_RESAMPLER_LEVEL; set while closed, NULL for full quality
+    void setBudget(const CpuBudget *budget) { budget_ = budget; }
+
+    // an empty buffer for priming the recorder queue before it starts
+    short *primeBuffer();
+    // recorder callback: the oldest enqueued buffer is full, returns the next
+    // buffer to enqueue. Never blocks or allocates.
+    short *onBufferFilled();
+    // recorder callback, before onBufferFilled(): the buffer that just
+    // filled, untouched by the writer until it's handed over; NULL if none
+    const short *filledBuffer() const;
+
+    unsigned bufferBytes() const { return samplesPerBuffer_ * sizeof(short); }
+    unsigned overruns() const { return overruns_.load(std::memory_order_relaxed); }
+    // filled buffers the writer hasn't got to yet
+    unsigned pendingBuffers() const { return static_cast<unsigned>(filledQueue_.size()); }
+    // PCM bytes handed to the file, after silence trimming and before any
+    // compression
+    unsigned long long bytesWritten() const { return bytesWritten_.load(std::memory_order_relaxed); }
+    // frames, at the file rate, silence trimming kept out of the file
+    unsigned long long trimmedFrames() const { return trimming_ ? trimmer_.droppedFrames() : 0; }
+
+private:
+    void writerLoop();
+    short *buffer(int index) { return &storage_[index * samplesPerBuffer_]; }
+    short *takeFreeBuffer();
+    // writes frames of the recorder's rate to the file
+    void write(const short *samples, size_t frames);
+    // frames at the file rate, through the trimmer if it's on
+    void trim(const short *samples, size_t frames);
+    void writeFile(const short *samples, size_t frames);
+    static void trimmed(const short *samples, size_t frames, void *context);
+
+    const int channels_;
+    const int bufferCount_;
+    unsigned samplesPerBuffer_;
+    // bufferCount_ pool buffers followed by the scratch buffer
+    std::vector<short> storage_;
+    SpscQueue<int> freeQueue_;   // writer -> callback
+    SpscQueue<int> filledQueue_; // callback -> writer
+
+    // buffers currently owned by the recorder queue, in enqueue order;
+    // only touched by the priming thread before start and the callback after
+    std::vector<int> inFlight_;
+    unsigned inFlightHead_;
+    unsigned inFlightCount_;
+
+    sem_t dataReady_;
+    std::thread writerThread_;
+    std::atomic<bool> running_;
+    std::atomic<unsigned> overruns_;
+    std::atomic<unsigned long long> bytesWritten_;
+    WavWriter writer_;
+    LosslessWriter lossless_;
+    bool compressing_;
+    VadConfig vad_;
+    bool trimming_;
+    SilenceTrimmer trimmer_;
+
+    int streamRate_;
+    int fileRate_;
+    bool resampling_;
+    Resampler resampler_;
+    const CpuBudget *budget_;
+    // writer thread only
+    std::vector<short> resampled_;
+    std::vector<short> silence_;
+    std::atomic<float> gain_;
+    // gain_ for every channel, writer thread only
+    std::vector<float> gains_;
+};
+
+#endif //NATIVEFEEDBACK_CAPTURESTREAM_H
@@ -0,0 +1,79 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "CpuBudget.h"
+
+#include <algorithm>
+
+CpuBudget::CpuBudget()
+        : periodNs_(0),
+          fraction_(CPU_BUDGET_DEFAULT_FRACTION),
+          windowBursts_(CPU_BUDGET_DEFAULT_WINDOW),
+          windowNs_(0),
+          bursts_(0),
+          quietWindows_(0),
+          level_(0),
+          load_(0),
+          overBudget_(0),
+          degradations_(0),
+          recoveries_(0) {
+}
+
+void CpuBudget::configure(double fraction, unsigned windowBursts) {
+    fraction_.store(fraction, std::memory_order_relaxed);
+    windowBursts_.store(std::max(1u, windowBursts), std::memory_order_relaxed);
+}
+
+void CpuBudget::reset(unsigned long long periodNs) {
+    periodNs_ = periodNs;
+    windowNs_ = 0;
+    bursts_ = 0;
+    quietWindows_ = 0;
+    level_.store(0, std::memory_order_relaxed);
+    load_.store(0, std::memory_order_relaxed);
+    overBudget_.store(0, std::memory_order_relaxed);
+    degradations_.store(0, std::memory_order_relaxed);
+    recoveries_.store(0, std::memory_order_relaxed);
+}
+
+void CpuBudget::setLevel(int level) {
+    level_.store(std::min(std::max(level, 0), CPU_BUDGET_MAX_LEVEL), std::memory_order_relaxed);
+}
+
+void CpuBudget::record(unsigned long long busyNs) {
+    if (periodNs_ == 0) {
+        return;
+    }
+    if (busyNs > periodNs_ * fraction_.load(std::memory_order_relaxed)) {
+        overBudget_.fetch_add(1, std::memory_order_relaxed);
+    }
+    windowNs_ += busyNs;
+    if (++bursts_ >= windowBursts_.load(std::memory_order_relaxed)) {
+        decide();
+    }
+}
+
+void CpuBudget::decide() {
+    double load = static_cast<double>(windowNs_) / (static_cast<double>(periodNs_) * bursts_);
+    double fraction = fraction_.load(std::memory_order_relaxed);
+    load_.store(load, std::memory_order_relaxed);
+    windowNs_ = 0;
+    bursts_ = 0;
+
+    int level = level_.load(std::memory_order_relaxed);
+    if (load > fraction) {
+        quietWindows_ = 0;
+        if (level < CPU_BUDGET_MAX_LEVEL) {
+            level_.store(level + 1, std::memory_order_relaxed);
+            degradations_.fetch_add(1, std::memory_order_relaxed);
+        }
+    } else if (load < fraction / 2 && level > 0) {
+        if (++quietWindows_ >= CPU_BUDGET_RECOVER_WINDOWS) {
+            quietWindows_ = 0;
+            level_.store(level - 1, std::memory_order_relaxed);
+            recoveries_.fetch_add(1, std::memory_order_relaxed);
+        }
+    } else {
+        quietWindows_ = 0;
+    }
+}
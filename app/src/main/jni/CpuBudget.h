@@ -0,0 +1,82 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_CPUBUDGET_H
+#define NATIVEFEEDBACK_CPUBUDGET_H
+
+#include <atomic>
+
+// share of each burst period the callback work may take before the optional
+// stages give way, and how many bursts one decision averages over
+#define CPU_BUDGET_DEFAULT_FRACTION 0.5
+#define CPU_BUDGET_DEFAULT_WINDOW 32
+// windows in a row under half the budget before a level is given back
+#define CPU_BUDGET_RECOVER_WINDOWS 4
+// level 0 runs everything at full quality; each level halves the analyzer
+// FFT, and from CPU_BUDGET_RESAMPLER_LEVEL the resamplers run QUALITY_LOW
+#define CPU_BUDGET_MAX_LEVEL 3
+#define CPU_BUDGET_RESAMPLER_LEVEL 2
+
+// Watches how much of each burst period the audio callback spends and
+// degrades the optional DSP stages while it's running close to its deadline.
+//
+// The callback reports how long every burst took with record(), which only
+// adds to a window and, once the window is full, compares its average load
+// with the budget: over it, the level goes up one; under half of it for
+// CPU_BUDGET_RECOVER_WINDOWS windows in a row, down one. Nothing in it
+// blocks, allocates or makes a syscall. The stages that can give way poll
+// level() from their own threads and step down or back up on their next
+// round, so the callback never waits on them; the level only changes once
+// per window, which keeps them from flapping.
+class CpuBudget {
+public:
+    CpuBudget();
+
+    // from any thread, taking effect from the next window; fraction of the
+    // period, windowBursts of at least 1
+    void configure(double fraction, unsigned windowBursts);
+    // starts a session of bursts periodNs long back at level 0. Only call
+    // while nothing is recording: the window is plain fields, so every
+    // stream that calls record() has to be gone, its callback returned.
+    void reset(unsigned long long periodNs);
+
+    // audio callback, one thread at a time: a burst took busyNs
+    void record(unsigned long long busyNs);
+
+    int level() const { return level_.load(std::memory_order_relaxed); }
+    // pins the level until the next reset() or decision, for tests and for
+    // running degraded on purpose
+    void setLevel(int level);
+    // average share of the period the last window took
+    double load() const { return load_.load(std::memory_order_relaxed); }
+    double fraction() const { return fraction_.load(std::memory_order_relaxed); }
+    // bursts that took more than the budget on their own, and level changes
+    unsigned long long overBudget() const { return overBudget_.load(std::memory_order_relaxed); }
+    unsigned degradations() const { return degradations_.load(std::memory_order_relaxed); }
+    unsigned recoveries() const { return recoveries_.load(std::memory_order_relaxed); }
+
+private:
+    CpuBudget(const CpuBudget &);
+    CpuBudget &operator=(const CpuBudget &);
+
+    // the end of a window
+    void decide();
+
+    unsigned long long periodNs_;
+    std::atomic<double> fraction_;
+    std::atomic<unsigned> windowBursts_;
+
+    // callback only
+    unsigned long long windowNs_;
+    unsigned bursts_;
+    unsigned quietWindows_;
+
+    std::atomic<int> level_;
+    std::atomic<double> load_;
+    std::atomic<unsigned long long> overBudget_;
+    std::atomic<unsigned> degradations_;
+    std::atomic<unsigned> recoveries_;
+};
+
+#endif //NATIVEFEEDBACK_CPUBUDGET_H
@@ -0,0 +1,319 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "DuplexMonitor.h"
+
+#include <cstring>
+
+#define LOG_TAG "NativeDuplexMonitor"
+
+#include "AudioStats.h"
+#include "Log.h"
+
+// weight of each new sample in the level, latency and period averages
+static const double AVERAGE_WEIGHT = 1.0 / 32;
+// bursts the player runs after priming before it takes its setpoint
+static const unsigned SETTLE_BURSTS = 32;
+
+DuplexMonitor::DuplexMonitor(AudioBackend *backend)
+        : backend_(backend), recorder_(NULL), player_(NULL), processor_(NULL),
+          processorContext_(NULL), budget_(NULL), channels_(0), sampleRate_(0),
+          framesPerBurst_(0), playerQueueDepth_(0), targetFrames_(0), recorderNext_(0), playerNext_(0),
+          captureSeq_(0), capturedFrames_(0), captureNs_(0), playedFrames_(0),
+          owedFrames_(0), lastPlayNs_(0), periodNs_(0), averageLevel_(0), setpoint_(0), settledBursts_(0),
+          averageLatencyNs_(0), primed_(false), latencyNs_(0),
+          maxLatencyNs_(0), level_(0), underruns_(0), framesDropped_(0), framesInserted_(0) {}
+
+DuplexMonitor::~DuplexMonitor() {
+    stop();
+}
+
+void DuplexMonitor::setProcessor(Processor processor, void *context) {
+    processor_ = processor;
+    processorContext_ = context;
+}
+
+bool DuplexMonitor::start(const StreamFormat &format, int framesPerBurst, int playerQueueDepth,
+                          int jitterBursts) {
+    stop();
+    if (framesPerBurst <= 1 || format.channels <= 0 || playerQueueDepth <= 0
+        || jitterBursts < 0) {
+        return false;
+    }
+    channels_ = format.channels;
+    sampleRate_ = format.sampleRate;
+    framesPerBurst_ = static_cast<unsigned>(framesPerBurst);
+    playerQueueDepth_ = playerQueueDepth;
+    targetFrames_ = jitterBursts * framesPerBurst_;
+
+    // room for the target, the burst being taken and enough slack that a
+    // callback coming a few bursts late doesn't make the recorder drop
+    size_t frameBytes = channels_ * sizeof(short);
+    size_t capacity = 1;
+    while (capacity < (targetFrames_ + 8 * framesPerBurst_) * frameBytes) {
+        capacity *= 2;
+    }
+    jitterMemory_.assign((SharedPcmRing::HEADER_BYTES + capacity) / sizeof(unsigned), 0);
+    jitter_.attach(&jitterMemory_[0], jitterMemory_.size() * sizeof(unsigned));
+
+    unsigned burstSamples = framesPerBurst_ * channels_;
+    recorderBuffers_.assign(MONITOR_RECORDER_QUEUE_DEPTH * burstSamples, 0);
+    playerBuffers_.assign(playerQueueDepth_ * burstSamples, 0);
+    scratch_.assign((framesPerBurst_ + 1) * channels_, 0);
+    recorderNext_ = 0;
+    playerNext_ = 0;
+
+    captureSeq_.store(0, std::memory_order_relaxed);
+    capturedFrames_.store(0, std::memory_order_relaxed);
+    captureNs_.store(0, std::memory_order_relaxed);
+    playedFrames_ = 0;
+    owedFrames_ = 0;
+    lastPlayNs_ = 0;
+    periodNs_ = 0;
+    averageLevel_ = 0;
+    setpoint_ = 0;
+    settledBursts_ = 0;
+    averageLatencyNs_ = 0;
+    primed_ = false;
+    latencyNs_.store(0, std::memory_order_relaxed);
+    maxLatencyNs_.store(0, std::memory_order_relaxed);
+    level_.store(0, std::memory_order_relaxed);
+    underruns_.store(0, std::memory_order_relaxed);
+    framesDropped_.store(0, std::memory_order_relaxed);
+    framesInserted_.store(0, std::memory_order_relaxed);
+
+    recorder_ = backend_->createRecorder(format, MONITOR_RECORDER_QUEUE_DEPTH);
+    player_ = backend_->createPlayer(format, playerQueueDepth_);
+    if (recorder_ == NULL || player_ == NULL
+        || !recorder_->registerCallback(recorderCallback, this)
+        || !player_->registerCallback(playerCallback, this)) {
+        LOGI("can't create the monitor streams");
+        stop();
+        return false;
+    }
+
+    unsigned burstBytes = burstSamples * sizeof(short);
+    for (int i = 0; i < MONITOR_RECORDER_QUEUE_DEPTH; i++) {
+        recorder_->enqueue(&recorderBuffers_[i * burstSamples], burstBytes);
+    }
+    // the player starts on silence and picks up the mic once the jitter
+    // buffer has reached its level
+    for (int i = 0; i < playerQueueDepth_; i++) {
+        player_->enqueue(&playerBuffers_[i * burstSamples], burstBytes);
+    }
+    if (!recorder_->start() || !player_->start()) {
+        LOGI("can't start the monitor streams");
+        stop();
+        return false;
+    }
+    return true;
+}
+
+void DuplexMonitor::stop() {
+    // the jitter buffer stays attached so stats() still reads after a stop
+    if (recorder_ != NULL) {
+        recorder_->stop();
+        delete recorder_;
+        recorder_ = NULL;
+    }
+    if (player_ != NULL) {
+        player_->stop();
+        delete player_;
+        player_ = NULL;
+    }
+}
+
+MonitorStats DuplexMonitor::stats() const {
+    MonitorStats stats;
+    stats.latencyMs = latencyNs_.load(std::memory_order_relaxed) / 1e6;
+    stats.maxLatencyMs = maxLatencyNs_.load(std::memory_order_relaxed) / 1e6;
+    stats.jitterFrames = level_.load(std::memory_order_relaxed);
+    stats.underruns = underruns_.load(std::memory_order_relaxed);
+    stats.overruns = jitter_.attached() ? jitter_.dropped() : 0;
+    stats.framesDropped = framesDropped_.load(std::memory_order_relaxed);
+    stats.framesInserted = framesInserted_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void DuplexMonitor::recorderCallback(AudioStream *stream, void *context) {
+    static_cast<DuplexMonitor *>(context)->onCaptured();
+}
+
+void DuplexMonitor::playerCallback(AudioStream *stream, void *context) {
+    static_cast<DuplexMonitor *>(context)->onPlayed();
+}
+
+void DuplexMonitor::onCaptured() {
+    unsigned long long begin = budget_ != NULL ? CallbackStats::nowNs() : 0;
+    unsigned burstSamples = framesPerBurst_ * channels_;
+    short *filled = &recorderBuffers_[recorderNext_ * burstSamples];
+    if (processor_ != NULL) {
+        processor_(filled, framesPerBurst_, channels_, processorContext_);
+    }
+    // a full jitter buffer drops the burst and counts an overrun
+    if (jitter_.write(filled, burstSamples * sizeof(short))) {
+        unsigned seq = captureSeq_.load(std::memory_order_relaxed);
+        captureSeq_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        capturedFrames_.store(capturedFrames_.load(std::memory_order_relaxed) + framesPerBurst_,
+                              std::memory_order_relaxed);
+        captureNs_.store(CallbackStats::nowNs(), std::memory_order_relaxed);
+        captureSeq_.store(seq + 2, std::memory_order_release);
+    }
+    recorder_->enqueue(filled, burstSamples * sizeof(short));
+    recorderNext_ = (recorderNext_ + 1) % MONITOR_RECORDER_QUEUE_DEPTH;
+    if (budget_ != NULL) {
+        budget_->record(CallbackStats::nowNs() - begin);
+    }
+}
+
+void DuplexMonitor::onPlayed() {
+    unsigned long long now = CallbackStats::nowNs();
+    // the device's burst period as the player sees it, which is what the
+    // recorder's progress between its callbacks is measured against. A
+    // stall and the burst of callbacks catching up after it say nothing
+    // about the period and are left out.
+    if (lastPlayNs_ != 0) {
+        double interval = static_cast<double>(now - lastPlayNs_);
+        if (periodNs_ == 0) {
+            periodNs_ = interval;
+        } else if (interval > periodNs_ / 2 && interval < periodNs_ * 2) {
+            periodNs_ += (interval - periodNs_) * AVERAGE_WEIGHT;
+        }
+    }
+    lastPlayNs_ = now;
+
+    unsigned burstSamples = framesPerBurst_ * channels_;
+    short *played = &playerBuffers_[playerNext_ * burstSamples];
+    render(played, now);
+    player_->enqueue(played, burstSamples * sizeof(short));
+    playerNext_ = (playerNext_ + 1) % playerQueueDepth_;
+}
+
+void DuplexMonitor::render(short *out, unsigned long long now) {
+    size_t frameBytes = channels_ * sizeof(short);
+    unsigned burstBytes = framesPerBurst_ * frameBytes;
+    unsigned long long captured, capturedNs;
+    lastCapture(&captured, &capturedNs);
+    unsigned available = static_cast<unsigned>(captured - playedFrames_);
+    if (!primed_) {
+        if (available < framesPerBurst_ + targetFrames_ || periodNs_ == 0) {
+            memset(out, 0, burstBytes);
+            return;
+        }
+        primed_ = true;
+    }
+    if (available < framesPerBurst_) {
+        // the recorder is late: play what there is and owe the rest, so the
+        // late frames are skipped when they come instead of pushing
+        // everything after them back by the gap
+        underruns_.fetch_add(1, std::memory_order_relaxed);
+        jitter_.read(out, available * frameBytes);
+        memset(out + available * channels_, 0, (framesPerBurst_ - available) * frameBytes);
+        playedFrames_ += available;
+        owedFrames_ += framesPerBurst_ - available;
+        return;
+    }
+    if (owedFrames_ > 0) {
+        unsigned skip = available - framesPerBurst_;
+        skip = skip < owedFrames_ ? skip : owedFrames_;
+        for (unsigned left = skip; left > 0;) {
+            unsigned n = left < framesPerBurst_ ? left : framesPerBurst_;
+            jitter_.read(&scratch_[0], n * frameBytes);
+            left -= n;
+        }
+        playedFrames_ += skip;
+        owedFrames_ -= skip;
+        available -= skip;
+    }
+
+    // the jitter buffer only grows a burst at a time, which depending on
+    // which callback happens to run first makes its level jump by a whole
+    // burst. Counting the part of the next burst the recorder has already
+    // captured since its last callback gives a level that only moves with
+    // the drift between the two clocks.
+    // (the recorder may have called back since now was taken)
+    double sinceCapture = (static_cast<double>(now) - capturedNs) / periodNs_;
+    if (sinceCapture < 0) {
+        sinceCapture = 0;
+    } else if (sinceCapture > 1) {
+        sinceCapture = 1;
+    }
+    double level = static_cast<double>(available) - owedFrames_ - framesPerBurst_
+                   + sinceCapture * framesPerBurst_;
+    unsigned take = framesPerBurst_;
+    if (settledBursts_ < SETTLE_BURSTS) {
+        averageLevel_ = settledBursts_ == 0 ? level
+                                            : averageLevel_ + (level - averageLevel_) * AVERAGE_WEIGHT;
+        if (++settledBursts_ == SETTLE_BURSTS) {
+            setpoint_ = averageLevel_;
+        }
+    } else {
+        averageLevel_ += (level - averageLevel_) * AVERAGE_WEIGHT;
+        double margin = framesPerBurst_ / 4.0;
+        if (averageLevel_ > setpoint_ + margin && available > framesPerBurst_) {
+            take = framesPerBurst_ + 1;
+            framesDropped_.fetch_add(1, std::memory_order_relaxed);
+        } else if (averageLevel_ < setpoint_ - margin) {
+            take = framesPerBurst_ - 1;
+            framesInserted_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    level_.store(averageLevel_ > 0 ? static_cast<unsigned>(averageLevel_ + 0.5) : 0,
+                 std::memory_order_relaxed);
+
+    updateLatency(now, captured, capturedNs);
+    jitter_.read(&scratch_[0], take * frameBytes);
+    playedFrames_ += take;
+
+    // corrections happen mid-burst, blending the two frames around the cut
+    unsigned middle = framesPerBurst_ / 2;
+    short *src = &scratch_[0];
+    if (take == framesPerBurst_) {
+        memcpy(out, src, burstBytes);
+    } else if (take > framesPerBurst_) {
+        memcpy(out, src, middle * frameBytes);
+        for (int c = 0; c < channels_; c++) {
+            out[middle * channels_ + c] = static_cast<short>(
+                    (src[middle * channels_ + c] + src[(middle + 1) * channels_ + c]) / 2);
+        }
+        memcpy(out + (middle + 1) * channels_, src + (middle + 2) * channels_,
+               (framesPerBurst_ - middle - 1) * frameBytes);
+    } else {
+        memcpy(out, src, middle * frameBytes);
+        for (int c = 0; c < channels_; c++) {
+            out[middle * channels_ + c] = static_cast<short>(
+                    (src[(middle - 1) * channels_ + c] + src[middle * channels_ + c]) / 2);
+        }
+        memcpy(out + (middle + 1) * channels_, src + middle * channels_,
+               (framesPerBurst_ - middle - 1) * frameBytes);
+    }
+}
+
+void DuplexMonitor::lastCapture(unsigned long long *frames, unsigned long long *ns) const {
+    unsigned seq;
+    do {
+        seq = captureSeq_.load(std::memory_order_acquire);
+        *frames = capturedFrames_.load(std::memory_order_relaxed);
+        *ns = captureNs_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) != 0 || seq != captureSeq_.load(std::memory_order_relaxed));
+}
+
+void DuplexMonitor::updateLatency(unsigned long long now, unsigned long long captured,
+                                  unsigned long long capturedNs) {
+    // the first frame of this burst was captured (captured - played) frames
+    // before the last capture callback, and plays once the buffers already
+    // queued ahead of it have drained
+    double framesNs = 1e9 / sampleRate_;
+    double ageNs = (static_cast<double>(now) - capturedNs)
+                   + (captured - playedFrames_) * framesNs;
+    double latency = ageNs + (playerQueueDepth_ - 1) * framesPerBurst_ * framesNs;
+    averageLatencyNs_ = averageLatencyNs_ == 0
+                        ? latency : averageLatencyNs_ + (latency - averageLatencyNs_) * AVERAGE_WEIGHT;
+    latencyNs_.store(static_cast<unsigned long long>(averageLatencyNs_),
+                     std::memory_order_relaxed);
+    if (latency > maxLatencyNs_.load(std::memory_order_relaxed)) {
+        maxLatencyNs_.store(static_cast<unsigned long long>(latency), std::memory_order_relaxed);
+    }
+}
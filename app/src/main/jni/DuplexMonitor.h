@@ -0,0 +1,131 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_DUPLEXMONITOR_H
+#define NATIVEFEEDBACK_DUPLEXMONITOR_H
+
+#include <atomic>
+#include <vector>
+
+#include "AudioBackend.h"
+#include "CpuBudget.h"
+#include "SharedPcmRing.h"
+
+// recorder buffers in flight: one filling while the last is processed
+#define MONITOR_RECORDER_QUEUE_DEPTH 2
+
+struct MonitorStats {
+    // mic to speaker as seen from the callbacks: the age of the oldest
+    // captured frame when the player takes it, plus the output queue ahead
+    // of it. Time spent in the converters and the mixer isn't visible here.
+    double latencyMs;
+    double maxLatencyMs;
+    // frames left in the jitter buffer after each output burst, averaged
+    unsigned jitterFrames;
+    // bursts the recorder came too late for, and bursts it dropped because
+    // the player didn't take them in time
+    unsigned underruns;
+    unsigned overruns;
+    // drift corrections: frames blended out of or into the output, not
+    // counting what underruns skip
+    unsigned framesDropped;
+    unsigned framesInserted;
+};
+
+// Full-duplex monitoring: every captured burst goes through an optional
+// processing hook and out to the speaker.
+//
+// The recorder callback writes bursts into a small jitter buffer and the
+// player callback takes them back out, both in one-burst buffers at the
+// native rate, so nothing but the two queues and the jitter buffer sits
+// between the mic and the speaker. The player starts once the jitter buffer
+// holds jitterBursts on top of the burst it takes, and from then on holds
+// the level it settled at: when the two device clocks drift apart it takes
+// one frame more or one less than a burst, blending the neighbours of the
+// dropped or repeated frame so the correction isn't audible.
+class DuplexMonitor {
+public:
+    // runs on the recorder callback, in place on one burst
+    typedef void (*Processor)(short *samples, unsigned frames, int channels, void *context);
+
+    // streams are created on backend, which must outlive this
+    explicit DuplexMonitor(AudioBackend *backend);
+    ~DuplexMonitor();
+
+    // set while stopped
+    void setProcessor(Processor processor, void *context);
+    // set while stopped: every recorder callback, the processor included,
+    // reports how long it took to budget, NULL for none
+    void setBudget(CpuBudget *budget) { budget_ = budget; }
+
+    // jitterBursts is the jitter buffer level the player aims for
+    bool start(const StreamFormat &format, int framesPerBurst, int playerQueueDepth,
+               int jitterBursts);
+    void stop();
+    bool running() const { return player_ != NULL; }
+
+    MonitorStats stats() const;
+
+private:
+    static void recorderCallback(AudioStream *stream, void *context);
+    static void playerCallback(AudioStream *stream, void *context);
+    void onCaptured();
+    void onPlayed();
+    // fills one output burst from the jitter buffer
+    void render(short *out, unsigned long long now);
+    // frames the recorder has delivered and when, consistent with each other
+    void lastCapture(unsigned long long *frames, unsigned long long *ns) const;
+    void updateLatency(unsigned long long now, unsigned long long captured,
+                       unsigned long long capturedNs);
+
+    AudioBackend *backend_;
+    AudioStream *recorder_;
+    AudioStream *player_;
+    Processor processor_;
+    void *processorContext_;
+    CpuBudget *budget_;
+
+    int channels_;
+    int sampleRate_;
+    unsigned framesPerBurst_;
+    int playerQueueDepth_;
+    unsigned targetFrames_;
+
+    std::vector<short> recorderBuffers_;
+    std::vector<short> playerBuffers_;
+    // one burst plus the frame a drift correction may take
+    std::vector<short> scratch_;
+    int recorderNext_;
+    int playerNext_;
+
+    std::vector<unsigned> jitterMemory_;
+    SharedPcmRing jitter_;
+
+    // last capture: frames written in total and when, as a seqlock pair
+    std::atomic<unsigned> captureSeq_;
+    std::atomic<unsigned long long> capturedFrames_;
+    std::atomic<unsigned long long> captureNs_;
+
+    // player callback only
+    unsigned long long playedFrames_;
+    // frames an underrun played as silence, skipped once they arrive
+    unsigned owedFrames_;
+    unsigned long long lastPlayNs_;
+    double periodNs_;
+    double averageLevel_;
+    // level the corrections hold, measured once the player has settled
+    double setpoint_;
+    unsigned settledBursts_;
+    double averageLatencyNs_;
+    bool primed_;
+
+    std::atomic<unsigned long long> latencyNs_;
+    std::atomic<unsigned long long> maxLatencyNs_;
+    std::atomic<unsigned> level_;
+    std::atomic<unsigned> underruns_;
+    std::atomic<unsigned> framesDropped_;
+    std::atomic<unsigned> framesInserted_;
+};
+
+#endif //NATIVEFEEDBACK_DUPLEXMONITOR_H
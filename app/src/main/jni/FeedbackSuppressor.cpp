@@ -0,0 +1,354 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "FeedbackSuppressor.h"
+
+#include <algorithm>
+#include <cmath>
+
+// bins either side of a candidate that have to be PNPR below it, outside
+// the Hann window's main lobe
+static const unsigned NEIGHBOUR_BINS = 4;
+// a candidate within this many bins of a track is the same peak; feedback
+// sits still where a voice's harmonics glide away
+static const float SAME_PEAK_BINS = 1.0f;
+// a howl this close to a notch is one the notch didn't hold down, pushed
+// aside a little by the cut
+static const float NOTCH_REACH_BINS = 2.0f;
+
+FeedbackSuppressor::FeedbackSuppressor()
+        : sampleRate_(0),
+          channels_(1),
+          fftSize_(0),
+          hop_(0),
+          lowBin_(0),
+          highBin_(0),
+          riseHops_(0),
+          sustainHops_(0),
+          holdHops_(0),
+          releaseDbPerHop_(0),
+          head_(0),
+          fill_(0),
+          analyses_(0),
+          trackCount_(0),
+          active_(0),
+          detections_(0) {
+    for (unsigned i = 0; i < FEEDBACK_MAX_NOTCHES; i++) {
+        notches_[i].hz = 0;
+        notches_[i].depthDb = 0;
+        notches_[i].lastHit = 0;
+        design(i);
+        publishedHz_[i].store(0, std::memory_order_relaxed);
+        publishedDepth_[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+bool FeedbackSuppressor::init(int sampleRate, int channels) {
+    unsigned fftSize = sampleRate > 48000 ? 2 * FEEDBACK_FFT_SIZE : FEEDBACK_FFT_SIZE;
+    if (sampleRate <= 0 || channels <= 0 || !fft_.init(fftSize)) {
+        return false;
+    }
+    sampleRate_ = sampleRate;
+    channels_ = channels;
+    fftSize_ = fftSize;
+    hop_ = fftSize / 2;
+    float binHz = static_cast<float>(sampleRate) / fftSize;
+    lowBin_ = std::max(NEIGHBOUR_BINS, static_cast<unsigned>(FEEDBACK_LOW_HZ / binHz));
+    highBin_ = std::min(fftSize / 2 - NEIGHBOUR_BINS,
+                        static_cast<unsigned>(std::min(FEEDBACK_HIGH_HZ, sampleRate * 9 / 20)
+                                              / binHz));
+    double hopMs = 1000.0 * hop_ / sampleRate;
+    riseHops_ = std::max(2u, static_cast<unsigned>(FEEDBACK_RISE_MS / hopMs + 0.5));
+    sustainHops_ = static_cast<unsigned>(FEEDBACK_SUSTAIN_MS / hopMs + 0.5);
+    holdHops_ = static_cast<unsigned long long>(FEEDBACK_HOLD_MS / hopMs + 0.5);
+    releaseDbPerHop_ = static_cast<float>(FEEDBACK_RELEASE_DB_PER_S * hopMs / 1000);
+
+    state_.assign(2 * FEEDBACK_MAX_NOTCHES * channels, 0);
+    scratch_.assign(FEEDBACK_CHUNK_FRAMES, 0);
+    history_.assign(fftSize, 0);
+    hann_.resize(fftSize);
+    for (unsigned i = 0; i < fftSize; i++) {
+        hann_[i] = static_cast<float>(0.5 - 0.5 * cos(2 * M_PI * i / fftSize));
+    }
+    window_.resize(fftSize);
+    re_.resize(fft_.bins());
+    im_.resize(fft_.bins());
+    db_.resize(fft_.bins());
+    peaks_.resize(2 * FEEDBACK_MAX_NOTCHES);
+    reset();
+    return true;
+}
+
+void FeedbackSuppressor::reset() {
+    std::fill(state_.begin(), state_.end(), 0.0f);
+    std::fill(history_.begin(), history_.end(), 0.0f);
+    head_ = 0;
+    fill_ = 0;
+    analyses_ = 0;
+    trackCount_ = 0;
+    for (unsigned i = 0; i < FEEDBACK_MAX_NOTCHES; i++) {
+        notches_[i].hz = 0;
+        notches_[i].depthDb = 0;
+        notches_[i].lastHit = 0;
+        design(i);
+        publish(i);
+    }
+    active_.store(0, std::memory_order_relaxed);
+    detections_.store(0, std::memory_order_relaxed);
+}
+
+void FeedbackSuppressor::processor(short *samples, unsigned frames, int channels, void *context) {
+    FeedbackSuppressor *suppressor = static_cast<FeedbackSuppressor *>(context);
+    if (channels == suppressor->channels_) {
+        suppressor->process(samples, frames);
+    }
+}
+
+void FeedbackSuppressor::process(short *samples, unsigned frames) {
+    if (fftSize_ == 0) {
+        return;
+    }
+    const PcmKernels &kernels = PcmKernels::best();
+    const float scale = 1.0f / 32768;
+    const unsigned mask = fftSize_ - 1;
+    while (frames > 0) {
+        unsigned n = std::min<unsigned>(frames, FEEDBACK_CHUNK_FRAMES);
+        float *x = &scratch_[0];
+        for (int c = 0; c < channels_; c++) {
+            float *state = &state_[c * 2 * FEEDBACK_MAX_NOTCHES];
+            if (channels_ == 1) {
+                kernels.s16ToFloat(samples, x, n);
+                kernels.biquadCascade(x, n, coefs_, state);
+                kernels.floatToS16(x, samples, n);
+                continue;
+            }
+            for (unsigned i = 0; i < n; i++) {
+                x[i] = samples[i * channels_ + c] * scale;
+            }
+            kernels.biquadCascade(x, n, coefs_, state);
+            for (unsigned i = 0; i < n; i++) {
+                float v = x[i] * 32768.0f;
+                samples[i * channels_ + c] = static_cast<short>(
+                        lrintf(std::max(-32768.0f, std::min(32767.0f, v))));
+            }
+        }
+
+        // the analysis sees the output, so a howl a notch holds down stops
+        // being found and one it doesn't hold down makes it deeper
+        const float mono = scale / channels_;
+        for (unsigned i = 0; i < n; i++) {
+            int sum = 0;
+            for (int c = 0; c < channels_; c++) {
+                sum += samples[i * channels_ + c];
+            }
+            history_[head_] = sum * mono;
+            head_ = (head_ + 1) & mask;
+            if (++fill_ == hop_) {
+                analyze();
+                fill_ = 0;
+            }
+        }
+        samples += n * channels_;
+        frames -= n;
+    }
+}
+
+void FeedbackSuppressor::analyze() {
+    for (unsigned i = 0; i < fftSize_; i++) {
+        window_[i] = history_[(head_ + i) & (fftSize_ - 1)] * hann_[i];
+    }
+    fft_.forward(&window_[0], &re_[0], &im_[0]);
+    // dBFS, a full scale sine reading 0 as in SpectrumAnalyzer
+    const float norm = 16.0f / (static_cast<float>(fftSize_) * fftSize_);
+    double bandPower = 0;
+    for (unsigned k = lowBin_ - NEIGHBOUR_BINS; k <= highBin_ + NEIGHBOUR_BINS; k++) {
+        float power = norm * (re_[k] * re_[k] + im_[k] * im_[k]);
+        db_[k] = 10.0f * log10f(power + 1e-12f);
+        if (k >= lowBin_ && k <= highBin_) {
+            bandPower += power;
+        }
+    }
+    float bandDb = 10.0f * log10f(static_cast<float>(bandPower / (highBin_ - lowBin_ + 1))
+                                  + 1e-12f);
+
+    // the loudest candidates, as many as there are tracks
+    unsigned count = 0;
+    for (unsigned k = lowBin_; k <= highBin_; k++) {
+        float d = db_[k];
+        if (d < FEEDBACK_MIN_LEVEL_DB || d - bandDb < FEEDBACK_PAPR_DB
+            || d <= db_[k - 1] || d < db_[k + 1]
+            || d - db_[k - NEIGHBOUR_BINS] < FEEDBACK_PNPR_DB
+            || d - db_[k + NEIGHBOUR_BINS] < FEEDBACK_PNPR_DB) {
+            continue;
+        }
+        if (count < peaks_.size()) {
+            peaks_[count++] = k;
+            continue;
+        }
+        unsigned quietest = 0;
+        for (unsigned i = 1; i < count; i++) {
+            if (db_[peaks_[i]] < db_[peaks_[quietest]]) {
+                quietest = i;
+            }
+        }
+        if (d > db_[peaks_[quietest]]) {
+            peaks_[quietest] = k;
+        }
+    }
+    analyses_++;
+    track(&peaks_[0], count);
+    release();
+}
+
+void FeedbackSuppressor::track(const unsigned *peaks, unsigned count) {
+    for (unsigned t = 0; t < trackCount_; t++) {
+        tracks_[t].seen = false;
+    }
+    for (unsigned p = 0; p < count; p++) {
+        unsigned k = peaks[p];
+        float d = db_[k];
+        Track *match = NULL;
+        for (unsigned t = 0; t < trackCount_; t++) {
+            if (!tracks_[t].seen && fabsf(tracks_[t].bin - k) <= SAME_PEAK_BINS
+                && (match == NULL || fabsf(tracks_[t].bin - k) < fabsf(match->bin - k))) {
+                match = &tracks_[t];
+            }
+        }
+        if (match == NULL) {
+            if (trackCount_ == sizeof(tracks_) / sizeof(tracks_[0])) {
+                continue;
+            }
+            match = &tracks_[trackCount_++];
+            match->bin = static_cast<float>(k);
+            match->hops = 0;
+            match->rising = 0;
+            match->riseStartDb = d;
+            match->lastDb = d;
+        }
+        match->seen = true;
+        match->hops++;
+        if (d < match->lastDb - FEEDBACK_JITTER_DB) {
+            match->rising = 1;
+            match->riseStartDb = d;
+        } else {
+            match->rising++;
+        }
+        match->lastDb = d;
+
+        bool growing = match->rising >= riseHops_
+                       && match->lastDb - match->riseStartDb >= FEEDBACK_RISE_DB;
+        if (growing || match->hops >= sustainHops_) {
+            // the peak of the parabola through the bin and its neighbours
+            float a = db_[k - 1], b = db_[k], c = db_[k + 1];
+            float curve = a - 2 * b + c;
+            float offset = curve < 0 ? 0.5f * (a - c) / curve : 0.0f;
+            onHowl(k + std::max(-0.5f, std::min(0.5f, offset)));
+            // it has to prove itself again under the notch
+            match->hops = 1;
+            match->rising = 1;
+            match->riseStartDb = d;
+        }
+    }
+    // a track found missing is gone
+    unsigned kept = 0;
+    for (unsigned t = 0; t < trackCount_; t++) {
+        if (tracks_[t].seen) {
+            tracks_[kept++] = tracks_[t];
+        }
+    }
+    trackCount_ = kept;
+}
+
+void FeedbackSuppressor::onHowl(float bin) {
+    float binHz = static_cast<float>(sampleRate_) / fftSize_;
+    float hz = bin * binHz;
+    unsigned slot = FEEDBACK_MAX_NOTCHES;
+    for (unsigned i = 0; i < FEEDBACK_MAX_NOTCHES; i++) {
+        if (notches_[i].depthDb < 0 && fabsf(notches_[i].hz - hz) <= NOTCH_REACH_BINS * binHz) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < FEEDBACK_MAX_NOTCHES) {
+        notches_[slot].depthDb = std::max(FEEDBACK_MAX_DEPTH_DB,
+                                          notches_[slot].depthDb - FEEDBACK_DEEPEN_DB);
+    } else {
+        // a free slot, or the one hit longest ago
+        slot = 0;
+        for (unsigned i = 0; i < FEEDBACK_MAX_NOTCHES; i++) {
+            if (notches_[i].depthDb == 0) {
+                slot = i;
+                break;
+            }
+            if (notches_[i].lastHit < notches_[slot].lastHit) {
+                slot = i;
+            }
+        }
+        notches_[slot].depthDb = FEEDBACK_FIRST_DEPTH_DB;
+    }
+    notches_[slot].hz = hz;
+    notches_[slot].lastHit = analyses_;
+    design(slot);
+    publish(slot);
+    detections_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void FeedbackSuppressor::release() {
+    for (unsigned i = 0; i < FEEDBACK_MAX_NOTCHES; i++) {
+        Notch &notch = notches_[i];
+        if (notch.depthDb == 0 || analyses_ - notch.lastHit <= holdHops_) {
+            continue;
+        }
+        notch.depthDb += releaseDbPerHop_;
+        if (notch.depthDb > -1.0f) {
+            notch.depthDb = 0;
+            notch.hz = 0;
+        }
+        design(i);
+        publish(i);
+    }
+}
+
+void FeedbackSuppressor::design(unsigned i) {
+    const unsigned n = FEEDBACK_MAX_NOTCHES;
+    const Notch &notch = notches_[i];
+    if (notch.depthDb == 0) {
+        coefs_[i] = 1;
+        coefs_[n + i] = 0;
+        coefs_[2 * n + i] = 0;
+        coefs_[3 * n + i] = 0;
+        coefs_[4 * n + i] = 0;
+        return;
+    }
+    // a peaking EQ cut (Bristow-Johnson): depthDb at hz, flat well away
+    double a = pow(10.0, notch.depthDb / 40.0);
+    double w0 = 2 * M_PI * notch.hz / sampleRate_;
+    double alpha = sin(w0) / (2 * FEEDBACK_NOTCH_Q);
+    double cosW0 = cos(w0);
+    double a0 = 1 + alpha / a;
+    coefs_[i] = static_cast<float>((1 + alpha * a) / a0);
+    coefs_[n + i] = static_cast<float>(-2 * cosW0 / a0);
+    coefs_[2 * n + i] = static_cast<float>((1 - alpha * a) / a0);
+    coefs_[3 * n + i] = static_cast<float>(-2 * cosW0 / a0);
+    coefs_[4 * n + i] = static_cast<float>((1 - alpha / a) / a0);
+}
+
+void FeedbackSuppressor::publish(unsigned i) {
+    publishedHz_[i].store(notches_[i].hz, std::memory_order_relaxed);
+    publishedDepth_[i].store(notches_[i].depthDb, std::memory_order_relaxed);
+    unsigned active = 0;
+    for (unsigned j = 0; j < FEEDBACK_MAX_NOTCHES; j++) {
+        active += notches_[j].depthDb < 0;
+    }
+    active_.store(active, std::memory_order_relaxed);
+}
+
+void FeedbackSuppressor::notch(unsigned slot, float *hz, float *depthDb) const {
+    if (slot >= FEEDBACK_MAX_NOTCHES) {
+        *hz = 0;
+        *depthDb = 0;
+        return;
+    }
+    *hz = publishedHz_[slot].load(std::memory_order_relaxed);
+    *depthDb = publishedDepth_[slot].load(std::memory_order_relaxed);
+}
@@ -0,0 +1,158 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_FEEDBACKSUPPRESSOR_H
+#define NATIVEFEEDBACK_FEEDBACKSUPPRESSOR_H
+
+#include <atomic>
+#include <vector>
+
+#include "Fft.h"
+#include "PcmConvert.h"
+
+// notches in the bank, one biquadCascade's worth
+#define FEEDBACK_MAX_NOTCHES PCM_BIQUAD_STAGES
+// analysis window up to 48 kHz, doubled above; the hop is half of it
+#define FEEDBACK_FFT_SIZE 1024
+// frames converted and filtered per pass, so the scratch is allocated once
+#define FEEDBACK_CHUNK_FRAMES 1024
+// a howl candidate: a local maximum this loud, this far over the bins four
+// out on either side and over the average of the band
+#define FEEDBACK_MIN_LEVEL_DB -60.0f
+#define FEEDBACK_PNPR_DB 10.0f
+#define FEEDBACK_PAPR_DB 10.0f
+// the band searched, Hz
+#define FEEDBACK_LOW_HZ 100
+#define FEEDBACK_HIGH_HZ 16000
+// it's a howl once it has risen this much over this long without falling
+// back more than the jitter, or has simply stayed this long
+#define FEEDBACK_RISE_MS 100
+#define FEEDBACK_RISE_DB 6.0f
+#define FEEDBACK_JITTER_DB 1.0f
+#define FEEDBACK_SUSTAIN_MS 1000
+// notch shape: peaking cuts of this Q, starting this deep and deepening on
+// every howl found under them
+#define FEEDBACK_NOTCH_Q 30.0f
+#define FEEDBACK_FIRST_DEPTH_DB -12.0f
+#define FEEDBACK_DEEPEN_DB 6.0f
+#define FEEDBACK_MAX_DEPTH_DB -36.0f
+// a notch nothing has hit for this long relaxes at this rate and goes once
+// it's within a dB of flat
+#define FEEDBACK_HOLD_MS 10000
+#define FEEDBACK_RELEASE_DB_PER_S 1.0f
+
+// Acoustic feedback suppressor for the monitor path: finds the narrowband
+// peaks a mic to speaker loop rings up and cuts each with a narrow notch.
+//
+// Every hop of the output, a Hann windowed RealFft of the last window looks
+// for candidates, and a candidate the next hops keep finding in the same
+// bin is a track. A track that keeps rising (feedback grows by the loop gain
+// every round trip, where voices and instruments move around) or that just
+// won't go away is a howl. A howl gets a free notch, or the one that was
+// hit longest ago, tuned to the peak interpolated between bins; a howl under
+// an existing notch re-centres it and makes it deeper. Notches nothing has
+// hit for a while relax back to flat.
+//
+// The notches run as one biquadCascade, eight peaking cuts in two SIMD
+// vectors whatever the number in use, so the filter costs the same every
+// burst. process() is the DuplexMonitor processor: it runs on the recorder
+// callback, never allocates or blocks and analyses at most a couple of hops
+// a call.
+class FeedbackSuppressor {
+public:
+    FeedbackSuppressor();
+
+    // allocates; call before the first process(), off the audio thread
+    bool init(int sampleRate, int channels);
+    // back to no notches and no tracks, for a new session
+    void reset();
+
+    // in place, interleaved frames of init()'s channels
+    void process(short *samples, unsigned frames);
+    // as a DuplexMonitor::Processor, context the suppressor
+    static void processor(short *samples, unsigned frames, int channels, void *context);
+
+    // from any thread: the notches in use and their slots' settings; a free
+    // slot reads 0 Hz and 0 dB
+    unsigned activeNotches() const { return active_.load(std::memory_order_relaxed); }
+    void notch(unsigned slot, float *hz, float *depthDb) const;
+    // howls found, each either placing or deepening a notch
+    unsigned detections() const { return detections_.load(std::memory_order_relaxed); }
+
+private:
+    FeedbackSuppressor(const FeedbackSuppressor &);
+    FeedbackSuppressor &operator=(const FeedbackSuppressor &);
+
+    struct Track {
+        // where it was first found; it has to stay there
+        float bin;
+        // hops it's been found in, and the run of them it hasn't fallen in
+        unsigned hops;
+        unsigned rising;
+        float riseStartDb;
+        float lastDb;
+        bool seen;
+    };
+
+    struct Notch {
+        float hz;
+        // 0 when the slot is free
+        float depthDb;
+        // the analysis that last placed or deepened it
+        unsigned long long lastHit;
+    };
+
+    void analyze();
+    // follows the candidates of the last analysis, handing howls to onHowl
+    void track(const unsigned *peaks, unsigned count);
+    void onHowl(float bin);
+    void release();
+    // coefficients of slot i into the bank, flat when it's free
+    void design(unsigned i);
+    void publish(unsigned i);
+
+    int sampleRate_;
+    int channels_;
+    unsigned fftSize_;
+    unsigned hop_;
+    unsigned lowBin_;
+    unsigned highBin_;
+    // the time constants in hops
+    unsigned riseHops_;
+    unsigned sustainHops_;
+    unsigned long long holdHops_;
+    float releaseDbPerHop_;
+
+    // b0, b1, b2, a1, a2 of every notch, as biquadCascade wants them, and
+    // its state for every channel
+    float coefs_[5 * FEEDBACK_MAX_NOTCHES];
+    std::vector<float> state_;
+    std::vector<float> scratch_;
+
+    RealFft fft_;
+    // the last fftSize_ frames of mono output, oldest at history_[head_],
+    // and the frames since the last analysis
+    std::vector<float> history_;
+    unsigned head_;
+    unsigned fill_;
+    std::vector<float> hann_;
+    std::vector<float> window_;
+    std::vector<float> re_;
+    std::vector<float> im_;
+    std::vector<float> db_;
+    std::vector<unsigned> peaks_;
+    // hops analysed since reset()
+    unsigned long long analyses_;
+
+    Track tracks_[2 * FEEDBACK_MAX_NOTCHES];
+    unsigned trackCount_;
+    Notch notches_[FEEDBACK_MAX_NOTCHES];
+
+    std::atomic<unsigned> active_;
+    std::atomic<unsigned> detections_;
+    std::atomic<float> publishedHz_[FEEDBACK_MAX_NOTCHES];
+    std::atomic<float> publishedDepth_[FEEDBACK_MAX_NOTCHES];
+};
+
+#endif //NATIVEFEEDBACK_FEEDBACKSUPPRESSOR_H
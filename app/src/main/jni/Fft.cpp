@@ -0,0 +1,129 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "Fft.h"
+
+#include <cmath>
+
+#include "PcmConvert.h"
+
+Fft::Fft() : size_(0) {}
+
+bool Fft::init(unsigned size) {
+    if (size < 2 || (size & (size - 1)) != 0) {
+        return false;
+    }
+    size_ = size;
+    cos_.resize(size - 1);
+    sin_.resize(size - 1);
+    for (unsigned half = 1; half < size; half *= 2) {
+        for (unsigned k = 0; k < half; k++) {
+            double angle = -M_PI * k / half;
+            cos_[half - 1 + k] = static_cast<float>(cos(angle));
+            sin_[half - 1 + k] = static_cast<float>(sin(angle));
+        }
+    }
+    unsigned bits = 0;
+    while ((1u << bits) < size) {
+        bits++;
+    }
+    reversed_.resize(size);
+    for (unsigned i = 0; i < size; i++) {
+        unsigned r = 0;
+        for (unsigned b = 0; b < bits; b++) {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        reversed_[i] = r;
+    }
+    return true;
+}
+
+unsigned Fft::sizeFor(unsigned n) {
+    unsigned size = 2;
+    while (size < n) {
+        size *= 2;
+    }
+    return size;
+}
+
+void Fft::forward(float *re, float *im) const {
+    transform(re, im, 1.0f);
+}
+
+void Fft::inverse(float *re, float *im) const {
+    transform(re, im, -1.0f);
+    float scale = 1.0f / size_;
+    for (unsigned i = 0; i < size_; i++) {
+        re[i] *= scale;
+        im[i] *= scale;
+    }
+}
+
+void Fft::transform(float *re, float *im, float direction) const {
+    for (unsigned i = 0; i < size_; i++) {
+        unsigned j = reversed_[i];
+        if (i < j) {
+            float t = re[i];
+            re[i] = re[j];
+            re[j] = t;
+            t = im[i];
+            im[i] = im[j];
+            im[j] = t;
+        }
+    }
+    // the inverse is the forward transform with conjugated twiddles
+    const PcmKernels &kernels = PcmKernels::best();
+    for (unsigned half = 1; half < size_; half *= 2) {
+        kernels.fftStage(re, im, size_, half, &cos_[half - 1], &sin_[half - 1], direction);
+    }
+}
+
+RealFft::RealFft() : size_(0) {}
+
+bool RealFft::init(unsigned size) {
+    if (size < 4 || !half_.init(size / 2)) {
+        return false;
+    }
+    size_ = size;
+    cos_.resize(size / 4 + 1);
+    sin_.resize(size / 4 + 1);
+    for (unsigned k = 0; k <= size / 4; k++) {
+        double angle = -2 * M_PI * k / size;
+        cos_[k] = static_cast<float>(cos(angle));
+        sin_[k] = static_cast<float>(sin(angle));
+    }
+    return true;
+}
+
+void RealFft::forward(const float *input, float *re, float *im) const {
+    unsigned m = size_ / 2;
+    for (unsigned k = 0; k < m; k++) {
+        re[k] = input[2 * k];
+        im[k] = input[2 * k + 1];
+    }
+    half_.forward(re, im);
+
+    // Z = E + iO for the spectra E of the even and O of the odd samples, so
+    // E[k] = (Z[k] + conj Z[m - k]) / 2 and O[k] = (Z[k] - conj Z[m - k]) / 2i,
+    // and X[k] = E[k] + W^k O[k]. Bins k and m - k come from the same pair.
+    float z0r = re[0];
+    float z0i = im[0];
+    re[0] = z0r + z0i;
+    im[0] = 0;
+    re[m] = z0r - z0i;
+    im[m] = 0;
+    for (unsigned k = 1; k <= m / 2; k++) {
+        unsigned j = m - k;
+        float er = 0.5f * (re[k] + re[j]);
+        float ei = 0.5f * (im[k] - im[j]);
+        float orr = 0.5f * (im[k] + im[j]);
+        float oi = -0.5f * (re[k] - re[j]);
+        float c = cos_[k];
+        float s = sin_[k];
+        // W^(m - k) = -conj W^k, and E, O at m - k are the conjugates
+        re[k] = er + c * orr - s * oi;
+        im[k] = ei + c * oi + s * orr;
+        re[j] = er - c * orr + s * oi;
+        im[j] = -ei + c * oi + s * orr;
+    }
+}
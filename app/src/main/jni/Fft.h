@@ -0,0 +1,68 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_FFT_H
+#define NATIVEFEEDBACK_FFT_H
+
+#include <vector>
+
+// In-place radix-2 complex FFT on split real and imaginary arrays.
+//
+// init() builds the twiddle and bit reversal tables for one power-of-two
+// size; forward() and inverse() then only touch the caller's arrays, so
+// they can run on any thread, the audio thread included. The butterflies
+// are the PcmKernels fftStage kernel, SIMD where the CPU has it, so each
+// stage keeps its twiddles contiguous.
+class Fft {
+public:
+    Fft();
+
+    // size must be a power of two, at least 2
+    bool init(unsigned size);
+    unsigned size() const { return size_; }
+
+    void forward(float *re, float *im) const;
+    // scaled by 1/size, so inverse(forward(x)) == x
+    void inverse(float *re, float *im) const;
+
+    // smallest power of two >= n
+    static unsigned sizeFor(unsigned n);
+
+private:
+    void transform(float *re, float *im, float direction) const;
+
+    unsigned size_;
+    // per stage of butterflies half points apart, from half - 1 on:
+    // e^(-2 pi i k / (2 * half)) for k < half
+    std::vector<float> cos_;
+    std::vector<float> sin_;
+    std::vector<unsigned> reversed_;
+};
+
+// FFT of real input through a complex Fft of half the size: the even and
+// odd samples go in as real and imaginary parts, and the two spectra are
+// pulled apart afterwards. About half the work of a complex FFT of the
+// same size, and like it, free to run on any thread once initialized.
+class RealFft {
+public:
+    RealFft();
+
+    // size must be a power of two, at least 4
+    bool init(unsigned size);
+    unsigned size() const { return size_; }
+    unsigned bins() const { return size_ / 2 + 1; }
+
+    // input holds size() samples; re and im get bins 0 to size() / 2, so
+    // they hold bins() floats each
+    void forward(const float *input, float *re, float *im) const;
+
+private:
+    unsigned size_;
+    Fft half_;
+    // e^(-2 pi i k / size) for k <= size / 4
+    std::vector<float> cos_;
+    std::vector<float> sin_;
+};
+
+#endif //NATIVEFEEDBACK_FFT_H
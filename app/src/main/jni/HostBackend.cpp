@@ -0,0 +1,353 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "HostBackend.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <thread>
+
+#include "WavFile.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// one simulated player or recorder, ticked by its backend's device clock
+class HostStream : public AudioStream {
+public:
+    HostStream(HostBackend &backend, bool recorder, const StreamFormat &format, int queueDepth)
+            : backend_(backend), recorder_(recorder), queueDepth_(queueDepth),
+              burstBytes_(backend.framesPerBurst() * format.channels * sizeof(short)),
+              silence_(burstBytes_, 0), period_(1), callback_(NULL), context_(NULL),
+              running_(false), held_(false) {
+        if (backend.clockSpeed() > 0) {
+            double speed = backend.clockSpeed();
+            if (recorder) {
+                speed *= 1 + backend.recorderDrift() * 1e-6;
+            }
+            double seconds = backend.framesPerBurst() / (format.sampleRate * speed);
+            period_ = std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(seconds));
+        }
+        backend_.addStream(this);
+    }
+
+    ~HostStream() override {
+        backend_.removeStream(this);
+    }
+
+    bool registerCallback(Callback callback, void *context) override {
+        std::lock_guard<std::mutex> lock(backend_.clockMutex_);
+        callback_ = callback;
+        context_ = context;
+        return true;
+    }
+
+    bool enqueue(const void *buffer, unsigned bytes) override {
+        std::lock_guard<std::mutex> lock(backend_.clockMutex_);
+        if (static_cast<int>(queue_.size()) >= queueDepth_) {
+            return false;
+        }
+        Entry entry = {static_cast<unsigned char *>(const_cast<void *>(buffer)), bytes, 0};
+        queue_.push_back(entry);
+        return true;
+    }
+
+    bool clear() override {
+        std::lock_guard<std::mutex> lock(backend_.clockMutex_);
+        queue_.clear();
+        return true;
+    }
+
+    bool start() override {
+        backend_.startStream(this);
+        return true;
+    }
+
+    bool stop() override {
+        std::lock_guard<std::mutex> lock(backend_.clockMutex_);
+        running_ = false;
+        held_ = false;
+        return true;
+    }
+
+private:
+    friend class HostBackend;
+
+    struct Entry {
+        unsigned char *data;
+        unsigned bytes;
+        unsigned offset;
+    };
+
+    HostBackend &backend_;
+    const bool recorder_;
+    const int queueDepth_;
+    const unsigned burstBytes_;
+    std::vector<unsigned char> silence_;
+    // a unit of device time when freewheeling
+    Clock::duration period_;
+
+    // all guarded by the backend's clockMutex_
+    std::deque<Entry> queue_;
+    Callback callback_;
+    void *context_;
+    bool running_;
+    // started, waiting for the rest of a startTogether group
+    bool held_;
+    Clock::time_point deadline_;
+};
+
+void HostBackend::Counters::addCallback(unsigned long long ns) {
+    callbacks.fetch_add(1, std::memory_order_relaxed);
+    totalNs.fetch_add(ns, std::memory_order_relaxed);
+    unsigned long long max = maxNs.load(std::memory_order_relaxed);
+    while (ns > max && !maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+}
+
+HostCallbackStats HostBackend::Counters::snapshot() const {
+    HostCallbackStats stats;
+    stats.callbacks = callbacks.load(std::memory_order_relaxed);
+    stats.totalNs = totalNs.load(std::memory_order_relaxed);
+    stats.maxNs = maxNs.load(std::memory_order_relaxed);
+    stats.starvedBursts = starvedBursts.load(std::memory_order_relaxed);
+    return stats;
+}
+
+HostBackend::HostBackend(int framesPerBurst, double clockSpeed)
+        : framesPerBurst_(framesPerBurst), clockSpeed_(clockSpeed), recorderDriftPpm_(0),
+          input_(NULL), loopbackDelay_(-1), loopbackGain_(1.0f), loopbackPosition_(0),
+          ticking_(NULL), startTogether_(0), clockQuit_(false) {
+    clockThread_ = std::thread(&HostBackend::clockLoop, this);
+}
+
+HostBackend::~HostBackend() {
+    {
+        std::lock_guard<std::mutex> lock(clockMutex_);
+        clockQuit_ = true;
+    }
+    clockWake_.notify_all();
+    clockThread_.join();
+}
+
+AudioStream *HostBackend::createPlayer(const StreamFormat &format, int queueDepth) {
+    return new HostStream(*this, false, format, queueDepth);
+}
+
+AudioStream *HostBackend::createRecorder(const StreamFormat &format, int queueDepth) {
+    return new HostStream(*this, true, format, queueDepth);
+}
+
+void HostBackend::startTogether(int count) {
+    std::lock_guard<std::mutex> lock(clockMutex_);
+    startTogether_ = count;
+}
+
+void HostBackend::setInput(PcmSource *source) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    input_ = source;
+}
+
+void HostBackend::setLoopback(int delayFrames, float gain) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    loopbackDelay_ = delayFrames;
+    loopbackGain_ = gain;
+    loopbackPosition_ = 0;
+}
+
+bool HostBackend::openInputFile(const char *path) {
+    // a WAV file plays from the start of its data chunk, anything else is
+    // taken as raw PCM
+    WavInfo wav;
+    unsigned long long offset = 0, length = ~0ULL;
+    switch (WavReader::probe(path, &wav)) {
+        case WAV_PCM16:
+            offset = wav.dataOffset;
+            length = wav.dataBytes;
+            break;
+        case WAV_UNSUPPORTED:
+            return false;
+        case WAV_NONE:
+            break;
+    }
+    std::unique_ptr<FilePcmSource> file(new FilePcmSource());
+    if (!file->open(path, offset, length)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    inputFile_.reset(file.release());
+    input_ = inputFile_.get();
+    return true;
+}
+
+std::vector<short> HostBackend::output() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return output_;
+}
+
+bool HostBackend::saveOutput(const char *path, const StreamFormat &format) {
+    std::vector<short> samples = output();
+    WavWriter writer;
+    if (!writer.open(path, format.sampleRate, format.channels, WavWriter::isWavPath(path))) {
+        return false;
+    }
+    bool ok = writer.write(samples.data(), samples.size() * sizeof(short));
+    return writer.close() && ok;
+}
+
+void HostBackend::pushOutput(const void *data, unsigned bytes) {
+    const short *samples = static_cast<const short *>(data);
+    std::lock_guard<std::mutex> lock(mutex_);
+    output_.insert(output_.end(), samples, samples + bytes / sizeof(short));
+}
+
+void HostBackend::pullInput(void *data, unsigned bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (loopbackDelay_ >= 0) {
+        // what hasn't been played yet, or was played before the first
+        // burst, is silence
+        short *samples = static_cast<short *>(data);
+        for (unsigned i = 0; i < bytes / sizeof(short); i++, loopbackPosition_++) {
+            size_t played = loopbackPosition_ - loopbackDelay_;
+            float sample = loopbackPosition_ >= static_cast<size_t>(loopbackDelay_)
+                           && played < output_.size() ? output_[played] * loopbackGain_ : 0;
+            samples[i] = static_cast<short>(sample);
+        }
+        return;
+    }
+    size_t n = input_ != NULL ? input_->read(data, bytes) : 0;
+    memset(static_cast<unsigned char *>(data) + n, 0, bytes - n);
+}
+
+void HostBackend::addStream(HostStream *stream) {
+    std::lock_guard<std::mutex> lock(clockMutex_);
+    streams_.push_back(stream);
+}
+
+void HostBackend::removeStream(HostStream *stream) {
+    std::unique_lock<std::mutex> lock(clockMutex_);
+    streams_.erase(std::find(streams_.begin(), streams_.end(), stream));
+    // waits out its callback, unless that's what is deleting it
+    if (std::this_thread::get_id() != clockThread_.get_id()) {
+        tickDone_.wait(lock, [this, stream] { return ticking_ != stream; });
+    }
+}
+
+void HostBackend::startStream(HostStream *stream) {
+    {
+        std::lock_guard<std::mutex> lock(clockMutex_);
+        if (stream->running_) {
+            return;
+        }
+        stream->running_ = true;
+        stream->held_ = startTogether_ > 0;
+        if (startTogether_ > 0) {
+            int held = 0;
+            for (size_t i = 0; i < streams_.size(); i++) {
+                held += streams_[i]->held_;
+            }
+            if (held < startTogether_) {
+                return;
+            }
+            startTogether_ = 0;
+        }
+        // the first burst moves a period after the start
+        Clock::time_point now = clockSpeed_ > 0 ? Clock::now() : freewheelNow_;
+        for (size_t i = 0; i < streams_.size(); i++) {
+            HostStream *started = streams_[i];
+            if (started == stream || started->held_) {
+                started->held_ = false;
+                started->deadline_ = now + started->period_;
+            }
+        }
+    }
+    clockWake_.notify_all();
+}
+
+HostStream *HostBackend::nextStream() {
+    // ties go to recorders, so what a player's callback hears of the input
+    // doesn't depend on the order the two were started in
+    HostStream *next = NULL;
+    for (size_t i = 0; i < streams_.size(); i++) {
+        HostStream *stream = streams_[i];
+        if (!stream->running_ || stream->held_) {
+            continue;
+        }
+        if (next == NULL || stream->deadline_ < next->deadline_
+            || (stream->deadline_ == next->deadline_ && stream->recorder_ && !next->recorder_)) {
+            next = stream;
+        }
+    }
+    return next;
+}
+
+void HostBackend::clockLoop() {
+    std::unique_lock<std::mutex> lock(clockMutex_);
+    while (!clockQuit_) {
+        HostStream *next = nextStream();
+        if (next == NULL) {
+            clockWake_.wait(lock);
+            continue;
+        }
+        if (clockSpeed_ > 0) {
+            Clock::time_point deadline = next->deadline_;
+            if (deadline > Clock::now()) {
+                // a stream may start, stop or go in the meantime
+                clockWake_.wait_until(lock, deadline);
+                continue;
+            }
+        } else {
+            freewheelNow_ = next->deadline_;
+        }
+        next->deadline_ += next->period_;
+        tick(next, lock);
+    }
+}
+
+void HostBackend::tick(HostStream *stream, std::unique_lock<std::mutex> &lock) {
+    Counters &counters = this->counters(stream->recorder_);
+    unsigned burstBytes = stream->burstBytes_;
+    if (stream->queue_.empty()) {
+        // the app didn't keep up: the device plays silence or loses a
+        // burst of input
+        counters.starvedBursts.fetch_add(1, std::memory_order_relaxed);
+        if (stream->recorder_) {
+            pullInput(&stream->silence_[0], burstBytes);
+            memset(&stream->silence_[0], 0, burstBytes);
+        } else {
+            pushOutput(&stream->silence_[0], burstBytes);
+        }
+        return;
+    }
+
+    HostStream::Entry &head = stream->queue_.front();
+    unsigned n = std::min(burstBytes, head.bytes - head.offset);
+    if (stream->recorder_) {
+        pullInput(head.data + head.offset, n);
+    } else {
+        pushOutput(head.data + head.offset, n);
+    }
+    head.offset += n;
+    if (head.offset < head.bytes) {
+        return;
+    }
+
+    stream->queue_.pop_front();
+    AudioStream::Callback callback = stream->callback_;
+    void *context = stream->context_;
+    if (callback == NULL) {
+        return;
+    }
+    ticking_ = stream;
+    lock.unlock();
+    Clock::time_point t0 = Clock::now();
+    callback(stream, context);
+    counters.addCallback(static_cast<unsigned long long>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count()));
+    lock.lock();
+    ticking_ = NULL;
+    tickDone_.notify_all();
+}
@@ -0,0 +1,141 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_HOSTBACKEND_H
+#define NATIVEFEEDBACK_HOSTBACKEND_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AudioBackend.h"
+#include "PcmSource.h"
+
+// cost of the callbacks the host streams have made, for benchmarks
+struct HostCallbackStats {
+    unsigned long long callbacks;
+    unsigned long long totalNs;
+    unsigned long long maxNs;
+    // ticks on which the queue was empty: silence played or input dropped
+    unsigned long long starvedBursts;
+};
+
+class HostStream;
+
+// Stand-in audio device for building and measuring the engine on a plain
+// Linux host.
+//
+// Every stream moves one burst of framesPerBurst frames per tick: players
+// push their bursts into an output buffer in memory, recorders pull theirs
+// from an input PcmSource (silence once it runs out). A clockSpeed of 1
+// ticks in real time, N ticks N times faster and 0 freewheels, which is
+// what benchmarks want.
+//
+// All the streams of a backend tick on one device clock thread, in the
+// order of their deadlines, and their callbacks run on it. A host stall
+// holds up every stream alike and the ticks it delayed then run in the
+// same order, so the streams never slip against each other the way two
+// threads would.
+class HostBackend : public AudioBackend {
+public:
+    HostBackend(int framesPerBurst, double clockSpeed);
+    ~HostBackend() override;
+
+    AudioStream *createPlayer(const StreamFormat &format, int queueDepth) override;
+    AudioStream *createRecorder(const StreamFormat &format, int queueDepth) override;
+
+    // recorders created after this tick ppm parts per million faster than
+    // players, as the two clocks of a real device drift apart
+    void setRecorderDrift(double ppm) { recorderDriftPpm_ = ppm; }
+
+    // holds the next streams started until there are count of them, then
+    // gives them all the same first tick, however the host scheduled the
+    // calls to start(): a full-duplex pair starting together
+    void startTogether(int count);
+
+    // input for recorders; the caller keeps ownership of source
+    void setInput(PcmSource *source);
+    // instead of the input, recorders hear what players played delayFrames
+    // earlier, scaled by gain: the speaker-to-mic path of a real device.
+    // Positions count from the first burst of each side, so set it up
+    // before creating the streams; both sides are taken to be mono at the
+    // same rate. A negative delay turns it off.
+    void setLoopback(int delayFrames, float gain);
+    // plays a raw PCM or WAV file into recorders
+    bool openInputFile(const char *path);
+
+    // everything players have pushed so far
+    std::vector<short> output();
+    // writes the output as raw PCM, or as WAV when path ends in .wav
+    bool saveOutput(const char *path, const StreamFormat &format);
+
+    HostCallbackStats playerStats() const { return players_.snapshot(); }
+    HostCallbackStats recorderStats() const { return recorders_.snapshot(); }
+
+    int framesPerBurst() const { return framesPerBurst_; }
+    double clockSpeed() const { return clockSpeed_; }
+    double recorderDrift() const { return recorderDriftPpm_; }
+
+    // device side of the streams, called from the clock thread
+    void pushOutput(const void *data, unsigned bytes);
+    void pullInput(void *data, unsigned bytes);
+
+    struct Counters {
+        std::atomic<unsigned long long> callbacks;
+        std::atomic<unsigned long long> totalNs;
+        std::atomic<unsigned long long> maxNs;
+        std::atomic<unsigned long long> starvedBursts;
+
+        Counters() : callbacks(0), totalNs(0), maxNs(0), starvedBursts(0) {}
+        void addCallback(unsigned long long ns);
+        HostCallbackStats snapshot() const;
+    };
+    Counters &counters(bool recorder) { return recorder ? recorders_ : players_; }
+
+private:
+    friend class HostStream;
+    typedef std::chrono::steady_clock Clock;
+
+    void addStream(HostStream *stream);
+    void removeStream(HostStream *stream);
+    void startStream(HostStream *stream);
+    HostStream *nextStream();
+    void clockLoop();
+    void tick(HostStream *stream, std::unique_lock<std::mutex> &lock);
+
+    Counters players_;
+    Counters recorders_;
+    const int framesPerBurst_;
+    const double clockSpeed_;
+    double recorderDriftPpm_;
+    std::mutex mutex_;
+    std::vector<short> output_;
+    PcmSource *input_;
+    std::unique_ptr<FilePcmSource> inputFile_;
+    int loopbackDelay_;
+    float loopbackGain_;
+    // samples recorders have pulled from the loopback so far
+    size_t loopbackPosition_;
+
+    // the device clock; guards the streams' queues and state as well
+    std::mutex clockMutex_;
+    std::condition_variable clockWake_;
+    // signalled when a callback returns
+    std::condition_variable tickDone_;
+    // in creation order, which breaks ties after recorders going first
+    std::vector<HostStream *> streams_;
+    // the stream whose callback is running, if any
+    HostStream *ticking_;
+    // freewheeling, each tick moves the device on by one unit
+    Clock::time_point freewheelNow_;
+    int startTogether_;
+    bool clockQuit_;
+    std::thread clockThread_;
+};
+
+#endif //NATIVEFEEDBACK_HOSTBACKEND_H
@@ -0,0 +1,250 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "LatencyProbe.h"
+
+#include <errno.h>
+#include <time.h>
+
+#include <cmath>
+#include <cstring>
+
+#define LOG_TAG "NativeLatencyProbe"
+
+#include "Fft.h"
+#include "Log.h"
+
+// one-burst recorder buffers, re-enqueued in place
+static const int RECORDER_QUEUE_DEPTH = 2;
+// Galois feedback taps of a primitive polynomial for each order
+static const unsigned MLS_TAPS[] = {
+        0, 0, 0x3, 0x6, 0xC, 0x14, 0x30, 0x60, 0xB8, 0x110, 0x240, 0x500, 0xE08, 0x1B00,
+        0x3500, 0x6000, 0xB400,
+};
+// half of full scale, loud enough to carry and clear of clipping
+static const float MLS_AMPLITUDE = 16384.0f;
+
+LatencyProbe::LatencyProbe(AudioBackend *backend)
+        : backend_(backend), recorder_(NULL), player_(NULL), channels_(0), framesPerBurst_(0),
+          playPosition_(0), recorderNext_(0), capturePosition_(0) {
+    sem_init(&done_, 0, 0);
+}
+
+LatencyProbe::~LatencyProbe() {
+    release();
+    sem_destroy(&done_);
+}
+
+std::vector<float> LatencyProbe::sequence(int order) {
+    std::vector<float> values;
+    if (order < 2 || order >= static_cast<int>(sizeof(MLS_TAPS) / sizeof(MLS_TAPS[0]))) {
+        return values;
+    }
+    values.resize((1u << order) - 1);
+    unsigned state = 1;
+    for (size_t i = 0; i < values.size(); i++) {
+        values[i] = (state & 1) ? 1.0f : -1.0f;
+        state = (state >> 1) ^ ((state & 1) ? MLS_TAPS[order] : 0);
+    }
+    return values;
+}
+
+bool LatencyProbe::measure(const StreamFormat &format, int framesPerBurst, int playerQueueDepth,
+                           LatencyResult *result) {
+    result->valid = false;
+    result->frames = 0;
+    result->latencyMs = 0;
+    result->confidence = 0;
+    release();
+    if (framesPerBurst <= 0 || format.channels <= 0 || format.sampleRate <= 0
+        || playerQueueDepth <= 0) {
+        return false;
+    }
+    channels_ = format.channels;
+    framesPerBurst_ = static_cast<unsigned>(framesPerBurst);
+
+    std::vector<float> mls = sequence(LATENCY_PROBE_MLS_ORDER);
+    size_t lead = static_cast<size_t>(format.sampleRate) * LATENCY_PROBE_LEAD_MS / 1000;
+    size_t frames = lead + mls.size()
+                    + static_cast<size_t>(format.sampleRate) * LATENCY_PROBE_MAX_MS / 1000;
+    frames = (frames + framesPerBurst_ - 1) / framesPerBurst_ * framesPerBurst_;
+
+    // the same sequence on every channel
+    timeline_.assign(frames * channels_, 0);
+    for (size_t i = 0; i < mls.size(); i++) {
+        for (int c = 0; c < channels_; c++) {
+            timeline_[(lead + i) * channels_ + c] = static_cast<short>(mls[i] * MLS_AMPLITUDE);
+        }
+    }
+    silence_.assign(framesPerBurst_ * channels_, 0);
+    recorderBuffers_.assign(RECORDER_QUEUE_DEPTH * framesPerBurst_ * channels_, 0);
+    captured_.assign(frames * channels_, 0);
+    playPosition_ = 0;
+    recorderNext_ = 0;
+    capturePosition_ = 0;
+    while (sem_trywait(&done_) == 0) {
+    }
+
+    recorder_ = backend_->createRecorder(format, RECORDER_QUEUE_DEPTH);
+    player_ = backend_->createPlayer(format, playerQueueDepth);
+    if (recorder_ == NULL || player_ == NULL
+        || !recorder_->registerCallback(recorderCallback, this)
+        || !player_->registerCallback(playerCallback, this)) {
+        LOGI("can't create the probe streams");
+        release();
+        return false;
+    }
+    unsigned burstSamples = framesPerBurst_ * channels_;
+    for (int i = 0; i < RECORDER_QUEUE_DEPTH; i++) {
+        recorder_->enqueue(&recorderBuffers_[i * burstSamples], burstSamples * sizeof(short));
+    }
+    for (int i = 0; i < playerQueueDepth; i++) {
+        player_->enqueue(&timeline_[playPosition_], burstSamples * sizeof(short));
+        playPosition_ += burstSamples;
+    }
+    if (!recorder_->start() || !player_->start()) {
+        LOGI("can't start the probe streams");
+        release();
+        return false;
+    }
+
+    // twice the capture in real time, plus a second for slow starts
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    long long timeoutMs = 2000LL * frames / format.sampleRate + 1000;
+    deadline.tv_sec += timeoutMs / 1000;
+    deadline.tv_nsec += (timeoutMs % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+    int waited;
+    while ((waited = sem_timedwait(&done_, &deadline)) != 0 && errno == EINTR) {
+    }
+    release();
+    if (waited != 0) {
+        LOGI("probe timed out with %zu of %zu frames captured",
+             capturePosition_ / channels_, frames);
+        return false;
+    }
+
+    // the first channel is enough to find the sequence in
+    std::vector<float> mono(frames);
+    for (size_t i = 0; i < frames; i++) {
+        mono[i] = captured_[i * channels_];
+    }
+    int delay;
+    double confidence;
+    if (!findDelay(&mls[0], mls.size(), &mono[0], frames, &delay, &confidence)) {
+        LOGI("probe captured nothing");
+        return true;
+    }
+    result->frames = delay - static_cast<int>(lead);
+    result->latencyMs = 1000.0 * result->frames / format.sampleRate;
+    result->confidence = confidence;
+    result->valid = result->frames >= 0;
+    LOGI("round trip %d frames (%.2fms), confidence %.3f", result->frames, result->latencyMs,
+         confidence);
+    return true;
+}
+
+bool LatencyProbe::findDelay(const float *reference, size_t referenceFrames, const float *captured,
+                             size_t capturedFrames, int *delay, double *confidence) {
+    if (referenceFrames == 0 || capturedFrames < referenceFrames) {
+        return false;
+    }
+    Fft fft;
+    fft.init(Fft::sizeFor(static_cast<unsigned>(capturedFrames + referenceFrames)));
+    unsigned n = fft.size();
+    std::vector<float> captureRe(captured, captured + capturedFrames), captureIm(n, 0.0f);
+    std::vector<float> referenceRe(reference, reference + referenceFrames), referenceIm(n, 0.0f);
+    captureRe.resize(n, 0.0f);
+    referenceRe.resize(n, 0.0f);
+    fft.forward(&captureRe[0], &captureIm[0]);
+    fft.forward(&referenceRe[0], &referenceIm[0]);
+    // capture times the conjugate of the reference: the inverse transform
+    // is sum(captured[i + k] * reference[i]) at k
+    for (unsigned i = 0; i < n; i++) {
+        float re = captureRe[i] * referenceRe[i] + captureIm[i] * referenceIm[i];
+        float im = captureIm[i] * referenceRe[i] - captureRe[i] * referenceIm[i];
+        captureRe[i] = re;
+        captureIm[i] = im;
+    }
+    fft.inverse(&captureRe[0], &captureIm[0]);
+
+    // normalise by the energy of the capture under the reference at each
+    // offset, so a loud stretch of noise doesn't win over a quiet echo
+    double referenceEnergy = 0;
+    for (size_t i = 0; i < referenceFrames; i++) {
+        referenceEnergy += reference[i] * reference[i];
+    }
+    std::vector<double> energy(capturedFrames + 1, 0.0);
+    for (size_t i = 0; i < capturedFrames; i++) {
+        energy[i + 1] = energy[i] + static_cast<double>(captured[i]) * captured[i];
+    }
+    double best = 0;
+    size_t bestOffset = 0;
+    for (size_t k = 0; k + referenceFrames <= capturedFrames; k++) {
+        double window = energy[k + referenceFrames] - energy[k];
+        if (window <= 0) {
+            continue;
+        }
+        double score = captureRe[k] / sqrt(referenceEnergy * window);
+        if (score > best) {
+            best = score;
+            bestOffset = k;
+        }
+    }
+    if (best <= 0) {
+        return false;
+    }
+    *delay = static_cast<int>(bestOffset);
+    *confidence = best > 1 ? 1 : best;
+    return true;
+}
+
+void LatencyProbe::release() {
+    if (recorder_ != NULL) {
+        recorder_->stop();
+        delete recorder_;
+        recorder_ = NULL;
+    }
+    if (player_ != NULL) {
+        player_->stop();
+        delete player_;
+        player_ = NULL;
+    }
+}
+
+void LatencyProbe::recorderCallback(AudioStream *stream, void *context) {
+    static_cast<LatencyProbe *>(context)->onCaptured();
+}
+
+void LatencyProbe::playerCallback(AudioStream *stream, void *context) {
+    static_cast<LatencyProbe *>(context)->onPlayed();
+}
+
+void LatencyProbe::onCaptured() {
+    unsigned burstSamples = framesPerBurst_ * channels_;
+    short *filled = &recorderBuffers_[recorderNext_ * burstSamples];
+    if (capturePosition_ < captured_.size()) {
+        memcpy(&captured_[capturePosition_], filled, burstSamples * sizeof(short));
+        capturePosition_ += burstSamples;
+        if (capturePosition_ == captured_.size()) {
+            sem_post(&done_);
+        }
+    }
+    recorder_->enqueue(filled, burstSamples * sizeof(short));
+    recorderNext_ = (recorderNext_ + 1) % RECORDER_QUEUE_DEPTH;
+}
+
+void LatencyProbe::onPlayed() {
+    // after the timeline the player keeps going on silence until it's stopped
+    unsigned burstSamples = framesPerBurst_ * channels_;
+    const short *next = &silence_[0];
+    if (playPosition_ < timeline_.size()) {
+        next = &timeline_[playPosition_];
+        playPosition_ += burstSamples;
+    }
+    player_->enqueue(next, burstSamples * sizeof(short));
+}
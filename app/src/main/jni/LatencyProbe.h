@@ -0,0 +1,86 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_LATENCYPROBE_H
+#define NATIVEFEEDBACK_LATENCYPROBE_H
+
+#include <semaphore.h>
+
+#include <cstddef>
+#include <vector>
+
+#include "AudioBackend.h"
+
+// the test signal: a maximum length sequence of 2^13 - 1 frames (~170ms at
+// 48 kHz), played after LATENCY_PROBE_LEAD_MS of silence. The recorder keeps
+// listening for LATENCY_PROBE_MAX_MS after the sequence has been played,
+// which bounds the round trip the probe can see.
+#define LATENCY_PROBE_MLS_ORDER 13
+#define LATENCY_PROBE_LEAD_MS 100
+#define LATENCY_PROBE_MAX_MS 500
+
+struct LatencyResult {
+    // false if nothing was captured or the peak lies outside the window
+    bool valid;
+    int frames;
+    double latencyMs;
+    // normalised cross-correlation at the peak: 1 when the capture holds a
+    // clean scaled copy of the sequence, near 0 when it's noise. Anything
+    // under ~0.3 shouldn't be trusted.
+    double confidence;
+};
+
+// Round-trip latency: plays a burst of MLS noise through a player while a
+// recorder listens, then finds the sequence in the capture by FFT
+// cross-correlation. The delay is measured between the two streams' own
+// frame positions, so it covers the output and input buffering, the
+// converters and the air gap, plus whatever the device puts between
+// starting the two streams.
+class LatencyProbe {
+public:
+    // streams are created on backend, which must outlive this
+    explicit LatencyProbe(AudioBackend *backend);
+    ~LatencyProbe();
+
+    // runs one measurement, blocking for roughly LATENCY_PROBE_LEAD_MS +
+    // the sequence + LATENCY_PROBE_MAX_MS. False if the streams couldn't
+    // run; *result says whether the sequence was found.
+    bool measure(const StreamFormat &format, int framesPerBurst, int playerQueueDepth,
+                 LatencyResult *result);
+
+    // where reference starts in captured, searching offsets
+    // 0..capturedFrames - referenceFrames
+    static bool findDelay(const float *reference, size_t referenceFrames, const float *captured,
+                          size_t capturedFrames, int *delay, double *confidence);
+
+    // +-1 sequence of 2^order - 1 values
+    static std::vector<float> sequence(int order);
+
+private:
+    static void recorderCallback(AudioStream *stream, void *context);
+    static void playerCallback(AudioStream *stream, void *context);
+    void onCaptured();
+    void onPlayed();
+    void release();
+
+    AudioBackend *backend_;
+    AudioStream *recorder_;
+    AudioStream *player_;
+    int channels_;
+    unsigned framesPerBurst_;
+
+    // the whole playback, lead-in, sequence and trailing silence, enqueued
+    // to the player a burst at a time in place
+    std::vector<short> timeline_;
+    std::vector<short> silence_;
+    size_t playPosition_;
+    std::vector<short> recorderBuffers_;
+    int recorderNext_;
+    std::vector<short> captured_;
+    size_t capturePosition_;
+    // posted by the recorder callback once captured_ is full
+    sem_t done_;
+};
+
+#endif //NATIVEFEEDBACK_LATENCYPROBE_H
@@ -0,0 +1,91 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "LiveCapture.h"
+
+#include <algorithm>
+
+#define LOG_TAG "NativeLiveCapture"
+
+#include "Log.h"
+#include "PcmConvert.h"
+
+LiveCapture::LiveCapture(AudioBackend *backend)
+        : backend_(backend), recorder_(NULL), channels_(0), samplesPerBuffer_(0), next_(0),
+          volume_(1.0f) {}
+
+LiveCapture::~LiveCapture() {
+    release();
+}
+
+size_t LiveCapture::init(const StreamFormat &format, int framesPerBuffer, void *ring,
+                         size_t ringBytes) {
+    release();
+    if (framesPerBuffer <= 0 || format.channels <= 0) {
+        return 0;
+    }
+    size_t capacity = ring_.attach(ring, ringBytes);
+    if (capacity < framesPerBuffer * format.channels * sizeof(short)) {
+        LOGI("ring of %zu bytes can't hold a %d frame buffer", ringBytes, framesPerBuffer);
+        ring_.detach();
+        return 0;
+    }
+    recorder_ = backend_->createRecorder(format, LIVE_CAPTURE_QUEUE_DEPTH);
+    if (recorder_ == NULL || !recorder_->registerCallback(recorderCallback, this)) {
+        release();
+        return 0;
+    }
+    channels_ = format.channels;
+    samplesPerBuffer_ = framesPerBuffer * format.channels;
+    storage_.assign(LIVE_CAPTURE_QUEUE_DEPTH * samplesPerBuffer_, 0);
+    gains_.assign(format.channels, 1.0f);
+    return capacity;
+}
+
+bool LiveCapture::start() {
+    if (recorder_ == NULL) {
+        return false;
+    }
+    recorder_->stop();
+    recorder_->clear();
+    next_ = 0;
+    for (int i = 0; i < LIVE_CAPTURE_QUEUE_DEPTH; i++) {
+        recorder_->enqueue(buffer(i), bufferBytes());
+    }
+    return recorder_->start();
+}
+
+bool LiveCapture::stop() {
+    if (recorder_ == NULL) {
+        return false;
+    }
+    bool stopped = recorder_->stop();
+    recorder_->clear();
+    return stopped;
+}
+
+void LiveCapture::release() {
+    if (recorder_ != NULL) {
+        recorder_->stop();
+        delete recorder_;
+        recorder_ = NULL;
+    }
+    ring_.detach();
+}
+
+void LiveCapture::recorderCallback(AudioStream *stream, void *context) {
+    static_cast<LiveCapture *>(context)->onBuffer();
+}
+
+void LiveCapture::onBuffer() {
+    short *filled = buffer(next_);
+    float volume = volume_.load(std::memory_order_relaxed);
+    if (volume != 1.0f) {
+        std::fill(gains_.begin(), gains_.end(), volume);
+        PcmKernels::best().applyGain(filled, samplesPerBuffer_ / channels_, channels_, &gains_[0]);
+    }
+    // a full ring drops this buffer, the recorder keeps going either way
+    ring_.write(filled, bufferBytes());
+    recorder_->enqueue(filled, bufferBytes());
+    next_ = (next_ + 1) % LIVE_CAPTURE_QUEUE_DEPTH;
+}
@@ -0,0 +1,59 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_LIVECAPTURE_H
+#define NATIVEFEEDBACK_LIVECAPTURE_H
+
+#include <atomic>
+#include <vector>
+
+#include "AudioBackend.h"
+#include "SharedPcmRing.h"
+
+// Streams the microphone into a SharedPcmRing instead of a file.
+//
+// The recorder callback applies the mic volume and copies each filled
+// buffer into the ring, then re-enqueues that buffer straight away, so the
+// recorder only needs its queue's worth of buffers and nothing on the path
+// blocks, allocates or makes a syscall. If the consumer falls behind, whole
+// buffers are dropped and counted in the ring header.
+#define LIVE_CAPTURE_QUEUE_DEPTH 4
+
+class LiveCapture {
+public:
+    // streams are created on backend, which must outlive this
+    explicit LiveCapture(AudioBackend *backend);
+    ~LiveCapture();
+
+    // creates the recorder and lays the ring out over ring/ringBytes.
+    // Returns the ring's data capacity in bytes, 0 on failure.
+    size_t init(const StreamFormat &format, int framesPerBuffer, void *ring, size_t ringBytes);
+    bool start();
+    bool stop();
+    void release();
+
+    // linear gain, 1.0 leaves the signal untouched
+    void setVolume(float gain) { volume_.store(gain, std::memory_order_relaxed); }
+    // the native view of the ring, for readers on this side and tests
+    SharedPcmRing &ring() { return ring_; }
+    unsigned bufferBytes() const { return samplesPerBuffer_ * sizeof(short); }
+
+private:
+    static void recorderCallback(AudioStream *stream, void *context);
+    void onBuffer();
+    short *buffer(int index) { return &storage_[index * samplesPerBuffer_]; }
+
+    AudioBackend *backend_;
+    AudioStream *recorder_;
+    int channels_;
+    unsigned samplesPerBuffer_;
+    std::vector<short> storage_;
+    std::vector<float> gains_;
+    // buffer the recorder fills next, callback only once started
+    int next_;
+    std::atomic<float> volume_;
+    SharedPcmRing ring_;
+};
+
+#endif //NATIVEFEEDBACK_LIVECAPTURE_H
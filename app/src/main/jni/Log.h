@@ -0,0 +1,21 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_LOG_H
+#define NATIVEFEEDBACK_LOG_H
+
+// LOGI for code that also builds on the host: logcat on Android. Host builds
+// only print to stderr with HOST_VERBOSE_LOG, so tests and benchmarks stay
+// quiet. Define LOG_TAG before including.
+#if defined(__ANDROID__)
+#include <android/log.h>
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#elif defined(HOST_VERBOSE_LOG)
+#include <cstdio>
+#define LOGI(...) (fprintf(stderr, LOG_TAG ": " __VA_ARGS__), fputc('\n', stderr))
+#else
+#define LOGI(...) ((void) 0)
+#endif
+
+#endif //NATIVEFEEDBACK_LOG_H
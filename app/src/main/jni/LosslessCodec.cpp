@@ -0,0 +1,623 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "LosslessCodec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// subframe types, 2 bits
+enum {
+    SUBFRAME_CONSTANT = 0,
+    SUBFRAME_VERBATIM,
+    SUBFRAME_FIXED,
+    SUBFRAME_LPC,
+};
+
+static const int MAX_FIXED_ORDER = 4;
+static const int RICE_PARAMETER_BITS = 5;
+// parameter value that marks a partition stored as raw fixed-width values
+static const int RICE_ESCAPE = (1 << RICE_PARAMETER_BITS) - 1;
+static const int ESCAPE_WIDTH_BITS = 6;
+// residuals past this mean the predictor is useless or overflowing
+static const long long MAX_RESIDUAL = 1LL << 30;
+
+static inline unsigned zigzag(int value) {
+    return (static_cast<unsigned>(value) << 1) ^ static_cast<unsigned>(value >> 31);
+}
+
+static inline int unzigzag(unsigned value) {
+    return static_cast<int>(value >> 1) ^ -static_cast<int>(value & 1);
+}
+
+static inline int bitWidth(unsigned long long value) {
+    int width = 0;
+    while (value != 0) {
+        width++;
+        value >>= 1;
+    }
+    return width;
+}
+
+// MSB first into a byte vector
+class LosslessEncoder::BitWriter {
+public:
+    explicit BitWriter(std::vector<unsigned char> *out) : out_(out), cache_(0), count_(0) {}
+
+    // n <= 32
+    void write(unsigned value, int n) {
+        if (n == 0) {
+            return;
+        }
+        cache_ = cache_ << n | (value & (0xFFFFFFFFULL >> (32 - n)));
+        count_ += n;
+        while (count_ >= 8) {
+            count_ -= 8;
+            out_->push_back(static_cast<unsigned char>(cache_ >> count_));
+        }
+    }
+
+    void writeSigned(int value, int n) { write(static_cast<unsigned>(value), n); }
+
+    // q zeros and a one
+    void writeUnary(unsigned q) {
+        while (q >= 32) {
+            write(0, 32);
+            q -= 32;
+        }
+        write(1, q + 1);
+    }
+
+    // pads the last byte with zeros
+    void flush() {
+        if (count_ > 0) {
+            write(0, 8 - count_);
+        }
+    }
+
+private:
+    std::vector<unsigned char> *out_;
+    unsigned long long cache_;
+    int count_;
+};
+
+class LosslessDecoder::BitReader {
+public:
+    BitReader(const unsigned char *data, size_t bytes)
+            : data_(data), bytes_(bytes), next_(0), cache_(0), count_(0), failed_(false) {}
+
+    // n <= 32
+    unsigned read(int n) {
+        if (n == 0) {
+            return 0;
+        }
+        while (count_ < n) {
+            if (next_ == bytes_) {
+                failed_ = true;
+                return 0;
+            }
+            cache_ = cache_ << 8 | data_[next_++];
+            count_ += 8;
+        }
+        count_ -= n;
+        return static_cast<unsigned>((cache_ >> count_) & (0xFFFFFFFFULL >> (32 - n)));
+    }
+
+    int readSigned(int n) {
+        unsigned value = read(n);
+        // sign extend
+        return n == 0 ? 0 : static_cast<int>(value << (32 - n)) >> (32 - n);
+    }
+
+    unsigned readUnary() {
+        unsigned q = 0;
+        for (;;) {
+            if (count_ == 0) {
+                if (next_ == bytes_) {
+                    failed_ = true;
+                    return 0;
+                }
+                cache_ = data_[next_++];
+                count_ = 8;
+            }
+            unsigned bits = static_cast<unsigned>(cache_ & ((1u << count_) - 1));
+            if (bits != 0) {
+                // leading zeros within the count_ valid bits, then the one
+                int width = bitWidth(bits);
+                q += count_ - width;
+                count_ = width - 1;
+                return q;
+            }
+            q += count_;
+            count_ = 0;
+        }
+    }
+
+    bool failed() const { return failed_; }
+
+private:
+    const unsigned char *data_;
+    size_t bytes_;
+    size_t next_;
+    unsigned long long cache_;
+    int count_;
+    bool failed_;
+};
+
+// residual of the fixed polynomial predictor of order for samples [order, frames)
+static void fixedResidual(const int *x, unsigned frames, int order, int *residual) {
+    for (unsigned i = order; i < frames; i++) {
+        int r;
+        switch (order) {
+            case 0:
+                r = x[i];
+                break;
+            case 1:
+                r = x[i] - x[i - 1];
+                break;
+            case 2:
+                r = x[i] - 2 * x[i - 1] + x[i - 2];
+                break;
+            case 3:
+                r = x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+                break;
+            default:
+                r = x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4];
+                break;
+        }
+        residual[i - order] = r;
+    }
+}
+
+static void fixedRestore(int *x, unsigned frames, int order, const int *residual) {
+    for (unsigned i = order; i < frames; i++) {
+        int r = residual[i - order];
+        switch (order) {
+            case 0:
+                x[i] = r;
+                break;
+            case 1:
+                x[i] = r + x[i - 1];
+                break;
+            case 2:
+                x[i] = r + 2 * x[i - 1] - x[i - 2];
+                break;
+            case 3:
+                x[i] = r + 3 * x[i - 1] - 3 * x[i - 2] + x[i - 3];
+                break;
+            default:
+                x[i] = r + 4 * x[i - 1] - 6 * x[i - 2] + 4 * x[i - 3] - x[i - 4];
+                break;
+        }
+    }
+}
+
+static inline long long lpcPrediction(const int *x, unsigned i, const int *coefficients,
+                                      int order, int shift) {
+    long long sum = 0;
+    for (int j = 0; j < order; j++) {
+        sum += static_cast<long long>(coefficients[j]) * x[i - 1 - j];
+    }
+    return sum >> shift;
+}
+
+// false if a residual is out of range
+static bool lpcResidual(const int *x, unsigned frames, const int *coefficients, int order,
+                        int shift, int *residual) {
+    for (unsigned i = order; i < frames; i++) {
+        long long r = x[i] - lpcPrediction(x, i, coefficients, order, shift);
+        if (r >= MAX_RESIDUAL || r <= -MAX_RESIDUAL) {
+            return false;
+        }
+        residual[i - order] = static_cast<int>(r);
+    }
+    return true;
+}
+
+LosslessEncoder::LosslessEncoder(int channels)
+        : channels_(channels),
+          parameters_(1 << LOSSLESS_MAX_PARTITION_ORDER),
+          bestParameters_(1 << LOSSLESS_MAX_PARTITION_ORDER) {}
+
+void LosslessEncoder::encode(const short *samples, unsigned frames, std::vector<unsigned char> *out) {
+    if (signal_.size() < frames) {
+        signal_.resize(frames);
+        residual_.resize(frames);
+        bestResidual_.resize(frames);
+        windowed_.resize(frames);
+    }
+    BitWriter bits(out);
+    for (int c = 0; c < channels_; c++) {
+        encodeChannel(samples + c, frames, bits);
+    }
+    bits.flush();
+}
+
+size_t LosslessEncoder::residualBits(const int *residual, unsigned count, int *partitionOrder) {
+    // sums and widths over the finest partitions, merged pairwise for the
+    // coarser orders
+    const int finest = 1 << LOSSLESS_MAX_PARTITION_ORDER;
+    unsigned long long sums[1 << LOSSLESS_MAX_PARTITION_ORDER];
+    unsigned widths[1 << LOSSLESS_MAX_PARTITION_ORDER];
+    for (int p = 0; p < finest; p++) {
+        unsigned begin = static_cast<unsigned>((static_cast<unsigned long long>(p) * count)
+                                               >> LOSSLESS_MAX_PARTITION_ORDER);
+        unsigned end = static_cast<unsigned>((static_cast<unsigned long long>(p + 1) * count)
+                                             >> LOSSLESS_MAX_PARTITION_ORDER);
+        unsigned long long sum = 0;
+        unsigned bitsOr = 0;
+        for (unsigned i = begin; i < end; i++) {
+            unsigned u = zigzag(residual[i]);
+            sum += u;
+            bitsOr |= u;
+        }
+        sums[p] = sum;
+        widths[p] = bitsOr;
+    }
+
+    size_t best = ~static_cast<size_t>(0);
+    for (int order = LOSSLESS_MAX_PARTITION_ORDER; order >= 0; order--) {
+        int partitions = 1 << order;
+        int merge = finest / partitions;
+        size_t total = 3;
+        for (int p = 0; p < partitions; p++) {
+            unsigned long long sum = 0;
+            unsigned bitsOr = 0;
+            for (int m = 0; m < merge; m++) {
+                sum += sums[p * merge + m];
+                bitsOr |= widths[p * merge + m];
+            }
+            unsigned begin = static_cast<unsigned>((static_cast<unsigned long long>(p) * count)
+                                                   >> order);
+            unsigned end = static_cast<unsigned>((static_cast<unsigned long long>(p + 1) * count)
+                                                 >> order);
+            unsigned long long n = end - begin;
+            // the parameter near log2 of the mean, give or take one
+            int k = n > 0 && sum > n ? bitWidth(sum / n) - 1 : 0;
+            int bestK = 0;
+            unsigned long long bestBits = ~0ULL;
+            for (int candidate = k - 1; candidate <= k + 1; candidate++) {
+                if (candidate < 0 || candidate >= RICE_ESCAPE) {
+                    continue;
+                }
+                unsigned long long b = n * (candidate + 1) + (sum >> candidate);
+                if (b < bestBits) {
+                    bestBits = b;
+                    bestK = candidate;
+                }
+            }
+            unsigned long long escapeBits = ESCAPE_WIDTH_BITS + n * bitWidth(bitsOr);
+            if (escapeBits < bestBits) {
+                bestBits = escapeBits;
+                bestK = RICE_ESCAPE;
+            }
+            parameters_[p] = bestK;
+            total += RICE_PARAMETER_BITS + static_cast<size_t>(bestBits);
+        }
+        if (total < best) {
+            best = total;
+            *partitionOrder = order;
+            bestParameters_.assign(parameters_.begin(), parameters_.begin() + partitions);
+        }
+    }
+    parameters_.assign(bestParameters_.begin(), bestParameters_.end());
+    return best;
+}
+
+void LosslessEncoder::writeResidual(const int *residual, unsigned count, int partitionOrder,
+                                    BitWriter &bits) {
+    bits.write(partitionOrder, 3);
+    int partitions = 1 << partitionOrder;
+    for (int p = 0; p < partitions; p++) {
+        unsigned begin = static_cast<unsigned>((static_cast<unsigned long long>(p) * count)
+                                               >> partitionOrder);
+        unsigned end = static_cast<unsigned>((static_cast<unsigned long long>(p + 1) * count)
+                                             >> partitionOrder);
+        int k = parameters_[p];
+        bits.write(k, RICE_PARAMETER_BITS);
+        if (k == RICE_ESCAPE) {
+            unsigned bitsOr = 0;
+            for (unsigned i = begin; i < end; i++) {
+                bitsOr |= zigzag(residual[i]);
+            }
+            int width = bitWidth(bitsOr);
+            bits.write(width, ESCAPE_WIDTH_BITS);
+            for (unsigned i = begin; i < end; i++) {
+                bits.write(zigzag(residual[i]), width);
+            }
+            continue;
+        }
+        for (unsigned i = begin; i < end; i++) {
+            unsigned u = zigzag(residual[i]);
+            bits.writeUnary(u >> k);
+            bits.write(u, k);
+        }
+    }
+}
+
+int LosslessEncoder::computeLpc(unsigned frames, int *coefficients, int *shift) {
+    int maxOrder = LOSSLESS_MAX_LPC_ORDER;
+    if (frames <= static_cast<unsigned>(4 * maxOrder)) {
+        return 0;
+    }
+    // Tukey(0.5) window, rebuilt only when the block length changes
+    if (window_.size() != frames) {
+        window_.resize(frames);
+        unsigned taper = frames / 4;
+        for (unsigned i = 0; i < frames; i++) {
+            double w = 1.0;
+            if (i < taper) {
+                w = 0.5 - 0.5 * cos(M_PI * i / taper);
+            } else if (i >= frames - taper) {
+                w = 0.5 - 0.5 * cos(M_PI * (frames - 1 - i) / taper);
+            }
+            window_[i] = w;
+        }
+    }
+    for (unsigned i = 0; i < frames; i++) {
+        windowed_[i] = signal_[i] * window_[i];
+    }
+    double autocorrelation[LOSSLESS_MAX_LPC_ORDER + 1];
+    for (int lag = 0; lag <= maxOrder; lag++) {
+        double sum = 0;
+        for (unsigned i = lag; i < frames; i++) {
+            sum += windowed_[i] * windowed_[i - lag];
+        }
+        autocorrelation[lag] = sum;
+    }
+    if (autocorrelation[0] <= 0) {
+        return 0;
+    }
+
+    // Levinson-Durbin, keeping the predictor of every order and choosing
+    // the one with the fewest estimated bits: half a bit per sample for
+    // every halving of the error, plus the coefficients and warm-up
+    double lpc[LOSSLESS_MAX_LPC_ORDER][LOSSLESS_MAX_LPC_ORDER];
+    double current[LOSSLESS_MAX_LPC_ORDER] = {0};
+    double error = autocorrelation[0];
+    int bestOrder = 0;
+    double bestBits = 0;
+    for (int order = 1; order <= maxOrder; order++) {
+        double reflection = -autocorrelation[order];
+        for (int j = 0; j < order - 1; j++) {
+            reflection -= current[j] * autocorrelation[order - 1 - j];
+        }
+        reflection /= error;
+        double previous[LOSSLESS_MAX_LPC_ORDER];
+        memcpy(previous, current, sizeof(previous));
+        current[order - 1] = reflection;
+        for (int j = 0; j < order - 1; j++) {
+            current[j] = previous[j] + reflection * previous[order - 2 - j];
+        }
+        error *= 1 - reflection * reflection;
+        if (error <= 0) {
+            break;
+        }
+        for (int j = 0; j < order; j++) {
+            lpc[order - 1][j] = -current[j];
+        }
+        double bits = 0.5 * log2(error / autocorrelation[0]) * (frames - order)
+                      + order * (LOSSLESS_LPC_PRECISION + 16);
+        if (bestOrder == 0 || bits < bestBits) {
+            bestOrder = order;
+            bestBits = bits;
+        }
+    }
+    if (bestOrder == 0) {
+        return 0;
+    }
+
+    const double *chosen = lpc[bestOrder - 1];
+    double largest = 0;
+    for (int j = 0; j < bestOrder; j++) {
+        largest = fmax(largest, fabs(chosen[j]));
+    }
+    if (largest <= 0) {
+        return 0;
+    }
+    // as many fractional bits as the largest coefficient leaves room for
+    int integerBits = static_cast<int>(floor(log2(largest))) + 1;
+    int s = LOSSLESS_LPC_PRECISION - 1 - integerBits;
+    s = s < 0 ? 0 : (s > 15 ? 15 : s);
+    const int limit = 1 << (LOSSLESS_LPC_PRECISION - 1);
+    // carry each rounding error into the next coefficient
+    double carried = 0;
+    for (int j = 0; j < bestOrder; j++) {
+        double scaled = chosen[j] * (1 << s) + carried;
+        long q = lround(scaled);
+        q = q >= limit ? limit - 1 : (q < -limit ? -limit : q);
+        carried = scaled - q;
+        coefficients[j] = static_cast<int>(q);
+    }
+    *shift = s;
+    return bestOrder;
+}
+
+void LosslessEncoder::encodeChannel(const short *samples, unsigned frames, BitWriter &bits) {
+    int *x = &signal_[0];
+    bool constant = true;
+    for (unsigned i = 0; i < frames; i++) {
+        x[i] = samples[i * channels_];
+        constant = constant && x[i] == x[0];
+    }
+    if (constant) {
+        bits.write(SUBFRAME_CONSTANT, 2);
+        bits.writeSigned(frames > 0 ? x[0] : 0, 16);
+        return;
+    }
+
+    // the fixed order with the smallest residual, by sum of magnitudes
+    int fixedOrder = 0;
+    unsigned long long smallest = ~0ULL;
+    for (int order = 0; order <= MAX_FIXED_ORDER && static_cast<unsigned>(order) < frames;
+         order++) {
+        fixedResidual(x, frames, order, &residual_[0]);
+        unsigned long long sum = 0;
+        for (unsigned i = 0; i + order < frames; i++) {
+            sum += zigzag(residual_[i]);
+        }
+        if (sum < smallest) {
+            smallest = sum;
+            fixedOrder = order;
+        }
+    }
+    fixedResidual(x, frames, fixedOrder, &bestResidual_[0]);
+    int bestPartitionOrder;
+    size_t bestBits = 2 + 3 + 16 * fixedOrder
+                      + residualBits(&bestResidual_[0], frames - fixedOrder, &bestPartitionOrder);
+    int chosenParameters[1 << LOSSLESS_MAX_PARTITION_ORDER];
+    std::copy(parameters_.begin(), parameters_.end(), chosenParameters);
+    int type = SUBFRAME_FIXED;
+
+    int coefficients[LOSSLESS_MAX_LPC_ORDER];
+    int shift = 0;
+    int lpcOrder = computeLpc(frames, coefficients, &shift);
+    if (lpcOrder > 0 && lpcResidual(x, frames, coefficients, lpcOrder, shift, &residual_[0])) {
+        int partitionOrder;
+        size_t lpcBits = 2 + 4 + 5 + lpcOrder * (LOSSLESS_LPC_PRECISION + 16)
+                         + residualBits(&residual_[0], frames - lpcOrder, &partitionOrder);
+        if (lpcBits < bestBits) {
+            bestBits = lpcBits;
+            bestPartitionOrder = partitionOrder;
+            std::copy(parameters_.begin(), parameters_.end(), chosenParameters);
+            bestResidual_.swap(residual_);
+            type = SUBFRAME_LPC;
+        }
+    }
+
+    if (bestBits >= 2 + 16 * static_cast<size_t>(frames)) {
+        bits.write(SUBFRAME_VERBATIM, 2);
+        for (unsigned i = 0; i < frames; i++) {
+            bits.writeSigned(x[i], 16);
+        }
+        return;
+    }
+    bits.write(type, 2);
+    int warmUp;
+    if (type == SUBFRAME_FIXED) {
+        bits.write(fixedOrder, 3);
+        warmUp = fixedOrder;
+    } else {
+        bits.write(lpcOrder - 1, 4);
+        bits.write(shift, 5);
+        for (int j = 0; j < lpcOrder; j++) {
+            bits.writeSigned(coefficients[j], LOSSLESS_LPC_PRECISION);
+        }
+        warmUp = lpcOrder;
+    }
+    for (int i = 0; i < warmUp; i++) {
+        bits.writeSigned(x[i], 16);
+    }
+    parameters_.assign(chosenParameters, chosenParameters + (1 << bestPartitionOrder));
+    writeResidual(&bestResidual_[0], frames - warmUp, bestPartitionOrder, bits);
+}
+
+LosslessDecoder::LosslessDecoder(int channels) : channels_(channels) {}
+
+bool LosslessDecoder::decode(const unsigned char *data, size_t bytes, unsigned frames,
+                             short *samples) {
+    if (signal_.size() < frames) {
+        signal_.resize(frames);
+    }
+    BitReader bits(data, bytes);
+    for (int c = 0; c < channels_; c++) {
+        if (!decodeChannel(bits, frames, samples + c)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool LosslessDecoder::decodeChannel(BitReader &bits, unsigned frames, short *samples) {
+    int *x = &signal_[0];
+    int type = static_cast<int>(bits.read(2));
+    if (type == SUBFRAME_CONSTANT) {
+        short value = static_cast<short>(bits.readSigned(16));
+        for (unsigned i = 0; i < frames; i++) {
+            samples[i * channels_] = value;
+        }
+        return !bits.failed();
+    }
+    if (type == SUBFRAME_VERBATIM) {
+        for (unsigned i = 0; i < frames; i++) {
+            samples[i * channels_] = static_cast<short>(bits.readSigned(16));
+        }
+        return !bits.failed();
+    }
+
+    int order;
+    int coefficients[LOSSLESS_MAX_LPC_ORDER];
+    int shift = 0;
+    if (type == SUBFRAME_FIXED) {
+        order = static_cast<int>(bits.read(3));
+        if (order > MAX_FIXED_ORDER) {
+            return false;
+        }
+    } else {
+        order = static_cast<int>(bits.read(4)) + 1;
+        shift = static_cast<int>(bits.read(5));
+        if (order > LOSSLESS_MAX_LPC_ORDER) {
+            return false;
+        }
+        for (int j = 0; j < order; j++) {
+            coefficients[j] = bits.readSigned(LOSSLESS_LPC_PRECISION);
+        }
+    }
+    if (static_cast<unsigned>(order) > frames) {
+        return false;
+    }
+    for (int i = 0; i < order; i++) {
+        x[i] = bits.readSigned(16);
+    }
+
+    // the residual, decoded in place behind the warm-up samples
+    unsigned count = frames - order;
+    int *residual = x + order;
+    int partitionOrder = static_cast<int>(bits.read(3));
+    if (partitionOrder > LOSSLESS_MAX_PARTITION_ORDER) {
+        return false;
+    }
+    int partitions = 1 << partitionOrder;
+    for (int p = 0; p < partitions && !bits.failed(); p++) {
+        unsigned begin = static_cast<unsigned>((static_cast<unsigned long long>(p) * count)
+                                               >> partitionOrder);
+        unsigned end = static_cast<unsigned>((static_cast<unsigned long long>(p + 1) * count)
+                                             >> partitionOrder);
+        int k = static_cast<int>(bits.read(RICE_PARAMETER_BITS));
+        if (k == RICE_ESCAPE) {
+            int width = static_cast<int>(bits.read(ESCAPE_WIDTH_BITS));
+            if (width > 32) {
+                return false;
+            }
+            for (unsigned i = begin; i < end; i++) {
+                residual[i] = unzigzag(bits.read(width));
+            }
+            continue;
+        }
+        for (unsigned i = begin; i < end && !bits.failed(); i++) {
+            unsigned q = bits.readUnary();
+            residual[i] = unzigzag(q << k | bits.read(k));
+        }
+    }
+    if (bits.failed()) {
+        return false;
+    }
+
+    // predict forwards over the residual; x[i] only ever overwrites the
+    // residual it was made from
+    if (type == SUBFRAME_FIXED) {
+        fixedRestore(x, frames, order, residual);
+    } else {
+        for (unsigned i = order; i < frames; i++) {
+            x[i] = static_cast<int>(x[i] + lpcPrediction(x, i, coefficients, order, shift));
+        }
+    }
+    for (unsigned i = 0; i < frames; i++) {
+        if (x[i] < -32768 || x[i] > 32767) {
+            return false;
+        }
+        samples[i * channels_] = static_cast<short>(x[i]);
+    }
+    return true;
+}
@@ -0,0 +1,79 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_LOSSLESSCODEC_H
+#define NATIVEFEEDBACK_LOSSLESSCODEC_H
+
+#include <cstddef>
+#include <vector>
+
+// frames per block: ~93ms at 44.1 kHz, long enough for the predictor to pay
+// for its coefficients, short enough to follow the signal
+#define LOSSLESS_BLOCK_FRAMES 4096
+#define LOSSLESS_MAX_LPC_ORDER 12
+// bits per quantised LPC coefficient, sign included
+#define LOSSLESS_LPC_PRECISION 14
+// Rice partitions per block are 2^order for order up to this
+#define LOSSLESS_MAX_PARTITION_ORDER 6
+
+// FLAC-style lossless coding of one block of 16-bit PCM.
+//
+// Each channel of a block becomes a subframe: a constant, the samples
+// verbatim, or a predictor plus its Rice-coded residual. The predictor is
+// either one of the fixed polynomials of order 0-4 or a linear predictor
+// found by Levinson-Durbin on the windowed autocorrelation, with quantised
+// coefficients, whichever codes smaller. The residual is split into 2^p
+// partitions with a Rice parameter each, p and the parameters chosen from
+// the partition sums; a partition that Rice coding would blow up is stored
+// as raw fixed-width values instead.
+//
+// No state carries over between blocks, so each one decodes on its own.
+// Neither side allocates once it has seen its first full block.
+class LosslessEncoder {
+public:
+    explicit LosslessEncoder(int channels);
+
+    // appends the coded block of frames (at most LOSSLESS_BLOCK_FRAMES) of
+    // interleaved samples to out
+    void encode(const short *samples, unsigned frames, std::vector<unsigned char> *out);
+
+private:
+    class BitWriter;
+
+    void encodeChannel(const short *samples, unsigned frames, BitWriter &bits);
+    // bits the residual takes with the best partitioning, which goes to
+    // *partitionOrder and parameters_
+    size_t residualBits(const int *residual, unsigned count, int *partitionOrder);
+    void writeResidual(const int *residual, unsigned count, int partitionOrder, BitWriter &bits);
+    int computeLpc(unsigned frames, int *coefficients, int *shift);
+
+    const int channels_;
+    // one channel of the block
+    std::vector<int> signal_;
+    std::vector<int> residual_;
+    std::vector<int> bestResidual_;
+    std::vector<double> windowed_;
+    std::vector<double> window_;
+    std::vector<int> parameters_;
+    std::vector<int> bestParameters_;
+};
+
+class LosslessDecoder {
+public:
+    explicit LosslessDecoder(int channels);
+
+    // decodes one block made by LosslessEncoder::encode of frames frames.
+    // False if it's damaged; samples is then undefined.
+    bool decode(const unsigned char *data, size_t bytes, unsigned frames, short *samples);
+
+private:
+    class BitReader;
+
+    bool decodeChannel(BitReader &bits, unsigned frames, short *samples);
+
+    const int channels_;
+    std::vector<int> signal_;
+};
+
+#endif //NATIVEFEEDBACK_LOSSLESSCODEC_H
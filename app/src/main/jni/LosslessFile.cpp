@@ -0,0 +1,336 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "LosslessFile.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#define LOG_TAG "NativeLosslessFile"
+
+#include "Log.h"
+
+static const unsigned char MAGIC[4] = {'N', 'F', 'L', 'A'};
+static const int VERSION = 1;
+static const unsigned FRAME_SYNC = 0xF1AC;
+static const unsigned char INDEX_MAGIC[4] = {'N', 'F', 'I', 'X'};
+static const int INDEX_VERSION = 1;
+static const size_t INDEX_HEADER_BYTES = 28;
+// nothing the encoder writes comes close; anything bigger is damage
+static const unsigned MAX_PAYLOAD_BYTES =
+        LOSSLESS_BLOCK_FRAMES * 8 * sizeof(short) + 1024;
+
+static void putLe(unsigned char *p, unsigned long long value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+static unsigned getLe(const unsigned char *p, int bytes) {
+    unsigned value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        value = value << 8 | p[i];
+    }
+    return value;
+}
+
+static unsigned long long getLe64(const unsigned char *p) {
+    return static_cast<unsigned long long>(getLe(p + 4, 4)) << 32 | getLe(p, 4);
+}
+
+void LosslessIndex::clear() {
+    offsets_.clear();
+    frames_ = 0;
+}
+
+void LosslessIndex::add(unsigned long long offset, unsigned frames) {
+    offsets_.push_back(offset);
+    frames_ += frames;
+}
+
+std::string LosslessIndex::indexPathFor(const char *path) {
+    return std::string(path) + ".nfidx";
+}
+
+bool LosslessIndex::save(const char *indexPath, unsigned long long fileBytes) const {
+    FILE *file = fopen(indexPath, "wb");
+    if (file == NULL) {
+        return false;
+    }
+    std::vector<unsigned char> bytes(INDEX_HEADER_BYTES + 4 * offsets_.size(), 0);
+    memcpy(&bytes[0], INDEX_MAGIC, 4);
+    bytes[4] = INDEX_VERSION;
+    putLe(&bytes[8], fileBytes, 8);
+    putLe(&bytes[16], frames_, 8);
+    putLe(&bytes[24], offsets_.size(), 4);
+    for (size_t i = 0; i < offsets_.size(); i++) {
+        unsigned long long end = i + 1 < offsets_.size() ? offsets_[i + 1] : fileBytes;
+        putLe(&bytes[INDEX_HEADER_BYTES + 4 * i], end - offsets_[i], 4);
+    }
+    bool ok = fwrite(&bytes[0], 1, bytes.size(), file) == bytes.size();
+    return fclose(file) == 0 && ok;
+}
+
+bool LosslessIndex::load(const char *indexPath, unsigned long long fileBytes) {
+    clear();
+    FILE *file = fopen(indexPath, "rb");
+    if (file == NULL) {
+        return false;
+    }
+    unsigned char header[INDEX_HEADER_BYTES];
+    bool ok = fread(header, 1, sizeof(header), file) == sizeof(header)
+              && memcmp(header, INDEX_MAGIC, 4) == 0 && header[4] == INDEX_VERSION
+              && getLe64(header + 8) == fileBytes;
+    size_t count = ok ? getLe(header + 24, 4) : 0;
+    std::vector<unsigned char> sizes(4 * count);
+    ok = ok && fread(sizes.data(), 1, sizes.size(), file) == sizes.size();
+    fclose(file);
+    // the frames have to add up to the file exactly
+    unsigned long long offset = LOSSLESS_FILE_HEADER_BYTES;
+    for (size_t i = 0; ok && i < count; i++) {
+        offsets_.push_back(offset);
+        offset += getLe(&sizes[4 * i], 4);
+    }
+    if (!ok || offset != fileBytes) {
+        clear();
+        return false;
+    }
+    frames_ = getLe64(header + 16);
+    return true;
+}
+
+bool LosslessIndex::scan(const char *path) {
+    clear();
+    std::ifstream in(path, std::ios_base::in | std::ios_base::binary);
+    if (!in.seekg(0, std::ios_base::end)) {
+        return false;
+    }
+    unsigned long long fileBytes = static_cast<unsigned long long>(in.tellg());
+    unsigned long long offset = LOSSLESS_FILE_HEADER_BYTES;
+    unsigned char header[LOSSLESS_FRAME_HEADER_BYTES];
+    while (offset + sizeof(header) <= fileBytes && in.seekg(static_cast<std::streamoff>(offset))
+           && in.read(reinterpret_cast<char *>(header), sizeof(header))) {
+        unsigned frames = getLe(header + 2, 2);
+        unsigned long long end = offset + sizeof(header) + getLe(header + 4, 4);
+        // a frame torn off by a crash isn't played either
+        if (getLe(header, 2) != FRAME_SYNC || frames == 0 || frames > LOSSLESS_BLOCK_FRAMES
+            || end > fileBytes) {
+            break;
+        }
+        add(offset, frames);
+        offset = end;
+    }
+    return !offsets_.empty();
+}
+
+LosslessWriter::LosslessWriter() : channels_(0), blockFrames_(0), fileBytes_(0), failed_(false) {}
+
+bool LosslessWriter::isLosslessPath(const char *path) {
+    size_t length = strlen(path);
+    return length > 5 && strcmp(path + length - 5, ".nfla") == 0;
+}
+
+bool LosslessWriter::open(const char *path, int sampleRate, int channels) {
+    close();
+    if (channels < 1 || channels > 8) {
+        return false;
+    }
+    if (!file_.open(path, sampleRate, channels, false)) {
+        return false;
+    }
+    if (encoder_ == NULL || channels != channels_) {
+        encoder_.reset(new LosslessEncoder(channels));
+        block_.resize(LOSSLESS_BLOCK_FRAMES * channels);
+        encoded_.reserve(LOSSLESS_FRAME_HEADER_BYTES + block_.size() * sizeof(short));
+    }
+    channels_ = channels;
+    blockFrames_ = 0;
+    failed_ = false;
+    path_ = path;
+    index_.clear();
+
+    unsigned char header[LOSSLESS_FILE_HEADER_BYTES];
+    memcpy(header, MAGIC, 4);
+    header[4] = VERSION;
+    header[5] = static_cast<unsigned char>(channels);
+    putLe(header + 6, 16, 2);
+    putLe(header + 8, sampleRate, 4);
+    putLe(header + 12, LOSSLESS_BLOCK_FRAMES, 4);
+    failed_ = !file_.write(header, sizeof(header));
+    fileBytes_ = sizeof(header);
+    return true;
+}
+
+bool LosslessWriter::write(const short *samples, size_t frames) {
+    if (!file_.isOpen()) {
+        return false;
+    }
+    while (frames > 0) {
+        size_t n = LOSSLESS_BLOCK_FRAMES - blockFrames_;
+        if (n > frames) {
+            n = frames;
+        }
+        memcpy(&block_[blockFrames_ * channels_], samples, n * channels_ * sizeof(short));
+        blockFrames_ += n;
+        samples += n * channels_;
+        frames -= n;
+        if (blockFrames_ == LOSSLESS_BLOCK_FRAMES) {
+            encodeBlock();
+        }
+    }
+    return !failed_;
+}
+
+void LosslessWriter::encodeBlock() {
+    encoded_.resize(LOSSLESS_FRAME_HEADER_BYTES);
+    encoder_->encode(&block_[0], blockFrames_, &encoded_);
+    unsigned char *header = &encoded_[0];
+    putLe(header, FRAME_SYNC, 2);
+    putLe(header + 2, blockFrames_, 2);
+    putLe(header + 4, encoded_.size() - LOSSLESS_FRAME_HEADER_BYTES, 4);
+    if (!file_.write(&encoded_[0], encoded_.size())) {
+        failed_ = true;
+    }
+    index_.add(fileBytes_, blockFrames_);
+    fileBytes_ += encoded_.size();
+    blockFrames_ = 0;
+}
+
+bool LosslessWriter::close() {
+    if (!file_.isOpen()) {
+        return true;
+    }
+    if (blockFrames_ > 0) {
+        encodeBlock();
+    }
+    bool ok = file_.close() && !failed_;
+    if (ok && !index_.save(LosslessIndex::indexPathFor(path_.c_str()).c_str(), fileBytes_)) {
+        LOGI("%s: no seek index, readers will scan", path_.c_str());
+    }
+    return ok;
+}
+
+LosslessPcmSource::LosslessPcmSource() : channels_(0), decodedHead_(0), decodedBytes_(0) {}
+
+bool LosslessPcmSource::probe(const char *path, LosslessInfo *info) {
+    std::ifstream in(path, std::ios_base::in | std::ios_base::binary);
+    unsigned char header[LOSSLESS_FILE_HEADER_BYTES];
+    if (!in.read(reinterpret_cast<char *>(header), sizeof(header))
+        || memcmp(header, MAGIC, 4) != 0) {
+        return false;
+    }
+    if (header[4] != VERSION || header[5] < 1 || header[5] > 8 || getLe(header + 6, 2) != 16
+        || getLe(header + 12, 4) != LOSSLESS_BLOCK_FRAMES) {
+        LOGI("%s: unsupported lossless file", path);
+        return false;
+    }
+    info->channels = header[5];
+    info->sampleRate = static_cast<int>(getLe(header + 8, 4));
+    info->blockFrames = getLe(header + 12, 4);
+    return true;
+}
+
+bool LosslessPcmSource::open(const char *path) {
+    close();
+    LosslessInfo info;
+    if (!probe(path, &info)) {
+        return false;
+    }
+    input_.open(path, std::ios_base::in | std::ios_base::binary);
+    if (!input_.is_open()) {
+        return false;
+    }
+    if (decoder_ == NULL || info.channels != channels_) {
+        decoder_.reset(new LosslessDecoder(info.channels));
+        decoded_.resize(LOSSLESS_BLOCK_FRAMES * info.channels);
+        payload_.reserve(MAX_PAYLOAD_BYTES);
+    }
+    channels_ = info.channels;
+    // the writer's index if it's of this file, otherwise a scan
+    unsigned long long fileBytes = 0;
+    if (input_.seekg(0, std::ios_base::end)) {
+        fileBytes = static_cast<unsigned long long>(input_.tellg());
+    }
+    if (!index_.load(LosslessIndex::indexPathFor(path).c_str(), fileBytes)) {
+        index_.scan(path);
+    }
+    if (!input_.seekg(LOSSLESS_FILE_HEADER_BYTES)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool LosslessPcmSource::decodeFrame() {
+    unsigned char header[LOSSLESS_FRAME_HEADER_BYTES];
+    if (!input_.read(reinterpret_cast<char *>(header), sizeof(header))) {
+        return false;
+    }
+    unsigned frames = getLe(header + 2, 2);
+    unsigned bytes = getLe(header + 4, 4);
+    if (getLe(header, 2) != FRAME_SYNC || frames == 0 || frames > LOSSLESS_BLOCK_FRAMES
+        || bytes > MAX_PAYLOAD_BYTES) {
+        LOGI("damaged lossless frame");
+        return false;
+    }
+    payload_.resize(bytes);
+    // a frame torn off by a crash ends the file
+    if (!input_.read(reinterpret_cast<char *>(&payload_[0]), bytes)
+        || !decoder_->decode(&payload_[0], bytes, frames, &decoded_[0])) {
+        return false;
+    }
+    decodedHead_ = 0;
+    decodedBytes_ = frames * channels_ * sizeof(short);
+    return true;
+}
+
+size_t LosslessPcmSource::read(void *dst, size_t bytes) {
+    unsigned char *out = static_cast<unsigned char *>(dst);
+    size_t copied = 0;
+    while (copied < bytes) {
+        if (decodedBytes_ == 0 && !decodeFrame()) {
+            break;
+        }
+        size_t n = bytes - copied;
+        if (n > decodedBytes_) {
+            n = decodedBytes_;
+        }
+        memcpy(out + copied, reinterpret_cast<unsigned char *>(&decoded_[0]) + decodedHead_, n);
+        decodedHead_ += n;
+        decodedBytes_ -= n;
+        copied += n;
+    }
+    return copied;
+}
+
+bool LosslessPcmSource::seek(unsigned long long byte) {
+    size_t frameBytes = channels_ * sizeof(short);
+    unsigned long long frame = std::min(byte / frameBytes, index_.frames());
+    size_t block = static_cast<size_t>(frame / LOSSLESS_BLOCK_FRAMES);
+    input_.clear();
+    decodedHead_ = 0;
+    decodedBytes_ = 0;
+    if (block >= index_.blocks()) {
+        // the end: nothing left to read
+        return static_cast<bool>(input_.seekg(0, std::ios_base::end));
+    }
+    if (!input_.seekg(static_cast<std::streamoff>(index_.offset(block))) || !decodeFrame()) {
+        return false;
+    }
+    size_t skip = static_cast<size_t>(frame - block * LOSSLESS_BLOCK_FRAMES) * frameBytes;
+    skip = std::min(skip, decodedBytes_);
+    decodedHead_ += skip;
+    decodedBytes_ -= skip;
+    return true;
+}
+
+void LosslessPcmSource::close() {
+    if (input_.is_open()) {
+        input_.close();
+    }
+    input_.clear();
+    decodedHead_ = 0;
+    decodedBytes_ = 0;
+    index_.clear();
+}
@@ -0,0 +1,133 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_LOSSLESSFILE_H
+#define NATIVEFEEDBACK_LOSSLESSFILE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "LosslessCodec.h"
+#include "PcmSource.h"
+#include "WavFile.h"
+
+// .nfla: a 16 byte file header ("NFLA", version, channels, bits per
+// sample, rate, frames per block), then one frame per block of
+// LOSSLESS_BLOCK_FRAMES: a sync word, the block's frame count and payload
+// size, and the payload from LosslessEncoder. Every frame decodes on its
+// own, so a file cut short by a crash plays up to its last whole frame.
+#define LOSSLESS_FILE_HEADER_BYTES 16
+#define LOSSLESS_FRAME_HEADER_BYTES 8
+
+struct LosslessInfo {
+    int sampleRate;
+    int channels;
+    unsigned blockFrames;
+};
+
+// Where every frame of a .nfla file starts, so playback can seek without
+// decoding its way there: frame k holds the samples from k *
+// LOSSLESS_BLOCK_FRAMES on. The writer keeps one as it goes and leaves it
+// next to the file as path + ".nfidx": "NFIX", a version byte and three
+// zero bytes, the .nfla's size and its frame count in 8 bytes each, the
+// number of frames in 4, then each frame's size in 4, 4 bytes per
+// LOSSLESS_BLOCK_FRAMES of audio. The size ties the index to the file;
+// without a matching one the reader scans the frame headers on open.
+class LosslessIndex {
+public:
+    LosslessIndex() : frames_(0) {}
+
+    void clear();
+    // the next frame: frames of audio at offset in the file
+    void add(unsigned long long offset, unsigned frames);
+    // false unless indexPath is an index of a .nfla of fileBytes
+    bool load(const char *indexPath, unsigned long long fileBytes);
+    bool save(const char *indexPath, unsigned long long fileBytes) const;
+    // walks the frame headers of the .nfla at path, up to the end or the
+    // first damage, reading 8 bytes a frame
+    bool scan(const char *path);
+
+    size_t blocks() const { return offsets_.size(); }
+    unsigned long long offset(size_t block) const { return offsets_[block]; }
+    unsigned long long frames() const { return frames_; }
+
+    static std::string indexPathFor(const char *path);
+
+private:
+    std::vector<unsigned long long> offsets_;
+    unsigned long long frames_;
+};
+
+// Compresses 16-bit PCM into a .nfla file as it's written. Blocks are
+// encoded on the calling thread, the capture writer thread in practice,
+// and go to disk through a headerless WavWriter.
+class LosslessWriter {
+public:
+    LosslessWriter();
+
+    bool open(const char *path, int sampleRate, int channels);
+    bool write(const short *samples, size_t frames);
+    // encodes the last, short block, closes the file and writes its
+    // index; false if any write since open() failed. A missing index only
+    // costs the reader a scan, so it doesn't count.
+    bool close();
+    bool isOpen() const { return file_.isOpen(); }
+    // compressed bytes so far, headers included
+    unsigned long long fileBytes() const { return fileBytes_; }
+
+    // true when path ends in .nfla
+    static bool isLosslessPath(const char *path);
+
+private:
+    LosslessWriter(const LosslessWriter &);
+    LosslessWriter &operator=(const LosslessWriter &);
+
+    void encodeBlock();
+
+    WavWriter file_;
+    std::unique_ptr<LosslessEncoder> encoder_;
+    int channels_;
+    // the block being filled
+    std::vector<short> block_;
+    unsigned blockFrames_;
+    std::vector<unsigned char> encoded_;
+    unsigned long long fileBytes_;
+    bool failed_;
+    std::string path_;
+    LosslessIndex index_;
+};
+
+// Plays a .nfla file by decoding it a block at a time on the reading
+// thread. A seek decodes the one frame it lands in, found in the index.
+class LosslessPcmSource : public PcmSource {
+public:
+    LosslessPcmSource();
+
+    // false unless path is a .nfla file this build can decode
+    static bool probe(const char *path, LosslessInfo *info);
+
+    bool open(const char *path);
+    size_t read(void *dst, size_t bytes) override;
+    void close() override;
+    // bytes of the decoded audio
+    bool seek(unsigned long long byte) override;
+    unsigned long long size() const override { return index_.frames() * channels_ * sizeof(short); }
+
+private:
+    // decodes the next frame into decoded_, false at the end or on damage
+    bool decodeFrame();
+
+    std::ifstream input_;
+    std::unique_ptr<LosslessDecoder> decoder_;
+    int channels_;
+    std::vector<unsigned char> payload_;
+    std::vector<short> decoded_;
+    // bytes of decoded_ still to hand out, from decodedHead_
+    size_t decodedHead_;
+    size_t decodedBytes_;
+    LosslessIndex index_;
+};
+
+#endif //NATIVEFEEDBACK_LOSSLESSFILE_H
@@ -0,0 +1,120 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "MappedPcmSource.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+MappedPcmFile::MappedPcmFile() : fd_(-1), base_(NULL), mapSize_(0), offset_(0), size_(0) {}
+
+MappedPcmFile::~MappedPcmFile() {
+    close();
+}
+
+bool MappedPcmFile::open(const char *path, unsigned long long offset, unsigned long long length) {
+    close();
+    fd_ = ::open(path, O_RDONLY);
+    if (fd_ < 0) {
+        return false;
+    }
+    // the size the mapping is pinned to; see the header about files that
+    // shrink under it
+    struct stat info;
+    if (fstat(fd_, &info) != 0 || !S_ISREG(info.st_mode)) {
+        close();
+        return false;
+    }
+    unsigned long long available = static_cast<unsigned long long>(info.st_size);
+    available = offset < available ? available - offset : 0;
+    if (length > available) {
+        length = available;
+    }
+    if (length == 0) {
+        // nothing to map, an empty file plays as an empty stream
+        return true;
+    }
+    // a window that doesn't fit in the address space, e.g. an RF64 file on a
+    // 32-bit device, has to be streamed instead
+    unsigned long long end = offset + length;
+    if (end != static_cast<size_t>(end)) {
+        close();
+        return false;
+    }
+    void *base = mmap(NULL, static_cast<size_t>(end), PROT_READ, MAP_SHARED, fd_, 0);
+    if (base == MAP_FAILED) {
+        close();
+        return false;
+    }
+    base_ = base;
+    mapSize_ = static_cast<size_t>(end);
+    offset_ = static_cast<size_t>(offset);
+    size_ = static_cast<size_t>(length);
+    madvise(base_, mapSize_, MADV_SEQUENTIAL);
+    return true;
+}
+
+void MappedPcmFile::close() {
+    if (base_ != NULL) {
+        munmap(base_, mapSize_);
+        base_ = NULL;
+    }
+    mapSize_ = 0;
+    offset_ = 0;
+    size_ = 0;
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+void MappedPcmFile::willNeed(size_t offset, size_t length) const {
+    if (offset >= size_) {
+        return;
+    }
+    length = std::min(length, size_ - offset);
+    // madvise wants a page aligned start, within the whole mapping
+    offset += offset_;
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t start = offset / pageSize * pageSize;
+    madvise(static_cast<char *>(base_) + start, length + offset - start, MADV_WILLNEED);
+}
+
+void MappedPcmFile::touch(size_t offset, size_t length) const {
+    if (offset >= size_) {
+        return;
+    }
+    size_t end = offset + std::min(length, size_ - offset);
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    const volatile unsigned char *bytes = data();
+    for (size_t i = offset; i < end; i += pageSize) {
+        (void) bytes[i];
+    }
+}
+
+bool MappedPcmSource::open(const char *path, unsigned long long offset, unsigned long long length) {
+    cursor_ = 0;
+    return file_.open(path, offset, length);
+}
+
+size_t MappedPcmSource::read(void *dst, size_t bytes) {
+    size_t n = std::min(bytes, file_.size() - cursor_);
+    memcpy(dst, file_.data() + cursor_, n);
+    cursor_ += n;
+    return n;
+}
+
+bool MappedPcmSource::seek(unsigned long long byte) {
+    cursor_ = static_cast<size_t>(std::min<unsigned long long>(byte, file_.size()));
+    return true;
+}
+
+void MappedPcmSource::close() {
+    file_.close();
+    cursor_ = 0;
+}
@@ -0,0 +1,71 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_MAPPEDPCMSOURCE_H
+#define NATIVEFEEDBACK_MAPPEDPCMSOURCE_H
+
+#include <cstddef>
+
+#include "PcmSource.h"
+
+// Read-only mapping of a whole PCM file, advised for sequential access so the
+// kernel reads ahead of playback. data() and size() cover the window of
+// length bytes at offset, e.g. the data chunk of a WAV file, and offsets
+// below count from its start.
+//
+// The size is taken once, by open(), and the fd stays open with the
+// mapping. The file must not be truncated or rewritten while it's mapped:
+// touching a page past a shrunk end raises SIGBUS, on the audio thread
+// when it's played zero-copy. Files that may change under the player
+// should be played with SOURCE_STREAM.
+class MappedPcmFile {
+public:
+    MappedPcmFile();
+    ~MappedPcmFile();
+
+    bool open(const char *path, unsigned long long offset = 0,
+              unsigned long long length = ~0ULL);
+    void close();
+
+    const unsigned char *data() const { return static_cast<const unsigned char *>(base_) + offset_; }
+    size_t size() const { return size_; }
+
+    // asks the kernel to start reading [offset, offset + length) in the
+    // background; never blocks on the disk
+    void willNeed(size_t offset, size_t length) const;
+    // faults [offset, offset + length) in by reading one byte per page, so the
+    // audio thread doesn't take the page faults itself
+    void touch(size_t offset, size_t length) const;
+
+private:
+    MappedPcmFile(const MappedPcmFile &);
+    MappedPcmFile &operator=(const MappedPcmFile &);
+
+    int fd_;
+    void *base_;
+    size_t mapSize_;
+    size_t offset_;
+    size_t size_;
+};
+
+// PcmSource view of a mapped file, for when the samples need converting on
+// their way to the player and can't be enqueued in place
+class MappedPcmSource : public PcmSource {
+public:
+    MappedPcmSource() : cursor_(0) {}
+
+    bool open(const char *path, unsigned long long offset = 0, unsigned long long length = ~0ULL);
+    size_t read(void *dst, size_t bytes) override;
+    void close() override;
+    bool seek(unsigned long long byte) override;
+    unsigned long long size() const override { return file_.size(); }
+
+    const MappedPcmFile &file() const { return file_; }
+
+private:
+    MappedPcmFile file_;
+    size_t cursor_;
+};
+
+#endif //NATIVEFEEDBACK_MAPPEDPCMSOURCE_H
@@ -0,0 +1,434 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "Mixer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#define LOG_TAG "NativeMixer"
+
+#include "Log.h"
+#include "PcmConvert.h"
+
+// the mic is played at most this many bursts behind; anything older is
+// dropped, so drift between the two clocks can't build up latency
+static const unsigned MIC_MAX_BACKLOG_BURSTS = 4;
+
+Mixer::Slot::Slot()
+        : state(SLOT_FREE), gain(1.0f), pan(0.0f), kind(MIXER_SOURCE_MEMORY), channels(0),
+          memory(NULL), memoryFrames(0), memoryCursor(0), delayFrames(0), pending(NULL),
+          pendingFrames(0), holding(false) {
+    applied[0] = applied[1] = 0;
+}
+
+Mixer::Mixer(AudioBackend *backend)
+        : backend_(backend), player_(NULL), recorder_(NULL), sampleRate_(0), framesPerBurst_(0),
+          playerQueueDepth_(0), playerNext_(0), limiterGain_(1.0f), limiterRelease_(0),
+          micNext_(0), bursts_(0), limitedBursts_(0) {}
+
+Mixer::~Mixer() {
+    stop();
+}
+
+bool Mixer::start(int sampleRate, int framesPerBurst, int playerQueueDepth) {
+    stop();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (sampleRate <= 0 || framesPerBurst <= 0 || playerQueueDepth <= 0) {
+        return false;
+    }
+    sampleRate_ = sampleRate;
+    framesPerBurst_ = static_cast<unsigned>(framesPerBurst);
+    playerQueueDepth_ = playerQueueDepth;
+    playerBuffers_.assign(playerQueueDepth_ * framesPerBurst_ * 2, 0);
+    playerNext_ = 0;
+    bus_.assign(framesPerBurst_ * 2, 0.0f);
+    limiterGain_ = 1.0f;
+    limiterRelease_ = static_cast<float>(
+            1.0 - exp(-1000.0 / (MIXER_LIMITER_RELEASE_MS * static_cast<double>(sampleRate))));
+
+    micBuffers_.assign(MIXER_MIC_QUEUE_DEPTH * framesPerBurst_, 0);
+    micScratch_.assign(framesPerBurst_, 0);
+    size_t capacity = 1;
+    while (capacity < 2 * MIC_MAX_BACKLOG_BURSTS * framesPerBurst_ * sizeof(short)) {
+        capacity *= 2;
+    }
+    micMemory_.assign((SharedPcmRing::HEADER_BYTES + capacity) / sizeof(unsigned), 0);
+    bursts_.store(0, std::memory_order_relaxed);
+    limitedBursts_.store(0, std::memory_order_relaxed);
+
+    StreamFormat format;
+    format.sampleRate = sampleRate;
+    format.channels = 2;
+    player_ = backend_->createPlayer(format, playerQueueDepth_);
+    if (player_ == NULL || !player_->registerCallback(playerCallback, this)) {
+        LOGI("can't create the mixer player");
+        delete player_;
+        player_ = NULL;
+        return false;
+    }
+    // silence to begin with; the callback takes it from there
+    unsigned burstSamples = framesPerBurst_ * 2;
+    for (int i = 0; i < playerQueueDepth_; i++) {
+        player_->enqueue(&playerBuffers_[i * burstSamples], burstSamples * sizeof(short));
+    }
+    if (!player_->start()) {
+        LOGI("can't start the mixer player");
+        delete player_;
+        player_ = NULL;
+        return false;
+    }
+    return true;
+}
+
+void Mixer::stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (player_ != NULL) {
+        // once it's deleted its callback has returned for good, and the
+        // slots can be torn down without asking
+        player_->stop();
+        delete player_;
+        player_ = NULL;
+    }
+    for (int id = 0; id < MIXER_MAX_SOURCES; id++) {
+        release(id);
+    }
+    stopMic();
+}
+
+int Mixer::claimSlot() {
+    for (int id = 0; id < MIXER_MAX_SOURCES; id++) {
+        int expected = SLOT_FREE;
+        if (slots_[id].state.compare_exchange_strong(expected, SLOT_BUSY,
+                                                     std::memory_order_acquire)) {
+            return id;
+        }
+    }
+    // full: make room by reclaiming a source that has played out
+    for (int id = 0; id < MIXER_MAX_SOURCES; id++) {
+        if (slots_[id].state.load(std::memory_order_acquire) == SLOT_FINISHED) {
+            release(id);
+            slots_[id].state.store(SLOT_BUSY, std::memory_order_relaxed);
+            return id;
+        }
+    }
+    return -1;
+}
+
+void Mixer::publish(int id, MixerSourceKind kind, int channels, float gain, float pan,
+                    unsigned delayFrames) {
+    Slot &slot = slots_[id];
+    slot.kind = kind;
+    slot.channels = channels;
+    slot.gain.store(gain, std::memory_order_relaxed);
+    slot.pan.store(pan, std::memory_order_relaxed);
+    slot.delayFrames = delayFrames;
+    // no ramp on the first burst
+    slot.applied[0] = gain * (pan > 0 ? 1 - pan : 1);
+    slot.applied[1] = gain * (pan < 0 ? 1 + pan : 1);
+    slot.pending = NULL;
+    slot.pendingFrames = 0;
+    slot.holding = false;
+    slot.memoryCursor = 0;
+    slot.state.store(SLOT_PLAYING, std::memory_order_release);
+}
+
+void Mixer::release(int id) {
+    Slot &slot = slots_[id];
+    int state = slot.state.load(std::memory_order_acquire);
+    if (state == SLOT_FREE || state == SLOT_BUSY) {
+        return;
+    }
+    if (player_ != NULL) {
+        int expected = SLOT_PLAYING;
+        if (slot.state.compare_exchange_strong(expected, SLOT_RELEASING,
+                                               std::memory_order_acq_rel)) {
+            // the next callback acknowledges; a finished slot it has
+            // already left alone
+            while (slot.state.load(std::memory_order_acquire) != SLOT_RELEASED) {
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+            }
+        }
+    }
+    slot.state.store(SLOT_BUSY, std::memory_order_relaxed);
+    if (slot.stream != NULL) {
+        if (slot.holding) {
+            slot.stream->onBufferPlayed();
+        }
+        slot.stream->close();
+    }
+    if (slot.kind == MIXER_SOURCE_MIC) {
+        stopMic();
+    }
+    slot.memory = NULL;
+    slot.holding = false;
+    slot.state.store(SLOT_FREE, std::memory_order_release);
+}
+
+int Mixer::addFile(const char *path, int fileRate, float gain, float pan, unsigned delayFrames) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (player_ == NULL) {
+        return -1;
+    }
+    int id = claimSlot();
+    if (id < 0) {
+        return -1;
+    }
+    Slot &slot = slots_[id];
+    if (slot.stream == NULL) {
+        // kept with the slot for the next file
+        slot.stream.reset(new PlaybackStream(2, MIXER_FILE_POOL_BUFFERS));
+    }
+    slot.stream->setSampleRates(fileRate, sampleRate_);
+    if (!slot.stream->open(path, framesPerBurst_, PlaybackStream::SOURCE_STREAM)) {
+        LOGI("mixer can't open %s", path);
+        slot.state.store(SLOT_FREE, std::memory_order_release);
+        return -1;
+    }
+    publish(id, MIXER_SOURCE_FILE, 2, gain, pan, delayFrames);
+    return id;
+}
+
+int Mixer::addMemory(const short *samples, size_t frames, int channels, float gain, float pan,
+                     unsigned delayFrames) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (player_ == NULL || samples == NULL || (channels != 1 && channels != 2)) {
+        return -1;
+    }
+    int id = claimSlot();
+    if (id < 0) {
+        return -1;
+    }
+    slots_[id].memory = samples;
+    slots_[id].memoryFrames = frames;
+    publish(id, MIXER_SOURCE_MEMORY, channels, gain, pan, delayFrames);
+    return id;
+}
+
+int Mixer::addMic(float gain, float pan, unsigned delayFrames) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (player_ == NULL || recorder_ != NULL) {
+        return -1;
+    }
+    int id = claimSlot();
+    if (id < 0) {
+        return -1;
+    }
+    // no mic slot is playing, so the callback isn't reading the ring
+    micRing_.attach(&micMemory_[0], micMemory_.size() * sizeof(unsigned));
+    micNext_ = 0;
+    StreamFormat format;
+    format.sampleRate = sampleRate_;
+    format.channels = 1;
+    recorder_ = backend_->createRecorder(format, MIXER_MIC_QUEUE_DEPTH);
+    bool started = recorder_ != NULL && recorder_->registerCallback(recorderCallback, this);
+    for (int i = 0; started && i < MIXER_MIC_QUEUE_DEPTH; i++) {
+        recorder_->enqueue(&micBuffers_[i * framesPerBurst_], framesPerBurst_ * sizeof(short));
+    }
+    if (!started || !recorder_->start()) {
+        LOGI("can't start the mixer mic");
+        stopMic();
+        slots_[id].state.store(SLOT_FREE, std::memory_order_release);
+        return -1;
+    }
+    publish(id, MIXER_SOURCE_MIC, 1, gain, pan, delayFrames);
+    return id;
+}
+
+void Mixer::stopMic() {
+    if (recorder_ != NULL) {
+        recorder_->stop();
+        delete recorder_;
+        recorder_ = NULL;
+    }
+}
+
+bool Mixer::remove(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!valid(id) || slots_[id].state.load(std::memory_order_acquire) == SLOT_FREE) {
+        return false;
+    }
+    release(id);
+    return true;
+}
+
+void Mixer::setGain(int id, float gain) {
+    if (valid(id)) {
+        slots_[id].gain.store(gain, std::memory_order_relaxed);
+    }
+}
+
+void Mixer::setPan(int id, float pan) {
+    if (valid(id)) {
+        slots_[id].pan.store(std::max(-1.0f, std::min(1.0f, pan)), std::memory_order_relaxed);
+    }
+}
+
+bool Mixer::finished(int id) const {
+    return valid(id) && slots_[id].state.load(std::memory_order_acquire) == SLOT_FINISHED;
+}
+
+MixerStats Mixer::stats() const {
+    MixerStats stats;
+    stats.sources = 0;
+    for (int id = 0; id < MIXER_MAX_SOURCES; id++) {
+        if (slots_[id].state.load(std::memory_order_relaxed) == SLOT_PLAYING) {
+            stats.sources++;
+        }
+    }
+    stats.bursts = bursts_.load(std::memory_order_relaxed);
+    stats.limitedBursts = limitedBursts_.load(std::memory_order_relaxed);
+    stats.micOverruns = micRing_.attached() ? micRing_.dropped() : 0;
+    return stats;
+}
+
+void Mixer::recorderCallback(AudioStream *stream, void *context) {
+    static_cast<Mixer *>(context)->onCaptured();
+}
+
+void Mixer::onCaptured() {
+    short *filled = &micBuffers_[micNext_ * framesPerBurst_];
+    // a full ring drops the burst and counts it
+    micRing_.write(filled, framesPerBurst_ * sizeof(short));
+    recorder_->enqueue(filled, framesPerBurst_ * sizeof(short));
+    micNext_ = (micNext_ + 1) % MIXER_MIC_QUEUE_DEPTH;
+}
+
+void Mixer::playerCallback(AudioStream *stream, void *context) {
+    static_cast<Mixer *>(context)->onPlayed();
+}
+
+void Mixer::onPlayed() {
+    unsigned burstSamples = framesPerBurst_ * 2;
+    short *out = &playerBuffers_[playerNext_ * burstSamples];
+    render(out);
+    player_->enqueue(out, burstSamples * sizeof(short));
+    playerNext_ = (playerNext_ + 1) % playerQueueDepth_;
+}
+
+void Mixer::render(short *out) {
+    std::fill(bus_.begin(), bus_.end(), 0.0f);
+    for (int id = 0; id < MIXER_MAX_SOURCES; id++) {
+        Slot &slot = slots_[id];
+        int state = slot.state.load(std::memory_order_acquire);
+        if (state == SLOT_RELEASING) {
+            slot.state.store(SLOT_RELEASED, std::memory_order_release);
+        } else if (state == SLOT_PLAYING && !mix(slot)) {
+            slot.state.store(SLOT_FINISHED, std::memory_order_release);
+        }
+    }
+    limit(framesPerBurst_);
+    PcmKernels::best().floatToS16(&bus_[0], out, bus_.size());
+    bursts_.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool Mixer::mix(Slot &slot) {
+    unsigned burst = framesPerBurst_;
+    if (slot.delayFrames >= burst) {
+        slot.delayFrames -= burst;
+        return true;
+    }
+    unsigned frame = slot.delayFrames;
+    slot.delayFrames = 0;
+
+    // balance: the far side fades out as the source pans, the near side
+    // stays at the gain
+    float gain = slot.gain.load(std::memory_order_relaxed);
+    float pan = slot.pan.load(std::memory_order_relaxed);
+    float target[2] = {gain * (pan > 0 ? 1 - pan : 1), gain * (pan < 0 ? 1 + pan : 1)};
+    float steps[2] = {(target[0] - slot.applied[0]) / (burst - frame),
+                      (target[1] - slot.applied[1]) / (burst - frame)};
+    float gains[2] = {slot.applied[0], slot.applied[1]};
+    const PcmKernels &kernels = PcmKernels::best();
+    while (frame < burst) {
+        if (slot.pendingFrames == 0 && !fetch(slot, burst - frame)) {
+            return false;
+        }
+        unsigned n = std::min(slot.pendingFrames, burst - frame);
+        kernels.mixToStereo(slot.pending, slot.channels, &bus_[2 * frame], n, gains, steps);
+        gains[0] += n * steps[0];
+        gains[1] += n * steps[1];
+        slot.pending += n * slot.channels;
+        slot.pendingFrames -= n;
+        frame += n;
+    }
+    slot.applied[0] = target[0];
+    slot.applied[1] = target[1];
+    return true;
+}
+
+bool Mixer::fetch(Slot &slot, unsigned wanted) {
+    switch (slot.kind) {
+        case MIXER_SOURCE_FILE: {
+            // the buffer just used up goes back to the reader thread
+            if (slot.holding) {
+                slot.stream->onBufferPlayed();
+                slot.holding = false;
+            }
+            unsigned bytes;
+            const short *buffer = slot.stream->nextBuffer(&bytes);
+            if (buffer == NULL) {
+                return false;
+            }
+            slot.holding = true;
+            slot.pending = buffer;
+            slot.pendingFrames = bytes / (2 * sizeof(short));
+            // an empty buffer ends nothing, the next fetch moves on
+            return true;
+        }
+        case MIXER_SOURCE_MEMORY:
+            if (slot.memoryCursor >= slot.memoryFrames) {
+                return false;
+            }
+            slot.pending = slot.memory + slot.memoryCursor * slot.channels;
+            slot.pendingFrames = static_cast<unsigned>(
+                    std::min<size_t>(slot.memoryFrames - slot.memoryCursor, wanted));
+            slot.memoryCursor += slot.pendingFrames;
+            return true;
+        case MIXER_SOURCE_MIC: {
+            size_t available = micRing_.available() / sizeof(short);
+            size_t backlog = MIC_MAX_BACKLOG_BURSTS * framesPerBurst_;
+            while (available > backlog) {
+                size_t n = std::min<size_t>(available - backlog, framesPerBurst_);
+                micRing_.read(&micScratch_[0], n * sizeof(short));
+                available -= n;
+            }
+            unsigned n = static_cast<unsigned>(std::min<size_t>(available, wanted));
+            if (n == 0) {
+                // the recorder hasn't caught up: silence, the mic never ends
+                n = wanted;
+                memset(&micScratch_[0], 0, n * sizeof(short));
+            } else {
+                micRing_.read(&micScratch_[0], n * sizeof(short));
+            }
+            slot.pending = &micScratch_[0];
+            slot.pendingFrames = n;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Mixer::limit(unsigned frames) {
+    // instant attack, so nothing over the threshold reaches the converter,
+    // and an exponential release back to unity
+    bool limited = false;
+    float gain = limiterGain_;
+    for (unsigned i = 0; i < frames; i++) {
+        float peak = std::max(fabsf(bus_[2 * i]), fabsf(bus_[2 * i + 1]));
+        gain += (1.0f - gain) * limiterRelease_;
+        if (peak * gain > MIXER_LIMITER_THRESHOLD) {
+            gain = MIXER_LIMITER_THRESHOLD / peak;
+            limited = true;
+        }
+        bus_[2 * i] *= gain;
+        bus_[2 * i + 1] *= gain;
+    }
+    limiterGain_ = gain;
+    if (limited) {
+        limitedBursts_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,180 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_MIXER_H
+#define NATIVEFEEDBACK_MIXER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "AudioBackend.h"
+#include "PlaybackStream.h"
+#include "SharedPcmRing.h"
+
+#define MIXER_MAX_SOURCES 16
+// prefetch pool of each file source, in bursts
+#define MIXER_FILE_POOL_BUFFERS 16
+#define MIXER_MIC_QUEUE_DEPTH 2
+// the limiter holds the bus under this, about -1 dBFS, and lets go over
+// MIXER_LIMITER_RELEASE_MS
+#define MIXER_LIMITER_THRESHOLD 0.89f
+#define MIXER_LIMITER_RELEASE_MS 100
+
+enum MixerSourceKind {
+    MIXER_SOURCE_FILE,
+    MIXER_SOURCE_MEMORY,
+    MIXER_SOURCE_MIC,
+};
+
+struct MixerStats {
+    unsigned sources;
+    unsigned long long bursts;
+    // bursts the limiter had to pull down
+    unsigned long long limitedBursts;
+    // mic bursts dropped because the player fell behind
+    unsigned micOverruns;
+};
+
+// Sums up to MIXER_MAX_SOURCES sources into one stereo player, so any
+// number of sounds share a single buffer queue player instead of each
+// realizing their own.
+//
+// A source is a file (PCM, WAV or .nfla, prefetched by a PlaybackStream),
+// a block of caller-owned memory, or the mic. Each has a gain, a pan and a
+// delay before it starts; gain and pan changes ramp over one burst. The
+// player callback converts every source to float, accumulates it on a
+// stereo bus with the PcmKernels mixToStereo kernel, runs a peak limiter
+// over the bus and converts it back.
+//
+// Sources come and go while the player runs. They live in fixed slots
+// whose state the callback reads with acquire loads: the caller sets a
+// slot up and publishes it, and to take one away asks the callback to let
+// go of it and waits for the acknowledgement, so the callback never waits
+// on a lock and never sees a half-built or freed source. The caller side
+// is serialized by a mutex of its own.
+class Mixer {
+public:
+    // streams are created on backend, which must outlive this
+    explicit Mixer(AudioBackend *backend);
+    ~Mixer();
+
+    // starts the player, stereo at sampleRate, playing silence until
+    // sources are added
+    bool start(int sampleRate, int framesPerBurst, int playerQueueDepth);
+    // stops the player and removes every source
+    void stop();
+    bool running() const { return player_ != NULL; }
+
+    // The add calls work while the mixer runs and return the source's id,
+    // or -1 when every slot is taken or the source can't be opened. gain
+    // is linear, pan goes from -1 (left) to 1 (right), delayFrames of
+    // silence come first. Files open and prefetch on the calling thread.
+    //
+    // fileRate is the rate of a raw PCM file; WAV and .nfla files know
+    // their own
+    int addFile(const char *path, int fileRate, float gain, float pan, unsigned delayFrames);
+    // frames of one or two channel PCM at the mixer's rate; the memory
+    // must stay valid until the source is removed or has finished
+    int addMemory(const short *samples, size_t frames, int channels, float gain, float pan,
+                  unsigned delayFrames);
+    // the mic, mono at the mixer's rate, through a recorder of its own;
+    // one at a time, only while the mixer runs
+    int addMic(float gain, float pan, unsigned delayFrames);
+    // returns once the callback has let go of the source
+    bool remove(int id);
+    void setGain(int id, float gain);
+    void setPan(int id, float pan);
+    // true once a file or memory source has played to its end
+    bool finished(int id) const;
+
+    MixerStats stats() const;
+
+private:
+    enum SlotState {
+        SLOT_FREE = 0,
+        // the caller is setting it up or tearing it down
+        SLOT_BUSY,
+        SLOT_PLAYING,
+        // played to the end, the callback skips it
+        SLOT_FINISHED,
+        // the caller asked the callback to let go, which it acknowledges
+        // by moving the slot to SLOT_RELEASED
+        SLOT_RELEASING,
+        SLOT_RELEASED,
+    };
+
+    struct Slot {
+        std::atomic<int> state;
+        std::atomic<float> gain;
+        std::atomic<float> pan;
+        MixerSourceKind kind;
+        int channels;
+        std::unique_ptr<PlaybackStream> stream;
+        const short *memory;
+        size_t memoryFrames;
+
+        // callback only
+        size_t memoryCursor;
+        unsigned delayFrames;
+        // gains the last burst ended on, left and right
+        float applied[2];
+        // what's left of the buffer the source handed out last
+        const short *pending;
+        unsigned pendingFrames;
+        // a PlaybackStream buffer is out and needs handing back
+        bool holding;
+
+        Slot();
+    };
+
+    static void playerCallback(AudioStream *stream, void *context);
+    static void recorderCallback(AudioStream *stream, void *context);
+    void onPlayed();
+    void onCaptured();
+    void render(short *out);
+    // mixes one burst of the slot onto the bus, false once it has ended
+    bool mix(Slot &slot);
+    // points pending at the slot's next frames, at most wanted of them;
+    // false at the end of the source
+    bool fetch(Slot &slot, unsigned wanted);
+    void limit(unsigned frames);
+
+    // caller side, under mutex_
+    int claimSlot();
+    void publish(int id, MixerSourceKind kind, int channels, float gain, float pan,
+                 unsigned delayFrames);
+    // takes the slot back from the callback, if it has it, and frees it
+    void release(int id);
+    void stopMic();
+    bool valid(int id) const { return id >= 0 && id < MIXER_MAX_SOURCES; }
+
+    AudioBackend *backend_;
+    AudioStream *player_;
+    AudioStream *recorder_;
+    std::mutex mutex_;
+    Slot slots_[MIXER_MAX_SOURCES];
+
+    int sampleRate_;
+    unsigned framesPerBurst_;
+    int playerQueueDepth_;
+    std::vector<short> playerBuffers_;
+    int playerNext_;
+    // interleaved stereo
+    std::vector<float> bus_;
+    float limiterGain_;
+    float limiterRelease_;
+
+    std::vector<short> micBuffers_;
+    int micNext_;
+    std::vector<unsigned> micMemory_;
+    SharedPcmRing micRing_;
+    std::vector<short> micScratch_;
+
+    std::atomic<unsigned long long> bursts_;
+    std::atomic<unsigned long long> limitedBursts_;
+};
+
+#endif //NATIVEFEEDBACK_MIXER_H
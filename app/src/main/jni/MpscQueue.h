@@ -0,0 +1,87 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_MPSCQUEUE_H
+#define NATIVEFEEDBACK_MPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free multi-producer/single-consumer queue.
+// push() may be called from any number of threads at once, audio callbacks
+// included; pop() only ever from one thread. Each slot carries a sequence
+// number that tells a producer whether it's free and the consumer whether
+// it's been filled, so neither side allocates, blocks or takes a lock.
+// Capacity is rounded up to a power of two.
+template <typename T>
+class MpscQueue {
+public:
+    explicit MpscQueue(size_t capacity)
+            : mask_(roundUpPow2(capacity) - 1), slots_(mask_ + 1), tail_(0), pad_(), head_(0) {
+        for (size_t i = 0; i <= mask_; i++) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // false when the queue is full
+    bool push(const T &value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        Slot *slot;
+        for (;;) {
+            slot = &slots_[tail & mask_];
+            size_t sequence = slot->sequence.load(std::memory_order_acquire);
+            if (sequence == tail) {
+                // free and nobody else has claimed it yet
+                if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (sequence < tail) {
+                // still holds a value from the previous lap
+                return false;
+            } else {
+                tail = tail_.load(std::memory_order_relaxed);
+            }
+        }
+        slot->value = value;
+        slot->sequence.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T *value) {
+        Slot &slot = slots_[head_ & mask_];
+        if (slot.sequence.load(std::memory_order_acquire) != head_ + 1) {
+            return false;
+        }
+        *value = slot.value;
+        // free for the producer one lap ahead
+        slot.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+        head_++;
+        return true;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    static size_t roundUpPow2(size_t n) {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    const size_t mask_;
+    std::vector<Slot> slots_;
+    // producers contend on tail_, keep the consumer's index off its line
+    std::atomic<size_t> tail_;
+    char pad_[64 - sizeof(std::atomic<size_t>)];
+    // consumer only
+    size_t head_;
+};
+
+#endif //NATIVEFEEDBACK_MPSCQUEUE_H
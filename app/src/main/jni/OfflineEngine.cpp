@@ -0,0 +1,496 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "OfflineEngine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+
+#define LOG_TAG "NativeOfflineEngine"
+
+#include "AudioEngine.h"
+#include "FeedbackSuppressor.h"
+#include "LosslessFile.h"
+#include "Log.h"
+#include "MappedPcmSource.h"
+#include "PcmConvert.h"
+#include "Resampler.h"
+#include "WavFile.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static unsigned gcd(unsigned a, unsigned b) {
+    while (b != 0) {
+        unsigned t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+OfflineConfig::OfflineConfig()
+        : sampleRate(0),
+          channels(0),
+          gain(1.0f),
+          suppressFeedback(false),
+          rawSampleRate(FILE_SAMPLE_RATE),
+          rawChannels(1),
+          threads(0),
+          chunkFrames(OFFLINE_CHUNK_FRAMES) {
+}
+
+struct OfflineEngine::FileJob {
+    OfflineEngine *engine;
+    std::string input;
+    std::string output;
+    OfflineFileResult result;
+
+    // WAV and raw input is mapped, so chunks read it in any order; .nfla is
+    // decoded front to back
+    MappedPcmFile mapped;
+    LosslessPcmSource decoder;
+    bool decoding;
+    int inChannels;
+
+    // copied into every chain, so the filter is only designed once
+    Resampler resampler;
+    bool resampling;
+    WavWriter writer;
+    LosslessWriter compressor;
+    bool compressing;
+    SilenceTrimmer trimmer;
+    bool trimming;
+
+    // input frames per chunk, and of the input before it that primes a
+    // chunk's resampler
+    size_t chunkFrames;
+    size_t primeFrames;
+
+    // chunks finished out of order wait here for the ones before them
+    std::mutex commitLock;
+    std::vector<std::vector<short> > finished;
+    std::vector<bool> ready;
+    size_t committed;
+
+    FileJob(OfflineEngine *engine, const std::string &input, const std::string &output)
+            : engine(engine),
+              input(input),
+              output(output),
+              decoding(false),
+              inChannels(0),
+              resampling(false),
+              compressing(false),
+              trimming(false),
+              chunkFrames(0),
+              primeFrames(0),
+              committed(0) {
+        memset(&result, 0, sizeof(result));
+    }
+};
+
+// The stages between the input and the file, in capture's order. Output
+// goes to a sink, the file's writer or a chunk's buffer.
+class OfflineEngine::Chain {
+public:
+    typedef void (*Sink)(const short *samples, size_t frames, void *context);
+
+    Chain(const FileJob &job, FeedbackSuppressor *suppressor, Sink sink, void *context)
+            : inChannels_(job.inChannels),
+              channels_(job.result.channels),
+              gain_(job.engine->config_.gain),
+              suppressor_(suppressor),
+              resampling_(job.resampling),
+              resampler_(job.resampler),
+              sink_(sink),
+              context_(context),
+              converted_(OFFLINE_BLOCK_FRAMES * job.result.channels) {
+        gains_[0] = gain_;
+        gains_[1] = gain_;
+        if (resampling_) {
+            resampler_.reset();
+            resampled_.resize(resampler_.outputFramesFor(OFFLINE_BLOCK_FRAMES) * channels_);
+            silence_.assign(resampler_.latencyFrames() * channels_, 0);
+        }
+    }
+
+    // at most OFFLINE_BLOCK_FRAMES of the input's layout
+    void feed(const short *samples, size_t frames) {
+        const PcmKernels &kernels = PcmKernels::best();
+        short *x = &converted_[0];
+        if (inChannels_ == channels_) {
+            memcpy(x, samples, frames * channels_ * sizeof(short));
+        } else if (inChannels_ == 1) {
+            kernels.monoToStereo(samples, x, frames);
+        } else {
+            kernels.stereoToMono(samples, x, frames);
+        }
+        if (gain_ != 1.0f) {
+            kernels.applyGain(x, frames, channels_, gains_);
+        }
+        if (suppressor_ != NULL) {
+            suppressor_->process(x, static_cast<unsigned>(frames));
+        }
+        if (resampling_) {
+            resample(x, frames);
+        } else {
+            sink_(x, frames, context_);
+        }
+    }
+
+    // after the last of the input: the tail still in the filter
+    void flush() {
+        if (resampling_) {
+            resample(&silence_[0], silence_.size() / channels_);
+        }
+    }
+
+private:
+    void resample(const short *samples, size_t frames) {
+        while (frames > 0) {
+            size_t consumed;
+            size_t n = resampler_.process(samples, frames, &consumed, &resampled_[0],
+                                          resampled_.size() / channels_);
+            sink_(&resampled_[0], n, context_);
+            samples += consumed * channels_;
+            frames -= consumed;
+        }
+    }
+
+    int inChannels_;
+    int channels_;
+    float gain_;
+    float gains_[2];
+    FeedbackSuppressor *suppressor_;
+    bool resampling_;
+    Resampler resampler_;
+    Sink sink_;
+    void *context_;
+    std::vector<short> converted_;
+    std::vector<short> resampled_;
+    std::vector<short> silence_;
+};
+
+// a chunk's output, less the frames its priming produced
+struct ChunkOutput {
+    std::vector<short> samples;
+    size_t discard;
+    int channels;
+};
+
+static void toChunk(const short *samples, size_t frames, void *context) {
+    ChunkOutput *out = static_cast<ChunkOutput *>(context);
+    size_t skip = std::min(frames, out->discard);
+    out->discard -= skip;
+    out->samples.insert(out->samples.end(), samples + skip * out->channels,
+                        samples + frames * out->channels);
+}
+
+OfflineEngine::OfflineEngine(const OfflineConfig &config)
+        : config_(config),
+          pool_(config.threads),
+          framesDone_(0),
+          framesTotal_(0) {
+}
+
+OfflineEngine::~OfflineEngine() {
+    pool_.wait();
+}
+
+double OfflineEngine::progress() const {
+    unsigned long long total = framesTotal_.load(std::memory_order_relaxed);
+    return total > 0 ? static_cast<double>(framesDone_.load(std::memory_order_relaxed)) / total
+                     : 0.0;
+}
+
+bool OfflineEngine::open(FileJob *job) {
+    const char *input = job->input.c_str();
+    const char *output = job->output.c_str();
+    OfflineFileResult &result = job->result;
+    if (job->input == job->output) {
+        LOGI("%s: won't write over the input", input);
+        return false;
+    }
+
+    LosslessInfo lossless;
+    WavInfo wav;
+    job->decoding = LosslessPcmSource::probe(input, &lossless);
+    if (job->decoding) {
+        // frames are counted as they decode
+        result.inputRate = lossless.sampleRate;
+        job->inChannels = lossless.channels;
+        if (!job->decoder.open(input)) {
+            LOGI("%s: can't open", input);
+            return false;
+        }
+    } else {
+        unsigned long long offset = 0, length = ~0ULL;
+        switch (WavReader::probe(input, &wav)) {
+            case WAV_PCM16:
+                result.inputRate = wav.sampleRate;
+                job->inChannels = wav.channels;
+                offset = wav.dataOffset;
+                length = wav.dataBytes;
+                break;
+            case WAV_NONE:
+                result.inputRate = config_.rawSampleRate;
+                job->inChannels = config_.rawChannels;
+                break;
+            default:
+                LOGI("%s: not a WAV file the pipeline plays", input);
+                return false;
+        }
+        if (job->inChannels <= 0 || !job->mapped.open(input, offset, length)) {
+            LOGI("%s: can't map", input);
+            return false;
+        }
+        result.inputFrames = job->mapped.size() / (job->inChannels * sizeof(short));
+        framesTotal_.fetch_add(result.inputFrames, std::memory_order_relaxed);
+    }
+
+    result.outputRate = config_.sampleRate > 0 ? config_.sampleRate : result.inputRate;
+    result.channels = config_.channels > 0 ? config_.channels : job->inChannels;
+    if (result.channels != job->inChannels
+        && (result.channels > 2 || job->inChannels > 2)) {
+        LOGI("%s: %d to %d channels isn't a conversion the chain has", input,
+             job->inChannels, result.channels);
+        return false;
+    }
+    job->resampling = result.outputRate != result.inputRate;
+    if (job->resampling
+        && !job->resampler.init(result.inputRate, result.outputRate, result.channels)) {
+        LOGI("%s: can't resample %d to %d", input, result.inputRate, result.outputRate);
+        return false;
+    }
+
+    job->compressing = LosslessWriter::isLosslessPath(output);
+    if (job->compressing ? !job->compressor.open(output, result.outputRate, result.channels)
+                         : !job->writer.open(output, result.outputRate, result.channels,
+                                             WavWriter::isWavPath(output))) {
+        LOGI("%s: can't create", output);
+        return false;
+    }
+    job->trimming = config_.vad.enabled;
+    if (job->trimming && !job->trimmer.open(SilenceTrimmer::indexPathFor(output).c_str(),
+                                            result.outputRate, result.channels, config_.vad,
+                                            writeFile, job)) {
+        job->trimming = false;
+        LOGI("%s: can't create the silence index", output);
+        return false;
+    }
+
+    // chunks start at multiples of the resampler's step, where its phase
+    // is back where reset() leaves it, and are primed with at least a
+    // filter's length of input
+    bool splittable = !job->decoding && !job->trimming && !config_.suppressFeedback;
+    unsigned step = 1;
+    if (job->resampling) {
+        step = static_cast<unsigned>(result.inputRate) / gcd(result.inputRate, result.outputRate);
+    }
+    job->primeFrames = job->resampling ? (RESAMPLER_TAPS + step - 1) / step * step : 0;
+    job->chunkFrames = std::max<size_t>(step, config_.chunkFrames / step * step);
+    job->chunkFrames = std::max(job->chunkFrames, job->primeFrames);
+    size_t chunks = 1;
+    if (splittable && result.inputFrames > job->chunkFrames) {
+        chunks = static_cast<size_t>((result.inputFrames + job->chunkFrames - 1) / job->chunkFrames);
+    }
+    result.chunks = static_cast<unsigned>(chunks);
+    job->finished.resize(chunks);
+    job->ready.assign(chunks, false);
+    job->committed = 0;
+    result.ok = true;
+    return true;
+}
+
+void OfflineEngine::fileTask(void *context, size_t begin, size_t end) {
+    FileJob *job = static_cast<FileJob *>(context);
+    OfflineEngine *engine = job->engine;
+    if (!engine->open(job)) {
+        engine->finish(job);
+    } else if (job->decoding || job->trimming || engine->config_.suppressFeedback) {
+        engine->runWhole(job);
+    } else {
+        chunkTask(job, 0, job->result.chunks);
+    }
+}
+
+void OfflineEngine::chunkTask(void *context, size_t begin, size_t end) {
+    FileJob *job = static_cast<FileJob *>(context);
+    // the back half for whoever steals it, then the back half of what's
+    // left, down to one chunk for this worker
+    while (end - begin > 1) {
+        size_t mid = begin + (end - begin) / 2;
+        job->engine->pool_.submit(chunkTask, job, mid, end);
+        end = mid;
+    }
+    job->engine->runChunk(job, begin);
+}
+
+void OfflineEngine::runWhole(FileJob *job) {
+    FeedbackSuppressor suppressor;
+    bool suppressing = config_.suppressFeedback
+                       && suppressor.init(job->result.inputRate, job->result.channels);
+    Chain chain(*job, suppressing ? &suppressor : NULL, writeOut, job);
+    if (job->decoding) {
+        size_t frameBytes = job->inChannels * sizeof(short);
+        std::vector<short> block(OFFLINE_BLOCK_FRAMES * job->inChannels);
+        for (;;) {
+            size_t n = job->decoder.read(&block[0], block.size() * sizeof(short)) / frameBytes;
+            if (n == 0) {
+                break;
+            }
+            chain.feed(&block[0], n);
+            job->result.inputFrames += n;
+            framesTotal_.fetch_add(n, std::memory_order_relaxed);
+            framesDone_.fetch_add(n, std::memory_order_relaxed);
+        }
+    } else {
+        const short *samples = reinterpret_cast<const short *>(job->mapped.data());
+        size_t frames = static_cast<size_t>(job->result.inputFrames);
+        for (size_t at = 0; at < frames; at += OFFLINE_BLOCK_FRAMES) {
+            size_t n = std::min<size_t>(OFFLINE_BLOCK_FRAMES, frames - at);
+            chain.feed(samples + at * job->inChannels, n);
+            framesDone_.fetch_add(n, std::memory_order_relaxed);
+        }
+    }
+    chain.flush();
+    finish(job);
+}
+
+void OfflineEngine::runChunk(FileJob *job, size_t chunk) {
+    const OfflineFileResult &result = job->result;
+    size_t frames = static_cast<size_t>(result.inputFrames);
+    size_t start = chunk * job->chunkFrames;
+    size_t stop = std::min(frames, start + job->chunkFrames);
+    size_t primed = std::min(job->primeFrames, start);
+    size_t frameBytes = job->inChannels * sizeof(short);
+    job->mapped.willNeed((start - primed) * frameBytes, (stop - start + primed) * frameBytes);
+
+    // primed is a whole number of steps, so this is exact
+    ChunkOutput out;
+    out.discard = static_cast<size_t>(static_cast<unsigned long long>(primed)
+                                      * result.outputRate / result.inputRate);
+    out.channels = result.channels;
+    out.samples.reserve((static_cast<unsigned long long>(stop - start) * result.outputRate
+                         / result.inputRate + RESAMPLER_TAPS) * result.channels);
+    Chain chain(*job, NULL, toChunk, &out);
+    const short *samples = reinterpret_cast<const short *>(job->mapped.data());
+    for (size_t at = start - primed; at < stop; at += OFFLINE_BLOCK_FRAMES) {
+        size_t n = std::min<size_t>(OFFLINE_BLOCK_FRAMES, stop - at);
+        chain.feed(samples + at * job->inChannels, n);
+    }
+    if (chunk + 1 == job->finished.size()) {
+        chain.flush();
+    }
+    framesDone_.fetch_add(stop - start, std::memory_order_relaxed);
+    commit(job, chunk, &out.samples);
+}
+
+void OfflineEngine::commit(FileJob *job, size_t chunk, std::vector<short> *samples) {
+    // writing under the lock keeps the file in order; whoever completes
+    // the run of ready chunks writes it while the other workers go on
+    std::lock_guard<std::mutex> lock(job->commitLock);
+    job->finished[chunk].swap(*samples);
+    job->ready[chunk] = true;
+    while (job->committed < job->finished.size() && job->ready[job->committed]) {
+        std::vector<short> &out = job->finished[job->committed];
+        if (!out.empty()) {
+            writeOut(&out[0], out.size() / job->result.channels, job);
+        }
+        std::vector<short>().swap(out);
+        job->committed++;
+    }
+    if (job->committed == job->finished.size()) {
+        finish(job);
+    }
+}
+
+void OfflineEngine::finish(FileJob *job) {
+    bool ok = job->result.ok;
+    // the trimmer still holds up to a window and its pre-roll
+    if (job->trimming) {
+        ok = job->trimmer.close() && ok;
+    }
+    if (job->compressor.isOpen()) {
+        ok = job->compressor.close() && ok;
+    }
+    if (job->writer.isOpen()) {
+        ok = job->writer.close() && ok;
+    }
+    job->mapped.close();
+    job->decoder.close();
+    job->result.ok = ok;
+    if (!ok) {
+        LOGI("%s: failed", job->input.c_str());
+    }
+}
+
+void OfflineEngine::writeOut(const short *samples, size_t frames, void *context) {
+    FileJob *job = static_cast<FileJob *>(context);
+    if (job->trimming) {
+        // the trimmer calls back into writeFile with what it keeps
+        job->trimmer.write(samples, frames);
+    } else {
+        writeFile(samples, frames, context);
+    }
+}
+
+void OfflineEngine::writeFile(const short *samples, size_t frames, void *context) {
+    FileJob *job = static_cast<FileJob *>(context);
+    if (job->compressing) {
+        job->compressor.write(samples, frames);
+    } else {
+        job->writer.write(samples, frames * job->result.channels * sizeof(short));
+    }
+    job->result.outputFrames += frames;
+}
+
+bool OfflineEngine::run(const std::vector<std::string> &inputs,
+                        const std::vector<std::string> &outputs, OfflineReport *report,
+                        std::vector<OfflineFileResult> *results) {
+    size_t files = std::min(inputs.size(), outputs.size());
+    framesDone_.store(0, std::memory_order_relaxed);
+    framesTotal_.store(0, std::memory_order_relaxed);
+    unsigned long long steals = pool_.steals();
+    jobs_.clear();
+    for (size_t i = 0; i < files; i++) {
+        jobs_.push_back(std::unique_ptr<FileJob>(new FileJob(this, inputs[i], outputs[i])));
+    }
+
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < files; i++) {
+        pool_.submit(fileTask, jobs_[i].get(), 0, 0);
+    }
+    pool_.wait();
+    double wall = std::chrono::duration<double>(Clock::now() - start).count();
+
+    OfflineReport summary;
+    memset(&summary, 0, sizeof(summary));
+    summary.files = static_cast<unsigned>(files);
+    summary.steals = pool_.steals() - steals;
+    summary.wallSeconds = wall;
+    if (results != NULL) {
+        results->clear();
+    }
+    for (size_t i = 0; i < files; i++) {
+        const OfflineFileResult &result = jobs_[i]->result;
+        summary.failed += !result.ok;
+        summary.chunks += result.chunks;
+        if (result.ok) {
+            summary.audioSeconds += static_cast<double>(result.inputFrames) / result.inputRate;
+        }
+        if (results != NULL) {
+            results->push_back(result);
+        }
+    }
+    summary.realtimeFactor = wall > 0 ? summary.audioSeconds / wall : 0;
+    jobs_.clear();
+    LOGI("%u files, %u failed, %.1fs of audio in %.2fs: %.1fx real time, %u chunks, %llu steals",
+         summary.files, summary.failed, summary.audioSeconds, wall, summary.realtimeFactor,
+         summary.chunks, summary.steals);
+    if (report != NULL) {
+        *report = summary;
+    }
+    return summary.failed == 0;
+}
@@ -0,0 +1,127 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_OFFLINEENGINE_H
+#define NATIVEFEEDBACK_OFFLINEENGINE_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "VoiceActivity.h"
+#include "WorkStealingPool.h"
+
+// input frames per chunk when a file can be split, rounded to the
+// resampler's step; every chunk is a task of its own
+#define OFFLINE_CHUNK_FRAMES 65536
+// frames a chunk pushes through the chain at a time
+#define OFFLINE_BLOCK_FRAMES 4096
+
+struct OfflineConfig {
+    // of the outputs, 0 keeping the input's; channels converts between
+    // mono and stereo
+    int sampleRate;
+    int channels;
+    // linear, clipping, before anything else that changes the audio
+    float gain;
+    // the monitor's FeedbackSuppressor, at the input rate
+    bool suppressFeedback;
+    // silence trimming as recordings get it, output + ".vad" the index
+    VadConfig vad;
+    // raw PCM has no header to say what it is
+    int rawSampleRate;
+    int rawChannels;
+    // workers, 0 for one per core
+    unsigned threads;
+    unsigned chunkFrames;
+
+    OfflineConfig();
+};
+
+struct OfflineFileResult {
+    bool ok;
+    int inputRate;
+    int outputRate;
+    int channels;
+    unsigned long long inputFrames;
+    // after silence trimming
+    unsigned long long outputFrames;
+    unsigned chunks;
+};
+
+struct OfflineReport {
+    unsigned files;
+    unsigned failed;
+    unsigned chunks;
+    // tasks the pool moved between workers
+    unsigned long long steals;
+    // of input, over the time run() took, and the ratio of the two
+    double audioSeconds;
+    double wallSeconds;
+    double realtimeFactor;
+};
+
+// Runs the recording chain on files instead of a device, as fast as the
+// cores allow: channel layout, gain, feedback suppression, resampling,
+// silence trimming and the container or compression the output's name
+// asks for, the same stages and in the same order as capture. Inputs are
+// WAV, .nfla or raw PCM.
+//
+// Files are tasks on a WorkStealingPool. A file whose stages keep no state
+// beyond the resampler's history, which is most of them, is split into
+// chunks at multiples of the resampler's step: each chunk primes a copy of
+// the resampler with the input just before it and drops what that
+// produces, so the chunks join into exactly what one pass would write. A
+// chunk task halves its range and leaves the second half for another worker
+// to steal, and finished chunks go to the file in order as soon as
+// everything before them has. Silence trimming and feedback suppression
+// adapt over the whole file, and .nfla input only decodes front to back,
+// so those files run as one task.
+class OfflineEngine {
+public:
+    explicit OfflineEngine(const OfflineConfig &config);
+    ~OfflineEngine();
+
+    // processes inputs[i] into outputs[i] for every i and returns once all
+    // are done, false if any failed; results may be NULL. One run() at a
+    // time.
+    bool run(const std::vector<std::string> &inputs, const std::vector<std::string> &outputs,
+             OfflineReport *report, std::vector<OfflineFileResult> *results);
+    // of the input found so far, from any thread while run() works
+    double progress() const;
+
+    const OfflineConfig &config() const { return config_; }
+    unsigned threads() const { return pool_.threads(); }
+
+private:
+    OfflineEngine(const OfflineEngine &);
+    OfflineEngine &operator=(const OfflineEngine &);
+
+    struct FileJob;
+    class Chain;
+
+    static void fileTask(void *context, size_t begin, size_t end);
+    static void chunkTask(void *context, size_t begin, size_t end);
+    bool open(FileJob *job);
+    // the whole file in one pass
+    void runWhole(FileJob *job);
+    void runChunk(FileJob *job, size_t chunk);
+    // hands chunk's output over and writes out every chunk now in order
+    void commit(FileJob *job, size_t chunk, std::vector<short> *samples);
+    // after the last frame: the trimmer, the writer, the result
+    void finish(FileJob *job);
+    // chain output into the trimmer or straight to the file, and what the
+    // trimmer keeps to the file; context the FileJob
+    static void writeOut(const short *samples, size_t frames, void *context);
+    static void writeFile(const short *samples, size_t frames, void *context);
+
+    OfflineConfig config_;
+    WorkStealingPool pool_;
+    std::vector<std::unique_ptr<FileJob> > jobs_;
+    std::atomic<unsigned long long> framesDone_;
+    std::atomic<unsigned long long> framesTotal_;
+};
+
+#endif //NATIVEFEEDBACK_OFFLINEENGINE_H
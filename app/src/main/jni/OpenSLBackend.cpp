@@ -0,0 +1,300 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "OpenSLBackend.h"
+
+#include <cassert>
+#include <cstddef>
+
+#define LOG_TAG "NativeOpenSLBackend"
+
+#include "Log.h"
+
+// aux effect on the output mix, used by the buffer queue player
+static const SLEnvironmentalReverbSettings reverbSettings =
+        SL_I3DL2_ENVIRONMENT_PRESET_STONECORRIDOR;
+
+static SLuint32 channelMask(int channels) {
+    return channels == 1 ? SL_SPEAKER_FRONT_CENTER
+                         : SL_SPEAKER_FRONT_LEFT | SL_SPEAKER_FRONT_RIGHT;
+}
+
+// buffer queue player or recorder, destroying its object with the stream
+class OpenSLStream : public AudioStream {
+public:
+    OpenSLStream(SLObjectItf object, bool recorder)
+            : object_(object), recorder_(recorder), play_(NULL), record_(NULL),
+              bufferQueue_(NULL), callback_(NULL), context_(NULL) {}
+
+    ~OpenSLStream() override {
+        (*object_)->Destroy(object_);
+    }
+
+    bool init() {
+        SLresult result;
+        if (recorder_) {
+            // get the record interface
+            result = (*object_)->GetInterface(object_, SL_IID_RECORD, &record_);
+        } else {
+            // get the play interface
+            result = (*object_)->GetInterface(object_, SL_IID_PLAY, &play_);
+        }
+        if (SL_RESULT_SUCCESS != result) {
+            return false;
+        }
+
+        // get the buffer queue interface
+        result = (*object_)->GetInterface(
+                object_, recorder_ ? SL_IID_ANDROIDSIMPLEBUFFERQUEUE : SL_IID_BUFFERQUEUE,
+                &bufferQueue_);
+        if (SL_RESULT_SUCCESS != result) {
+            return false;
+        }
+
+        // register callback on the buffer queue
+        result = (*bufferQueue_)->RegisterCallback(bufferQueue_, bufferQueueCallback, this);
+        return SL_RESULT_SUCCESS == result;
+    }
+
+    bool registerCallback(Callback callback, void *context) override {
+        callback_ = callback;
+        context_ = context;
+        return true;
+    }
+
+    bool enqueue(const void *buffer, unsigned bytes) override {
+        // the most likely other result is SL_RESULT_BUFFER_INSUFFICIENT
+        return SL_RESULT_SUCCESS == (*bufferQueue_)->Enqueue(bufferQueue_, buffer, bytes);
+    }
+
+    bool clear() override {
+        return SL_RESULT_SUCCESS == (*bufferQueue_)->Clear(bufferQueue_);
+    }
+
+    bool start() override {
+        SLresult result = recorder_
+                ? (*record_)->SetRecordState(record_, SL_RECORDSTATE_RECORDING)
+                : (*play_)->SetPlayState(play_, SL_PLAYSTATE_PLAYING);
+        return SL_RESULT_SUCCESS == result;
+    }
+
+    bool stop() override {
+        SLresult result = recorder_
+                ? (*record_)->SetRecordState(record_, SL_RECORDSTATE_STOPPED)
+                : (*play_)->SetPlayState(play_, SL_PLAYSTATE_STOPPED);
+        return SL_RESULT_SUCCESS == result;
+    }
+
+private:
+    // this callback handler is called every time a buffer finishes playing
+    // or recording
+    static void bufferQueueCallback(SLAndroidSimpleBufferQueueItf bq, void *context) {
+        OpenSLStream *stream = static_cast<OpenSLStream *>(context);
+        assert(bq == stream->bufferQueue_);
+        if (stream->callback_ != NULL) {
+            stream->callback_(stream, stream->context_);
+        }
+    }
+
+    SLObjectItf object_;
+    bool recorder_;
+    SLPlayItf play_;
+    SLRecordItf record_;
+    SLAndroidSimpleBufferQueueItf bufferQueue_;
+    Callback callback_;
+    void *context_;
+};
+
+OpenSLBackend::OpenSLBackend()
+        : engineObject_(NULL), engineEngine_(NULL), outputMixObject_(NULL),
+          outputMixEnvironmentalReverb_(NULL) {
+    createEngine();
+}
+
+OpenSLBackend::~OpenSLBackend() {
+    // destroy output mix object, and invalidate all associated interfaces
+    if (outputMixObject_ != NULL) {
+        (*outputMixObject_)->Destroy(outputMixObject_);
+        outputMixObject_ = NULL;
+        outputMixEnvironmentalReverb_ = NULL;
+    }
+
+    // destroy engine object, and invalidate all associated interfaces
+    if (engineObject_ != NULL) {
+        (*engineObject_)->Destroy(engineObject_);
+        engineObject_ = NULL;
+        engineEngine_ = NULL;
+    }
+}
+
+bool OpenSLBackend::createEngine() {
+    LOGI("createEngine");
+    SLresult result;
+
+    // create engine
+    result = slCreateEngine(&engineObject_, 0, NULL, 0, NULL, NULL);
+    assert(SL_RESULT_SUCCESS == result);
+    (void) result;
+
+    // realize the engine
+    result = (*engineObject_)->Realize(engineObject_, SL_BOOLEAN_FALSE);
+    assert(SL_RESULT_SUCCESS == result);
+    (void) result;
+
+    // get the engine interface, which is needed in order to create other objects
+    result = (*engineObject_)->GetInterface(engineObject_, SL_IID_ENGINE, &engineEngine_);
+    assert(SL_RESULT_SUCCESS == result);
+    (void) result;
+
+    // create output mix, with environmental reverb specified as a non-required
+    // interface
+    const SLInterfaceID ids[1] = {SL_IID_ENVIRONMENTALREVERB};
+    const SLboolean req[1] = {SL_BOOLEAN_FALSE};
+    result = (*engineEngine_)
+            ->CreateOutputMix(engineEngine_, &outputMixObject_, 1, ids, req);
+    assert(SL_RESULT_SUCCESS == result);
+    (void)result;
+
+    // realize the output mix
+    result = (*outputMixObject_)->Realize(outputMixObject_, SL_BOOLEAN_FALSE);
+    assert(SL_RESULT_SUCCESS == result);
+    (void)result;
+
+    // get the environmental reverb interface
+    // this could fail if the environmental reverb effect is not available,
+    // either because the feature is not present, excessive CPU load, or
+    // the required MODIFY_AUDIO_SETTINGS permission was not requested and granted
+    result = (*outputMixObject_)
+            ->GetInterface(outputMixObject_, SL_IID_ENVIRONMENTALREVERB,
+                           &outputMixEnvironmentalReverb_);
+    if (SL_RESULT_SUCCESS == result) {
+        result = (*outputMixEnvironmentalReverb_)
+                ->SetEnvironmentalReverbProperties(
+                        outputMixEnvironmentalReverb_, &reverbSettings);
+        (void)result;
+    }
+    // ignore unsuccessful result codes for environmental reverb, as it is
+    // optional for this example
+    return engineEngine_ != NULL;
+}
+
+// asks for the low latency path before the object is realized. Devices that
+// don't know the key keep their default mode, so failures are only logged.
+static void requestLowLatency(SLObjectItf object) {
+#ifdef SL_ANDROID_KEY_PERFORMANCE_MODE
+    SLAndroidConfigurationItf config;
+    if ((*object)->GetInterface(object, SL_IID_ANDROIDCONFIGURATION, &config)
+        != SL_RESULT_SUCCESS) {
+        return;
+    }
+    SLuint32 mode = SL_ANDROID_PERFORMANCE_LATENCY;
+    SLresult result = (*config)->SetConfiguration(config, SL_ANDROID_KEY_PERFORMANCE_MODE,
+                                                  &mode, sizeof(mode));
+    if (SL_RESULT_SUCCESS != result) {
+        LOGI("low latency performance mode not available: %u", result);
+    }
+#else
+    (void) object;
+#endif
+}
+
+AudioStream *OpenSLBackend::createPlayer(const StreamFormat &format, int queueDepth) {
+    SLresult result;
+
+    // configure audio source
+    SLDataLocator_AndroidSimpleBufferQueue loc_bufq = {
+            SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE, static_cast<SLuint32>(queueDepth)};
+    SLDataFormat_PCM format_pcm = {
+            SL_DATAFORMAT_PCM,           static_cast<SLuint32>(format.channels),
+            static_cast<SLuint32>(format.sampleRate * 1000), SL_PCMSAMPLEFORMAT_FIXED_16,
+            SL_PCMSAMPLEFORMAT_FIXED_16, channelMask(format.channels),
+            SL_BYTEORDER_LITTLEENDIAN};
+    SLDataSource audioSrc = {&loc_bufq, &format_pcm};
+
+    // configure audio sink
+    SLDataLocator_OutputMix loc_outmix = {SL_DATALOCATOR_OUTPUTMIX,
+                                          outputMixObject_};
+    SLDataSink audioSnk = {&loc_outmix, NULL};
+
+    /*
+     * create audio player:
+     *     fast audio does not support when SL_IID_EFFECTSEND is required, so it
+     *     is not requested at all; the configuration interface is optional
+     */
+    const SLInterfaceID ids[3] = {
+            SL_IID_BUFFERQUEUE, SL_IID_VOLUME, SL_IID_ANDROIDCONFIGURATION,
+            /*SL_IID_MUTESOLO,*/};
+    const SLboolean req[3] = {SL_BOOLEAN_TRUE, SL_BOOLEAN_TRUE, SL_BOOLEAN_FALSE,
+            /*SL_BOOLEAN_TRUE,*/};
+
+    SLObjectItf playerObject;
+    result = (*engineEngine_)
+            ->CreateAudioPlayer(engineEngine_, &playerObject, &audioSrc,
+                                &audioSnk, 3, ids, req);
+    if (SL_RESULT_SUCCESS != result) {
+        LOGI("CreateAudioPlayer failed: %u", result);
+        return NULL;
+    }
+    requestLowLatency(playerObject);
+
+    // realize the player
+    result = (*playerObject)->Realize(playerObject, SL_BOOLEAN_FALSE);
+    if (SL_RESULT_SUCCESS != result) {
+        (*playerObject)->Destroy(playerObject);
+        return NULL;
+    }
+
+    OpenSLStream *stream = new OpenSLStream(playerObject, false);
+    if (!stream->init()) {
+        delete stream;
+        return NULL;
+    }
+    return stream;
+}
+
+AudioStream *OpenSLBackend::createRecorder(const StreamFormat &format, int queueDepth) {
+    SLresult result;
+
+    // configure audio source
+    SLDataLocator_IODevice loc_dev = {SL_DATALOCATOR_IODEVICE,
+                                      SL_IODEVICE_AUDIOINPUT,
+                                      SL_DEFAULTDEVICEID_AUDIOINPUT, NULL};
+    SLDataSource audioSrc = {&loc_dev, NULL};
+
+    // configure audio sink
+    SLDataLocator_AndroidSimpleBufferQueue loc_bq = {
+            SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE, static_cast<SLuint32>(queueDepth)};
+    SLDataFormat_PCM format_pcm = {
+            SL_DATAFORMAT_PCM,           static_cast<SLuint32>(format.channels),
+            static_cast<SLuint32>(format.sampleRate * 1000), SL_PCMSAMPLEFORMAT_FIXED_16,
+            SL_PCMSAMPLEFORMAT_FIXED_16, channelMask(format.channels),
+            SL_BYTEORDER_LITTLEENDIAN};
+    SLDataSink audioSnk = {&loc_bq, &format_pcm};
+
+    // create audio recorder
+    // (requires the RECORD_AUDIO permission)
+    const SLInterfaceID id[2] = {SL_IID_ANDROIDSIMPLEBUFFERQUEUE, SL_IID_ANDROIDCONFIGURATION};
+    const SLboolean req[2] = {SL_BOOLEAN_TRUE, SL_BOOLEAN_FALSE};
+    SLObjectItf recorderObject;
+    result = (*engineEngine_)
+            ->CreateAudioRecorder(engineEngine_, &recorderObject, &audioSrc,
+                                  &audioSnk, 2, id, req);
+    if (SL_RESULT_SUCCESS != result) {
+        return NULL;
+    }
+    requestLowLatency(recorderObject);
+
+    // realize the audio recorder
+    result = (*recorderObject)->Realize(recorderObject, SL_BOOLEAN_FALSE);
+    if (SL_RESULT_SUCCESS != result) {
+        (*recorderObject)->Destroy(recorderObject);
+        return NULL;
+    }
+
+    OpenSLStream *stream = new OpenSLStream(recorderObject, true);
+    if (!stream->init()) {
+        delete stream;
+        return NULL;
+    }
+    return stream;
+}
@@ -0,0 +1,35 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_OPENSLBACKEND_H
+#define NATIVEFEEDBACK_OPENSLBACKEND_H
+
+#include <SLES/OpenSLES.h>
+#include <SLES/OpenSLES_Android.h>
+
+#include "AudioBackend.h"
+
+// OpenSL ES engine and output mix, creating buffer queue players and
+// recorders on them
+class OpenSLBackend : public AudioBackend {
+public:
+    OpenSLBackend();
+    ~OpenSLBackend() override;
+
+    AudioStream *createPlayer(const StreamFormat &format, int queueDepth) override;
+    AudioStream *createRecorder(const StreamFormat &format, int queueDepth) override;
+
+private:
+    bool createEngine();
+
+    // engine interfaces
+    SLObjectItf engineObject_;
+    SLEngineItf engineEngine_;
+
+    // output mix interfaces
+    SLObjectItf outputMixObject_;
+    SLEnvironmentalReverbItf outputMixEnvironmentalReverb_;
+};
+
+#endif //NATIVEFEEDBACK_OPENSLBACKEND_H
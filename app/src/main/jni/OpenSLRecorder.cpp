@@ -1,507 +1,785 @@
 //
 // Created by darrenyuan on 2022/11/6.
 //
-// for native audio
-#include <SLES/OpenSLES.h>
-#include <SLES/OpenSLES_Android.h>
-
-#include <cassert>
-#include <android/log.h>
-#include <pthread.h>
-#include <fstream>
-#include <vector>
+// JNI entry points of OpenSLEngine. The record/playback logic lives in
+// AudioEngine, running here on the OpenSL ES backend.
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
 
 #include "com_darrenyuan_nativefeedback_OpenSLRecorder.h"
+#include "AudioEngine.h"
+#include "AudioThreads.h"
+#include "LiveCapture.h"
+#include "OfflineEngine.h"
+#include "OpenSLBackend.h"
 
 #define LOG_TAG "NativeOpenSLRecorder"
 
-#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
-
-// engine interfaces
-static SLObjectItf engineObject = NULL;
-static SLEngineItf engineEngine;
-
-// a mutext to guard against re-entrance to record & playback
-// as well as make recording and playing back to be mutually exclusive
-// this is to avoid crash at situations like:
-//    recording is in session [not finished]
-//    user presses record button and another recording coming in
-// The action: when recording/playing back is not finished, ignore the new
-// request
-static pthread_mutex_t audioEngineLock = PTHREAD_MUTEX_INITIALIZER;
-
-// output mix interfaces
-static SLObjectItf outputMixObject = NULL;
-static SLEnvironmentalReverbItf outputMixEnvironmentalReverb = NULL;
-
-// aux effect on the output mix, used by the buffer queue player
-static const SLEnvironmentalReverbSettings reverbSettings =
-        SL_I3DL2_ENVIRONMENT_PRESET_STONECORRIDOR;
-
-// recorder interfaces
-static SLObjectItf recorderObject = NULL;
-static SLRecordItf recorderRecord;
-static SLAndroidSimpleBufferQueueItf recorderBufferQueue;
-
-// buffer queue player interfaces
-static SLObjectItf bqPlayerObject = NULL;
-static SLPlayItf bqPlayerPlay;
-static SLAndroidSimpleBufferQueueItf bqPlayerBufferQueue;
-static SLEffectSendItf bqPlayerEffectSend;
-static SLMuteSoloItf bqPlayerMuteSolo;
-static SLVolumeItf bqPlayerVolume;
-static SLmilliHertz bqPlayerSampleRate = 0;
-static jint bqPlayerBufSize = 0;
-static short* resampleBuf = NULL;
-
-// pointer and size of the next player buffer to enqueue
-const int PLAYER_BUFFER_COUNT = 50;
-const int BUFFER_SIZE = 1024;
-static unsigned char *playerBuffers = NULL;
-std::fstream inputFs;
-
-// 5 seconds of recorded audio at 44.1 kHz mono, 16-bit signed little endian
-#define RECORDER_FRAMES (44100 * 5)
-static short recorderBuffer[RECORDER_FRAMES];
-static unsigned recorderSize = 0;
-static const char* pcmDstPathPtr;
+#include "Log.h"
+
+// The engine is built by the first call that needs it and lives until
+// shutDown, after which every call fails rather than building another.
+// A call holds an EngineRef for as long as it uses the engine, and
+// shutDown waits for the last one to go before deleting it. Calls made
+// after it return false, -1 or null, or do nothing.
+static std::mutex engineMutex;
+static std::condition_variable engineReleased;
+static AudioEngine *audioEngine = NULL;
+static int engineUsers = 0;
+static bool engineShutDown = false;
+static JavaVM *javaVm = NULL;
+
+static void onMixerStopped(void *context);
+
+class EngineRef {
+public:
+    EngineRef() : engine_(NULL) {
+        std::lock_guard<std::mutex> lock(engineMutex);
+        if (engineShutDown) {
+            return;
+        }
+        if (audioEngine == NULL) {
+            LOGI("engine is null");
+            audioEngine = new AudioEngine(new OpenSLBackend());
+            audioEngine->setMixerStopped(onMixerStopped, NULL);
+        }
+        engine_ = audioEngine;
+        engineUsers++;
+    }
+
+    ~EngineRef() {
+        if (engine_ == NULL) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(engineMutex);
+        if (--engineUsers == 0) {
+            engineReleased.notify_all();
+        }
+    }
+
+    // false once shutDown has run
+    bool valid() const { return engine_ != NULL; }
+    AudioEngine *get() const { return engine_; }
+    AudioEngine *operator->() const { return engine_; }
+
+private:
+    EngineRef(const EngineRef &);
+    EngineRef &operator=(const EngineRef &);
+
+    AudioEngine *engine_;
+};
+
+// OpenSLRecorder streams the microphone into a direct ByteBuffer owned by
+// Java, laid out as a SharedPcmRing; the global ref keeps it alive until
+// nativeRelease
+static LiveCapture *liveCapture = NULL;
+static jobject liveRing = NULL;
+
+// nativeInit error codes, a positive result is the ring's data capacity
+static const jint LIVE_ERROR_BUFFER = -1;
+static const jint LIVE_ERROR_RECORDER = -2;
+static const jint LIVE_ERROR_STATE = -3;
+
+static void releaseLiveCapture(JNIEnv *env) {
+    delete liveCapture;
+    liveCapture = NULL;
+    if (liveRing != NULL) {
+        env->DeleteGlobalRef(liveRing);
+        liveRing = NULL;
+    }
+}
+
+// the direct ByteBuffers behind mixer memory sources, by source id; a ref
+// goes when its source is removed, its slot is reused or the mixer stops.
+// Guarded by engineMutex, which the source calls hold across the mixer
+// call and the update, so a stop can't slip in between.
+static jobject mixerBuffers[MIXER_MAX_SOURCES] = {NULL};
+
+static void setMixerBuffer(JNIEnv *env, int id, jobject buffer) {
+    if (mixerBuffers[id] != NULL) {
+        env->DeleteGlobalRef(mixerBuffers[id]);
+    }
+    mixerBuffers[id] = buffer != NULL ? env->NewGlobalRef(buffer) : NULL;
+}
+
+static void releaseMixerBuffers(JNIEnv *env) {
+    for (int id = 0; id < MIXER_MAX_SOURCES; id++) {
+        setMixerBuffer(env, id, NULL);
+    }
+}
+
+// once the mixer has dropped every source, on the thread that stopped it:
+// a Java caller's, or the engine's control thread which has to attach
+static void onMixerStopped(void *context) {
+    JNIEnv *env = NULL;
+    if (javaVm == NULL) {
+        return;
+    }
+    jint attached = javaVm->GetEnv(reinterpret_cast<void **>(&env), JNI_VERSION_1_6);
+    if (attached == JNI_EDETACHED && javaVm->AttachCurrentThread(&env, NULL) != JNI_OK) {
+        return;
+    }
+    if (env != NULL) {
+        std::lock_guard<std::mutex> lock(engineMutex);
+        releaseMixerBuffers(env);
+    }
+    if (attached == JNI_EDETACHED) {
+        javaVm->DetachCurrentThread();
+    }
+}
+
+// the direct ByteBuffers the analyzers publish into, by AnalysisTap.
+// Guarded by engineMutex, held across the analyzer call and the update.
+static jobject analysisBuffers[TAP_COUNT] = {NULL};
+
+// with engineMutex held; engine is NULL once it's gone
+static void stopAnalysis(JNIEnv *env, AudioEngine *engine, int tap) {
+    if (engine != NULL) {
+        engine->stopAnalysis(static_cast<AnalysisTap>(tap));
+    }
+    if (analysisBuffers[tap] != NULL) {
+        env->DeleteGlobalRef(analysisBuffers[tap]);
+        analysisBuffers[tap] = NULL;
+    }
+}
+
+static unsigned delayFrames(const EngineRef &engine, jint delayMs) {
+    return delayMs > 0 ? static_cast<unsigned>(
+            static_cast<long long>(delayMs) * engine->sampleRate() / 1000) : 0;
+}
 
 #ifdef __cplusplus
 extern "C" {
 #endif
-void createEngine()
+
+JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM *vm, void *reserved) {
+    // for handing back mixer buffers from the engine's control thread
+    javaVm = vm;
+    return JNI_VERSION_1_6;
+}
+
+// buffer must be a direct ByteBuffer of more than SharedPcmRing::HEADER_BYTES;
+// Java reads PCM out of it as described in SharedPcmRing.h
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLRecorder_nativeInit(JNIEnv *env, jobject thiz, jint sampleRate,
+                                                             jobject buffer, jint channels,
+                                                             jint framesPerBuffer)
 {
-    LOGI("createEngine");
-    SLresult result;
-
-    // create engine
-    result = slCreateEngine(&engineObject, 0, NULL, 0, NULL, NULL);
-    assert(SL_RESULT_SUCCESS == result);
-    (void) result;
-
-    // realize the engine
-    result = (*engineObject)->Realize(engineObject, SL_BOOLEAN_FALSE);
-    assert(SL_RESULT_SUCCESS == result);
-    (void) result;
-
-    // get the engine interface, which is needed in order to create other objects
-    result = (*engineObject)->GetInterface(engineObject, SL_IID_ENGINE, &engineEngine);
-    assert(SL_RESULT_SUCCESS == result);
-    (void) result;
-
-    // create output mix, with environmental reverb specified as a non-required
-    // interface
-    const SLInterfaceID ids[1] = {SL_IID_ENVIRONMENTALREVERB};
-    const SLboolean req[1] = {SL_BOOLEAN_FALSE};
-    result = (*engineEngine)
-            ->CreateOutputMix(engineEngine, &outputMixObject, 1, ids, req);
-    assert(SL_RESULT_SUCCESS == result);
-    (void)result;
-
-    // realize the output mix
-    result = (*outputMixObject)->Realize(outputMixObject, SL_BOOLEAN_FALSE);
-    assert(SL_RESULT_SUCCESS == result);
-    (void)result;
-
-    // get the environmental reverb interface
-    // this could fail if the environmental reverb effect is not available,
-    // either because the feature is not present, excessive CPU load, or
-    // the required MODIFY_AUDIO_SETTINGS permission was not requested and granted
-    result = (*outputMixObject)
-            ->GetInterface(outputMixObject, SL_IID_ENVIRONMENTALREVERB,
-                           &outputMixEnvironmentalReverb);
-    if (SL_RESULT_SUCCESS == result) {
-        result = (*outputMixEnvironmentalReverb)
-                ->SetEnvironmentalReverbProperties(
-                        outputMixEnvironmentalReverb, &reverbSettings);
-        (void)result;
-    }
-    // ignore unsuccessful result codes for environmental reverb, as it is
-    // optional for this example
-}
-
-// this callback handler is called every time a buffer finishes recording
-void bqRecorderCallback(SLAndroidSimpleBufferQueueItf bq, void* context) {
-    assert(bq == recorderBufferQueue);
-    assert(NULL == context);
-    // for streaming recording, here we would call Enqueue to give recorder the
-    // next buffer to fill but instead, this is a one-time buffer so we stop
-    // recording
-    SLresult result;
-    result =
-            (*recorderRecord)->SetRecordState(recorderRecord, SL_RECORDSTATE_STOPPED);
-    if (SL_RESULT_SUCCESS == result) {
-        recorderSize = RECORDER_FRAMES * sizeof(short);
-        LOGI("bqRecorderCallback fill 5s's buffer,sizeof short is %d,  buffer size is %d", sizeof(short), recorderSize);
-    }
-    // 将录得的数据写入文件
-    std::fstream outputFs;
-    outputFs.open(pcmDstPathPtr, std::ios_base::out);
-    outputFs.write(reinterpret_cast<const char *>(recorderBuffer), RECORDER_FRAMES * sizeof(short));
-    LOGI("write pcm data done");
-    assert(SL_RESULT_SUCCESS == result);
-    pthread_mutex_unlock(&audioEngineLock);
+    EngineRef engine;
+    if (!engine.valid()) {
+        return LIVE_ERROR_STATE;
+    }
+    releaseLiveCapture(env);
+    void *memory = env->GetDirectBufferAddress(buffer);
+    jlong bytes = env->GetDirectBufferCapacity(buffer);
+    if (memory == nullptr || bytes <= 0) {
+        LOGI("nativeInit needs a direct ByteBuffer");
+        return LIVE_ERROR_BUFFER;
+    }
+    StreamFormat format;
+    format.sampleRate = sampleRate;
+    format.channels = channels;
+    liveCapture = new LiveCapture(engine->backend());
+    size_t capacity = liveCapture->init(format, framesPerBuffer, memory, static_cast<size_t>(bytes));
+    if (capacity == 0) {
+        releaseLiveCapture(env);
+        return LIVE_ERROR_RECORDER;
+    }
+    liveRing = env->NewGlobalRef(buffer);
+    return static_cast<jint>(capacity);
 }
 
-JNIEXPORT jboolean JNICALL
-Java_com_darrenyuan_nativefeedback_OpenSLEngine_createAudioRecorder(JNIEnv *env, jobject thiz)
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLRecorder_nativeStart(JNIEnv *env, jobject thiz)
 {
-    LOGI("createAudioRecorder");
-    if (engineEngine == nullptr) {
-        LOGI("engineEngine is null");
-        createEngine();
-    }
-
-    SLresult result;
-
-    // configure audio source
-    SLDataLocator_IODevice loc_dev = {SL_DATALOCATOR_IODEVICE,
-                                      SL_IODEVICE_AUDIOINPUT,
-                                      SL_DEFAULTDEVICEID_AUDIOINPUT, NULL};
-    SLDataSource audioSrc = {&loc_dev, NULL};
-
-    // configure audio sink
-    SLDataLocator_AndroidSimpleBufferQueue loc_bq = {
-            SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE, 2};
-    SLDataFormat_PCM format_pcm = {
-            SL_DATAFORMAT_PCM,           1,
-            SL_SAMPLINGRATE_44_1,          SL_PCMSAMPLEFORMAT_FIXED_16,
-            SL_PCMSAMPLEFORMAT_FIXED_16, SL_SPEAKER_FRONT_CENTER,
-            SL_BYTEORDER_LITTLEENDIAN};
-    SLDataSink audioSnk = {&loc_bq, &format_pcm};
-
-    // create audio recorder
-    // (requires the RECORD_AUDIO permission)
-    const SLInterfaceID id[1] = {SL_IID_ANDROIDSIMPLEBUFFERQUEUE};
-    const SLboolean req[1] = {SL_BOOLEAN_TRUE};
-    result = (*engineEngine)
-            ->CreateAudioRecorder(engineEngine, &recorderObject, &audioSrc,
-                                  &audioSnk, 1, id, req);
-    if (SL_RESULT_SUCCESS != result) {
-        return JNI_FALSE;
+    if (liveCapture == NULL) {
+        return LIVE_ERROR_STATE;
     }
+    return liveCapture->start() ? 0 : LIVE_ERROR_RECORDER;
+}
 
-    // realize the audio recorder
-    result = (*recorderObject)->Realize(recorderObject, SL_BOOLEAN_FALSE);
-    if (SL_RESULT_SUCCESS != result) {
-        return JNI_FALSE;
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLRecorder_nativeStop(JNIEnv *env, jobject thiz)
+{
+    if (liveCapture == NULL) {
+        return LIVE_ERROR_STATE;
     }
+    return liveCapture->stop() ? 0 : LIVE_ERROR_RECORDER;
+}
 
-    // get the record interface
-    result = (*recorderObject)
-            ->GetInterface(recorderObject, SL_IID_RECORD, &recorderRecord);
-    assert(SL_RESULT_SUCCESS == result);
-    (void)result;
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLRecorder_nativeRelease(JNIEnv *env, jobject thiz)
+{
+    releaseLiveCapture(env);
+    return 0;
+}
 
-    // get the buffer queue interface
-    result = (*recorderObject)
-            ->GetInterface(recorderObject, SL_IID_ANDROIDSIMPLEBUFFERQUEUE,
-                           &recorderBufferQueue);
-    assert(SL_RESULT_SUCCESS == result);
-    (void)result;
+// volume in percent, 100 leaves the signal as the microphone delivers it
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLRecorder_nativeSetMicVolume(JNIEnv *env, jobject thiz, jint volume)
+{
+    if (liveCapture == NULL) {
+        return LIVE_ERROR_STATE;
+    }
+    liveCapture->setVolume(volume < 0 ? 0.0f : volume / 100.0f);
+    return 0;
+}
 
-    // register callback on the buffer queue
-    result =
-            (*recorderBufferQueue)
-                    ->RegisterCallback(recorderBufferQueue, bqRecorderCallback, NULL);
-    assert(SL_RESULT_SUCCESS == result);
-    (void)result;
+// sampleRate and framesPerBurst come from AudioManager.getProperty(
+// PROPERTY_OUTPUT_SAMPLE_RATE / PROPERTY_OUTPUT_FRAMES_PER_BUFFER). Also
+// realizes the player and recorder the sessions start on, so call it early,
+// not right before the first startPlay. Both rebuild streams the sessions
+// use, so they run on the control thread like the session calls below;
+// true once queued, and a session started after them runs on what they
+// built
+JNIEXPORT jboolean JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_configure(JNIEnv *env, jobject thiz, jint sampleRate, jint framesPerBurst)
+{
+    EngineRef engine;
+    if (!engine.valid() || sampleRate <= 0 || framesPerBurst <= 0) {
+        return JNI_FALSE;
+    }
+    return engine->post(COMMAND_CONFIGURE, NULL, sampleRate, framesPerBurst) ? JNI_TRUE : JNI_FALSE;
+}
 
-    return JNI_TRUE;
+JNIEXPORT jboolean JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_createAudioRecorder(JNIEnv *env, jobject thiz)
+{
+    EngineRef engine;
+    return engine.valid() && engine->post(COMMAND_CREATE_RECORDER) ? JNI_TRUE : JNI_FALSE;
 }
 
+// the session calls below queue a command for the engine's control thread
+// and return straight away; getState() tells how it went
 JNIEXPORT void JNICALL
 Java_com_darrenyuan_nativefeedback_OpenSLEngine_startRecord(JNIEnv *env, jobject thiz, jstring desPath)
 {
-    pcmDstPathPtr = env->GetStringUTFChars(desPath, nullptr);
-    LOGI("startRecord pcmDstPathPtr' value is %s", pcmDstPathPtr);
-
-    SLresult result;
-
-    if (pthread_mutex_trylock(&audioEngineLock)) {
+    EngineRef engine;
+    if (!engine.valid()) {
         return;
     }
-    // in case already recording, stop recording and clear buffer queue
-    result =
-            (*recorderRecord)->SetRecordState(recorderRecord, SL_RECORDSTATE_STOPPED);
-    assert(SL_RESULT_SUCCESS == result);
-    (void)result;
-    result = (*recorderBufferQueue)->Clear(recorderBufferQueue);
-    assert(SL_RESULT_SUCCESS == result);
-    (void)result;
-
-    // the buffer is not valid for playback yet
-    recorderSize = 0;
-
-    // enqueue an empty buffer to be filled by the recorder
-    // (for streaming recording, we would enqueue at least 2 empty buffers to
-    // start things off)
-    result = (*recorderBufferQueue)
-            ->Enqueue(recorderBufferQueue, recorderBuffer,
-                      RECORDER_FRAMES * sizeof(short));
-    // the most likely other result is SL_RESULT_BUFFER_INSUFFICIENT,
-    // which for this code example would indicate a programming error
-    assert(SL_RESULT_SUCCESS == result);
-    (void)result;
-
-    // start recording
-    result = (*recorderRecord)
-            ->SetRecordState(recorderRecord, SL_RECORDSTATE_RECORDING);
-    assert(SL_RESULT_SUCCESS == result);
-    (void)result;
-}
-
-extern "C"
+    const char *pcmDstPathPtr = env->GetStringUTFChars(desPath, nullptr);
+    engine->post(COMMAND_START_RECORD, pcmDstPathPtr);
+    env->ReleaseStringUTFChars(desPath, pcmDstPathPtr);
+}
+
 JNIEXPORT void JNICALL
 Java_com_darrenyuan_nativefeedback_OpenSLEngine_stopRecord(JNIEnv *env, jobject thiz) {
-    LOGI("stopRecord");
-    SLresult result;
-    result =
-            (*recorderRecord)->SetRecordState(recorderRecord, SL_RECORDSTATE_STOPPED);
-    if (SL_RESULT_SUCCESS == result) {
-        LOGI("stop success");
-    }
-    pthread_mutex_unlock(&audioEngineLock);
-}
-
-int counter = 0;
-// this callback handler is called every time a buffer finishes playing
-void bqPlayerCallback(SLAndroidSimpleBufferQueueItf bq, void* context) {
-    LOGI("bqPlayerCallback");
-    assert(bq == bqPlayerBufferQueue);
-    assert(nullptr == context);
-
-    SLresult result = 0;
-    // enqueue another buffer
-//    char * buffer = getPcmBufferData();
-    char inBuffer[BUFFER_SIZE * PLAYER_BUFFER_COUNT] = {0};
-//    inputFs.read(tempBuffer, BUFFER_SIZE * PLAYER_BUFFER_COUNT);
-//    inputFs.read(tempBuffer, BUFFER_SIZE * PLAYER_BUFFER_COUNT);
-    // todo darrenyuen 每段buffer间存在杂音
-    if (inputFs.read(inBuffer, sizeof(inBuffer))) {
-        counter++;
-        LOGI("size of buffer is %d, counter is %d", sizeof(inBuffer), counter);
-        result = (*bqPlayerBufferQueue)
-                ->Enqueue(bqPlayerBufferQueue, inBuffer, sizeof(inBuffer));
-    } else {
-        result = (*bqPlayerPlay)->SetPlayState(bqPlayerPlay, SL_PLAYSTATE_STOPPED);
-    }
-
-    // the most likely other result is SL_RESULT_BUFFER_INSUFFICIENT,
-    // which for this code example would indicate a programming error
-    if (SL_RESULT_SUCCESS != result) {
-        pthread_mutex_unlock(&audioEngineLock);
-    }
-    (void)result;
-    LOGI("read buffer to play done");
-//    } else {
-//        releaseResampleBuf();
-//        pthread_mutex_unlock(&audioEngineLock);
-//    }
-}
-
-void openSrcFile() {
-    inputFs.open(pcmDstPathPtr, std::ios_base::in);
-    inputFs.seekg(0, std::ios::end);
-    long fileSize = inputFs.tellg();
-    inputFs.seekg(0, std::ios::beg);
-    LOGI("openSrcFile size is %ld", fileSize);
+    EngineRef engine;
+    if (engine.valid()) {
+        engine->post(COMMAND_STOP_RECORD);
+    }
 }
 
 JNIEXPORT void JNICALL
 Java_com_darrenyuan_nativefeedback_OpenSLEngine_startPlay(JNIEnv *env, jobject thiz, jstring srcFilePath) {
+    EngineRef engine;
+    if (!engine.valid()) {
+        return;
+    }
+    const char *pcmSrcPathPtr = env->GetStringUTFChars(srcFilePath, nullptr);
+    engine->post(COMMAND_START_PLAY, pcmSrcPathPtr);
+    env->ReleaseStringUTFChars(srcFilePath, pcmSrcPathPtr);
+}
 
-    pcmDstPathPtr = env->GetStringUTFChars(srcFilePath, nullptr);
-    LOGI("startPlay srcFilePath' value is %s", pcmDstPathPtr);
-
-    if (engineEngine == nullptr) {
-        LOGI("start play engineEngine is null");
-        createEngine();
-    }
-
-    openSrcFile();
-
-    SLresult result;
-//    if (sampleRate >= 0 && bufSize >= 0) {
-//        bqPlayerSampleRate = sampleRate * 1000;
-//        /*
-//         * device native buffer size is another factor to minimize audio latency,
-//         * not used in this sample: we only play one giant buffer here
-//         */
-//        bqPlayerBufSize = bufSize;
-//    }
-
-    // configure audio source
-    SLDataLocator_AndroidSimpleBufferQueue loc_bufq = {
-            SL_DATALOCATOR_ANDROIDSIMPLEBUFFERQUEUE, PLAYER_BUFFER_COUNT};
-
-//    if (playerBuffers == nullptr) {
-//        playerBuffers = (unsigned char *) malloc(PLAYER_BUFFER_COUNT * BUFFER_SIZE);
-//        memset(playerBuffers, 0, PLAYER_BUFFER_COUNT * BUFFER_SIZE);
-//    }
-
-    SLDataFormat_PCM format_pcm = {
-            SL_DATAFORMAT_PCM,           1,
-            SL_SAMPLINGRATE_44_1,           SL_PCMSAMPLEFORMAT_FIXED_16,
-            SL_PCMSAMPLEFORMAT_FIXED_16, SL_SPEAKER_FRONT_CENTER,
-            SL_BYTEORDER_LITTLEENDIAN};
-
-    /*
-     * Enable Fast Audio when possible:  once we set the same rate to be the
-     * native, fast audio path will be triggered
-     */
-//    if (bqPlayerSampleRate) {
-//        format_pcm.samplesPerSec = bqPlayerSampleRate;  // sample rate in mili
-//        // second
-//    }
-    SLDataSource audioSrc = {&loc_bufq, &format_pcm};
-
-    // configure audio sink
-    SLDataLocator_OutputMix loc_outmix = {SL_DATALOCATOR_OUTPUTMIX,
-                                          outputMixObject};
-    SLDataSink audioSnk = {&loc_outmix, NULL};
-
-    // create output mix
-//    result = (*engineEngine)->CreateOutputMix(engineEngine, &outputMixObject, 0, NULL, NULL);
-//    if (SL_RESULT_SUCCESS != result) {
-//        LOGI("engineEngine.CreateOutputMix failed: %d", result);
-//    }
-
-    // realize the output mix
-//    result = (*outputMixObject)->Realize(outputMixObject, SL_BOOLEAN_FALSE);
-//    if (SL_RESULT_SUCCESS != result) {
-//        LOGI("engineEngine.Realize failed: %d", result);
-//    }
-
-    /*
-     * create audio player:
-     *     fast audio does not support when SL_IID_EFFECTSEND is required, skip it
-     *     for fast audio case
-     */
-    const SLInterfaceID ids[3] = {
-            SL_IID_BUFFERQUEUE, SL_IID_VOLUME, SL_IID_EFFECTSEND,
-            /*SL_IID_MUTESOLO,*/};
-    const SLboolean req[3] = {SL_BOOLEAN_TRUE, SL_BOOLEAN_TRUE, SL_BOOLEAN_TRUE,
-            /*SL_BOOLEAN_TRUE,*/};
-
-    result =
-            (*engineEngine)
-                    ->CreateAudioPlayer(engineEngine, &bqPlayerObject, &audioSrc,
-                                        &audioSnk, 2, ids, req);
-
-    assert(SL_RESULT_SUCCESS == result);
-    (void)result;
-
-    // realize the player
-    result = (*bqPlayerObject)->Realize(bqPlayerObject, SL_BOOLEAN_FALSE);
-    assert(SL_RESULT_SUCCESS == result);
-    (void)result;
-
-    // get the play interface
-    result = (*bqPlayerObject)
-            ->GetInterface(bqPlayerObject, SL_IID_PLAY, &bqPlayerPlay);
-    assert(SL_RESULT_SUCCESS == result);
-    (void)result;
-
-    // get the buffer queue interface
-    result = (*bqPlayerObject)
-            ->GetInterface(bqPlayerObject, SL_IID_BUFFERQUEUE,
-                           &bqPlayerBufferQueue);
-    assert(SL_RESULT_SUCCESS == result);
-    (void)result;
-
-    // register callback on the buffer queue
-    result = (*bqPlayerBufferQueue)
-            ->RegisterCallback(bqPlayerBufferQueue, bqPlayerCallback, NULL);
-    assert(SL_RESULT_SUCCESS == result);
-    (void)result;
-
-    // get the effect send interface
-//    bqPlayerEffectSend = NULL;
-//    if (0 == bqPlayerSampleRate) {
-//        result = (*bqPlayerObject)
-//                ->GetInterface(bqPlayerObject, SL_IID_EFFECTSEND,
-//                               &bqPlayerEffectSend);
-//        assert(SL_RESULT_SUCCESS == result);
-//        LOGI("get SL_IID_EFFECTSEND interface success");
-//        (void)result;
-//    }
-//
-//#if 0  // mute/solo is not supported for sources that are known to be mono, as
-//    // this is
-//    // get the mute/solo interface
-//    result = (*bqPlayerObject)->GetInterface(bqPlayerObject, SL_IID_MUTESOLO, &bqPlayerMuteSolo);
-//    assert(SL_RESULT_SUCCESS == result);
-//    (void)result;
-//#endif
+// playback from frame of the file on, e.g. where getPlayPosition() was
+// when it stopped
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_startPlayAt(JNIEnv *env, jobject thiz, jstring srcFilePath,
+                                                            jlong frame) {
+    EngineRef engine;
+    if (!engine.valid()) {
+        return;
+    }
+    const char *pcmSrcPathPtr = env->GetStringUTFChars(srcFilePath, nullptr);
+    engine->post(COMMAND_START_PLAY, pcmSrcPathPtr, frame > 0 ? frame : 0);
+    env->ReleaseStringUTFChars(srcFilePath, pcmSrcPathPtr);
+}
+
+// positions are frames of the file playing, at its own rate
+JNIEXPORT jboolean JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_seekPlay(JNIEnv *env, jobject thiz, jlong frame) {
+    EngineRef engine;
+    return engine.valid() && engine->post(COMMAND_SEEK_PLAY, NULL, frame > 0 ? frame : 0)
+           ? JNI_TRUE : JNI_FALSE;
+}
 
-    // get the volume interface
-    result = (*bqPlayerObject)
-            ->GetInterface(bqPlayerObject, SL_IID_VOLUME, &bqPlayerVolume);
-    assert(SL_RESULT_SUCCESS == result);
-    (void)result;
+// repeats [start, end) while it plays; end 0 clears the loop
+JNIEXPORT jboolean JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setPlayLoop(JNIEnv *env, jobject thiz, jlong start, jlong end) {
+    EngineRef engine;
+    return engine.valid()
+           && engine->post(COMMAND_SET_PLAY_LOOP, NULL, start > 0 ? start : 0, end > 0 ? end : 0)
+           ? JNI_TRUE : JNI_FALSE;
+}
 
+// 0.5 to 3 times the file's pace, pitch unchanged, while playing or for
+// the next playback
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setPlaySpeed(JNIEnv *env, jobject thiz, jfloat speed) {
+    EngineRef engine;
+    if (engine.valid()) {
+        engine->setPlaySpeed(speed);
+    }
+}
 
-    char inBuffer[BUFFER_SIZE * PLAYER_BUFFER_COUNT] = {0};
-    // enqueue another buffer
-    result = (*bqPlayerBufferQueue)
-            ->Enqueue(bqPlayerBufferQueue, inBuffer, sizeof(inBuffer));
+JNIEXPORT jfloat JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getPlaySpeed(JNIEnv *env, jobject thiz) {
+    EngineRef engine;
+    return engine.valid() ? engine->playSpeed() : 0.0f;
+}
 
-    // the most likely other result is SL_RESULT_BUFFER_INSUFFICIENT,
-    // which for this code example would indicate a programming error
-    if (SL_RESULT_SUCCESS != result) {
-        pthread_mutex_unlock(&audioEngineLock);
+// plays on into the file after the one playing with no gap, or starts
+// playing it when nothing is
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_queuePlay(JNIEnv *env, jobject thiz, jstring srcFilePath) {
+    EngineRef engine;
+    if (!engine.valid()) {
+        return;
     }
-    (void)result;
+    const char *pcmSrcPathPtr = env->GetStringUTFChars(srcFilePath, nullptr);
+    engine->post(COMMAND_QUEUE_PLAY, pcmSrcPathPtr);
+    env->ReleaseStringUTFChars(srcFilePath, pcmSrcPathPtr);
+}
+
+// how many queued files have played out before the one playing
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getPlayTrack(JNIEnv *env, jobject thiz) {
+    EngineRef engine;
+    return engine.valid() ? static_cast<jint>(engine->playTrack()) : -1;
+}
 
-    // set the player's state to playing
-    result = (*bqPlayerPlay)->SetPlayState(bqPlayerPlay, SL_PLAYSTATE_PLAYING);
-    assert(SL_RESULT_SUCCESS == result);
-    (void)result;
+JNIEXPORT jlong JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getPlayPosition(JNIEnv *env, jobject thiz) {
+    EngineRef engine;
+    return engine.valid() ? static_cast<jlong>(engine->playPosition()) : -1;
+}
+
+// {frames, sample rate} of the file playing or last played
+JNIEXPORT jlongArray JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getPlayLength(JNIEnv *env, jobject thiz) {
+    EngineRef engine;
+    if (!engine.valid()) {
+        return nullptr;
+    }
+    jlong values[2] = {static_cast<jlong>(engine->playLength()),
+                       static_cast<jlong>(engine->playback().fileRate())};
+    jlongArray array = env->NewLongArray(2);
+    if (array != nullptr) {
+        env->SetLongArrayRegion(array, 0, 2, values);
+    }
+    return array;
+}
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setMappedPlayback(JNIEnv *env, jobject thiz, jboolean mapped) {
+    EngineRef engine;
+    if (engine.valid()) {
+        engine->setMappedPlayback(mapped);
+    }
+}
+
+// from the next startRecord, silence is dropped from the file, or with
+// maxGapMs > 0 every pause is shortened to about that; the path + ".vad"
+// index maps the file back to capture time
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setSilenceTrimming(JNIEnv *env, jobject thiz, jboolean enabled,
+                                                                   jint maxGapMs) {
+    VadConfig config;
+    config.enabled = enabled;
+    config.maxGapMs = maxGapMs > 0 ? static_cast<unsigned>(maxGapMs) : 0;
+    EngineRef engine;
+    if (engine.valid()) {
+        engine->setSilenceTrimming(config);
+    }
 }
 
 JNIEXPORT void JNICALL
 Java_com_darrenyuan_nativefeedback_OpenSLEngine_stopPlay(JNIEnv *env, jobject thiz) {
-    LOGI("stop play");
-    SLresult result = (*bqPlayerPlay)->SetPlayState(bqPlayerPlay, SL_PLAYSTATE_STOPPED);
-    assert(result == SL_RESULT_SUCCESS);
+    EngineRef engine;
+    if (engine.valid()) {
+        engine->post(COMMAND_STOP_PLAY);
+    }
 }
 
-void Java_com_darrenyuan_nativefeedback_OpenSLEngine_shutDown(JNIEnv *env, jobject thiz) {
-    LOGI("shutDown");
-    // destroy audio recorder object, and invalidate all associated interfaces
-    if (recorderObject != NULL) {
-        (*recorderObject)->Destroy(recorderObject);
-        recorderObject = NULL;
-        recorderRecord = NULL;
-        recorderBufferQueue = NULL;
+JNIEXPORT jboolean JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_startMonitor(JNIEnv *env, jobject thiz) {
+    EngineRef engine;
+    return engine.valid() && engine->post(COMMAND_START_MONITOR) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_stopMonitor(JNIEnv *env, jobject thiz) {
+    EngineRef engine;
+    if (engine.valid()) {
+        engine->post(COMMAND_STOP_MONITOR);
     }
+}
+
+JNIEXPORT jfloat JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getMonitorLatencyMs(JNIEnv *env, jobject thiz) {
+    // averaged over the last few dozen bursts, valid after a stop too
+    EngineRef engine;
+    return engine.valid() ? static_cast<jfloat>(engine->monitor().stats().latencyMs) : 0.0f;
+}
 
-    // destroy output mix object, and invalidate all associated interfaces
-    if (outputMixObject != NULL) {
-        (*outputMixObject)->Destroy(outputMixObject);
-        outputMixObject = NULL;
-        outputMixEnvironmentalReverb = NULL;
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setFeedbackSuppression(JNIEnv *env, jobject thiz,
+                                                                       jboolean enabled) {
+    // from the next startMonitor
+    EngineRef engine;
+    if (engine.valid()) {
+        engine->setFeedbackSuppression(enabled == JNI_TRUE);
     }
+}
 
-    // destroy engine object, and invalidate all associated interfaces
-    if (engineObject != NULL) {
-        (*engineObject)->Destroy(engineObject);
-        engineObject = NULL;
-        engineEngine = NULL;
+JNIEXPORT jfloatArray JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getFeedbackNotches(JNIEnv *env, jobject thiz) {
+    // {Hz, depth in dB} of every notch in use, live while the monitor runs
+    EngineRef engine;
+    if (!engine.valid()) {
+        return nullptr;
     }
+    const FeedbackSuppressor &suppressor = engine->feedbackSuppressor();
+    jfloat values[2 * FEEDBACK_MAX_NOTCHES];
+    jsize count = 0;
+    for (unsigned i = 0; i < FEEDBACK_MAX_NOTCHES; i++) {
+        float hz, depthDb;
+        suppressor.notch(i, &hz, &depthDb);
+        if (depthDb < 0) {
+            values[count++] = hz;
+            values[count++] = depthDb;
+        }
+    }
+    jfloatArray array = env->NewFloatArray(count);
+    if (array != nullptr) {
+        env->SetFloatArrayRegion(array, 0, count, values);
+    }
+    return array;
+}
 
-    if(playerBuffers != NULL){
-        LOGI("free playerBuffers");
-        free(playerBuffers);
-        playerBuffers = NULL;
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setThreadPolicy(JNIEnv *env, jobject thiz, jint role,
+                                                                jint nice, jint cores) {
+    // role is a ThreadRole and cores a CoreClass; threads started from the
+    // next session on pick it up
+    if (role < 0 || role >= THREAD_ROLE_COUNT || cores < CORES_ANY || cores > CORES_LITTLE) {
+        return;
     }
+    ThreadPolicy policy;
+    policy.nice = nice;
+    policy.cores = static_cast<CoreClass>(cores);
+    AudioThreads::setPolicy(static_cast<ThreadRole>(role), policy);
+}
 
-    inputFs.close();
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setCpuBudget(JNIEnv *env, jobject thiz, jfloat fraction) {
+    // share of each burst the callbacks may take before analysis and
+    // resampling step down
+    EngineRef engine;
+    if (engine.valid()) {
+        engine->budget().configure(fraction, CPU_BUDGET_DEFAULT_WINDOW);
+    }
+}
 
-    pthread_mutex_destroy(&audioEngineLock);
+JNIEXPORT jfloatArray JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getCpuBudget(JNIEnv *env, jobject thiz) {
+    // {level, load of the last window, bursts over budget, degradations,
+    // recoveries}
+    EngineRef engine;
+    if (!engine.valid()) {
+        return nullptr;
+    }
+    const CpuBudget &budget = engine->budget();
+    jfloat values[] = {
+            static_cast<jfloat>(budget.level()),
+            static_cast<jfloat>(budget.load()),
+            static_cast<jfloat>(budget.overBudget()),
+            static_cast<jfloat>(budget.degradations()),
+            static_cast<jfloat>(budget.recoveries()),
+    };
+    jsize count = sizeof(values) / sizeof(values[0]);
+    jfloatArray array = env->NewFloatArray(count);
+    if (array != nullptr) {
+        env->SetFloatArrayRegion(array, 0, count, values);
+    }
+    return array;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_measureLatency(JNIEnv *env, jobject thiz) {
+    // runs for under a second on the control thread, getLatencyResult()
+    // has the outcome once getState() is back to idle
+    EngineRef engine;
+    return engine.valid() && engine->post(COMMAND_MEASURE_LATENCY) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getLatencyResult(JNIEnv *env, jobject thiz) {
+    // {round trip in ms, confidence 0..1} of the last measurement,
+    // confidence 0 if the sequence wasn't found; null before the first one
+    EngineRef engine;
+    LatencyResult result;
+    if (!engine.valid() || !engine->lastLatency(&result)) {
+        return nullptr;
+    }
+    jfloat values[2] = {static_cast<jfloat>(result.latencyMs),
+                        static_cast<jfloat>(result.valid ? result.confidence : 0)};
+    jfloatArray array = env->NewFloatArray(2);
+    if (array != nullptr) {
+        env->SetFloatArrayRegion(array, 0, 2, values);
+    }
+    return array;
+}
+
+// an EngineState: 0 idle, 1 recording, 2 playing, 3 monitoring, 4 measuring,
+// 5 stopping, 6 mixing, 7 configuring; -1 after shutDown
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getState(JNIEnv *env, jobject thiz) {
+    EngineRef engine;
+    return engine.valid() ? engine->state() : -1;
+}
+
+JNIEXPORT jlongArray JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getStats(JNIEnv *env, jobject thiz) {
+    // layout: see StatsField in AudioStats.h, recorder block then player block
+    jlong snapshot[AudioEngine::STATS_SNAPSHOT_SIZE];
+    long long fields[AudioEngine::STATS_SNAPSHOT_SIZE];
+    EngineRef engine;
+    if (engine.valid()) {
+        engine->getStats(fields);
+    }
+    for (int i = 0; i < AudioEngine::STATS_SNAPSHOT_SIZE; i++) {
+        snapshot[i] = fields[i];
+    }
+    jlongArray result = env->NewLongArray(AudioEngine::STATS_SNAPSHOT_SIZE);
+    if (result != nullptr) {
+        env->SetLongArrayRegion(result, 0, AudioEngine::STATS_SNAPSHOT_SIZE, snapshot);
+    }
+    return result;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_startMixer(JNIEnv *env, jobject thiz) {
+    EngineRef engine;
+    return engine.valid() && engine->post(COMMAND_START_MIXER) ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_stopMixer(JNIEnv *env, jobject thiz) {
+    EngineRef engine;
+    if (engine.valid()) {
+        engine->post(COMMAND_STOP_MIXER);
+    }
+}
+
+// The mixer source calls go straight to the mixer rather than through the
+// control thread, since they return the source id; the mixer has to be
+// running (getState() 6). addMixerFile opens and prefetches the file, so
+// call it off the UI thread. Each returns the source id, -1 on failure.
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_addMixerFile(JNIEnv *env, jobject thiz, jstring path,
+                                                             jfloat gain, jfloat pan, jint delayMs) {
+    EngineRef engine;
+    if (!engine.valid()) {
+        return -1;
+    }
+    const char *pathPtr = env->GetStringUTFChars(path, nullptr);
+    int id;
+    {
+        std::lock_guard<std::mutex> lock(engineMutex);
+        id = engine->mixer().addFile(pathPtr, FILE_SAMPLE_RATE, gain, pan, delayFrames(engine, delayMs));
+        if (id >= 0) {
+            // the slot may have held a finished buffer source
+            setMixerBuffer(env, id, NULL);
+        }
+    }
+    env->ReleaseStringUTFChars(path, pathPtr);
+    return id;
+}
+
+// buffer: a direct ByteBuffer of 16-bit PCM at the engine's sample rate,
+// one or two channels; it's kept alive until the source is removed
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_addMixerBuffer(JNIEnv *env, jobject thiz, jobject buffer,
+                                                               jint channels, jfloat gain, jfloat pan,
+                                                               jint delayMs) {
+    EngineRef engine;
+    void *memory = env->GetDirectBufferAddress(buffer);
+    jlong bytes = env->GetDirectBufferCapacity(buffer);
+    if (!engine.valid() || memory == NULL || bytes <= 0 || channels < 1 || channels > 2) {
+        return -1;
+    }
+    size_t frames = static_cast<size_t>(bytes) / (channels * sizeof(short));
+    std::lock_guard<std::mutex> lock(engineMutex);
+    int id = engine->mixer().addMemory(static_cast<const short *>(memory), frames, channels,
+                                       gain, pan, delayFrames(engine, delayMs));
+    if (id >= 0) {
+        setMixerBuffer(env, id, buffer);
+    }
+    return id;
+}
+
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_addMixerMic(JNIEnv *env, jobject thiz, jfloat gain,
+                                                            jfloat pan, jint delayMs) {
+    EngineRef engine;
+    if (!engine.valid()) {
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(engineMutex);
+    int id = engine->mixer().addMic(gain, pan, delayFrames(engine, delayMs));
+    if (id >= 0) {
+        setMixerBuffer(env, id, NULL);
+    }
+    return id;
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_removeMixerSource(JNIEnv *env, jobject thiz, jint id) {
+    EngineRef engine;
+    std::lock_guard<std::mutex> lock(engineMutex);
+    bool removed = engine.valid() && engine->mixer().remove(id);
+    if (removed) {
+        setMixerBuffer(env, id, NULL);
+    }
+    return removed ? JNI_TRUE : JNI_FALSE;
+}
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setMixerGain(JNIEnv *env, jobject thiz, jint id, jfloat gain) {
+    EngineRef engine;
+    if (engine.valid()) {
+        engine->mixer().setGain(id, gain);
+    }
+}
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setMixerPan(JNIEnv *env, jobject thiz, jint id, jfloat pan) {
+    EngineRef engine;
+    if (engine.valid()) {
+        engine->mixer().setPan(id, pan);
+    }
+}
+
+JNIEXPORT jboolean JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_isMixerSourceFinished(JNIEnv *env, jobject thiz, jint id) {
+    EngineRef engine;
+    return engine.valid() && engine->mixer().finished(id) ? JNI_TRUE : JNI_FALSE;
+}
+
+// bytes of the direct ByteBuffer startAnalysis needs for fftSize, a power of
+// two from 64 to 16384; 0 for any other size
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_analysisBufferBytes(JNIEnv *env, jobject thiz, jint fftSize) {
+    return fftSize > 0 ? static_cast<jint>(SpectrumAnalyzer::bytesFor(static_cast<unsigned>(fftSize))) : 0;
+}
+
+// tap 0 analyses what's recorded, 1 what's played. The analyzer publishes
+// peak, RMS and fftSize / 2 + 1 spectrum bins into buffer at display rate,
+// laid out and read as SpectrumAnalyzer.h describes, until stopAnalysis.
+// Returns the number of bins, -1 on failure.
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_startAnalysis(JNIEnv *env, jobject thiz, jint tap, jobject buffer,
+                                                              jint fftSize) {
+    EngineRef engine;
+    if (!engine.valid() || tap < 0 || tap >= TAP_COUNT || fftSize <= 0) {
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(engineMutex);
+    stopAnalysis(env, engine.get(), tap);
+    void *memory = env->GetDirectBufferAddress(buffer);
+    jlong bytes = env->GetDirectBufferCapacity(buffer);
+    if (memory == nullptr || bytes <= 0
+        || !engine->startAnalysis(static_cast<AnalysisTap>(tap), memory, static_cast<size_t>(bytes),
+                                  static_cast<unsigned>(fftSize))) {
+        return -1;
+    }
+    analysisBuffers[tap] = env->NewGlobalRef(buffer);
+    return static_cast<jint>(engine->analyzer(static_cast<AnalysisTap>(tap)).bins());
+}
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_stopAnalysis(JNIEnv *env, jobject thiz, jint tap) {
+    EngineRef engine;
+    if (engine.valid() && tap >= 0 && tap < TAP_COUNT) {
+        std::lock_guard<std::mutex> lock(engineMutex);
+        stopAnalysis(env, engine.get(), tap);
+    }
+}
+
+// runs inputs[i] into outputs[i] through the recording chain without the
+// device, on every core, and blocks until all are done, so not from the UI
+// thread. sampleRate 0 keeps each input's; raw inputs are read as 44.1 kHz
+// mono. Returns {files done, files failed, seconds of audio, seconds taken,
+// times real time}.
+JNIEXPORT jfloatArray JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_processOffline(JNIEnv *env, jobject thiz, jobjectArray inputs,
+                                                               jobjectArray outputs, jint sampleRate,
+                                                               jfloat gain, jboolean trimSilence,
+                                                               jboolean suppressFeedback) {
+    jsize count = env->GetArrayLength(inputs);
+    if (env->GetArrayLength(outputs) != count) {
+        return nullptr;
+    }
+    std::vector<std::string> inputPaths, outputPaths;
+    for (jsize i = 0; i < count; i++) {
+        jstring path = static_cast<jstring>(env->GetObjectArrayElement(inputs, i));
+        const char *pathPtr = env->GetStringUTFChars(path, nullptr);
+        inputPaths.push_back(pathPtr);
+        env->ReleaseStringUTFChars(path, pathPtr);
+        env->DeleteLocalRef(path);
+        path = static_cast<jstring>(env->GetObjectArrayElement(outputs, i));
+        pathPtr = env->GetStringUTFChars(path, nullptr);
+        outputPaths.push_back(pathPtr);
+        env->ReleaseStringUTFChars(path, pathPtr);
+        env->DeleteLocalRef(path);
+    }
+
+    OfflineConfig config;
+    config.sampleRate = sampleRate > 0 ? sampleRate : 0;
+    config.gain = gain;
+    config.vad.enabled = trimSilence == JNI_TRUE;
+    config.suppressFeedback = suppressFeedback == JNI_TRUE;
+    OfflineEngine engine(config);
+    OfflineReport report;
+    engine.run(inputPaths, outputPaths, &report, NULL);
+    jfloat values[5] = {static_cast<jfloat>(report.files - report.failed),
+                        static_cast<jfloat>(report.failed),
+                        static_cast<jfloat>(report.audioSeconds),
+                        static_cast<jfloat>(report.wallSeconds),
+                        static_cast<jfloat>(report.realtimeFactor)};
+    jfloatArray array = env->NewFloatArray(5);
+    if (array != nullptr) {
+        env->SetFloatArrayRegion(array, 0, 5, values);
+    }
+    return array;
+}
+
+void Java_com_darrenyuan_nativefeedback_OpenSLEngine_shutDown(JNIEnv *env, jobject thiz) {
+    // no call gets the engine from here on, and the ones using it finish
+    AudioEngine *engine;
+    {
+        std::unique_lock<std::mutex> lock(engineMutex);
+        engineShutDown = true;
+        engineReleased.wait(lock, [] { return engineUsers == 0; });
+        engine = audioEngine;
+        audioEngine = NULL;
+    }
+    // the live recorder runs on the engine's backend, so it goes first;
+    // then the recorder, player, output mix and engine objects
+    releaseLiveCapture(env);
+    delete engine;
+    // the mixer let go of its memory sources with the engine, and the
+    // analyzers stopped with it
+    std::lock_guard<std::mutex> lock(engineMutex);
+    releaseMixerBuffers(env);
+    for (int tap = 0; tap < TAP_COUNT; tap++) {
+        stopAnalysis(env, NULL, tap);
+    }
 }
 
 #ifdef __cplusplus
 }
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,908 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "PcmConvert.h"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define PCM_HAVE_NEON 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PCM_HAVE_SSE 1
+// SSSE3 for the byte shuffles of the int24 kernels, checked at run time
+#define PCM_SSE_TARGET __attribute__((target("ssse3")))
+#endif
+
+static const float S16_SCALE = 1.0f / 32768;
+static const float S24_SCALE = 1.0f / 8388608;
+static const float S32_SCALE = 1.0f / 2147483648.0f;
+// largest float below 2^31, so the conversion can't overflow
+static const float S32_MAX = 2147483520.0f;
+// dither LSBs from the top 24 bits of each random number
+static const float DITHER_SCALE = 1.0f / 16777216;
+
+// ---- scalar reference ------------------------------------------------------
+
+static inline long roundClip(float v, float lo, float hi) {
+    return lrintf(v < lo ? lo : (v > hi ? hi : v));
+}
+
+static inline unsigned xorshift(unsigned x) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+static void s16ToFloatScalar(const short *src, float *dst, size_t samples) {
+    for (size_t i = 0; i < samples; i++) {
+        dst[i] = src[i] * S16_SCALE;
+    }
+}
+
+static void floatToS16Scalar(const float *src, short *dst, size_t samples) {
+    for (size_t i = 0; i < samples; i++) {
+        dst[i] = static_cast<short>(roundClip(src[i] * 32768.0f, -32768.0f, 32767.0f));
+    }
+}
+
+// sample i always takes its dither from lane i % 4, as the SIMD variants do
+static void floatToS16DitherScalar(const float *src, short *dst, size_t samples,
+                                   PcmDither *dither) {
+    for (size_t i = 0; i < samples; i++) {
+        unsigned *state = &dither->state[i & 3];
+        unsigned a = xorshift(*state);
+        unsigned b = xorshift(a);
+        *state = b;
+        float d = static_cast<float>(static_cast<int>(a >> 8) - static_cast<int>(b >> 8))
+                  * DITHER_SCALE;
+        float v = src[i] * 32768.0f + d;
+        dst[i] = static_cast<short>(roundClip(v, -32768.0f, 32767.0f));
+    }
+}
+
+static void s24ToFloatScalar(const unsigned char *src, float *dst, size_t samples) {
+    for (size_t i = 0; i < samples; i++) {
+        const unsigned char *p = src + i * 3;
+        int v = static_cast<int>((p[0] << 8) | (p[1] << 16) | (static_cast<unsigned>(p[2]) << 24)) >> 8;
+        dst[i] = v * S24_SCALE;
+    }
+}
+
+static void floatToS24Scalar(const float *src, unsigned char *dst, size_t samples) {
+    for (size_t i = 0; i < samples; i++) {
+        long v = roundClip(src[i] * 8388608.0f, -8388608.0f, 8388607.0f);
+        dst[i * 3] = static_cast<unsigned char>(v);
+        dst[i * 3 + 1] = static_cast<unsigned char>(v >> 8);
+        dst[i * 3 + 2] = static_cast<unsigned char>(v >> 16);
+    }
+}
+
+static void s32ToFloatScalar(const int *src, float *dst, size_t samples) {
+    for (size_t i = 0; i < samples; i++) {
+        dst[i] = static_cast<float>(src[i]) * S32_SCALE;
+    }
+}
+
+static void floatToS32Scalar(const float *src, int *dst, size_t samples) {
+    for (size_t i = 0; i < samples; i++) {
+        dst[i] = static_cast<int>(roundClip(src[i] * 2147483648.0f, -2147483648.0f, S32_MAX));
+    }
+}
+
+static void monoToStereoScalar(const short *src, short *dst, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        dst[i * 2] = src[i];
+        dst[i * 2 + 1] = src[i];
+    }
+}
+
+static void stereoToMonoScalar(const short *src, short *dst, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        dst[i] = static_cast<short>((src[i * 2] + src[i * 2 + 1]) >> 1);
+    }
+}
+
+static void interleaveScalar(const float *left, const float *right, float *dst, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        dst[i * 2] = left[i];
+        dst[i * 2 + 1] = right[i];
+    }
+}
+
+static void deinterleaveScalar(const float *src, float *left, float *right, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        left[i] = src[i * 2];
+        right[i] = src[i * 2 + 1];
+    }
+}
+
+static void applyGainScalar(short *samples, size_t frames, int channels, const float *gains) {
+    for (size_t i = 0; i < frames; i++) {
+        for (int c = 0; c < channels; c++) {
+            short *s = &samples[i * channels + c];
+            *s = static_cast<short>(roundClip(*s * gains[c], -32768.0f, 32767.0f));
+        }
+    }
+}
+
+static void mixToStereoScalar(const short *src, int srcChannels, float *bus, size_t frames,
+                              const float *gains, const float *steps) {
+    for (size_t i = 0; i < frames; i++) {
+        float t = static_cast<float>(i);
+        float left = src[i * srcChannels] * S16_SCALE;
+        float right = src[i * srcChannels + srcChannels - 1] * S16_SCALE;
+        bus[2 * i] += left * (gains[0] + t * steps[0]);
+        bus[2 * i + 1] += right * (gains[1] + t * steps[1]);
+    }
+}
+
+// the rest of a mixToStereo call from frame done on
+static void mixToStereoTail(const short *src, int srcChannels, float *bus, size_t frames,
+                            size_t done, const float *gains, const float *steps) {
+    float start[2] = {gains[0] + done * steps[0], gains[1] + done * steps[1]};
+    mixToStereoScalar(src + done * srcChannels, srcChannels, bus + 2 * done, frames - done,
+                      start, steps);
+}
+
+static void fftStageScalar(float *re, float *im, size_t size, unsigned half, const float *wr,
+                           const float *wi, float direction) {
+    for (size_t start = 0; start < size; start += 2 * half) {
+        for (unsigned k = 0; k < half; k++) {
+            float c = wr[k];
+            float s = direction * wi[k];
+            size_t a = start + k;
+            size_t b = a + half;
+            float tr = re[b] * c - im[b] * s;
+            float ti = re[b] * s + im[b] * c;
+            re[b] = re[a] - tr;
+            im[b] = im[a] - ti;
+            re[a] += tr;
+            im[a] += ti;
+        }
+    }
+}
+
+static void biquadCascadeScalar(float *samples, size_t frames, const float *coefs,
+                                float *state) {
+    const int n = PCM_BIQUAD_STAGES;
+    const float *b0 = coefs, *b1 = coefs + n, *b2 = coefs + 2 * n;
+    const float *a1 = coefs + 3 * n, *a2 = coefs + 4 * n;
+    float *s1 = state, *s2 = state + n;
+    for (size_t i = 0; i < frames; i++) {
+        float x = samples[i];
+        for (int s = 0; s < n; s++) {
+            float y = b0[s] * x + s1[s];
+            s1[s] = b1[s] * x - a1[s] * y + s2[s];
+            s2[s] = b2[s] * x - a2[s] * y;
+            x = y;
+        }
+        samples[i] = x;
+    }
+}
+
+static void crossCorrelateScalar(const float *ref, const float *x, size_t length, size_t lags,
+                                 float *scores) {
+    for (size_t d = 0; d < lags; d++) {
+        float sum = 0;
+        for (size_t i = 0; i < length; i++) {
+            sum += ref[i] * x[d + i];
+        }
+        scores[d] = sum;
+    }
+}
+
+// ---- SSE -------------------------------------------------------------------
+
+#ifdef PCM_HAVE_SSE
+PCM_SSE_TARGET
+static inline __m128i xorshiftSse(__m128i x) {
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    return _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+}
+
+PCM_SSE_TARGET
+static inline __m128i roundClipSse(__m128 v, __m128 lo, __m128 hi) {
+    return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(v, lo), hi));
+}
+
+PCM_SSE_TARGET
+static void s16ToFloatSse(const short *src, float *dst, size_t samples) {
+    const __m128 scale = _mm_set1_ps(S16_SCALE);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(dst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    s16ToFloatScalar(src + i, dst + i, samples - i);
+}
+
+PCM_SSE_TARGET
+static void floatToS16Sse(const float *src, short *dst, size_t samples) {
+    const __m128 k = _mm_set1_ps(32768.0f);
+    const __m128 lo = _mm_set1_ps(-32768.0f);
+    const __m128 hi = _mm_set1_ps(32767.0f);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        __m128i a = roundClipSse(_mm_mul_ps(_mm_loadu_ps(src + i), k), lo, hi);
+        __m128i b = roundClipSse(_mm_mul_ps(_mm_loadu_ps(src + i + 4), k), lo, hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(a, b));
+    }
+    floatToS16Scalar(src + i, dst + i, samples - i);
+}
+
+PCM_SSE_TARGET
+static void floatToS16DitherSse(const float *src, short *dst, size_t samples, PcmDither *dither) {
+    const __m128 k = _mm_set1_ps(32768.0f);
+    const __m128 lo = _mm_set1_ps(-32768.0f);
+    const __m128 hi = _mm_set1_ps(32767.0f);
+    const __m128 scale = _mm_set1_ps(DITHER_SCALE);
+    __m128i state = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dither->state));
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        __m128i a = xorshiftSse(state);
+        __m128i b = xorshiftSse(a);
+        state = b;
+        __m128i diff = _mm_sub_epi32(_mm_srli_epi32(a, 8), _mm_srli_epi32(b, 8));
+        __m128 d = _mm_mul_ps(_mm_cvtepi32_ps(diff), scale);
+        __m128 v = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src + i), k), d);
+        __m128i r = roundClipSse(v, lo, hi);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(r, r));
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dither->state), state);
+    floatToS16DitherScalar(src + i, dst + i, samples - i, dither);
+}
+
+PCM_SSE_TARGET
+static void s24ToFloatSse(const unsigned char *src, float *dst, size_t samples) {
+    // each sample's three bytes to the top of a 32-bit lane, then an
+    // arithmetic shift sign-extends it
+    const __m128i shuffle = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m128 scale = _mm_set1_ps(S24_SCALE);
+    size_t i = 0;
+    // the 16-byte load reads past the 12 it uses, so stop while that's in range
+    for (; i + 6 <= samples; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 3));
+        v = _mm_srai_epi32(_mm_shuffle_epi8(v, shuffle), 8);
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+    s24ToFloatScalar(src + i * 3, dst + i, samples - i);
+}
+
+PCM_SSE_TARGET
+static void floatToS24Sse(const float *src, unsigned char *dst, size_t samples) {
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m128 k = _mm_set1_ps(8388608.0f);
+    const __m128 lo = _mm_set1_ps(-8388608.0f);
+    const __m128 hi = _mm_set1_ps(8388607.0f);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        __m128i v = roundClipSse(_mm_mul_ps(_mm_loadu_ps(src + i), k), lo, hi);
+        __m128i packed = _mm_shuffle_epi8(v, shuffle);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + i * 3), packed);
+        int last = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+        memcpy(dst + i * 3 + 8, &last, 4);
+    }
+    floatToS24Scalar(src + i, dst + i * 3, samples - i);
+}
+
+PCM_SSE_TARGET
+static void s32ToFloatSse(const int *src, float *dst, size_t samples) {
+    const __m128 scale = _mm_set1_ps(S32_SCALE);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+    }
+    s32ToFloatScalar(src + i, dst + i, samples - i);
+}
+
+PCM_SSE_TARGET
+static void floatToS32Sse(const float *src, int *dst, size_t samples) {
+    const __m128 k = _mm_set1_ps(2147483648.0f);
+    const __m128 lo = _mm_set1_ps(-2147483648.0f);
+    const __m128 hi = _mm_set1_ps(S32_MAX);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        __m128i v = roundClipSse(_mm_mul_ps(_mm_loadu_ps(src + i), k), lo, hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), v);
+    }
+    floatToS32Scalar(src + i, dst + i, samples - i);
+}
+
+PCM_SSE_TARGET
+static void monoToStereoSse(const short *src, short *dst, size_t frames) {
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 2), _mm_unpacklo_epi16(v, v));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 2 + 8), _mm_unpackhi_epi16(v, v));
+    }
+    monoToStereoScalar(src + i, dst + i * 2, frames - i);
+}
+
+PCM_SSE_TARGET
+static void stereoToMonoSse(const short *src, short *dst, size_t frames) {
+    // madd against ones sums each left/right pair into 32 bits
+    const __m128i ones = _mm_set1_epi16(1);
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 2 + 8));
+        a = _mm_srai_epi32(_mm_madd_epi16(a, ones), 1);
+        b = _mm_srai_epi32(_mm_madd_epi16(b, ones), 1);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm_packs_epi32(a, b));
+    }
+    stereoToMonoScalar(src + i * 2, dst + i, frames - i);
+}
+
+PCM_SSE_TARGET
+static void interleaveSse(const float *left, const float *right, float *dst, size_t frames) {
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128 l = _mm_loadu_ps(left + i);
+        __m128 r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(dst + i * 2, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(dst + i * 2 + 4, _mm_unpackhi_ps(l, r));
+    }
+    interleaveScalar(left + i, right + i, dst + i * 2, frames - i);
+}
+
+PCM_SSE_TARGET
+static void deinterleaveSse(const float *src, float *left, float *right, size_t frames) {
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128 a = _mm_loadu_ps(src + i * 2);
+        __m128 b = _mm_loadu_ps(src + i * 2 + 4);
+        _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+    deinterleaveScalar(src + i * 2, left + i, right + i, frames - i);
+}
+
+PCM_SSE_TARGET
+static void applyGainSse(short *samples, size_t frames, int channels, const float *gains) {
+    if (channels > 2) {
+        applyGainScalar(samples, frames, channels, gains);
+        return;
+    }
+    // four lanes cover whole frames of one or two channels
+    const __m128 g = channels == 1 ? _mm_set1_ps(gains[0])
+                                   : _mm_setr_ps(gains[0], gains[1], gains[0], gains[1]);
+    const __m128 lo = _mm_set1_ps(-32768.0f);
+    const __m128 hi = _mm_set1_ps(32767.0f);
+    size_t total = frames * channels;
+    size_t i = 0;
+    for (; i + 8 <= total; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + i));
+        __m128 a = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+        __m128 b = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+        __m128i ra = roundClipSse(_mm_mul_ps(a, g), lo, hi);
+        __m128i rb = roundClipSse(_mm_mul_ps(b, g), lo, hi);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(samples + i), _mm_packs_epi32(ra, rb));
+    }
+    applyGainScalar(samples + i, (total - i) / channels, channels, gains);
+}
+
+PCM_SSE_TARGET
+static void mixToStereoSse(const short *src, int srcChannels, float *bus, size_t frames,
+                           const float *gains, const float *steps) {
+    // two frames of the bus per vector: L R L R, at frames i and i + 1
+    const __m128 gain = _mm_setr_ps(gains[0], gains[1], gains[0], gains[1]);
+    const __m128 step = _mm_setr_ps(steps[0], steps[1], steps[0], steps[1]);
+    const __m128i lane = _mm_setr_epi32(0, 0, 1, 1);
+    const __m128 scale = _mm_set1_ps(S16_SCALE);
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128i v;
+        if (srcChannels == 1) {
+            v = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(src + i));
+            v = _mm_unpacklo_epi16(v, v);
+        } else {
+            v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * i));
+        }
+        __m128 a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)), scale);
+        __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)), scale);
+        __m128i at = _mm_add_epi32(_mm_set1_epi32(static_cast<int>(i)), lane);
+        __m128i bt = _mm_add_epi32(at, _mm_set1_epi32(2));
+        __m128 ga = _mm_add_ps(gain, _mm_mul_ps(_mm_cvtepi32_ps(at), step));
+        __m128 gb = _mm_add_ps(gain, _mm_mul_ps(_mm_cvtepi32_ps(bt), step));
+        _mm_storeu_ps(bus + 2 * i, _mm_add_ps(_mm_loadu_ps(bus + 2 * i), _mm_mul_ps(a, ga)));
+        _mm_storeu_ps(bus + 2 * i + 4,
+                      _mm_add_ps(_mm_loadu_ps(bus + 2 * i + 4), _mm_mul_ps(b, gb)));
+    }
+    mixToStereoTail(src, srcChannels, bus, frames, i, gains, steps);
+}
+
+PCM_SSE_TARGET
+static void fftStageSse(float *re, float *im, size_t size, unsigned half, const float *wr,
+                        const float *wi, float direction) {
+    if (half < 4) {
+        fftStageScalar(re, im, size, half, wr, wi, direction);
+        return;
+    }
+    const __m128 dir = _mm_set1_ps(direction);
+    for (size_t start = 0; start < size; start += 2 * half) {
+        float *ar = re + start, *ai = im + start;
+        float *br = ar + half, *bi = ai + half;
+        for (unsigned k = 0; k < half; k += 4) {
+            __m128 c = _mm_loadu_ps(wr + k);
+            __m128 s = _mm_mul_ps(_mm_loadu_ps(wi + k), dir);
+            __m128 xr = _mm_loadu_ps(br + k);
+            __m128 xi = _mm_loadu_ps(bi + k);
+            __m128 tr = _mm_sub_ps(_mm_mul_ps(xr, c), _mm_mul_ps(xi, s));
+            __m128 ti = _mm_add_ps(_mm_mul_ps(xr, s), _mm_mul_ps(xi, c));
+            __m128 yr = _mm_loadu_ps(ar + k);
+            __m128 yi = _mm_loadu_ps(ai + k);
+            _mm_storeu_ps(br + k, _mm_sub_ps(yr, tr));
+            _mm_storeu_ps(bi + k, _mm_sub_ps(yi, ti));
+            _mm_storeu_ps(ar + k, _mm_add_ps(yr, tr));
+            _mm_storeu_ps(ai + k, _mm_add_ps(yi, ti));
+        }
+    }
+}
+
+PCM_SSE_TARGET
+static inline __m128 selectSse(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+PCM_SSE_TARGET
+static void biquadCascadeSse(float *samples, size_t frames, const float *coefs, float *state) {
+    // stages 0-3 in the low vector, 4-7 in the high one; each stage takes
+    // what the stage before it produced on the previous step
+    const int n = PCM_BIQUAD_STAGES;
+    const size_t lag = n - 1;
+    const __m128 b0l = _mm_loadu_ps(coefs), b0h = _mm_loadu_ps(coefs + 4);
+    const __m128 b1l = _mm_loadu_ps(coefs + n), b1h = _mm_loadu_ps(coefs + n + 4);
+    const __m128 b2l = _mm_loadu_ps(coefs + 2 * n), b2h = _mm_loadu_ps(coefs + 2 * n + 4);
+    const __m128 a1l = _mm_loadu_ps(coefs + 3 * n), a1h = _mm_loadu_ps(coefs + 3 * n + 4);
+    const __m128 a2l = _mm_loadu_ps(coefs + 4 * n), a2h = _mm_loadu_ps(coefs + 4 * n + 4);
+    const __m128i stageL = _mm_setr_epi32(0, 1, 2, 3), stageH = _mm_setr_epi32(4, 5, 6, 7);
+    __m128 s1l = _mm_loadu_ps(state), s1h = _mm_loadu_ps(state + 4);
+    __m128 s2l = _mm_loadu_ps(state + n), s2h = _mm_loadu_ps(state + n + 4);
+    __m128 yl = _mm_setzero_ps(), yh = _mm_setzero_ps();
+    for (size_t t = 0; t < frames + lag; t++) {
+        __m128 x = _mm_set_ss(t < frames ? samples[t] : 0.0f);
+        __m128 xl = _mm_move_ss(_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(yl), 4)), x);
+        __m128 xh = _mm_move_ss(_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(yh), 4)),
+                                _mm_shuffle_ps(yl, yl, _MM_SHUFFLE(3, 3, 3, 3)));
+        yl = _mm_add_ps(_mm_mul_ps(b0l, xl), s1l);
+        yh = _mm_add_ps(_mm_mul_ps(b0h, xh), s1h);
+        __m128 n1l = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1l, xl), _mm_mul_ps(a1l, yl)), s2l);
+        __m128 n1h = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1h, xh), _mm_mul_ps(a1h, yh)), s2h);
+        __m128 n2l = _mm_sub_ps(_mm_mul_ps(b2l, xl), _mm_mul_ps(a2l, yl));
+        __m128 n2h = _mm_sub_ps(_mm_mul_ps(b2h, xh), _mm_mul_ps(a2h, yh));
+        if (t >= lag && t < frames) {
+            s1l = n1l;
+            s1h = n1h;
+            s2l = n2l;
+            s2h = n2h;
+        } else {
+            // filling or draining: stage s has a sample when t - frames < s <= t
+            __m128i next = _mm_set1_epi32(static_cast<int>(t + 1));
+            __m128i first = _mm_set1_epi32(static_cast<int>(t) - static_cast<int>(frames));
+            __m128 ml = _mm_castsi128_ps(_mm_and_si128(_mm_cmpgt_epi32(next, stageL),
+                                                       _mm_cmpgt_epi32(stageL, first)));
+            __m128 mh = _mm_castsi128_ps(_mm_and_si128(_mm_cmpgt_epi32(next, stageH),
+                                                       _mm_cmpgt_epi32(stageH, first)));
+            s1l = selectSse(ml, n1l, s1l);
+            s1h = selectSse(mh, n1h, s1h);
+            s2l = selectSse(ml, n2l, s2l);
+            s2h = selectSse(mh, n2h, s2h);
+        }
+        if (t >= lag) {
+            samples[t - lag] = _mm_cvtss_f32(_mm_shuffle_ps(yh, yh, _MM_SHUFFLE(3, 3, 3, 3)));
+        }
+    }
+    _mm_storeu_ps(state, s1l);
+    _mm_storeu_ps(state + 4, s1h);
+    _mm_storeu_ps(state + n, s2l);
+    _mm_storeu_ps(state + n + 4, s2h);
+}
+
+PCM_SSE_TARGET
+static void crossCorrelateSse(const float *ref, const float *x, size_t length, size_t lags,
+                              float *scores) {
+    size_t d = 0;
+    for (; d + 16 <= lags; d += 16) {
+        __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+        __m128 s2 = _mm_setzero_ps(), s3 = _mm_setzero_ps();
+        const float *p = x + d;
+        for (size_t i = 0; i < length; i++) {
+            __m128 r = _mm_set1_ps(ref[i]);
+            s0 = _mm_add_ps(s0, _mm_mul_ps(r, _mm_loadu_ps(p + i)));
+            s1 = _mm_add_ps(s1, _mm_mul_ps(r, _mm_loadu_ps(p + i + 4)));
+            s2 = _mm_add_ps(s2, _mm_mul_ps(r, _mm_loadu_ps(p + i + 8)));
+            s3 = _mm_add_ps(s3, _mm_mul_ps(r, _mm_loadu_ps(p + i + 12)));
+        }
+        _mm_storeu_ps(scores + d, s0);
+        _mm_storeu_ps(scores + d + 4, s1);
+        _mm_storeu_ps(scores + d + 8, s2);
+        _mm_storeu_ps(scores + d + 12, s3);
+    }
+    crossCorrelateScalar(ref, x + d, length, lags - d, scores + d);
+}
+#endif
+
+// ---- NEON ------------------------------------------------------------------
+
+#ifdef PCM_HAVE_NEON
+static inline uint32x4_t xorshiftNeon(uint32x4_t x) {
+    x = veorq_u32(x, vshlq_n_u32(x, 13));
+    x = veorq_u32(x, vshrq_n_u32(x, 17));
+    return veorq_u32(x, vshlq_n_u32(x, 5));
+}
+
+static inline int32x4_t roundClipNeon(float32x4_t v, float lo, float hi) {
+    v = vminq_f32(vmaxq_f32(v, vdupq_n_f32(lo)), vdupq_n_f32(hi));
+#if defined(__aarch64__)
+    return vcvtnq_s32_f32(v);
+#else
+    // ARMv7 only converts toward zero: round half away from zero instead,
+    // which differs from the reference on exact ties only
+    uint32x4_t sign = vandq_u32(vreinterpretq_u32_f32(v), vdupq_n_u32(0x80000000u));
+    float32x4_t half = vreinterpretq_f32_u32(
+            vorrq_u32(vreinterpretq_u32_f32(vdupq_n_f32(0.5f)), sign));
+    return vcvtq_s32_f32(vaddq_f32(v, half));
+#endif
+}
+
+static inline float32x4_t widenS16(int16x4_t v) {
+    return vcvtq_f32_s32(vmovl_s16(v));
+}
+
+static void s16ToFloatNeon(const short *src, float *dst, size_t samples) {
+    const float32x4_t scale = vdupq_n_f32(S16_SCALE);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        int16x8_t v = vld1q_s16(src + i);
+        vst1q_f32(dst + i, vmulq_f32(widenS16(vget_low_s16(v)), scale));
+        vst1q_f32(dst + i + 4, vmulq_f32(widenS16(vget_high_s16(v)), scale));
+    }
+    s16ToFloatScalar(src + i, dst + i, samples - i);
+}
+
+static void floatToS16Neon(const float *src, short *dst, size_t samples) {
+    const float32x4_t k = vdupq_n_f32(32768.0f);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        int32x4_t a = roundClipNeon(vmulq_f32(vld1q_f32(src + i), k), -32768.0f, 32767.0f);
+        int32x4_t b = roundClipNeon(vmulq_f32(vld1q_f32(src + i + 4), k), -32768.0f, 32767.0f);
+        vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+    }
+    floatToS16Scalar(src + i, dst + i, samples - i);
+}
+
+static void floatToS16DitherNeon(const float *src, short *dst, size_t samples, PcmDither *dither) {
+    const float32x4_t k = vdupq_n_f32(32768.0f);
+    const float32x4_t scale = vdupq_n_f32(DITHER_SCALE);
+    uint32x4_t state = vld1q_u32(dither->state);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        uint32x4_t a = xorshiftNeon(state);
+        uint32x4_t b = xorshiftNeon(a);
+        state = b;
+        int32x4_t diff = vsubq_s32(vreinterpretq_s32_u32(vshrq_n_u32(a, 8)),
+                                   vreinterpretq_s32_u32(vshrq_n_u32(b, 8)));
+        float32x4_t d = vmulq_f32(vcvtq_f32_s32(diff), scale);
+        float32x4_t v = vaddq_f32(vmulq_f32(vld1q_f32(src + i), k), d);
+        vst1_s16(dst + i, vqmovn_s32(roundClipNeon(v, -32768.0f, 32767.0f)));
+    }
+    vst1q_u32(dither->state, state);
+    floatToS16DitherScalar(src + i, dst + i, samples - i, dither);
+}
+
+static void s24ToFloatNeon(const unsigned char *src, float *dst, size_t samples) {
+    const float32x4_t scale = vdupq_n_f32(S24_SCALE);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        // vld3 splits low, middle and high bytes of eight samples
+        uint8x8x3_t bytes = vld3_u8(src + i * 3);
+        uint16x8_t low = vorrq_u16(vmovl_u8(bytes.val[0]), vshll_n_u8(bytes.val[1], 8));
+        int16x8_t high = vmovl_s8(vreinterpret_s8_u8(bytes.val[2]));
+        int32x4_t a = vorrq_s32(vshlq_n_s32(vmovl_s16(vget_low_s16(high)), 16),
+                                vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(low))));
+        int32x4_t b = vorrq_s32(vshlq_n_s32(vmovl_s16(vget_high_s16(high)), 16),
+                                vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(low))));
+        vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(a), scale));
+        vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_s32(b), scale));
+    }
+    s24ToFloatScalar(src + i * 3, dst + i, samples - i);
+}
+
+static inline uint8x8_t byteOf(uint32x4_t a, uint32x4_t b) {
+    return vmovn_u16(vcombine_u16(vmovn_u32(a), vmovn_u32(b)));
+}
+
+static void floatToS24Neon(const float *src, unsigned char *dst, size_t samples) {
+    const float32x4_t k = vdupq_n_f32(8388608.0f);
+    size_t i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        uint32x4_t a = vreinterpretq_u32_s32(
+                roundClipNeon(vmulq_f32(vld1q_f32(src + i), k), -8388608.0f, 8388607.0f));
+        uint32x4_t b = vreinterpretq_u32_s32(
+                roundClipNeon(vmulq_f32(vld1q_f32(src + i + 4), k), -8388608.0f, 8388607.0f));
+        uint8x8x3_t bytes;
+        bytes.val[0] = byteOf(a, b);
+        bytes.val[1] = byteOf(vshrq_n_u32(a, 8), vshrq_n_u32(b, 8));
+        bytes.val[2] = byteOf(vshrq_n_u32(a, 16), vshrq_n_u32(b, 16));
+        vst3_u8(dst + i * 3, bytes);
+    }
+    floatToS24Scalar(src + i, dst + i * 3, samples - i);
+}
+
+static void s32ToFloatNeon(const int *src, float *dst, size_t samples) {
+    const float32x4_t scale = vdupq_n_f32(S32_SCALE);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_s32(vld1q_s32(src + i)), scale));
+    }
+    s32ToFloatScalar(src + i, dst + i, samples - i);
+}
+
+static void floatToS32Neon(const float *src, int *dst, size_t samples) {
+    const float32x4_t k = vdupq_n_f32(2147483648.0f);
+    size_t i = 0;
+    for (; i + 4 <= samples; i += 4) {
+        vst1q_s32(dst + i,
+                  roundClipNeon(vmulq_f32(vld1q_f32(src + i), k), -2147483648.0f, S32_MAX));
+    }
+    floatToS32Scalar(src + i, dst + i, samples - i);
+}
+
+static void monoToStereoNeon(const short *src, short *dst, size_t frames) {
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t pair;
+        pair.val[0] = vld1q_s16(src + i);
+        pair.val[1] = pair.val[0];
+        vst2q_s16(dst + i * 2, pair);
+    }
+    monoToStereoScalar(src + i, dst + i * 2, frames - i);
+}
+
+static void stereoToMonoNeon(const short *src, short *dst, size_t frames) {
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        int16x8x2_t pair = vld2q_s16(src + i * 2);
+        vst1q_s16(dst + i, vhaddq_s16(pair.val[0], pair.val[1]));
+    }
+    stereoToMonoScalar(src + i * 2, dst + i, frames - i);
+}
+
+static void interleaveNeon(const float *left, const float *right, float *dst, size_t frames) {
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        float32x4x2_t pair;
+        pair.val[0] = vld1q_f32(left + i);
+        pair.val[1] = vld1q_f32(right + i);
+        vst2q_f32(dst + i * 2, pair);
+    }
+    interleaveScalar(left + i, right + i, dst + i * 2, frames - i);
+}
+
+static void deinterleaveNeon(const float *src, float *left, float *right, size_t frames) {
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        float32x4x2_t pair = vld2q_f32(src + i * 2);
+        vst1q_f32(left + i, pair.val[0]);
+        vst1q_f32(right + i, pair.val[1]);
+    }
+    deinterleaveScalar(src + i * 2, left + i, right + i, frames - i);
+}
+
+static void applyGainNeon(short *samples, size_t frames, int channels, const float *gains) {
+    if (channels > 2) {
+        applyGainScalar(samples, frames, channels, gains);
+        return;
+    }
+    const float pattern[4] = {gains[0], gains[channels - 1], gains[0], gains[channels - 1]};
+    const float32x4_t g = vld1q_f32(pattern);
+    size_t total = frames * channels;
+    size_t i = 0;
+    for (; i + 8 <= total; i += 8) {
+        int16x8_t v = vld1q_s16(samples + i);
+        int32x4_t a = roundClipNeon(vmulq_f32(widenS16(vget_low_s16(v)), g), -32768.0f, 32767.0f);
+        int32x4_t b = roundClipNeon(vmulq_f32(widenS16(vget_high_s16(v)), g), -32768.0f, 32767.0f);
+        vst1q_s16(samples + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+    }
+    applyGainScalar(samples + i, (total - i) / channels, channels, gains);
+}
+
+static void mixToStereoNeon(const short *src, int srcChannels, float *bus, size_t frames,
+                            const float *gains, const float *steps) {
+    // two frames of the bus per vector: L R L R, at frames i and i + 1
+    const float gainPattern[4] = {gains[0], gains[1], gains[0], gains[1]};
+    const float stepPattern[4] = {steps[0], steps[1], steps[0], steps[1]};
+    const int lanePattern[4] = {0, 0, 1, 1};
+    const float32x4_t gain = vld1q_f32(gainPattern);
+    const float32x4_t step = vld1q_f32(stepPattern);
+    const int32x4_t lane = vld1q_s32(lanePattern);
+    const float32x4_t scale = vdupq_n_f32(S16_SCALE);
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        int16x4_t lo, hi;
+        if (srcChannels == 1) {
+            int16x4x2_t pair = vzip_s16(vld1_s16(src + i), vld1_s16(src + i));
+            lo = pair.val[0];
+            hi = pair.val[1];
+        } else {
+            int16x8_t v = vld1q_s16(src + 2 * i);
+            lo = vget_low_s16(v);
+            hi = vget_high_s16(v);
+        }
+        int32x4_t at = vaddq_s32(vdupq_n_s32(static_cast<int>(i)), lane);
+        int32x4_t bt = vaddq_s32(at, vdupq_n_s32(2));
+        float32x4_t ga = vaddq_f32(gain, vmulq_f32(vcvtq_f32_s32(at), step));
+        float32x4_t gb = vaddq_f32(gain, vmulq_f32(vcvtq_f32_s32(bt), step));
+        float32x4_t a = vmulq_f32(vmulq_f32(widenS16(lo), scale), ga);
+        float32x4_t b = vmulq_f32(vmulq_f32(widenS16(hi), scale), gb);
+        vst1q_f32(bus + 2 * i, vaddq_f32(vld1q_f32(bus + 2 * i), a));
+        vst1q_f32(bus + 2 * i + 4, vaddq_f32(vld1q_f32(bus + 2 * i + 4), b));
+    }
+    mixToStereoTail(src, srcChannels, bus, frames, i, gains, steps);
+}
+
+static void fftStageNeon(float *re, float *im, size_t size, unsigned half, const float *wr,
+                         const float *wi, float direction) {
+    if (half < 4) {
+        fftStageScalar(re, im, size, half, wr, wi, direction);
+        return;
+    }
+    for (size_t start = 0; start < size; start += 2 * half) {
+        float *ar = re + start, *ai = im + start;
+        float *br = ar + half, *bi = ai + half;
+        for (unsigned k = 0; k < half; k += 4) {
+            float32x4_t c = vld1q_f32(wr + k);
+            float32x4_t s = vmulq_n_f32(vld1q_f32(wi + k), direction);
+            float32x4_t xr = vld1q_f32(br + k);
+            float32x4_t xi = vld1q_f32(bi + k);
+            float32x4_t tr = vmlsq_f32(vmulq_f32(xr, c), xi, s);
+            float32x4_t ti = vmlaq_f32(vmulq_f32(xr, s), xi, c);
+            float32x4_t yr = vld1q_f32(ar + k);
+            float32x4_t yi = vld1q_f32(ai + k);
+            vst1q_f32(br + k, vsubq_f32(yr, tr));
+            vst1q_f32(bi + k, vsubq_f32(yi, ti));
+            vst1q_f32(ar + k, vaddq_f32(yr, tr));
+            vst1q_f32(ai + k, vaddq_f32(yi, ti));
+        }
+    }
+}
+
+static void biquadCascadeNeon(float *samples, size_t frames, const float *coefs, float *state) {
+    // stages 0-3 in the low vector, 4-7 in the high one; each stage takes
+    // what the stage before it produced on the previous step
+    const int n = PCM_BIQUAD_STAGES;
+    const size_t lag = n - 1;
+    const float32x4_t b0l = vld1q_f32(coefs), b0h = vld1q_f32(coefs + 4);
+    const float32x4_t b1l = vld1q_f32(coefs + n), b1h = vld1q_f32(coefs + n + 4);
+    const float32x4_t b2l = vld1q_f32(coefs + 2 * n), b2h = vld1q_f32(coefs + 2 * n + 4);
+    const float32x4_t a1l = vld1q_f32(coefs + 3 * n), a1h = vld1q_f32(coefs + 3 * n + 4);
+    const float32x4_t a2l = vld1q_f32(coefs + 4 * n), a2h = vld1q_f32(coefs + 4 * n + 4);
+    const int stagePattern[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+    const int32x4_t stageL = vld1q_s32(stagePattern), stageH = vld1q_s32(stagePattern + 4);
+    float32x4_t s1l = vld1q_f32(state), s1h = vld1q_f32(state + 4);
+    float32x4_t s2l = vld1q_f32(state + n), s2h = vld1q_f32(state + n + 4);
+    float32x4_t yl = vdupq_n_f32(0), yh = vdupq_n_f32(0);
+    for (size_t t = 0; t < frames + lag; t++) {
+        float32x4_t xl = vextq_f32(vdupq_n_f32(t < frames ? samples[t] : 0.0f), yl, 3);
+        float32x4_t xh = vextq_f32(yl, yh, 3);
+        yl = vaddq_f32(vmulq_f32(b0l, xl), s1l);
+        yh = vaddq_f32(vmulq_f32(b0h, xh), s1h);
+        float32x4_t n1l = vaddq_f32(vsubq_f32(vmulq_f32(b1l, xl), vmulq_f32(a1l, yl)), s2l);
+        float32x4_t n1h = vaddq_f32(vsubq_f32(vmulq_f32(b1h, xh), vmulq_f32(a1h, yh)), s2h);
+        float32x4_t n2l = vsubq_f32(vmulq_f32(b2l, xl), vmulq_f32(a2l, yl));
+        float32x4_t n2h = vsubq_f32(vmulq_f32(b2h, xh), vmulq_f32(a2h, yh));
+        if (t >= lag && t < frames) {
+            s1l = n1l;
+            s1h = n1h;
+            s2l = n2l;
+            s2h = n2h;
+        } else {
+            // filling or draining: stage s has a sample when t - frames < s <= t
+            int32x4_t last = vdupq_n_s32(static_cast<int>(t));
+            int32x4_t first = vdupq_n_s32(static_cast<int>(t) - static_cast<int>(frames));
+            uint32x4_t ml = vandq_u32(vcleq_s32(stageL, last), vcgtq_s32(stageL, first));
+            uint32x4_t mh = vandq_u32(vcleq_s32(stageH, last), vcgtq_s32(stageH, first));
+            s1l = vbslq_f32(ml, n1l, s1l);
+            s1h = vbslq_f32(mh, n1h, s1h);
+            s2l = vbslq_f32(ml, n2l, s2l);
+            s2h = vbslq_f32(mh, n2h, s2h);
+        }
+        if (t >= lag) {
+            samples[t - lag] = vgetq_lane_f32(yh, 3);
+        }
+    }
+    vst1q_f32(state, s1l);
+    vst1q_f32(state + 4, s1h);
+    vst1q_f32(state + n, s2l);
+    vst1q_f32(state + n + 4, s2h);
+}
+
+static void crossCorrelateNeon(const float *ref, const float *x, size_t length, size_t lags,
+                               float *scores) {
+    size_t d = 0;
+    for (; d + 16 <= lags; d += 16) {
+        float32x4_t s0 = vdupq_n_f32(0), s1 = vdupq_n_f32(0);
+        float32x4_t s2 = vdupq_n_f32(0), s3 = vdupq_n_f32(0);
+        const float *p = x + d;
+        for (size_t i = 0; i < length; i++) {
+            float r = ref[i];
+            s0 = vmlaq_n_f32(s0, vld1q_f32(p + i), r);
+            s1 = vmlaq_n_f32(s1, vld1q_f32(p + i + 4), r);
+            s2 = vmlaq_n_f32(s2, vld1q_f32(p + i + 8), r);
+            s3 = vmlaq_n_f32(s3, vld1q_f32(p + i + 12), r);
+        }
+        vst1q_f32(scores + d, s0);
+        vst1q_f32(scores + d + 4, s1);
+        vst1q_f32(scores + d + 8, s2);
+        vst1q_f32(scores + d + 12, s3);
+    }
+    crossCorrelateScalar(ref, x + d, length, lags - d, scores + d);
+}
+#endif
+
+// ---- tables ----------------------------------------------------------------
+
+static const PcmKernels SCALAR_KERNELS = {
+        PcmKernels::SET_SCALAR, "scalar",
+        s16ToFloatScalar, floatToS16Scalar, floatToS16DitherScalar,
+        s24ToFloatScalar, floatToS24Scalar, s32ToFloatScalar, floatToS32Scalar,
+        monoToStereoScalar, stereoToMonoScalar, interleaveScalar, deinterleaveScalar,
+        applyGainScalar, mixToStereoScalar, fftStageScalar,
+        biquadCascadeScalar, crossCorrelateScalar,
+};
+
+#ifdef PCM_HAVE_SSE
+static const PcmKernels SSE_KERNELS = {
+        PcmKernels::SET_SSE, "sse",
+        s16ToFloatSse, floatToS16Sse, floatToS16DitherSse,
+        s24ToFloatSse, floatToS24Sse, s32ToFloatSse, floatToS32Sse,
+        monoToStereoSse, stereoToMonoSse, interleaveSse, deinterleaveSse,
+        applyGainSse, mixToStereoSse, fftStageSse,
+        biquadCascadeSse, crossCorrelateSse,
+};
+#endif
+
+#ifdef PCM_HAVE_NEON
+static const PcmKernels NEON_KERNELS = {
+        PcmKernels::SET_NEON, "neon",
+        s16ToFloatNeon, floatToS16Neon, floatToS16DitherNeon,
+        s24ToFloatNeon, floatToS24Neon, s32ToFloatNeon, floatToS32Neon,
+        monoToStereoNeon, stereoToMonoNeon, interleaveNeon, deinterleaveNeon,
+        applyGainNeon, mixToStereoNeon, fftStageNeon,
+        biquadCascadeNeon, crossCorrelateNeon,
+};
+#endif
+
+const PcmKernels *PcmKernels::get(Set set) {
+    switch (set) {
+        case SET_SCALAR:
+            return &SCALAR_KERNELS;
+#ifdef PCM_HAVE_SSE
+        case SET_SSE:
+            return __builtin_cpu_supports("ssse3") ? &SSE_KERNELS : NULL;
+#endif
+#ifdef PCM_HAVE_NEON
+        case SET_NEON:
+            return &NEON_KERNELS;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+const PcmKernels &PcmKernels::best() {
+    static const PcmKernels *kernels = get(SET_NEON) != NULL ? get(SET_NEON)
+                                       : get(SET_SSE) != NULL ? get(SET_SSE)
+                                       : &SCALAR_KERNELS;
+    return *kernels;
+}
@@ -0,0 +1,94 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_PCMCONVERT_H
+#define NATIVEFEEDBACK_PCMCONVERT_H
+
+#include <cstddef>
+
+// stages of a biquadCascade, two SIMD vectors of them
+#define PCM_BIQUAD_STAGES 8
+
+// Sample format and layout conversions for the stream and file paths.
+//
+// Every kernel exists as a scalar reference and as SSE (SSSE3) and NEON
+// variants; a PcmKernels table holds one set and best() is the fastest set
+// this CPU runs. Floats are full scale at +-1.0. Conversions to integers
+// round to nearest and clip, and int24 is packed little endian, 3 bytes a
+// sample. Counts are samples unless a parameter says frames. None of the
+// kernels allocate, so they are safe on the audio thread.
+
+// per-lane xorshift state for floatToS16Dither, seeded once per stream
+struct PcmDither {
+    unsigned state[4];
+
+    explicit PcmDither(unsigned seed = 0x9e3779b9u) {
+        for (int i = 0; i < 4; i++) {
+            state[i] = seed * (2 * i + 1) | 1;
+        }
+    }
+};
+
+struct PcmKernels {
+    enum Set {
+        SET_SCALAR,
+        SET_SSE,
+        SET_NEON,
+    };
+
+    Set set;
+    const char *name;
+
+    void (*s16ToFloat)(const short *src, float *dst, size_t samples);
+    void (*floatToS16)(const float *src, short *dst, size_t samples);
+    // adds triangular dither of one LSB peak before rounding
+    void (*floatToS16Dither)(const float *src, short *dst, size_t samples, PcmDither *dither);
+    void (*s24ToFloat)(const unsigned char *src, float *dst, size_t samples);
+    void (*floatToS24)(const float *src, unsigned char *dst, size_t samples);
+    void (*s32ToFloat)(const int *src, float *dst, size_t samples);
+    void (*floatToS32)(const float *src, int *dst, size_t samples);
+
+    // int16 channel layouts: mono to both sides, stereo to the average
+    void (*monoToStereo)(const short *src, short *dst, size_t frames);
+    void (*stereoToMono)(const short *src, short *dst, size_t frames);
+    // float planar <-> interleaved stereo
+    void (*interleave)(const float *left, const float *right, float *dst, size_t frames);
+    void (*deinterleave)(const float *src, float *left, float *right, size_t frames);
+
+    // scales interleaved int16 in place by gains[channel], clipping; SIMD
+    // variants handle one and two channels and fall back beyond that
+    void (*applyGain)(short *samples, size_t frames, int channels, const float *gains);
+    // adds int16 of one or two channels into an interleaved stereo float
+    // bus, a mono source to both sides. Side c of frame i is scaled by
+    // gains[c] + i * steps[c], so the gains ramp across the call.
+    void (*mixToStereo)(const short *src, int srcChannels, float *bus, size_t frames,
+                        const float *gains, const float *steps);
+
+    // one radix-2 stage of a complex FFT on split arrays of size points:
+    // every group of 2 * half points gets its butterflies, point k of the
+    // group twiddled by (wr[k], direction * wi[k]). SIMD variants work four
+    // butterflies at a time once half reaches 4.
+    void (*fftStage)(float *re, float *im, size_t size, unsigned half, const float *wr,
+                     const float *wi, float direction);
+
+    // PCM_BIQUAD_STAGES biquads in series over a mono float block in place,
+    // transposed direct form II. coefs holds b0, b1, b2, a1, a2 (a0 is 1)
+    // each as PCM_BIQUAD_STAGES values, one per stage in order; state is
+    // s1 then s2 of every stage, zeroed to start. A stage of b0 = 1 and
+    // the rest 0 passes through. SIMD variants run stage s on sample t - s
+    // at step t, so every lane has work but the first and last seven steps.
+    void (*biquadCascade)(float *samples, size_t frames, const float *coefs, float *state);
+
+    // scores[d] = sum of ref[i] * x[d + i] over i < length, for every lag
+    // d < lags, so x holds lags + length - 1 samples. SIMD variants work
+    // sixteen lags at a time, one broadcast of ref[i] to all of them.
+    void (*crossCorrelate)(const float *ref, const float *x, size_t length, size_t lags,
+                           float *scores);
+
+    static const PcmKernels &best();
+    // NULL when the set isn't built in or this CPU can't run it
+    static const PcmKernels *get(Set set);
+};
+
+#endif //NATIVEFEEDBACK_PCMCONVERT_H
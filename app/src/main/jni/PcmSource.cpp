@@ -0,0 +1,70 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "PcmSource.h"
+
+#include <algorithm>
+#include <cstring>
+
+bool FilePcmSource::open(const char *path, unsigned long long offset, unsigned long long length) {
+    close();
+    inputFs_.open(path, std::ios_base::in | std::ios_base::binary);
+    if (!inputFs_.is_open()) {
+        return false;
+    }
+    // the data runs to the end of the file at most
+    unsigned long long fileBytes = 0;
+    if (inputFs_.seekg(0, std::ios_base::end)) {
+        fileBytes = static_cast<unsigned long long>(inputFs_.tellg());
+    }
+    begin_ = std::min(offset, fileBytes);
+    length_ = std::min(length, fileBytes - begin_);
+    if (!inputFs_.seekg(static_cast<std::streamoff>(begin_))) {
+        close();
+        return false;
+    }
+    remaining_ = length_;
+    return true;
+}
+
+bool FilePcmSource::seek(unsigned long long byte) {
+    byte = std::min(byte, length_);
+    inputFs_.clear();
+    if (!inputFs_.seekg(static_cast<std::streamoff>(begin_ + byte))) {
+        return false;
+    }
+    remaining_ = length_ - byte;
+    return true;
+}
+
+size_t FilePcmSource::read(void *dst, size_t bytes) {
+    if (bytes > remaining_) {
+        bytes = static_cast<size_t>(remaining_);
+    }
+    inputFs_.read(static_cast<char *>(dst), bytes);
+    size_t n = static_cast<size_t>(inputFs_.gcount());
+    remaining_ -= n;
+    return n;
+}
+
+void FilePcmSource::close() {
+    if (inputFs_.is_open()) {
+        inputFs_.close();
+    }
+    inputFs_.clear();
+    begin_ = 0;
+    length_ = 0;
+    remaining_ = 0;
+}
+
+size_t MemoryPcmSource::read(void *dst, size_t bytes) {
+    size_t n = std::min(bytes, size_ - cursor_);
+    memcpy(dst, data_ + cursor_, n);
+    cursor_ += n;
+    return n;
+}
+
+bool MemoryPcmSource::seek(unsigned long long byte) {
+    cursor_ = static_cast<size_t>(std::min<unsigned long long>(byte, size_));
+    return true;
+}
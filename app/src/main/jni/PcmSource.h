@@ -0,0 +1,65 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_PCMSOURCE_H
+#define NATIVEFEEDBACK_PCMSOURCE_H
+
+#include <cstddef>
+#include <fstream>
+
+// Source of raw interleaved PCM for the playback pipeline, read front to
+// back but able to jump. Sources are read from the prefetch thread, never
+// from the audio callback.
+class PcmSource {
+public:
+    virtual ~PcmSource() {}
+
+    // copies up to bytes of the next PCM data into dst, returns the number of
+    // bytes copied, 0 at the end of the source
+    virtual size_t read(void *dst, size_t bytes) = 0;
+    virtual void close() = 0;
+    // moves the next read() to byte of the PCM data, clamped to its end;
+    // false if the source can't get there
+    virtual bool seek(unsigned long long byte) = 0;
+    // bytes of PCM data
+    virtual unsigned long long size() const = 0;
+};
+
+// reads the file through std::ifstream, length bytes from offset on
+class FilePcmSource : public PcmSource {
+public:
+    FilePcmSource() : begin_(0), length_(0), remaining_(0) {}
+
+    bool open(const char *path, unsigned long long offset = 0, unsigned long long length = ~0ULL);
+    size_t read(void *dst, size_t bytes) override;
+    void close() override;
+    bool seek(unsigned long long byte) override;
+    unsigned long long size() const override { return length_; }
+
+private:
+    std::ifstream inputFs_;
+    // where the PCM data starts in the file, and how long it is
+    unsigned long long begin_;
+    unsigned long long length_;
+    unsigned long long remaining_;
+};
+
+// plays a caller-owned block of memory
+class MemoryPcmSource : public PcmSource {
+public:
+    MemoryPcmSource(const void *data, size_t bytes)
+            : data_(static_cast<const unsigned char *>(data)), size_(bytes), cursor_(0) {}
+
+    size_t read(void *dst, size_t bytes) override;
+    void close() override { cursor_ = 0; }
+    bool seek(unsigned long long byte) override;
+    unsigned long long size() const override { return size_; }
+
+private:
+    const unsigned char *data_;
+    size_t size_;
+    size_t cursor_;
+};
+
+#endif //NATIVEFEEDBACK_PCMSOURCE_H
@@ -0,0 +1,864 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "PlaybackStream.h"
+
+#include <algorithm>
+#include <cstring>
+
+#define LOG_TAG "NativePlaybackStream"
+
+#include "AudioStats.h"
+#include "AudioThreads.h"
+#include "Log.h"
+#include "PcmConvert.h"
+#include "WavFile.h"
+
+// in-flight marker for a slice of the mapping, which has nothing to recycle
+static const int MAPPED_SLICE = -1;
+// how far ahead of the play position the mapping is kept faulted in, and how
+// much gets played between wake-ups of the read-ahead thread
+static const size_t READ_AHEAD_BYTES = 256 * 1024;
+static const size_t READ_AHEAD_STEP = READ_AHEAD_BYTES / 4;
+// end of a silence buffer, which doesn't move the play position
+static const unsigned long long NO_POSITION = ~0ULL;
+// the end of the last file: not there yet, read by the reader, handed out
+// by the callback. Only a reached end can be taken back by enqueue().
+static const unsigned END_READING = 0;
+static const unsigned END_REACHED = 1;
+static const unsigned END_TAKEN = 2;
+
+static unsigned long long endState(unsigned generation, unsigned state) {
+    return static_cast<unsigned long long>(generation) << 2 | state;
+}
+
+// a linear ramp over the frames, up from silence or down to it
+static void fade(short *samples, unsigned frames, int channels, bool in) {
+    for (unsigned i = 0; i < frames; i++) {
+        float gain = static_cast<float>(in ? i : frames - 1 - i) / frames;
+        for (int c = 0; c < channels; c++) {
+            samples[i * channels + c] = static_cast<short>(samples[i * channels + c] * gain);
+        }
+    }
+}
+
+// copies frames between channel layouts: down to mono by averaging, up from
+// mono by duplicating, otherwise channel by channel with the rest silent
+static void convertChannels(const short *src, int srcChannels, short *dst, int dstChannels,
+                            unsigned frames) {
+    if (srcChannels == 1 && dstChannels == 2) {
+        PcmKernels::best().monoToStereo(src, dst, frames);
+        return;
+    }
+    if (srcChannels == 2 && dstChannels == 1) {
+        PcmKernels::best().stereoToMono(src, dst, frames);
+        return;
+    }
+    for (unsigned i = 0; i < frames; i++) {
+        const short *in = src + i * srcChannels;
+        short *out = dst + i * dstChannels;
+        if (dstChannels == 1) {
+            int sum = 0;
+            for (int c = 0; c < srcChannels; c++) {
+                sum += in[c];
+            }
+            out[0] = static_cast<short>(sum / srcChannels);
+        } else if (srcChannels == 1) {
+            for (int c = 0; c < dstChannels; c++) {
+                out[c] = in[0];
+            }
+        } else {
+            for (int c = 0; c < dstChannels; c++) {
+                out[c] = c < srcChannels ? in[c] : 0;
+            }
+        }
+    }
+}
+
+PlaybackStream::PlaybackStream(int channels, int bufferCount)
+        : channels_(channels),
+          bufferCount_(bufferCount),
+          fileChannels_(channels),
+          framesPerBuffer_(0),
+          samplesPerBuffer_(0),
+          sizes_(bufferCount),
+          generations_(bufferCount),
+          trackNumbers_(bufferCount),
+          ends_(bufferCount),
+          fileRate_(0),
+          streamRate_(0),
+          resampling_(false),
+          resampler_(NULL),
+          budget_(NULL),
+          pendingHead_(0),
+          pendingFrames_(0),
+          tailFrames_(0),
+          pendingSilence_(false),
+          stretching_(false),
+          stretchHead_(0),
+          stretchFrames_(0),
+          stretchTail_(0),
+          stretchSilence_(false),
+          freeQueue_(bufferCount),
+          readyQueue_(bufferCount),
+          inFlight_(bufferCount + 1),
+          inFlightHead_(0),
+          inFlightCount_(0),
+          current_(0),
+          source_(NULL),
+          mode_(SOURCE_STREAM),
+          open_(false),
+          nextReady_(false),
+          readerTrack_(0),
+          track_(0),
+          direct_(false),
+          mapCursor_(0),
+          readAheadWoken_(0),
+          faulted_(0),
+          seekFrame_(0),
+          generation_(0),
+          seekRequestedNs_(0),
+          seekLatencyNs_(0),
+          readerGeneration_(0),
+          callbackGeneration_(0),
+          fadedOut_(0),
+          fadeIn_(false),
+          fadeBuffer_(0),
+          loopSeq_(0),
+          loopStart_(0),
+          loopEnd_(0),
+          sourcePos_(0),
+          held_(-1),
+          sourceRate_(0),
+          totalFrames_(0),
+          position_(0),
+          running_(false),
+          end_(endState(0, END_TAKEN)),
+          underruns_(0),
+          bytesRead_(0) {
+    sem_init(&spaceAvailable_, 0, 0);
+}
+
+PlaybackStream::~PlaybackStream() {
+    close();
+    sem_destroy(&spaceAvailable_);
+}
+
+bool PlaybackStream::openTrack(Track *track, const char *path, SourceMode mode, int fileChannels) {
+    track->channels = fileChannels > 0 ? fileChannels : channels_;
+    track->rate = fileRate_;
+    // a WAV file plays its data chunk at its own rate and layout
+    WavInfo wav;
+    unsigned long long dataOffset = 0, dataBytes = ~0ULL;
+    switch (WavReader::probe(path, &wav)) {
+        case WAV_PCM16:
+            track->channels = wav.channels;
+            track->rate = wav.sampleRate;
+            dataOffset = wav.dataOffset;
+            dataBytes = wav.dataBytes;
+            break;
+        case WAV_UNSUPPORTED:
+            return false;
+        case WAV_NONE:
+            break;
+    }
+    // a lossless one is decoded by the reader thread, the mapping is no use
+    LosslessInfo lossless;
+    if (LosslessPcmSource::probe(path, &lossless)) {
+        if (!track->lossless.open(path)) {
+            return false;
+        }
+        track->channels = lossless.channels;
+        track->rate = lossless.sampleRate;
+        track->source = &track->lossless;
+    } else if (mode == SOURCE_MAPPED && track->mapped.open(path, dataOffset, dataBytes)) {
+        track->source = &track->mapped;
+    } else {
+        // also when the file is too big to map
+        if (!track->file.open(path, dataOffset, dataBytes)) {
+            return false;
+        }
+        track->source = &track->file;
+    }
+    track->frames = track->source->size() / (track->channels * sizeof(short));
+    if (track->rate != streamRate_ && !track->resampler.init(track->rate, streamRate_, track->channels)) {
+        closeTrack(track);
+        return false;
+    }
+    return true;
+}
+
+void PlaybackStream::startTrack(int index) {
+    Track &track = tracks_[index];
+    current_ = index;
+    source_ = track.source;
+    fileChannels_ = track.channels;
+    resampling_ = track.rate != streamRate_;
+    resampler_ = &track.resampler;
+    if (fileChannels_ != channels_) {
+        convertBuffer_.resize(framesPerBuffer_ * fileChannels_);
+    }
+    if (resampling_) {
+        pending_.resize(framesPerBuffer_ * fileChannels_);
+        pendingHead_ = 0;
+        pendingFrames_ = 0;
+        tailFrames_ = resampler_->latencyFrames();
+    }
+    sourceRate_.store(track.rate, std::memory_order_relaxed);
+    totalFrames_.store(track.frames, std::memory_order_relaxed);
+    sourcePos_ = 0;
+}
+
+void PlaybackStream::closeTrack(Track *track) {
+    if (track->source != NULL) {
+        track->source->close();
+        track->source = NULL;
+    }
+}
+
+bool PlaybackStream::open(const char *path, int framesPerBuffer, SourceMode mode,
+                          int fileChannels, unsigned long long startFrame) {
+    close();
+    framesPerBuffer_ = framesPerBuffer;
+    if (!openTrack(&tracks_[0], path, mode, fileChannels)) {
+        return false;
+    }
+    startTrack(0);
+    mode_ = mode;
+    direct_ = source_ == &tracks_[0].mapped && fileChannels_ == channels_ && !resampling_
+              && speed() == 1.0f;
+    stretching_ = false;
+    if (stretcher_.init(streamRate_, channels_)) {
+        stretchIn_.resize(framesPerBuffer * channels_);
+    }
+
+    unsigned samples = framesPerBuffer * channels_;
+    if (samples != samplesPerBuffer_) {
+        samplesPerBuffer_ = samples;
+        storage_.assign((bufferCount_ + 1) * samples, 0);
+    }
+    std::fill(storage_.begin() + bufferCount_ * samples, storage_.end(), 0);
+
+    freeQueue_.reset();
+    readyQueue_.reset();
+    inFlightHead_ = 0;
+    inFlightCount_ = 0;
+    underruns_.store(0, std::memory_order_relaxed);
+    bytesRead_.store(0, std::memory_order_relaxed);
+
+    nextReady_ = false;
+    queued_.clear();
+    readerTrack_.store(0, std::memory_order_relaxed);
+    track_.store(0, std::memory_order_relaxed);
+    startFrame = std::min(startFrame, frames());
+    storeLoop(0, 0);
+    unsigned generation = generation_.load(std::memory_order_relaxed);
+    readerGeneration_ = generation;
+    callbackGeneration_ = generation;
+    fadedOut_ = generation;
+    seekLatencyNs_.store(0, std::memory_order_relaxed);
+    position_.store(startFrame, std::memory_order_relaxed);
+    held_ = -1;
+
+    open_.store(true, std::memory_order_release);
+    if (direct_) {
+        const MappedPcmFile &file = mapping();
+        size_t start = static_cast<size_t>(startFrame) * channels_ * sizeof(short);
+        mapCursor_.store(start, std::memory_order_relaxed);
+        readAheadWoken_ = start;
+        file.willNeed(start, READ_AHEAD_BYTES);
+        file.touch(start, READ_AHEAD_BYTES);
+        faulted_.store(start + READ_AHEAD_BYTES, std::memory_order_relaxed);
+        if (file.size() > READ_AHEAD_BYTES) {
+            running_.store(true, std::memory_order_release);
+            reader_ = std::thread(&PlaybackStream::readAheadLoop, this);
+        }
+        return true;
+    }
+
+    if (startFrame > 0) {
+        moveSource(startFrame);
+    }
+    // starting halfway through a waveform would click
+    fadeIn_ = startFrame > 0;
+    for (int i = 0; i < bufferCount_; i++) {
+        freeQueue_.push(i);
+    }
+    end_.store(endState(generation, END_READING), std::memory_order_relaxed);
+    // fill the whole pool up front so the player starts on real data
+    prefetch();
+    // the reader stays up past the end, for a seek back
+    running_.store(true, std::memory_order_release);
+    reader_ = std::thread(&PlaybackStream::readerLoop, this);
+    return true;
+}
+
+bool PlaybackStream::seek(unsigned long long frame) {
+    if (!open_.load(std::memory_order_acquire)) {
+        return false;
+    }
+    // the length and number of the file the reader is on, not half of one
+    // and half of the next
+    unsigned track;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        frame = std::min(frame, frames());
+        track = readerTrack_.load(std::memory_order_relaxed);
+    }
+    if (direct_) {
+        // the callback jumps straight there, so the pages have to be in
+        // before it does
+        const MappedPcmFile &file = mapping();
+        size_t offset = static_cast<size_t>(frame) * channels_ * sizeof(short);
+        file.willNeed(offset, READ_AHEAD_BYTES);
+        file.touch(offset, READ_AHEAD_BYTES);
+    }
+    seekRequestedNs_.store(CallbackStats::nowNs(), std::memory_order_relaxed);
+    seekFrame_.store(frame, std::memory_order_relaxed);
+    generation_.fetch_add(1, std::memory_order_release);
+    // after the bump, so no buffer from before it can overwrite this
+    position_.store(frame, std::memory_order_relaxed);
+    track_.store(track, std::memory_order_relaxed);
+    sem_post(&spaceAvailable_);
+    return true;
+}
+
+void PlaybackStream::setLoop(unsigned long long start, unsigned long long end) {
+    {
+        // clamped to the file the reader is on, and never stored while it
+        // clears the loop of the last one
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        end = std::min(end, frames());
+        storeLoop(start, end > start ? end : 0);
+    }
+    if (direct_ && end > start) {
+        const MappedPcmFile &file = mapping();
+        size_t offset = static_cast<size_t>(start) * channels_ * sizeof(short);
+        file.willNeed(offset, READ_AHEAD_BYTES);
+        file.touch(offset, READ_AHEAD_BYTES);
+    }
+}
+
+void PlaybackStream::storeLoop(unsigned long long start, unsigned long long end) {
+    unsigned seq = loopSeq_.load(std::memory_order_relaxed);
+    loopSeq_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    loopStart_.store(start, std::memory_order_relaxed);
+    loopEnd_.store(end, std::memory_order_relaxed);
+    loopSeq_.store(seq + 2, std::memory_order_release);
+}
+
+bool PlaybackStream::loop(unsigned long long *start, unsigned long long *end) const {
+    unsigned seq;
+    do {
+        seq = loopSeq_.load(std::memory_order_acquire);
+        *start = loopStart_.load(std::memory_order_relaxed);
+        *end = loopEnd_.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) != 0 || seq != loopSeq_.load(std::memory_order_relaxed));
+    return *end > *start;
+}
+
+void PlaybackStream::setSampleRates(int fileRate, int streamRate) {
+    fileRate_ = fileRate;
+    streamRate_ = streamRate;
+}
+
+void PlaybackStream::close() {
+    open_.store(false, std::memory_order_release);
+    if (reader_.joinable()) {
+        running_.store(false, std::memory_order_release);
+        sem_post(&spaceAvailable_);
+        reader_.join();
+    }
+    closeTrack(&tracks_[0]);
+    closeTrack(&tracks_[1]);
+    source_ = NULL;
+    direct_ = false;
+}
+
+bool PlaybackStream::enqueue(const char *path) {
+    // direct_ only changes with open() and close(), on this thread
+    if (!open_.load(std::memory_order_acquire) || direct_) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queueMutex_);
+        // a reader that has run out reads on, unless the callback has
+        // already handed out the end
+        unsigned generation = generation_.load(std::memory_order_acquire);
+        unsigned long long reached = endState(generation, END_REACHED);
+        if (ended(generation)
+            && !end_.compare_exchange_strong(reached, endState(generation, END_READING))) {
+            return false;
+        }
+        queued_.push_back(path);
+    }
+    // the reader opens it now, not at the end of the file
+    sem_post(&spaceAvailable_);
+    return true;
+}
+
+size_t PlaybackStream::readSource(void *dst, size_t bytes) {
+    // at the end of a loop, back to its start; never past its end
+    unsigned long long frameBytes = fileChannels_ * sizeof(short);
+    unsigned long long start, end;
+    if (loop(&start, &end)) {
+        end *= frameBytes;
+        if (sourcePos_ >= end) {
+            moveSource(start);
+        }
+        bytes = static_cast<size_t>(std::min<unsigned long long>(bytes, end - sourcePos_));
+    }
+    size_t n = source_->read(dst, bytes);
+    sourcePos_ += n;
+    bytesRead_.fetch_add(n, std::memory_order_relaxed);
+    return n;
+}
+
+void PlaybackStream::moveSource(unsigned long long frame) {
+    unsigned long long byte = std::min(frame, frames()) * fileChannels_ * sizeof(short);
+    if (!source_->seek(byte)) {
+        // a damaged .nfla frame: the next read finds the end
+        LOGI("can't seek to frame %llu", frame);
+    }
+    sourcePos_ = byte;
+}
+
+unsigned long long PlaybackStream::readerFrame() const {
+    unsigned long long frame = sourcePos_ / (fileChannels_ * sizeof(short));
+    if (resampling_ && !pendingSilence_) {
+        frame -= pendingFrames_ - pendingHead_;
+    }
+    if (stretching_ && !stretchSilence_) {
+        // at the stream rate, and only roughly right just past a loop's
+        // end or a switch of files
+        unsigned long long held = stretchFrames_ - stretchHead_ + stretcher_.heldFrames();
+        held = held * sourceRate_.load(std::memory_order_relaxed) / streamRate_;
+        frame -= std::min(frame, held);
+    }
+    return frame;
+}
+
+void PlaybackStream::applySeek() {
+    unsigned generation = generation_.load(std::memory_order_acquire);
+    if (generation == readerGeneration_) {
+        return;
+    }
+    readerGeneration_ = generation;
+    moveSource(seekFrame_.load(std::memory_order_relaxed));
+    if (resampling_) {
+        resampler_->reset();
+        pendingHead_ = 0;
+        pendingFrames_ = 0;
+        tailFrames_ = resampler_->latencyFrames();
+    }
+    if (stretching_) {
+        resetStretch();
+    }
+    end_.store(endState(generation, END_READING), std::memory_order_relaxed);
+    fadeIn_ = true;
+}
+
+bool PlaybackStream::ended(unsigned generation) const {
+    unsigned long long end = end_.load(std::memory_order_acquire);
+    return (end & 3) != END_READING && end >> 2 == generation;
+}
+
+bool PlaybackStream::refillPending() {
+    size_t frameBytes = fileChannels_ * sizeof(short);
+    size_t frames = readSource(&pending_[0], pending_.size() * sizeof(short)) / frameBytes;
+    pendingSilence_ = frames == 0;
+    if (frames == 0) {
+        if (tailFrames_ == 0) {
+            return false;
+        }
+        frames = std::min(tailFrames_, pending_.size() / fileChannels_);
+        std::fill(pending_.begin(), pending_.begin() + frames * fileChannels_, 0);
+        tailFrames_ -= frames;
+    }
+    pendingHead_ = 0;
+    pendingFrames_ = frames;
+    return true;
+}
+
+void PlaybackStream::prepareNext() {
+    while (!nextReady_) {
+        std::string path;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            if (queued_.empty()) {
+                return;
+            }
+            path = queued_.front();
+            queued_.pop_front();
+        }
+        // the other track is closed once the reader is past it
+        nextReady_ = openTrack(&tracks_[1 - current_], path.c_str(), mode_, 0);
+        if (!nextReady_) {
+            LOGI("can't open %s, skipping it", path.c_str());
+        }
+    }
+}
+
+bool PlaybackStream::nextTrack() {
+    prepareNext();
+    if (!nextReady_) {
+        return false;
+    }
+    nextReady_ = false;
+    closeTrack(&tracks_[current_]);
+    std::lock_guard<std::mutex> lock(queueMutex_);
+    // a loop belongs to its file
+    storeLoop(0, 0);
+    startTrack(1 - current_);
+    readerTrack_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+unsigned PlaybackStream::resample(short *dst, unsigned maxFrames) {
+    // resample in the file's layout, then convert like a plain read
+    short *out = fileChannels_ == channels_ ? dst : &convertBuffer_[0];
+    if (budget_ != NULL) {
+        resampler_->setQuality(budget_->level() >= CPU_BUDGET_RESAMPLER_LEVEL ? Resampler::QUALITY_LOW
+                                                                              : Resampler::QUALITY_HIGH);
+    }
+    size_t frames = 0;
+    while (frames < maxFrames) {
+        if (pendingHead_ == pendingFrames_ && !refillPending()) {
+            break;
+        }
+        size_t consumed;
+        frames += resampler_->process(&pending_[pendingHead_ * fileChannels_],
+                                     pendingFrames_ - pendingHead_, &consumed,
+                                     out + frames * fileChannels_, maxFrames - frames);
+        pendingHead_ += consumed;
+    }
+    if (out != dst) {
+        convertChannels(out, fileChannels_, dst, channels_, frames);
+    }
+    return static_cast<unsigned>(frames);
+}
+
+unsigned PlaybackStream::readFrames(short *dst, unsigned maxFrames) {
+    // only whole frames go to the player
+    if (resampling_) {
+        return resample(dst, maxFrames);
+    }
+    if (fileChannels_ == channels_) {
+        return static_cast<unsigned>(readSource(dst, maxFrames * channels_ * sizeof(short))
+                                     / (channels_ * sizeof(short)));
+    }
+    size_t bytes = readSource(&convertBuffer_[0], maxFrames * fileChannels_ * sizeof(short));
+    unsigned frames = static_cast<unsigned>(bytes / (fileChannels_ * sizeof(short)));
+    convertChannels(&convertBuffer_[0], fileChannels_, dst, channels_, frames);
+    return frames;
+}
+
+unsigned PlaybackStream::readTracks(short *dst, unsigned maxFrames) {
+    // past a loop's end it goes on from the loop's start, past a file's
+    // from the next file's first frame
+    unsigned frames = 0;
+    while (frames < maxFrames) {
+        unsigned n = readFrames(dst + frames * channels_, maxFrames - frames);
+        if (n == 0 && !nextTrack()) {
+            break;
+        }
+        frames += n;
+    }
+    return frames;
+}
+
+void PlaybackStream::resetStretch() {
+    stretcher_.reset();
+    stretchHead_ = 0;
+    stretchFrames_ = 0;
+    stretchTail_ = stretcher_.latencyFrames();
+    stretchSilence_ = false;
+}
+
+unsigned PlaybackStream::stretch(short *dst, unsigned maxFrames) {
+    size_t frames = 0;
+    while (frames < maxFrames) {
+        if (stretchHead_ == stretchFrames_) {
+            stretchHead_ = 0;
+            stretchFrames_ = readTracks(&stretchIn_[0], framesPerBuffer_);
+            stretchSilence_ = stretchFrames_ == 0;
+            if (stretchFrames_ == 0) {
+                if (stretchTail_ == 0) {
+                    // all out: whatever an enqueue() or a seek brings next
+                    // starts afresh
+                    resetStretch();
+                    break;
+                }
+                stretchFrames_ = std::min<size_t>(stretchTail_, framesPerBuffer_);
+                std::fill(stretchIn_.begin(), stretchIn_.begin() + stretchFrames_ * channels_, 0);
+                stretchTail_ -= stretchFrames_;
+            }
+        }
+        size_t consumed;
+        frames += stretcher_.process(&stretchIn_[stretchHead_ * channels_],
+                                     stretchFrames_ - stretchHead_, &consumed,
+                                     dst + frames * channels_, maxFrames - frames);
+        stretchHead_ += consumed;
+    }
+    return static_cast<unsigned>(frames);
+}
+
+bool PlaybackStream::fill(int index) {
+    // switched in at the first speed that isn't 1, from a window that
+    // starts at full gain, so there's no seam
+    if (!stretching_ && speed() != 1.0f && stretcher_.active()) {
+        stretching_ = true;
+        resetStretch();
+    }
+    // a buffer is only short at the very end
+    unsigned frames = stretching_ ? stretch(buffer(index), framesPerBuffer_)
+                                  : readTracks(buffer(index), framesPerBuffer_);
+    if (frames == 0) {
+        return false;
+    }
+    sizes_[index] = frames * channels_ * sizeof(short);
+    generations_[index] = readerGeneration_;
+    trackNumbers_[index] = readerTrack_.load(std::memory_order_relaxed);
+    ends_[index] = readerFrame();
+    if (fadeIn_) {
+        fade(buffer(index), frames, channels_, true);
+        fadeIn_ = false;
+    }
+    return true;
+}
+
+void PlaybackStream::prefetch() {
+    for (;;) {
+        applySeek();
+        // nothing more to read until a seek or an enqueue()
+        if (ended(readerGeneration_)) {
+            return;
+        }
+        prepareNext();
+        int index = held_;
+        held_ = -1;
+        if (index < 0 && !freeQueue_.pop(&index)) {
+            return;
+        }
+        if (!fill(index)) {
+            held_ = index;
+            std::lock_guard<std::mutex> lock(queueMutex_);
+            // queued while the buffer was being filled
+            if (!queued_.empty()) {
+                continue;
+            }
+            end_.store(endState(readerGeneration_, END_REACHED), std::memory_order_release);
+            return;
+        }
+        readyQueue_.push(index);
+    }
+}
+
+void PlaybackStream::readerLoop() {
+    AudioThreads::enter(THREAD_PREFETCH);
+    for (;;) {
+        sem_wait(&spaceAvailable_);
+        if (!running_.load(std::memory_order_acquire)) {
+            break;
+        }
+        prefetch();
+    }
+}
+
+void PlaybackStream::readAheadLoop() {
+    AudioThreads::enter(THREAD_PREFETCH);
+    const MappedPcmFile &file = mapping();
+    size_t faulted = faulted_.load(std::memory_order_relaxed);
+    size_t from = mapCursor_.load(std::memory_order_relaxed);
+    for (;;) {
+        sem_wait(&spaceAvailable_);
+        if (!running_.load(std::memory_order_acquire)) {
+            break;
+        }
+        size_t cursor = mapCursor_.load(std::memory_order_acquire);
+        if (cursor < from || cursor > faulted) {
+            // a seek or a loop moved the play position, follow it from there
+            from = cursor;
+            faulted = cursor;
+        }
+        size_t target = std::min(cursor + READ_AHEAD_BYTES, file.size());
+        if (target > faulted) {
+            file.willNeed(faulted, target - faulted);
+            file.touch(faulted, target - faulted);
+            faulted = target;
+            faulted_.store(faulted, std::memory_order_relaxed);
+        }
+    }
+}
+
+void PlaybackStream::pushInFlight(int index, unsigned generation, unsigned track,
+                                  unsigned long long end) {
+    InFlight &entry = inFlight_[(inFlightHead_ + inFlightCount_) % inFlight_.size()];
+    entry.index = index;
+    entry.generation = generation;
+    entry.track = track;
+    entry.end = end;
+    inFlightCount_++;
+}
+
+void PlaybackStream::recycle(int index) {
+    freeQueue_.push(index);
+    sem_post(&spaceAvailable_);
+}
+
+const short *PlaybackStream::fadedSlice(size_t offset, size_t bytes, bool in) {
+    // the player queue holds a few buffers at most, so going round the
+    // idle pool never reuses one it still holds
+    short *copy = buffer(fadeBuffer_);
+    fadeBuffer_ = (fadeBuffer_ + 1) % bufferCount_;
+    memcpy(copy, mapping().data() + offset, bytes);
+    fade(copy, static_cast<unsigned>(bytes / (channels_ * sizeof(short))), channels_, in);
+    return copy;
+}
+
+const short *PlaybackStream::nextMappedSlice(unsigned *bytes) {
+    const MappedPcmFile &file = mapping();
+    size_t offset = mapCursor_.load(std::memory_order_relaxed);
+    size_t frameBytes = channels_ * sizeof(short);
+    unsigned generation = generation_.load(std::memory_order_acquire);
+    bool jumped = generation != callbackGeneration_;
+    if (jumped) {
+        // one more slice of what was playing, faded out, then the jump
+        size_t n = std::min<size_t>(bufferBytes(), file.size() - offset) / frameBytes * frameBytes;
+        if (fadedOut_ != generation && n > 0) {
+            fadedOut_ = generation;
+            pushInFlight(MAPPED_SLICE, callbackGeneration_, 0, NO_POSITION);
+            *bytes = static_cast<unsigned>(n);
+            return fadedSlice(offset, n, false);
+        }
+        callbackGeneration_ = generation;
+        fadedOut_ = generation;
+        offset = static_cast<size_t>(seekFrame_.load(std::memory_order_relaxed)) * frameBytes;
+        seekLatencyNs_.store(CallbackStats::nowNs() - seekRequestedNs_.load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+    }
+    size_t limit = file.size();
+    unsigned long long loopStart, loopEnd;
+    if (loop(&loopStart, &loopEnd)) {
+        size_t end = static_cast<size_t>(loopEnd) * frameBytes;
+        if (offset >= end) {
+            offset = static_cast<size_t>(loopStart) * frameBytes;
+        }
+        limit = end;
+    }
+    size_t n = std::min<size_t>(bufferBytes(), limit - offset) / frameBytes * frameBytes;
+    mapCursor_.store(offset + n, std::memory_order_release);
+    if (n == 0) {
+        return NULL;
+    }
+    bytesRead_.fetch_add(n, std::memory_order_relaxed);
+    pushInFlight(MAPPED_SLICE, generation, 0, (offset + n) / frameBytes);
+    *bytes = static_cast<unsigned>(n);
+    return jumped ? fadedSlice(offset, n, true)
+                  : reinterpret_cast<const short *>(file.data() + offset);
+}
+
+const short *PlaybackStream::nextBuffer(unsigned *bytes) {
+    if (direct_) {
+        return nextMappedSlice(bytes);
+    }
+    unsigned generation = generation_.load(std::memory_order_acquire);
+    int index;
+    for (;;) {
+        bool popped = readyQueue_.pop(&index);
+        if (!popped && ended(generation)) {
+            // the reader publishes its last buffer before flagging EOF. Past
+            // that the end is handed out, unless an enqueue() has just taken
+            // it back for the reader to go on.
+            popped = readyQueue_.pop(&index);
+            unsigned long long reached = endState(generation, END_REACHED);
+            if (!popped && (end_.compare_exchange_strong(reached, endState(generation, END_TAKEN))
+                            || (reached & 3) == END_TAKEN)) {
+                return NULL;
+            }
+        }
+        if (!popped) {
+            // reader is behind: play silence rather than wait for the disk.
+            // While it refills after a seek that's expected.
+            if (generation == callbackGeneration_) {
+                underruns_.fetch_add(1, std::memory_order_relaxed);
+            }
+            pushInFlight(bufferCount_, generation, 0, NO_POSITION);
+            *bytes = bufferBytes();
+            return buffer(bufferCount_);
+        }
+        if (generations_[index] == generation) {
+            break;
+        }
+        // read before a seek: the first one fades out what was playing,
+        // the rest go straight back to the reader
+        if (fadedOut_ != generation) {
+            fadedOut_ = generation;
+            fade(buffer(index), sizes_[index] / (channels_ * sizeof(short)), channels_, false);
+            pushInFlight(index, generations_[index], trackNumbers_[index], ends_[index]);
+            *bytes = sizes_[index];
+            return buffer(index);
+        }
+        recycle(index);
+    }
+    if (callbackGeneration_ != generation) {
+        callbackGeneration_ = generation;
+        fadedOut_ = generation;
+        seekLatencyNs_.store(CallbackStats::nowNs() - seekRequestedNs_.load(std::memory_order_relaxed),
+                             std::memory_order_relaxed);
+    }
+    pushInFlight(index, generation, trackNumbers_[index], ends_[index]);
+    *bytes = sizes_[index];
+    return buffer(index);
+}
+
+void PlaybackStream::onBufferPlayed() {
+    if (inFlightCount_ == 0) {
+        return;
+    }
+    InFlight entry = inFlight_[inFlightHead_];
+    int played = entry.index;
+    inFlightHead_ = (inFlightHead_ + 1) % inFlight_.size();
+    inFlightCount_--;
+    // what played before a seek doesn't move the position back
+    if (entry.end != NO_POSITION
+        && entry.generation == generation_.load(std::memory_order_relaxed)) {
+        position_.store(entry.end, std::memory_order_relaxed);
+        track_.store(entry.track, std::memory_order_relaxed);
+    }
+    if (played == MAPPED_SLICE) {
+        // wake the read-ahead thread to follow the play position, but only
+        // every READ_AHEAD_STEP so the callback rarely makes the syscall
+        size_t cursor = mapCursor_.load(std::memory_order_relaxed);
+        if (cursor - readAheadWoken_ >= READ_AHEAD_STEP) {
+            readAheadWoken_ = cursor;
+            sem_post(&spaceAvailable_);
+        }
+    } else if (played != bufferCount_) {
+        recycle(played);
+    }
+}
+
+bool PlaybackStream::drained() const {
+    // not with a seek on its way
+    unsigned generation = generation_.load(std::memory_order_acquire);
+    if (direct_) {
+        size_t frameBytes = channels_ * sizeof(short);
+        return inFlightCount_ == 0 && generation == callbackGeneration_
+               && mapping().size() - mapCursor_.load(std::memory_order_relaxed)
+                  < frameBytes;
+    }
+    return inFlightCount_ == 0 && ended(generation) && readyQueue_.size() == 0;
+}
+
+unsigned PlaybackStream::readyBuffers() const {
+    if (direct_) {
+        size_t size = mapping().size();
+        size_t faulted = std::min(faulted_.load(std::memory_order_relaxed), size);
+        size_t cursor = mapCursor_.load(std::memory_order_relaxed);
+        return faulted > cursor ? static_cast<unsigned>((faulted - cursor) / bufferBytes()) : 0;
+    }
+    return static_cast<unsigned>(readyQueue_.size());
+}
@@ -0,0 +1,343 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_PLAYBACKSTREAM_H
+#define NATIVEFEEDBACK_PLAYBACKSTREAM_H
+
+#include <semaphore.h>
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CpuBudget.h"
+#include "LosslessFile.h"
+#include "MappedPcmSource.h"
+#include "PcmSource.h"
+#include "Resampler.h"
+#include "SpscQueue.h"
+#include "TimeStretcher.h"
+
+// Prefetching playback for the buffer queue player.
+//
+// A reader thread reads the file ahead into a pool of fixed buffers and
+// publishes them on a lock-free SPSC ring; the player callback only recycles
+// the buffer that just finished and enqueues the next ready one. Buffers stay
+// owned by the pool while the player queue holds them, so nothing the player
+// is reading ever goes out of scope. If the reader cannot keep up the
+// callback enqueues silence and counts an underrun instead of blocking.
+//
+// In SOURCE_MAPPED mode the file is mmapped instead. When its layout already
+// matches the player the callback enqueues slices of the mapping directly,
+// with no copies at all, and the reader thread only keeps the pages ahead of
+// the play position faulted in. Otherwise the mapping feeds the conversion
+// stage in place of read() calls. The file must not shrink while it plays
+// mapped, see MappedPcmFile.
+//
+// A .nfla file is decoded block by block on the reader thread, in either
+// mode, and never reaches the callback compressed.
+//
+// When the file rate differs from the stream rate the reader thread runs the
+// frames through a Resampler before the buffers are published, so the
+// callback side is the same either way.
+//
+// Playback can start anywhere, jump with seek() and loop between two
+// points, on raw PCM, WAV and .nfla alike; positions are frames of the
+// file. A seek bumps a generation number and wakes the reader, which moves
+// the source and refills the pool for the new generation. Buffers tag the
+// generation they were read for, so the callback recycles anything read
+// before the seek instead of playing it, fading out the first of them
+// while the reader catches up; the first buffer after the seek fades in.
+// The silence in between is not an underrun. A seek reaches the player
+// within the callback that hands back the stale buffers plus one buffer's
+// read, or one .nfla frame's decode, however far it jumps. In mapped mode
+// seek() faults the target's pages in itself and the callback jumps there
+// directly. A loop is followed by whoever reads the file, so it
+// splices without a gap, but a pool's worth ahead of the speaker: setting
+// one the reader has already passed takes effect on the next pass.
+//
+// Files queued with enqueue() play on after the open one with no gap. The
+// reader opens and parses the next one as soon as it's queued, and at the
+// end of a file it goes straight on reading the next into the same buffer,
+// so tracks meet on the exact frame and the player never sees the switch.
+// Each file may have its own rate and layout. Seeks and loops act on the
+// file the reader is on, which at a switch runs a pool ahead of the
+// speaker, and a loop ends with its file. Zero-copy playback hands out the
+// mapping itself, so it takes no queue.
+//
+// setSpeed() plays faster or slower with the pitch unchanged: the reader
+// runs its frames through a TimeStretcher, at the stream rate, once the
+// speed first isn't 1, and keeps it in until the next open(). A change of
+// speed is read by the reader, so like a loop it reaches the speaker a
+// pool's worth later, and positions are off by what the stretcher holds,
+// a few tens of milliseconds of the file. Zero-copy playback has no reader
+// in the way and plays at 1; a speed set before open() reads the file
+// instead.
+class PlaybackStream {
+public:
+    enum SourceMode {
+        SOURCE_STREAM,
+        SOURCE_MAPPED,
+    };
+
+    PlaybackStream(int channels, int bufferCount);
+    ~PlaybackStream();
+
+    // opens the source file, prefetches as much of it as the pool holds and
+    // starts the reader thread. framesPerBuffer should be the device burst;
+    // fileChannels is the layout of a raw PCM file, 0 if it matches the
+    // player. WAV and .nfla files bring their own rate and layout; only
+    // 16-bit PCM WAVs play.
+    bool open(const char *path, int framesPerBuffer, SourceMode mode = SOURCE_STREAM,
+              int fileChannels = 0, unsigned long long startFrame = 0);
+    // stops the reader thread; the player must be stopped first
+    void close();
+    // rate of raw PCM files and of the player, used from the next open()
+    void setSampleRates(int fileRate, int streamRate);
+    // the reader resamples at low quality while budget is degraded past
+    // CPU_BUDGET_RESAMPLER_LEVEL; set while closed, NULL for full quality
+    void setBudget(const CpuBudget *budget) { budget_ = budget; }
+
+    // next buffer to enqueue on the player, either for priming or from the
+    // callback. Returns NULL once the whole file has been handed out.
+    const short *nextBuffer(unsigned *bytes);
+    // player callback: the oldest enqueued buffer finished playing
+    void onBufferPlayed();
+    // true once the last buffer of the file has finished playing
+    bool drained() const;
+
+    // not from the callback: plays on from frame of the file, clamped to
+    // its end. False if nothing is open.
+    bool seek(unsigned long long frame);
+    // repeats [start, end) once playback gets to end, until cleared with
+    // end 0; end is clamped to the file. Cleared by open().
+    void setLoop(unsigned long long start, unsigned long long end);
+    // from any thread, STRETCH_MIN_SPEED to STRETCH_MAX_SPEED; kept across
+    // open()s, ignored while zeroCopy()
+    void setSpeed(float speed) { stretcher_.setSpeed(speed); }
+    float speed() const { return stretcher_.speed(); }
+    // the file frame the player has played up to, or the target of a seek
+    // still on its way
+    unsigned long long position() const { return position_.load(std::memory_order_relaxed); }
+    // not from the callback: plays path once everything before it has,
+    // in the open() mode. Fine after the reader has read the last file
+    // out; false in zero-copy mode or once nextBuffer() has returned NULL.
+    bool enqueue(const char *path);
+    // files played to the end before the one playing: 0 for the one
+    // open() was given, then one more for each queued file
+    unsigned track() const { return track_.load(std::memory_order_relaxed); }
+    // of the file the reader is on, and its rate
+    unsigned long long frames() const { return totalFrames_.load(std::memory_order_relaxed); }
+    int fileRate() const { return sourceRate_.load(std::memory_order_relaxed); }
+    // from the last seek() to the callback handing out its first buffer
+    unsigned long long lastSeekLatencyNs() const { return seekLatencyNs_.load(std::memory_order_relaxed); }
+
+    unsigned bufferBytes() const { return samplesPerBuffer_ * sizeof(short); }
+    unsigned underruns() const { return underruns_.load(std::memory_order_relaxed); }
+    // buffers ready ahead of the player: prefetched ones, or in mapped mode
+    // the ones already faulted in
+    unsigned readyBuffers() const;
+    unsigned long long bytesRead() const { return bytesRead_.load(std::memory_order_relaxed); }
+    // true when buffers are enqueued straight from the file mapping
+    bool zeroCopy() const { return direct_; }
+
+private:
+    // what the player queue holds: a pool buffer, MAPPED_SLICE or the
+    // silence buffer, the generation it was read for, and the track and
+    // file frame it plays up to
+    struct InFlight {
+        int index;
+        unsigned generation;
+        unsigned track;
+        unsigned long long end;
+    };
+
+    // a file and its format, the one being read or the next one queued
+    struct Track {
+        FilePcmSource file;
+        MappedPcmSource mapped;
+        LosslessPcmSource lossless;
+        // one of the three, NULL when closed
+        PcmSource *source;
+        // set up at open when the file's rate isn't the stream's
+        Resampler resampler;
+        int channels;
+        int rate;
+        unsigned long long frames;
+
+        Track() : source(NULL), channels(0), rate(0), frames(0) {}
+    };
+
+    void readerLoop();
+    void readAheadLoop();
+    // opens path into track: WAV and .nfla files bring their own rate and
+    // layout, raw PCM has fileChannels and the raw rate
+    bool openTrack(Track *track, const char *path, SourceMode mode, int fileChannels);
+    // the reader reads tracks_[index] from its start
+    void startTrack(int index);
+    void closeTrack(Track *track);
+    // reader: opens the next queued file that opens, unless one already is
+    void prepareNext();
+    // reader: at the end of the file, on to the prepared one. False if
+    // nothing more is queued.
+    bool nextTrack();
+    // fills pool buffer index with the next chunk of the file, and of the
+    // files after it at the end, false at the end of the last one
+    bool fill(int index);
+    // up to maxFrames frames for the player, going on past a loop's end and
+    // into the next file; fewer only at the end of the last one
+    unsigned readTracks(short *dst, unsigned maxFrames);
+    // the same through the stretcher, flushing it with silence at the end
+    unsigned stretch(short *dst, unsigned maxFrames);
+    // reader: the stretcher empty, for a seek or switching it in
+    void resetStretch();
+    // up to maxFrames frames of the file in the player's layout and rate,
+    // fewer only at the end of the file or a loop
+    unsigned readFrames(short *dst, unsigned maxFrames);
+    // reads from the source, counting what was read
+    size_t readSource(void *dst, size_t bytes);
+    // fills dst with up to maxFrames resampled frames, returns how many
+    unsigned resample(short *dst, unsigned maxFrames);
+    bool refillPending();
+    void prefetch();
+    // reader: moves the source for a seek() it hasn't seen yet
+    void applySeek();
+    // reader: the source to frame, counting from there
+    void moveSource(unsigned long long frame);
+    // the file frame the reader has got to, less what the resampler and
+    // the stretcher hold
+    unsigned long long readerFrame() const;
+    // the reader reached the end of the file for generation
+    bool ended(unsigned generation) const;
+    short *buffer(int index) { return &storage_[index * samplesPerBuffer_]; }
+    void pushInFlight(int index, unsigned generation, unsigned track, unsigned long long end);
+    void recycle(int index);
+    const short *nextMappedSlice(unsigned *bytes);
+    // copies a slice of the mapping into a pool buffer to fade it
+    const short *fadedSlice(size_t offset, size_t bytes, bool in);
+    const MappedPcmFile &mapping() const { return tracks_[current_].mapped.file(); }
+    // the loop points, written under queueMutex_ or before the reader runs
+    void storeLoop(unsigned long long start, unsigned long long end);
+    // false if there's no loop
+    bool loop(unsigned long long *start, unsigned long long *end) const;
+
+    const int channels_;
+    const int bufferCount_;
+    int fileChannels_;
+    unsigned framesPerBuffer_;
+    unsigned samplesPerBuffer_;
+    // bufferCount_ pool buffers followed by the silence buffer
+    std::vector<short> storage_;
+    // valid bytes in each pool buffer, the generation it was read for and
+    // the track and file frame it ends at, written by the reader before
+    // publishing
+    std::vector<unsigned> sizes_;
+    std::vector<unsigned> generations_;
+    std::vector<unsigned> trackNumbers_;
+    std::vector<unsigned long long> ends_;
+    // file frames waiting for channel conversion
+    std::vector<short> convertBuffer_;
+
+    int fileRate_;
+    int streamRate_;
+    bool resampling_;
+    // the current track's
+    Resampler *resampler_;
+    const CpuBudget *budget_;
+    // file frames read ahead of the resampler, reader thread only
+    std::vector<short> pending_;
+    size_t pendingHead_;
+    size_t pendingFrames_;
+    // silence still to feed at EOF to flush the filter
+    size_t tailFrames_;
+    // pending_ holds that silence rather than file frames
+    bool pendingSilence_;
+    // the player's frames on their way through the stretcher, reader only
+    TimeStretcher stretcher_;
+    bool stretching_;
+    std::vector<short> stretchIn_;
+    size_t stretchHead_;
+    size_t stretchFrames_;
+    // silence still to feed at the end of the last file, and whether
+    // stretchIn_ holds it
+    size_t stretchTail_;
+    bool stretchSilence_;
+    SpscQueue<int> freeQueue_;  // callback -> reader
+    SpscQueue<int> readyQueue_; // reader -> callback
+
+    // buffers currently owned by the player queue, in enqueue order
+    std::vector<InFlight> inFlight_;
+    unsigned inFlightHead_;
+    unsigned inFlightCount_;
+
+    // the track the reader is on and the one after it; source_ and
+    // fileChannels_ are the current one's. The reader moves them on at a
+    // switch of files, so the control thread only goes by open_ and what
+    // it snapshots under queueMutex_.
+    Track tracks_[2];
+    int current_;
+    PcmSource *source_;
+    SourceMode mode_;
+    // set by open() once everything is in place, cleared first by close()
+    std::atomic<bool> open_;
+    // the other track is open and next to play, reader only
+    bool nextReady_;
+    // files waiting for the reader; the lock also orders enqueue() against
+    // the reader giving up at the end of the last file, and seek() against
+    // it switching files
+    std::mutex queueMutex_;
+    std::deque<std::string> queued_;
+    // what the reader and the player are on, counting from 0 at open()
+    std::atomic<unsigned> readerTrack_;
+    std::atomic<unsigned> track_;
+    bool direct_;
+    // next byte of the mapping to enqueue, advanced by the callback
+    std::atomic<size_t> mapCursor_;
+    // cursor at the last read-ahead wake-up, callback only
+    size_t readAheadWoken_;
+    // end of the faulted-in part of the mapping
+    std::atomic<size_t> faulted_;
+
+    // seek(): the target, and a generation bumped after it's stored
+    std::atomic<unsigned long long> seekFrame_;
+    std::atomic<unsigned> generation_;
+    std::atomic<unsigned long long> seekRequestedNs_;
+    std::atomic<unsigned long long> seekLatencyNs_;
+    // the generation the reader reads for and the callback hands out, and
+    // the last one the callback faded out for
+    unsigned readerGeneration_;
+    unsigned callbackGeneration_;
+    unsigned fadedOut_;
+    // the reader's next buffer starts a generation
+    bool fadeIn_;
+    // next pool buffer for a faded copy of the mapping
+    int fadeBuffer_;
+    // loop points in file frames, end 0 for none, as a seqlock that's odd
+    // while they're being written, so they're only ever read as a pair
+    std::atomic<unsigned> loopSeq_;
+    std::atomic<unsigned long long> loopStart_;
+    std::atomic<unsigned long long> loopEnd_;
+    // reader: bytes into the source's PCM data
+    unsigned long long sourcePos_;
+    // a pool buffer the reader took but found nothing to fill with
+    int held_;
+    std::atomic<int> sourceRate_;
+    std::atomic<unsigned long long> totalFrames_;
+    std::atomic<unsigned long long> position_;
+
+    sem_t spaceAvailable_;
+    std::thread reader_;
+    std::atomic<bool> running_;
+    // how far the end of the last file has got, END_READING to END_TAKEN,
+    // with the generation it was reached for above the two low bits. One
+    // word, so enqueue() and the callback can race for it.
+    std::atomic<unsigned long long> end_;
+    std::atomic<unsigned> underruns_;
+    std::atomic<unsigned long long> bytesRead_;
+};
+
+#endif //NATIVEFEEDBACK_PLAYBACKSTREAM_H
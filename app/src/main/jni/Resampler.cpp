@@ -0,0 +1,301 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "Resampler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RESAMPLER_HAVE_NEON 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RESAMPLER_HAVE_X86 1
+#endif
+
+// passband edge as a fraction of the lower Nyquist frequency, and the
+// Kaiser window shape: ~80 dB stopband over the transition band 48 taps buy
+static const double ROLLOFF = 0.9;
+static const double KAISER_BETA = 8.0;
+// where the low quality taps sit in the full window, so both filters have
+// the same delay
+static const int LOW_OFFSET = (RESAMPLER_TAPS - RESAMPLER_LOW_TAPS) / 2;
+
+// taps is a multiple of 8
+static float dotScalar(const float *a, const float *b, int taps) {
+    float sum = 0;
+    for (int i = 0; i < taps; i++) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+#ifdef RESAMPLER_HAVE_NEON
+static float dotNeon(const float *a, const float *b, int taps) {
+    float32x4_t acc0 = vdupq_n_f32(0);
+    float32x4_t acc1 = vdupq_n_f32(0);
+    for (int i = 0; i < taps; i += 8) {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    float32x4_t acc = vaddq_f32(acc0, acc1);
+#if defined(__aarch64__)
+    return vaddvq_f32(acc);
+#else
+    float32x2_t half = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+    return vget_lane_f32(vpadd_f32(half, half), 0);
+#endif
+}
+#endif
+
+#ifdef RESAMPLER_HAVE_X86
+__attribute__((target("sse")))
+static float dotSse(const float *a, const float *b, int taps) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (int i = 0; i < taps; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 acc = _mm_add_ps(acc0, acc1);
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    return _mm_cvtss_f32(acc);
+}
+
+// built for AVX whatever the baseline is, only called when the CPU has it
+__attribute__((target("avx")))
+static float dotAvx(const float *a, const float *b, int taps) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    int i = 0;
+    for (; i + 16 <= taps; i += 16) {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8),
+                                                 _mm256_loadu_ps(b + i + 8)));
+    }
+    for (; i < taps; i += 8) {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+#endif
+
+// zeroth order modified Bessel function, for the Kaiser window
+static double besselI0(double x) {
+    double sum = 1, term = 1;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2 * k)) * (x / (2 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+// windowed sinc at the upsampled rate, cut at the lower of the two Nyquist
+// frequencies, then split into phases of taps coefficients. The filter is
+// the taps middle ones of a RESAMPLER_TAPS long window starting offset taps
+// in, so every length has the same delay.
+static void design(std::vector<float> *coefs, unsigned phases, unsigned step, int taps,
+                   int offset) {
+    const double center = (RESAMPLER_TAPS * phases - 1) / 2.0;
+    const double halfWidth = (taps * phases + 1) / 2.0;
+    const double cutoff = ROLLOFF * 0.5 / (phases > step ? phases : step);
+    const double norm = besselI0(KAISER_BETA);
+    coefs->assign(taps * phases, 0);
+    for (unsigned p = 0; p < phases; p++) {
+        float *phase = &(*coefs)[p * taps];
+        double sum = 0;
+        for (int k = 0; k < taps; k++) {
+            double t = (k + offset) * static_cast<double>(phases) + p - center;
+            double x = 2 * cutoff * t;
+            double sinc = x == 0 ? 1 : std::sin(M_PI * x) / (M_PI * x);
+            double w = t / halfWidth;
+            double window = besselI0(KAISER_BETA * std::sqrt(std::max(0.0, 1 - w * w))) / norm;
+            double h = sinc * window;
+            phase[taps - 1 - k] = static_cast<float>(h);
+            sum += h;
+        }
+        // unity gain at DC for every phase, so a constant stays constant
+        for (int k = 0; k < taps; k++) {
+            phase[k] = static_cast<float>(phase[k] / sum);
+        }
+    }
+}
+
+static unsigned gcd(unsigned a, unsigned b) {
+    while (b != 0) {
+        unsigned t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static inline short toShort(float v) {
+    v *= 32768.0f;
+    if (v >= 32767.0f) {
+        return 32767;
+    }
+    if (v <= -32768.0f) {
+        return -32768;
+    }
+    return static_cast<short>(v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+Resampler::Resampler()
+        : channels_(0), phases_(1), step_(1), phase_(0), advance_(1), historyPos_(0),
+          quality_(QUALITY_HIGH), kernel_(KERNEL_SCALAR), dot_(dotScalar) {
+    setKernel(bestKernel());
+}
+
+bool Resampler::init(int inRate, int outRate, int channels) {
+    channels_ = 0;
+    if (inRate <= 0 || outRate <= 0 || channels <= 0) {
+        return false;
+    }
+    unsigned g = gcd(inRate, outRate);
+    unsigned phases = outRate / g;
+    unsigned step = inRate / g;
+    if (phases > RESAMPLER_MAX_PHASES) {
+        return false;
+    }
+    phases_ = phases;
+    step_ = step;
+
+    design(&coefs_, phases, step, RESAMPLER_TAPS, 0);
+    design(&lowCoefs_, phases, step, RESAMPLER_LOW_TAPS, LOW_OFFSET);
+
+    history_.assign(channels * 2 * RESAMPLER_TAPS, 0);
+    channels_ = channels;
+    reset();
+    return true;
+}
+
+void Resampler::reset() {
+    std::fill(history_.begin(), history_.end(), 0.0f);
+    historyPos_ = 0;
+    phase_ = 0;
+    advance_ = 1;
+}
+
+void Resampler::push(const short *frame) {
+    historyPos_ = historyPos_ + 1 == RESAMPLER_TAPS ? 0 : historyPos_ + 1;
+    for (int c = 0; c < channels_; c++) {
+        float *h = &history_[c * 2 * RESAMPLER_TAPS];
+        float v = frame[c] * (1.0f / 32768.0f);
+        h[historyPos_] = v;
+        h[historyPos_ + RESAMPLER_TAPS] = v;
+    }
+}
+
+size_t Resampler::process(const short *in, size_t inFrames, size_t *consumed, short *out,
+                          size_t outFrames) {
+    size_t used = 0;
+    size_t written = 0;
+    while (written < outFrames) {
+        while (advance_ > 0 && used < inFrames) {
+            push(in + used * channels_);
+            used++;
+            advance_--;
+        }
+        if (advance_ > 0) {
+            break;
+        }
+        // the low quality filter is the middle of the window, on the same
+        // history, so switching mid-stream doesn't disturb the signal
+        const bool low = quality_ == QUALITY_LOW;
+        const int taps = low ? RESAMPLER_LOW_TAPS : RESAMPLER_TAPS;
+        const float *coefs = low ? &lowCoefs_[phase_ * taps] : &coefs_[phase_ * taps];
+        const unsigned offset = historyPos_ + 1 + (low ? LOW_OFFSET : 0);
+        for (int c = 0; c < channels_; c++) {
+            const float *window = &history_[c * 2 * RESAMPLER_TAPS + offset];
+            out[written * channels_ + c] = toShort(dot_(window, coefs, taps));
+        }
+        written++;
+        // step_ is at most a few times phases_, cheaper than dividing
+        phase_ += step_;
+        while (phase_ >= phases_) {
+            phase_ -= phases_;
+            advance_++;
+        }
+    }
+    *consumed = used;
+    return written;
+}
+
+size_t Resampler::outputFramesFor(size_t inFrames) const {
+    return (inFrames * phases_ + step_ - 1) / step_ + 1;
+}
+
+bool Resampler::kernelSupported(Kernel kernel) {
+    switch (kernel) {
+        case KERNEL_SCALAR:
+            return true;
+#ifdef RESAMPLER_HAVE_X86
+        case KERNEL_SSE:
+            return __builtin_cpu_supports("sse");
+        case KERNEL_AVX:
+            return __builtin_cpu_supports("avx");
+#endif
+#ifdef RESAMPLER_HAVE_NEON
+        case KERNEL_NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+Resampler::Kernel Resampler::bestKernel() {
+    static const Kernel preference[] = {KERNEL_NEON, KERNEL_AVX, KERNEL_SSE};
+    for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); i++) {
+        if (kernelSupported(preference[i])) {
+            return preference[i];
+        }
+    }
+    return KERNEL_SCALAR;
+}
+
+bool Resampler::setKernel(Kernel kernel) {
+    if (!kernelSupported(kernel)) {
+        return false;
+    }
+    switch (kernel) {
+#ifdef RESAMPLER_HAVE_X86
+        case KERNEL_SSE:
+            dot_ = dotSse;
+            break;
+        case KERNEL_AVX:
+            dot_ = dotAvx;
+            break;
+#endif
+#ifdef RESAMPLER_HAVE_NEON
+        case KERNEL_NEON:
+            dot_ = dotNeon;
+            break;
+#endif
+        default:
+            dot_ = dotScalar;
+            break;
+    }
+    kernel_ = kernel;
+    return true;
+}
+
+const char *Resampler::kernelName(Kernel kernel) {
+    switch (kernel) {
+        case KERNEL_SSE:
+            return "sse";
+        case KERNEL_AVX:
+            return "avx";
+        case KERNEL_NEON:
+            return "neon";
+        default:
+            return "scalar";
+    }
+}
@@ -0,0 +1,101 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_RESAMPLER_H
+#define NATIVEFEEDBACK_RESAMPLER_H
+
+#include <cstddef>
+#include <vector>
+
+// Streaming polyphase sample rate converter for 16-bit interleaved PCM.
+//
+// The ratio outRate/inRate is reduced to L/M and a windowed-sinc prototype
+// filter is split into L phases of RESAMPLER_TAPS coefficients each. Every
+// output frame is one dot product of a phase against the last
+// RESAMPLER_TAPS input frames, which is the part the SIMD kernels do. All
+// memory is allocated by init(); process() can run on the audio thread and
+// may be fed and drained in chunks of any size.
+//
+// QUALITY_LOW trades the stopband for half the work: a filter of
+// RESAMPLER_LOW_TAPS taps with the same delay, over the middle of the same
+// history, so the quality can change between any two process() calls
+// without a click or a shift in time.
+#define RESAMPLER_TAPS 48
+#define RESAMPLER_LOW_TAPS 24
+// largest L accepted, which bounds the coefficient table to
+// RESAMPLER_MAX_PHASES * RESAMPLER_TAPS floats
+#define RESAMPLER_MAX_PHASES 1024
+
+class Resampler {
+public:
+    enum Kernel {
+        KERNEL_SCALAR,
+        KERNEL_SSE,
+        KERNEL_AVX,
+        KERNEL_NEON,
+    };
+
+    enum Quality {
+        QUALITY_HIGH,
+        QUALITY_LOW,
+    };
+
+    Resampler();
+
+    // builds the filter for inRate -> outRate. Fails for ratios that would
+    // need more than RESAMPLER_MAX_PHASES phases.
+    bool init(int inRate, int outRate, int channels);
+    // clears the history, as if no input had been seen
+    void reset();
+
+    // converts up to inFrames of in into at most outFrames of out. Returns
+    // the frames written and sets *consumed to the input frames used; input
+    // not consumed has to be passed again on the next call.
+    size_t process(const short *in, size_t inFrames, size_t *consumed, short *out,
+                   size_t outFrames);
+
+    // output frames inFrames of input can produce, rounded up
+    size_t outputFramesFor(size_t inFrames) const;
+    // input frames of delay through the filter; feeding that much silence at
+    // the end flushes the tail of the signal out
+    size_t latencyFrames() const { return RESAMPLER_TAPS / 2; }
+    bool active() const { return channels_ > 0; }
+
+    // from the thread calling process(), any time; init() builds both filters
+    void setQuality(Quality quality) { quality_ = quality; }
+    Quality quality() const { return quality_; }
+
+    Kernel kernel() const { return kernel_; }
+    // overrides the kernel picked from the CPU, false if it can't run here
+    bool setKernel(Kernel kernel);
+    static Kernel bestKernel();
+    static bool kernelSupported(Kernel kernel);
+    static const char *kernelName(Kernel kernel);
+
+private:
+    typedef float (*DotFn)(const float *a, const float *b, int taps);
+
+    void push(const short *frame);
+
+    int channels_;
+    unsigned phases_; // L
+    unsigned step_;   // M
+    unsigned phase_;
+    // input frames to push before the next output frame
+    unsigned advance_;
+    // L phases of RESAMPLER_TAPS, each reversed so it lines up with the
+    // history in time order
+    std::vector<float> coefs_;
+    // the same for QUALITY_LOW, RESAMPLER_LOW_TAPS each
+    std::vector<float> lowCoefs_;
+    // per channel, every frame is written twice RESAMPLER_TAPS apart so the
+    // last RESAMPLER_TAPS frames are always contiguous after historyPos_
+    std::vector<float> history_;
+    unsigned historyPos_;
+    Quality quality_;
+    Kernel kernel_;
+    DotFn dot_;
+};
+
+#endif //NATIVEFEEDBACK_RESAMPLER_H
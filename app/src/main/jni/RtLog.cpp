@@ -0,0 +1,168 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "RtLog.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#endif
+
+#include "AudioStats.h"
+
+namespace {
+
+const unsigned RING_SIZE = 1024; // power of two
+const int FLUSH_INTERVAL_MS = 20;
+
+struct Record {
+    // for the writer at position p (lap p / RING_SIZE) the slot is free when
+    // turn == 2 * lap and holds a published record when turn == 2 * lap + 1.
+    // Zero initialised memory is an empty ring, so nothing needs setting up
+    // before the first write.
+    std::atomic<size_t> turn;
+    unsigned long long timestampNs;
+    const char *tag;
+    const char *format;
+    int level;
+    long long args[4];
+};
+
+Record ring[RING_SIZE];
+std::atomic<size_t> writePosition(0);
+size_t readPosition = 0;
+std::atomic<unsigned long long> droppedRecords(0);
+unsigned long long reportedDrops = 0;
+
+// start/stop and the flush side, never touched by the audio threads
+std::mutex flusherLock;
+int flusherUsers = 0;
+bool flusherRunning = false;
+std::thread flusher;
+RtLog::Sink sink = NULL;
+
+size_t lap(size_t position) {
+    return position / RING_SIZE;
+}
+
+void output(int level, const char *tag, const char *text) {
+    if (sink != NULL) {
+        sink(level, tag, text);
+        return;
+    }
+#ifdef __ANDROID__
+    static const int priorities[] = {ANDROID_LOG_DEBUG, ANDROID_LOG_INFO, ANDROID_LOG_WARN,
+                                     ANDROID_LOG_ERROR};
+    __android_log_write(priorities[level], tag, text);
+#else
+    static const char levels[] = {'D', 'I', 'W', 'E'};
+    fprintf(stderr, "%c/%s: %s\n", levels[level], tag, text);
+#endif
+}
+
+// single consumer, called with flusherLock held
+void drain() {
+    char text[256];
+    for (;;) {
+        Record &record = ring[readPosition & (RING_SIZE - 1)];
+        size_t turn = 2 * lap(readPosition);
+        if (record.turn.load(std::memory_order_acquire) != turn + 1) {
+            break;
+        }
+        // records are formatted late, so lead with the time they were written
+        int n = snprintf(text, sizeof(text), "[%llu.%06llu] ",
+                         record.timestampNs / 1000000000ULL,
+                         record.timestampNs / 1000ULL % 1000000ULL);
+        snprintf(text + n, sizeof(text) - n, record.format, record.args[0], record.args[1],
+                 record.args[2], record.args[3]);
+        output(record.level, record.tag, text);
+        record.turn.store(turn + 2, std::memory_order_release);
+        readPosition++;
+    }
+    unsigned long long drops = droppedRecords.load(std::memory_order_relaxed);
+    if (drops != reportedDrops) {
+        snprintf(text, sizeof(text), "dropped %llu log records", drops - reportedDrops);
+        output(RTLOG_LEVEL_WARN, "RtLog", text);
+        reportedDrops = drops;
+    }
+}
+
+void flusherLoop() {
+    std::unique_lock<std::mutex> lock(flusherLock);
+    while (flusherRunning) {
+        drain();
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::milliseconds(FLUSH_INTERVAL_MS));
+        lock.lock();
+    }
+    drain();
+}
+
+} // namespace
+
+void RtLog::push(int level, const char *tag, const char *format, const long long *args,
+                 int count) {
+    size_t position = writePosition.load(std::memory_order_relaxed);
+    Record *record;
+    for (;;) {
+        record = &ring[position & (RING_SIZE - 1)];
+        size_t turn = record->turn.load(std::memory_order_acquire);
+        if (turn == 2 * lap(position)) {
+            if (writePosition.compare_exchange_weak(position, position + 1,
+                                                    std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (turn < 2 * lap(position)) {
+            // full: the flusher hasn't caught up, drop rather than wait
+            droppedRecords.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            position = writePosition.load(std::memory_order_relaxed);
+        }
+    }
+    record->timestampNs = CallbackStats::nowNs();
+    record->tag = tag;
+    record->format = format;
+    record->level = level;
+    for (int i = 0; i < 4; i++) {
+        record->args[i] = i < count ? args[i] : 0;
+    }
+    record->turn.store(2 * lap(position) + 1, std::memory_order_release);
+}
+
+void RtLog::setSink(Sink newSink) {
+    std::lock_guard<std::mutex> lock(flusherLock);
+    sink = newSink;
+}
+
+void RtLog::start() {
+    std::lock_guard<std::mutex> lock(flusherLock);
+    if (flusherUsers++ == 0) {
+        flusherRunning = true;
+        flusher = std::thread(flusherLoop);
+    }
+}
+
+void RtLog::stop() {
+    std::unique_lock<std::mutex> lock(flusherLock);
+    if (flusherUsers == 0 || --flusherUsers > 0) {
+        return;
+    }
+    flusherRunning = false;
+    lock.unlock();
+    flusher.join();
+}
+
+void RtLog::flush() {
+    std::lock_guard<std::mutex> lock(flusherLock);
+    drain();
+}
+
+unsigned long long RtLog::dropped() {
+    return droppedRecords.load(std::memory_order_relaxed);
+}
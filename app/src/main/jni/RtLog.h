@@ -0,0 +1,84 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_RTLOG_H
+#define NATIVEFEEDBACK_RTLOG_H
+
+// Logging that is safe to call from the audio callbacks.
+//
+// RTLOGD/I/W/E copy a fixed-format record (a string literal plus up to four
+// integer arguments) into a preallocated lock-free ring; a background thread
+// formats the records and hands them to logcat, or stderr on the host, so the
+// callback never waits on logd. The format string must be a literal and its
+// conversions must take long long (%lld, %llx). When the ring is full the
+// record is dropped and counted.
+//
+// Levels below RTLOG_LEVEL compile to nothing. It defaults to INFO in release
+// builds and DEBUG otherwise; define it before including to override.
+
+#define RTLOG_LEVEL_DEBUG 0
+#define RTLOG_LEVEL_INFO 1
+#define RTLOG_LEVEL_WARN 2
+#define RTLOG_LEVEL_ERROR 3
+#define RTLOG_LEVEL_NONE 4
+
+#ifndef RTLOG_LEVEL
+#ifdef NDEBUG
+#define RTLOG_LEVEL RTLOG_LEVEL_INFO
+#else
+#define RTLOG_LEVEL RTLOG_LEVEL_DEBUG
+#endif
+#endif
+
+class RtLog {
+public:
+    typedef void (*Sink)(int level, const char *tag, const char *text);
+
+    // replaces logcat/stderr as the destination of formatted records,
+    // NULL restores it
+    static void setSink(Sink sink);
+    // the flusher thread runs while at least one user has started it
+    static void start();
+    static void stop();
+    // formats and outputs everything queued so far on the calling thread
+    static void flush();
+    static unsigned long long dropped();
+
+    template <typename... Args>
+    static void write(int level, const char *tag, const char *format, Args... args) {
+        static_assert(sizeof...(Args) <= 4, "RtLog records hold at most 4 arguments");
+        long long values[] = {static_cast<long long>(args)..., 0};
+        push(level, tag, format, values, sizeof...(Args));
+    }
+
+private:
+    static void push(int level, const char *tag, const char *format, const long long *args,
+                     int count);
+};
+
+#if RTLOG_LEVEL <= RTLOG_LEVEL_DEBUG
+#define RTLOGD(...) RtLog::write(RTLOG_LEVEL_DEBUG, LOG_TAG, __VA_ARGS__)
+#else
+#define RTLOGD(...) ((void) 0)
+#endif
+
+#if RTLOG_LEVEL <= RTLOG_LEVEL_INFO
+#define RTLOGI(...) RtLog::write(RTLOG_LEVEL_INFO, LOG_TAG, __VA_ARGS__)
+#else
+#define RTLOGI(...) ((void) 0)
+#endif
+
+#if RTLOG_LEVEL <= RTLOG_LEVEL_WARN
+#define RTLOGW(...) RtLog::write(RTLOG_LEVEL_WARN, LOG_TAG, __VA_ARGS__)
+#else
+#define RTLOGW(...) ((void) 0)
+#endif
+
+#if RTLOG_LEVEL <= RTLOG_LEVEL_ERROR
+#define RTLOGE(...) RtLog::write(RTLOG_LEVEL_ERROR, LOG_TAG, __VA_ARGS__)
+#else
+#define RTLOGE(...) ((void) 0)
+#endif
+
+#endif //NATIVEFEEDBACK_RTLOG_H
@@ -0,0 +1,73 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "SharedPcmRing.h"
+
+#include <cstring>
+
+SharedPcmRing::SharedPcmRing() : memory_(NULL), data_(NULL), mask_(0) {}
+
+size_t SharedPcmRing::attach(void *memory, size_t bytes) {
+    detach();
+    // the header is read as 32-bit atomics from both sides
+    if (memory == NULL || reinterpret_cast<uintptr_t>(memory) % sizeof(uint32_t) != 0
+        || bytes <= HEADER_BYTES) {
+        return 0;
+    }
+    size_t capacity = 1;
+    while (capacity * 2 <= bytes - HEADER_BYTES && capacity * 2 <= 0x80000000u) {
+        capacity *= 2;
+    }
+    memory_ = static_cast<unsigned char *>(memory);
+    memset(memory_, 0, HEADER_BYTES);
+    field(CAPACITY_OFFSET)->store(static_cast<uint32_t>(capacity), std::memory_order_relaxed);
+    mask_ = static_cast<uint32_t>(capacity - 1);
+    data_ = memory_ + HEADER_BYTES;
+    std::atomic_thread_fence(std::memory_order_release);
+    return capacity;
+}
+
+void SharedPcmRing::detach() {
+    memory_ = NULL;
+    data_ = NULL;
+    mask_ = 0;
+}
+
+bool SharedPcmRing::write(const void *data, size_t bytes) {
+    uint32_t writePos = field(WRITE_OFFSET)->load(std::memory_order_relaxed);
+    uint32_t readPos = field(READ_OFFSET)->load(std::memory_order_acquire);
+    if (bytes > capacity() - static_cast<uint32_t>(writePos - readPos)) {
+        field(DROPPED_OFFSET)->fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    size_t offset = writePos & mask_;
+    size_t first = bytes < capacity() - offset ? bytes : capacity() - offset;
+    memcpy(data_ + offset, data, first);
+    memcpy(data_, static_cast<const unsigned char *>(data) + first, bytes - first);
+    field(WRITE_OFFSET)->store(writePos + static_cast<uint32_t>(bytes), std::memory_order_release);
+    return true;
+}
+
+size_t SharedPcmRing::read(void *data, size_t bytes) {
+    uint32_t readPos = field(READ_OFFSET)->load(std::memory_order_relaxed);
+    uint32_t writePos = field(WRITE_OFFSET)->load(std::memory_order_acquire);
+    size_t n = writePos - readPos;
+    if (n > bytes) {
+        n = bytes;
+    }
+    size_t offset = readPos & mask_;
+    size_t first = n < capacity() - offset ? n : capacity() - offset;
+    memcpy(data, data_ + offset, first);
+    memcpy(static_cast<unsigned char *>(data) + first, data_, n - first);
+    field(READ_OFFSET)->store(readPos + static_cast<uint32_t>(n), std::memory_order_release);
+    return n;
+}
+
+size_t SharedPcmRing::available() const {
+    return field(WRITE_OFFSET)->load(std::memory_order_acquire)
+           - field(READ_OFFSET)->load(std::memory_order_acquire);
+}
+
+uint32_t SharedPcmRing::dropped() const {
+    return field(DROPPED_OFFSET)->load(std::memory_order_relaxed);
+}
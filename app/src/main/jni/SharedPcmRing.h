@@ -0,0 +1,64 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_SHAREDPCMRING_H
+#define NATIVEFEEDBACK_SHAREDPCMRING_H
+
+#include <stdint.h>
+
+#include <atomic>
+#include <cstddef>
+
+// Single-producer/single-consumer byte ring laid out in memory the other
+// side can see too, here a direct ByteBuffer shared with Java.
+//
+// Layout, native byte order, offsets in bytes:
+//      0  uint32 write position, advanced by the producer (native)
+//     64  uint32 read position, advanced by the consumer (Java)
+//    128  uint32 capacity of the data area, a power of two
+//    132  uint32 chunks dropped because the consumer fell behind
+//    192  data
+// Positions count bytes from the start and wrap at 2^32; the data for
+// position p is at 192 + (p & (capacity - 1)). The consumer reads the write
+// position with acquire semantics (VarHandle getAcquire, or a volatile read
+// behind a fence), copies out write - read bytes and publishes the new read
+// position with release semantics. The producer only ever writes whole
+// chunks, so a chunk is never split by an overrun.
+class SharedPcmRing {
+public:
+    static const size_t WRITE_OFFSET = 0;
+    static const size_t READ_OFFSET = 64;
+    static const size_t CAPACITY_OFFSET = 128;
+    static const size_t DROPPED_OFFSET = 132;
+    static const size_t HEADER_BYTES = 192;
+
+    SharedPcmRing();
+
+    // lays the ring out over memory, resetting both positions. Returns the
+    // data capacity, 0 if bytes can't hold the header and some data.
+    size_t attach(void *memory, size_t bytes);
+    void detach();
+
+    // producer: appends the whole chunk or, if it doesn't fit, drops it and
+    // counts it. Never blocks.
+    bool write(const void *data, size_t bytes);
+    // consumer: what Java does, for native readers and tests
+    size_t read(void *data, size_t bytes);
+
+    size_t available() const;
+    size_t capacity() const { return mask_ + 1; }
+    uint32_t dropped() const;
+    bool attached() const { return data_ != NULL; }
+
+private:
+    std::atomic<uint32_t> *field(size_t offset) const {
+        return reinterpret_cast<std::atomic<uint32_t> *>(memory_ + offset);
+    }
+
+    unsigned char *memory_;
+    unsigned char *data_;
+    uint32_t mask_;
+};
+
+#endif //NATIVEFEEDBACK_SHAREDPCMRING_H
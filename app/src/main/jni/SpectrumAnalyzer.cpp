@@ -0,0 +1,278 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "SpectrumAnalyzer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "AudioThreads.h"
+
+// the ring holds this many windows, so the worker can be a few hops late
+// before it has to skip
+static const unsigned RING_WINDOWS = 4;
+// how often read() retries a torn copy before giving up
+static const int READ_ATTEMPTS = 100;
+
+static float toDb(double linear) {
+    return linear > 0 ? std::max(SPECTRUM_FLOOR_DB, static_cast<float>(20 * log10(linear)))
+                      : SPECTRUM_FLOOR_DB;
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer()
+        : memory_(NULL),
+          sampleRate_(0),
+          channels_(1),
+          fftSize_(0),
+          budget_(NULL),
+          ringMask_(0),
+          written_(0),
+          active_(false),
+          feeding_(false),
+          stopping_(false),
+          size_(0),
+          hop_(0),
+          analysed_(0),
+          skipped_(0),
+          peakDb_(SPECTRUM_FLOOR_DB),
+          rmsDb_(SPECTRUM_FLOOR_DB) {
+    sem_init(&dataReady_, 0, 0);
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer() {
+    stop();
+    sem_destroy(&dataReady_);
+}
+
+size_t SpectrumAnalyzer::bytesFor(unsigned fftSize) {
+    if (fftSize < SPECTRUM_MIN_FFT_SIZE || fftSize > SPECTRUM_MAX_FFT_SIZE
+        || (fftSize & (fftSize - 1)) != 0) {
+        return 0;
+    }
+    return HEADER_BYTES + (fftSize / 2 + 1) * sizeof(float);
+}
+
+bool SpectrumAnalyzer::start(void *memory, size_t bytes, int sampleRate, int channels,
+                             unsigned fftSize) {
+    stop();
+    size_t needed = bytesFor(fftSize);
+    if (memory == NULL || needed == 0 || bytes < needed || sampleRate <= 0 || channels <= 0
+        || !fft_.init(fftSize)) {
+        return false;
+    }
+    memory_ = static_cast<unsigned char *>(memory);
+    sampleRate_ = sampleRate;
+    channels_ = channels;
+    fftSize_ = fftSize;
+
+    ring_.assign(static_cast<size_t>(RING_WINDOWS) * fftSize * channels, 0);
+    ringMask_ = RING_WINDOWS * fftSize - 1;
+    // room for the full size, so shrinking and growing back only
+    // reallocates the FFT's own tables
+    frames_.reserve(fftSize * channels);
+    window_.reserve(fftSize);
+    hann_.reserve(fftSize);
+    re_.reserve(fft_.bins());
+    im_.reserve(fft_.bins());
+    resize(fftSize);
+
+    field(SEQUENCE_OFFSET)->store(0, std::memory_order_relaxed);
+    field(RATE_OFFSET)->store(static_cast<uint32_t>(sampleRate), std::memory_order_relaxed);
+    peakDb_ = SPECTRUM_FLOOR_DB;
+    rmsDb_ = SPECTRUM_FLOOR_DB;
+    std::fill(re_.begin(), re_.end(), SPECTRUM_FLOOR_DB);
+    analysed_ = 0;
+    skipped_ = 0;
+    publish(0);
+    // nothing's been analysed yet: back to 0 so read() says so
+    field(SEQUENCE_OFFSET)->store(0, std::memory_order_release);
+
+    written_.store(0, std::memory_order_relaxed);
+    stopping_.store(false, std::memory_order_relaxed);
+    worker_ = std::thread(&SpectrumAnalyzer::workerLoop, this);
+    active_.store(true, std::memory_order_seq_cst);
+    return true;
+}
+
+void SpectrumAnalyzer::stop() {
+    if (!worker_.joinable()) {
+        return;
+    }
+    // a feed() that saw the analyzer active is still copying; the two
+    // seq_cst pairs make sure one of them sees the other
+    active_.store(false, std::memory_order_seq_cst);
+    while (feeding_.load(std::memory_order_seq_cst)) {
+        std::this_thread::yield();
+    }
+    stopping_.store(true, std::memory_order_release);
+    sem_post(&dataReady_);
+    worker_.join();
+    memory_ = NULL;
+}
+
+void SpectrumAnalyzer::feed(const short *samples, size_t frames) {
+    feeding_.store(true, std::memory_order_seq_cst);
+    if (active_.load(std::memory_order_seq_cst)) {
+        unsigned long long written = written_.load(std::memory_order_relaxed);
+        size_t ringFrames = ringMask_ + 1;
+        while (frames > 0) {
+            // at most a window at a time, which is the margin the worker
+            // leaves for a copy in progress
+            size_t n = std::min<size_t>(frames, fftSize_);
+            size_t at = static_cast<size_t>(written & ringMask_);
+            size_t first = std::min(n, ringFrames - at);
+            memcpy(&ring_[at * channels_], samples, first * channels_ * sizeof(short));
+            memcpy(&ring_[0], samples + first * channels_, (n - first) * channels_ * sizeof(short));
+            written += n;
+            written_.store(written, std::memory_order_release);
+            samples += n * channels_;
+            frames -= n;
+        }
+        sem_post(&dataReady_);
+    }
+    feeding_.store(false, std::memory_order_release);
+}
+
+void SpectrumAnalyzer::resize(unsigned size) {
+    if (fft_.bins() != size / 2 + 1) {
+        fft_.init(size);
+    }
+    size_ = size;
+    hop_ = size / 2;
+    frames_.resize(size * channels_);
+    window_.resize(size);
+    hann_.resize(size);
+    for (unsigned i = 0; i < size; i++) {
+        hann_[i] = static_cast<float>(0.5 - 0.5 * cos(2 * M_PI * i / size));
+    }
+    re_.resize(fft_.bins());
+    im_.resize(fft_.bins());
+}
+
+void SpectrumAnalyzer::workerLoop() {
+    AudioThreads::enter(THREAD_ANALYSIS);
+    unsigned long long ringFrames = ringMask_ + 1;
+    for (;;) {
+        sem_wait(&dataReady_);
+        if (stopping_.load(std::memory_order_acquire)) {
+            break;
+        }
+        if (budget_ != NULL) {
+            unsigned size = std::max<unsigned>(fftSize_ >> budget_->level(), SPECTRUM_MIN_FFT_SIZE);
+            if (size != size_) {
+                resize(size);
+            }
+        }
+        unsigned long long written = written_.load(std::memory_order_acquire);
+        while (written - analysed_ >= hop_) {
+            unsigned long long end = analysed_ + hop_;
+            if (written - end > ringFrames - 2 * fftSize_) {
+                // too far behind: the newest whole hop, the rest is skipped
+                unsigned long long newest = analysed_ + (written - analysed_) / hop_ * hop_;
+                skipped_ += static_cast<uint32_t>((newest - end) / hop_);
+                end = newest;
+            }
+            if (analyze(end)) {
+                publish(end);
+            } else {
+                skipped_++;
+            }
+            analysed_ = end;
+        }
+    }
+}
+
+bool SpectrumAnalyzer::analyze(unsigned long long end) {
+    // before the first window fills, the frames ahead of the start are the
+    // ring's initial zeros
+    unsigned long long start = end - size_;
+    size_t ringFrames = ringMask_ + 1;
+    size_t at = static_cast<size_t>(start & ringMask_);
+    size_t first = std::min<size_t>(size_, ringFrames - at);
+    memcpy(&frames_[0], &ring_[at * channels_], first * channels_ * sizeof(short));
+    memcpy(&frames_[first * channels_], &ring_[0], (size_ - first) * channels_ * sizeof(short));
+    // the copy has to come before the check, like a seqlock reader
+    std::atomic_thread_fence(std::memory_order_acquire);
+    unsigned long long written = written_.load(std::memory_order_relaxed);
+    if (written - start > ringFrames - fftSize_) {
+        return false;
+    }
+
+    // levels of the hop that's new since the last window
+    int peak = 0;
+    double sumSquares = 0;
+    for (size_t i = (size_ - hop_) * channels_; i < frames_.size(); i++) {
+        int v = frames_[i];
+        peak = std::max(peak, v < 0 ? -v : v);
+        sumSquares += static_cast<double>(v) * v;
+    }
+    peakDb_ = toDb(peak / 32768.0);
+    rmsDb_ = toDb(sqrt(sumSquares / (hop_ * channels_)) / 32768.0);
+
+    const float scale = 1.0f / (32768.0f * channels_);
+    for (unsigned i = 0; i < size_; i++) {
+        int sum = 0;
+        for (int c = 0; c < channels_; c++) {
+            sum += frames_[i * channels_ + c];
+        }
+        window_[i] = sum * scale * hann_[i];
+    }
+    fft_.forward(&window_[0], &re_[0], &im_[0]);
+    // a full scale sine reads 0 dBFS: the Hann window sums to fftSize / 2
+    // and a real sine splits its power between two bins
+    const float norm = 4.0f / size_;
+    for (size_t k = 0; k < re_.size(); k++) {
+        re_[k] = toDb(norm * sqrt(re_[k] * re_[k] + im_[k] * im_[k]));
+    }
+    return true;
+}
+
+void SpectrumAnalyzer::publish(unsigned long long end) {
+    std::atomic<uint32_t> *sequence = field(SEQUENCE_OFFSET);
+    uint32_t s = sequence->load(std::memory_order_relaxed);
+    sequence->store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    field(BINS_OFFSET)->store(static_cast<uint32_t>(re_.size()), std::memory_order_relaxed);
+    field(FFT_SIZE_OFFSET)->store(size_, std::memory_order_relaxed);
+    field(SKIPPED_OFFSET)->store(skipped_, std::memory_order_relaxed);
+    memcpy(memory_ + PEAK_OFFSET, &peakDb_, sizeof(float));
+    memcpy(memory_ + RMS_OFFSET, &rmsDb_, sizeof(float));
+    field(FRAMES_OFFSET)->store(static_cast<uint32_t>(end), std::memory_order_relaxed);
+    memcpy(memory_ + HEADER_BYTES, &re_[0], re_.size() * sizeof(float));
+    sequence->store(s + 2, std::memory_order_release);
+}
+
+bool SpectrumAnalyzer::read(SpectrumLevels *levels, float *bins) const {
+    if (memory_ == NULL) {
+        return false;
+    }
+    const std::atomic<uint32_t> *sequence = field(SEQUENCE_OFFSET);
+    for (int attempt = 0; attempt < READ_ATTEMPTS; attempt++) {
+        uint32_t before = sequence->load(std::memory_order_acquire);
+        if (before == 0) {
+            return false;
+        }
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        SpectrumLevels copy;
+        memcpy(&copy.peakDb, memory_ + PEAK_OFFSET, sizeof(float));
+        memcpy(&copy.rmsDb, memory_ + RMS_OFFSET, sizeof(float));
+        copy.frames = field(FRAMES_OFFSET)->load(std::memory_order_relaxed);
+        copy.skipped = field(SKIPPED_OFFSET)->load(std::memory_order_relaxed);
+        copy.updates = before / 2;
+        // the size can shrink under a busy CPU: the count goes with this update
+        copy.bins = std::min<uint32_t>(field(BINS_OFFSET)->load(std::memory_order_relaxed), fftSize_ / 2 + 1);
+        if (bins != NULL) {
+            memcpy(bins, memory_ + HEADER_BYTES, copy.bins * sizeof(float));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (sequence->load(std::memory_order_relaxed) == before) {
+            *levels = copy;
+            return true;
+        }
+    }
+    return false;
+}
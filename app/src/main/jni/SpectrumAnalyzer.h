@@ -0,0 +1,161 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_SPECTRUMANALYZER_H
+#define NATIVEFEEDBACK_SPECTRUMANALYZER_H
+
+#include <semaphore.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "CpuBudget.h"
+#include "Fft.h"
+
+#define SPECTRUM_MIN_FFT_SIZE 64
+#define SPECTRUM_MAX_FFT_SIZE 16384
+// what silence reads as, in dBFS
+#define SPECTRUM_FLOOR_DB -120.0f
+
+// one update of a SpectrumAnalyzer, as read back by read()
+struct SpectrumLevels {
+    // dBFS over every channel of the newest fftSize / 2 frames
+    float peakDb;
+    float rmsDb;
+    // frames analysed since start(), wrapping at 2^32
+    uint32_t frames;
+    uint32_t skipped;
+    // updates since start()
+    uint32_t updates;
+    // bins in this update, fewer than bins() while the CPU budget has the
+    // FFT size down
+    uint32_t bins;
+};
+
+// Level meter and spectrum analyzer tapped off an audio callback, publishing
+// into memory the other side can see, here a direct ByteBuffer Java reads at
+// display rate without a JNI call or a copy.
+//
+// The callback side, feed(), only copies the burst into a ring and wakes the
+// worker thread, the same work for every burst. The worker takes a window of
+// fftSize frames every fftSize / 2, Hann windows the mono downmix, runs a
+// RealFft and publishes the magnitudes along with the peak and RMS of the
+// fftSize / 2 frames that are new in the window. If it falls behind it skips
+// to the newest window and counts the ones it missed.
+//
+// With a CpuBudget set, the worker halves the FFT for every level the
+// budget is degraded by, down to SPECTRUM_MIN_FFT_SIZE, and grows it back
+// as the level drops. The bins and fft size fields change with it, inside
+// the update that first uses the new size, so a reader always gets the
+// size that goes with the bins it copied.
+//
+// Layout, native byte order, offsets in bytes:
+//      0  uint32 sequence, odd while an update is being written
+//      4  uint32 bins, fftSize / 2 + 1 of the size in use
+//      8  uint32 sample rate
+//     12  uint32 fft size in use, at most start()'s
+//     16  uint32 windows skipped because the worker fell behind
+//     20  float  peak, dBFS
+//     24  float  RMS, dBFS
+//     28  uint32 frames analysed, wrapping at 2^32
+//     32  float  magnitude of each bin, dBFS, bin k at k * rate / fftSize Hz
+// It's a seqlock: the reader reads the sequence with acquire semantics
+// (VarHandle getAcquire), retries while it's odd, copies what it needs,
+// issues an acquire fence (VarHandle.acquireFence) and reads the sequence
+// again; if it moved, the copy may be torn and the reader tries again. The
+// sequence divided by two counts updates.
+class SpectrumAnalyzer {
+public:
+    static const size_t SEQUENCE_OFFSET = 0;
+    static const size_t BINS_OFFSET = 4;
+    static const size_t RATE_OFFSET = 8;
+    static const size_t FFT_SIZE_OFFSET = 12;
+    static const size_t SKIPPED_OFFSET = 16;
+    static const size_t PEAK_OFFSET = 20;
+    static const size_t RMS_OFFSET = 24;
+    static const size_t FRAMES_OFFSET = 28;
+    static const size_t HEADER_BYTES = 32;
+
+    SpectrumAnalyzer();
+    ~SpectrumAnalyzer();
+
+    // memory needed for fftSize, 0 if it isn't a power of two between
+    // SPECTRUM_MIN_FFT_SIZE and SPECTRUM_MAX_FFT_SIZE
+    static size_t bytesFor(unsigned fftSize);
+
+    // lays the layout out over memory and starts the worker; the memory has
+    // to stay valid until stop(). Restarts if already running.
+    bool start(void *memory, size_t bytes, int sampleRate, int channels, unsigned fftSize);
+    // returns once the worker and any feed() under way are done with memory
+    void stop();
+    bool running() const { return active_.load(std::memory_order_acquire); }
+    // polled by the worker; set while stopped, NULL for the full size always
+    void setBudget(const CpuBudget *budget) { budget_ = budget; }
+
+    // audio callback: frames of interleaved PCM of start()'s channels. Never
+    // blocks or allocates; does nothing unless running.
+    void feed(const short *samples, size_t frames);
+
+    // the seqlock read, as Java does it: copies the latest update; bins may
+    // be NULL or hold bins() floats. False before the first update, or if
+    // the writer kept it busy.
+    bool read(SpectrumLevels *levels, float *bins) const;
+    // for start()'s size, the most an update has
+    unsigned bins() const { return fftSize_ / 2 + 1; }
+
+private:
+    SpectrumAnalyzer(const SpectrumAnalyzer &);
+    SpectrumAnalyzer &operator=(const SpectrumAnalyzer &);
+
+    std::atomic<uint32_t> *field(size_t offset) const {
+        return reinterpret_cast<std::atomic<uint32_t> *>(memory_ + offset);
+    }
+    void workerLoop();
+    // worker: the window the budget allows from now on
+    void resize(unsigned size);
+    // analyses the window of frames that ends at end, false if the feed
+    // overwrote it while it was being copied
+    bool analyze(unsigned long long end);
+    // writes the last analysis out under the sequence
+    void publish(unsigned long long end);
+
+    unsigned char *memory_;
+    int sampleRate_;
+    int channels_;
+    // start()'s; what the ring is sized for
+    unsigned fftSize_;
+    const CpuBudget *budget_;
+
+    // interleaved frames from feed(), a power of two of them
+    std::vector<short> ring_;
+    unsigned long long ringMask_;
+    // frames fed since start()
+    std::atomic<unsigned long long> written_;
+    std::atomic<bool> active_;
+    std::atomic<bool> feeding_;
+
+    sem_t dataReady_;
+    std::thread worker_;
+    std::atomic<bool> stopping_;
+
+    // worker only: the window in use and its hop
+    unsigned size_;
+    unsigned hop_;
+    RealFft fft_;
+    std::vector<short> frames_;
+    std::vector<float> window_;
+    std::vector<float> hann_;
+    std::vector<float> re_;
+    std::vector<float> im_;
+    // end of the last window analysed
+    unsigned long long analysed_;
+    uint32_t skipped_;
+    float peakDb_;
+    float rmsDb_;
+};
+
+#endif //NATIVEFEEDBACK_SPECTRUMANALYZER_H
@@ -0,0 +1,71 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_SPSCQUEUE_H
+#define NATIVEFEEDBACK_SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free single-producer/single-consumer queue.
+// push() must only ever be called from one thread and pop() from one other
+// thread. Neither side allocates or blocks, so either one may be an audio
+// callback. Capacity is rounded up to a power of two.
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity)
+            : mask_(roundUpPow2(capacity) - 1), slots_(mask_ + 1), head_(0), pad_(), tail_(0) {}
+
+    bool push(const T &value) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_) {
+            return false;
+        }
+        slots_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T *value) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;
+        }
+        *value = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // approximate when called concurrently with push/pop
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // only safe while neither side is running
+    void reset() {
+        head_.store(0, std::memory_order_relaxed);
+        tail_.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static size_t roundUpPow2(size_t n) {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    const size_t mask_;
+    std::vector<T> slots_;
+    // keep the two indices on separate cache lines so producer and consumer
+    // don't false-share
+    std::atomic<size_t> head_;
+    char pad_[64 - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> tail_;
+};
+
+#endif //NATIVEFEEDBACK_SPSCQUEUE_H
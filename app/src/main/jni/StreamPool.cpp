@@ -0,0 +1,176 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "StreamPool.h"
+
+#include <thread>
+
+#define LOG_TAG "NativeStreamPool"
+
+#include "Log.h"
+
+// what the owner of a pooled stream holds: forwards to the device stream,
+// goes back to the pool when deleted
+class StreamPool::PooledStream : public AudioStream {
+public:
+    PooledStream(StreamPool &pool, Entry *entry) : pool_(pool), entry_(entry) {}
+
+    ~PooledStream() override { pool_.release(entry_); }
+
+    bool registerCallback(Callback callback, void *context) override {
+        // context first: dispatch() reads it after the callback
+        entry_->context.store(context);
+        entry_->callback.store(callback);
+        return true;
+    }
+
+    bool enqueue(const void *buffer, unsigned bytes) override {
+        return entry_->stream->enqueue(buffer, bytes);
+    }
+
+    bool clear() override { return entry_->stream->clear(); }
+    bool start() override { return entry_->stream->start(); }
+    bool stop() override { return entry_->stream->stop(); }
+
+private:
+    StreamPool &pool_;
+    Entry *entry_;
+};
+
+StreamPool::StreamPool(AudioBackend *device) : device_(device), hits_(0), misses_(0) {}
+
+StreamPool::~StreamPool() {
+    trim();
+    delete device_;
+}
+
+AudioStream *StreamPool::createPlayer(const StreamFormat &format, int queueDepth) {
+    return acquire(false, format, queueDepth);
+}
+
+AudioStream *StreamPool::createRecorder(const StreamFormat &format, int queueDepth) {
+    return acquire(true, format, queueDepth);
+}
+
+static bool sameKind(bool recorder, const StreamFormat &format, int queueDepth, bool otherRecorder,
+                     const StreamFormat &otherFormat, int otherQueueDepth) {
+    return recorder == otherRecorder && format.sampleRate == otherFormat.sampleRate
+           && format.channels == otherFormat.channels && queueDepth == otherQueueDepth;
+}
+
+AudioStream *StreamPool::acquire(bool recorder, const StreamFormat &format, int queueDepth) {
+    Entry *entry = NULL;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < idle_.size(); i++) {
+            if (sameKind(recorder, format, queueDepth, idle_[i]->recorder, idle_[i]->format,
+                         idle_[i]->queueDepth)) {
+                entry = idle_[i];
+                idle_.erase(idle_.begin() + i);
+                hits_++;
+                break;
+            }
+        }
+        if (entry == NULL) {
+            misses_++;
+        }
+    }
+    if (entry == NULL) {
+        entry = build(recorder, format, queueDepth);
+        if (entry == NULL) {
+            return NULL;
+        }
+    }
+    entry->handle = new PooledStream(*this, entry);
+    return entry->handle;
+}
+
+StreamPool::Entry *StreamPool::build(bool recorder, const StreamFormat &format, int queueDepth) {
+    AudioStream *stream = recorder ? device_->createRecorder(format, queueDepth)
+                                   : device_->createPlayer(format, queueDepth);
+    if (stream == NULL) {
+        return NULL;
+    }
+    Entry *entry = new Entry();
+    entry->recorder = recorder;
+    entry->format = format;
+    entry->queueDepth = queueDepth;
+    entry->stream = stream;
+    entry->handle = NULL;
+    entry->callback.store(NULL);
+    entry->context.store(NULL);
+    entry->active.store(0);
+    // registered once for the stream's whole life
+    if (!stream->registerCallback(dispatch, entry)) {
+        LOGI("can't register the pooled stream's callback");
+        delete stream;
+        delete entry;
+        return NULL;
+    }
+    return entry;
+}
+
+bool StreamPool::prewarm(bool recorder, const StreamFormat &format, int queueDepth) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < idle_.size(); i++) {
+            if (sameKind(recorder, format, queueDepth, idle_[i]->recorder, idle_[i]->format,
+                         idle_[i]->queueDepth)) {
+                return true;
+            }
+        }
+    }
+    Entry *entry = build(recorder, format, queueDepth);
+    if (entry == NULL) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.push_back(entry);
+    return true;
+}
+
+void StreamPool::release(Entry *entry) {
+    entry->stream->stop();
+    entry->stream->clear();
+    // stopping doesn't wait for a callback that's already running. The
+    // callback and active are sequentially consistent on both sides: either
+    // dispatch() sees NULL or this sees it running and waits it out.
+    entry->callback.store(NULL);
+    while (entry->active.load() != 0) {
+        std::this_thread::yield();
+    }
+    entry->handle = NULL;
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.push_back(entry);
+}
+
+void StreamPool::trim() {
+    std::vector<Entry *> idle;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle.swap(idle_);
+    }
+    for (size_t i = 0; i < idle.size(); i++) {
+        delete idle[i]->stream;
+        delete idle[i];
+    }
+}
+
+StreamPoolStats StreamPool::stats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    StreamPoolStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.idle = static_cast<unsigned>(idle_.size());
+    return stats;
+}
+
+void StreamPool::dispatch(AudioStream *stream, void *context) {
+    Entry *entry = static_cast<Entry *>(context);
+    entry->active.fetch_add(1);
+    AudioStream::Callback callback = entry->callback.load();
+    if (callback != NULL) {
+        callback(entry->handle, entry->context.load());
+    }
+    entry->active.fetch_sub(1);
+}
@@ -0,0 +1,84 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_STREAMPOOL_H
+#define NATIVEFEEDBACK_STREAMPOOL_H
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "AudioBackend.h"
+
+struct StreamPoolStats {
+    // streams handed out from the pool / built because none was idle
+    unsigned hits;
+    unsigned misses;
+    unsigned idle;
+};
+
+// Keeps realized players and recorders around between sessions. Creating
+// an OpenSL ES player (CreateAudioPlayer, Realize, GetInterface) takes tens
+// to hundreds of milliseconds on some devices, and so does tearing it down;
+// a stream that's only been stopped and cleared starts again in a buffer.
+//
+// It's an AudioBackend itself, so everything that creates streams goes
+// through it unchanged: createPlayer()/createRecorder() hand out an idle
+// stream of the same kind, format and queue depth if there is one, and
+// deleting the returned stream stops it, clears its queue and puts it back
+// instead of destroying it. Like destroying, that waits for a callback in
+// flight to return, so the caller can free whatever the callback touches
+// straight after.
+//
+// createPlayer, createRecorder, prewarm and trim take a lock, so call them
+// from the control thread, never from a callback.
+class StreamPool : public AudioBackend {
+public:
+    // takes ownership of device
+    explicit StreamPool(AudioBackend *device);
+    // every stream handed out must have been deleted by now
+    ~StreamPool() override;
+
+    AudioStream *createPlayer(const StreamFormat &format, int queueDepth) override;
+    AudioStream *createRecorder(const StreamFormat &format, int queueDepth) override;
+
+    // builds an idle stream ahead of the first session that needs it,
+    // unless one is already waiting
+    bool prewarm(bool recorder, const StreamFormat &format, int queueDepth);
+    // destroys the idle streams, e.g. once the format has changed
+    void trim();
+
+    StreamPoolStats stats();
+    AudioBackend *device() { return device_; }
+
+private:
+    class PooledStream;
+
+    struct Entry {
+        bool recorder;
+        StreamFormat format;
+        int queueDepth;
+        AudioStream *stream;
+        PooledStream *handle;
+        // the owner's callback; dispatch() calls it through these so the
+        // device stream's own registration never changes
+        std::atomic<AudioStream::Callback> callback;
+        std::atomic<void *> context;
+        // dispatch() calls running right now
+        std::atomic<int> active;
+    };
+
+    static void dispatch(AudioStream *stream, void *context);
+    AudioStream *acquire(bool recorder, const StreamFormat &format, int queueDepth);
+    Entry *build(bool recorder, const StreamFormat &format, int queueDepth);
+    void release(Entry *entry);
+
+    AudioBackend *device_;
+    std::mutex mutex_;
+    std::vector<Entry *> idle_;
+    unsigned hits_;
+    unsigned misses_;
+};
+
+#endif //NATIVEFEEDBACK_STREAMPOOL_H
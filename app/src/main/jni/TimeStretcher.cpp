@@ -0,0 +1,183 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "TimeStretcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// a candidate has to beat the natural continuation by this much of its
+// score to be taken, so rounding in the search never moves a window that
+// needn't move
+static const float CONTINUATION_MARGIN = 1e-4f;
+// keeps silence from dividing by zero
+static const double ENERGY_FLOOR = 1e-12;
+
+TimeStretcher::TimeStretcher()
+        : channels_(0),
+          window_(0),
+          hop_(0),
+          seek_(0),
+          speed_(1.0f),
+          kernels_(&PcmKernels::best()),
+          base_(0),
+          frames_(0),
+          nominal_(0),
+          continuation_(-1),
+          readyHead_(0),
+          readyFrames_(0) {
+}
+
+bool TimeStretcher::init(int sampleRate, int channels) {
+    if (sampleRate <= 0 || channels <= 0) {
+        channels_ = 0;
+        return false;
+    }
+    channels_ = channels;
+    hop_ = std::max(16u, static_cast<unsigned>(sampleRate * STRETCH_WINDOW_MS / 2000));
+    window_ = 2 * hop_;
+    seek_ = static_cast<unsigned>(sampleRate * STRETCH_SEEK_MS / 1000);
+
+    // periodic, so two halves overlapping add up to exactly 1
+    hann_.resize(window_);
+    for (unsigned i = 0; i < window_; i++) {
+        hann_[i] = static_cast<float>(0.5 - 0.5 * cos(2 * M_PI * i / window_));
+    }
+    // the next window ends at most seek_ + window_ past its nominal start,
+    // and the last continuation sits at most 2 hops + seek_ before that
+    // start at the top speed
+    size_t capacity = 2 * window_ + 2 * seek_ + hop_;
+    input_.assign(capacity * channels, 0.0f);
+    mono_.assign(capacity, 0.0f);
+    accum_.assign(window_ * channels, 0.0f);
+    ready_.assign(hop_ * channels, 0);
+    scores_.assign(2 * seek_ + 1, 0.0f);
+    reset();
+    return true;
+}
+
+void TimeStretcher::reset() {
+    base_ = 0;
+    frames_ = 0;
+    nominal_ = 0;
+    continuation_ = -1;
+    readyHead_ = 0;
+    readyFrames_ = 0;
+    std::fill(accum_.begin(), accum_.end(), 0.0f);
+}
+
+void TimeStretcher::setSpeed(float speed) {
+    speed_.store(std::min(STRETCH_MAX_SPEED, std::max(STRETCH_MIN_SPEED, speed)),
+                 std::memory_order_relaxed);
+}
+
+size_t TimeStretcher::heldFrames() const {
+    double held = base_ + frames_ - nominal_ + (readyFrames_ - readyHead_) * speed();
+    return held > 0 ? static_cast<size_t>(held) : 0;
+}
+
+size_t TimeStretcher::process(const short *in, size_t inFrames, size_t *consumed, short *out,
+                              size_t outFrames) {
+    size_t used = 0, written = 0;
+    while (written < outFrames) {
+        if (readyHead_ < readyFrames_) {
+            size_t n = std::min(outFrames - written, readyFrames_ - readyHead_);
+            memcpy(out + written * channels_, &ready_[readyHead_ * channels_],
+                   n * channels_ * sizeof(short));
+            readyHead_ += n;
+            written += n;
+            continue;
+        }
+        // take in just what the next window and its search reach
+        unsigned long long need = static_cast<unsigned long long>(nominal_) + seek_ + window_;
+        size_t n = static_cast<size_t>(std::min<unsigned long long>(inFrames - used,
+                                                                    need - (base_ + frames_)));
+        if (n > 0) {
+            float *dst = &input_[frames_ * channels_];
+            kernels_->s16ToFloat(in + used * channels_, dst, n * channels_);
+            for (size_t i = 0; i < n; i++) {
+                float sum = 0;
+                for (int c = 0; c < channels_; c++) {
+                    sum += dst[i * channels_ + c];
+                }
+                mono_[frames_ + i] = sum / channels_;
+            }
+            frames_ += n;
+            used += n;
+        }
+        if (base_ + frames_ < need) {
+            break;
+        }
+        step();
+    }
+    *consumed = used;
+    return written;
+}
+
+void TimeStretcher::step() {
+    long long start = static_cast<long long>(nominal_);
+    long long at = start;
+    const long long base = static_cast<long long>(base_);
+    if (continuation_ >= 0) {
+        long long lo = std::max(start - static_cast<long long>(seek_), base);
+        long long hi = start + seek_;
+        size_t lags = static_cast<size_t>(hi - lo + 1);
+        const float *x = &mono_[lo - base];
+        kernels_->crossCorrelate(&mono_[continuation_ - base], x, hop_, lags, &scores_[0]);
+
+        // the continuation if it's in reach, the nominal start otherwise
+        long long best = continuation_ >= lo && continuation_ <= hi ? continuation_ : start;
+        float bestScore = -INFINITY;
+        double energy = 0;
+        for (unsigned i = 0; i < hop_; i++) {
+            energy += static_cast<double>(x[i]) * x[i];
+        }
+        for (size_t d = 0; d < lags; d++) {
+            if (d > 0) {
+                energy += static_cast<double>(x[d + hop_ - 1]) * x[d + hop_ - 1]
+                          - static_cast<double>(x[d - 1]) * x[d - 1];
+            }
+            float score = static_cast<float>(scores_[d] / sqrt(std::max(energy, 0.0) + ENERGY_FLOOR));
+            if (lo + static_cast<long long>(d) == best) {
+                bestScore = std::max(bestScore, score);
+            }
+            scores_[d] = score;
+        }
+        for (size_t d = 0; d < lags; d++) {
+            if (scores_[d] > bestScore + CONTINUATION_MARGIN * fabsf(bestScore)) {
+                bestScore = scores_[d];
+                best = lo + static_cast<long long>(d);
+            }
+        }
+        at = best;
+    }
+
+    // the first window has no tail before it to overlap, so it rises at
+    // full gain
+    const float *src = &input_[(at - base) * channels_];
+    for (unsigned i = 0; i < window_; i++) {
+        float w = continuation_ < 0 && i < hop_ ? 1.0f : hann_[i];
+        for (int c = 0; c < channels_; c++) {
+            accum_[i * channels_ + c] += w * src[i * channels_ + c];
+        }
+    }
+    kernels_->floatToS16(&accum_[0], &ready_[0], hop_ * channels_);
+    readyHead_ = 0;
+    readyFrames_ = hop_;
+    std::copy(accum_.begin() + hop_ * channels_, accum_.end(), accum_.begin());
+    std::fill(accum_.begin() + hop_ * channels_, accum_.end(), 0.0f);
+
+    continuation_ = at + hop_;
+    nominal_ += speed() * hop_;
+
+    // drop what neither the next continuation nor the next search reaches
+    long long keep = std::min(continuation_, static_cast<long long>(nominal_) - static_cast<long long>(seek_));
+    if (keep > base) {
+        size_t drop = std::min(static_cast<size_t>(keep - base), frames_);
+        memmove(&input_[0], &input_[drop * channels_], (frames_ - drop) * channels_ * sizeof(float));
+        memmove(&mono_[0], &mono_[drop], (frames_ - drop) * sizeof(float));
+        base_ += drop;
+        frames_ -= drop;
+    }
+}
@@ -0,0 +1,101 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_TIMESTRETCHER_H
+#define NATIVEFEEDBACK_TIMESTRETCHER_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "PcmConvert.h"
+
+// Streaming WSOLA (waveform similarity overlap-add) time stretcher for
+// 16-bit interleaved PCM: plays at a speed of STRETCH_MIN_SPEED to
+// STRETCH_MAX_SPEED times with the pitch unchanged.
+//
+// Output is Hann windows of STRETCH_WINDOW_MS overlapping by half. Each
+// window is taken from the input about speed times one hop after the last
+// one, but moved by up to STRETCH_SEEK_MS either way to wherever the mono
+// downmix best matches what the last window would have gone on to play,
+// so the overlap adds up in phase. The search is one PcmKernels
+// crossCorrelate call per hop, normalized by the candidates' energy.
+//
+// At speed 1 the natural continuation always matches best and the output
+// is the input exactly, a window's latency later. The first window after
+// init() or reset() starts at full gain rather than fading in, so the
+// stretcher can be switched in mid-stream without a dip. All memory is
+// allocated by init(); process() can run on any one thread and may be fed
+// and drained in chunks of any size.
+#define STRETCH_MIN_SPEED 0.5f
+#define STRETCH_MAX_SPEED 3.0f
+#define STRETCH_WINDOW_MS 20
+#define STRETCH_SEEK_MS 10
+
+class TimeStretcher {
+public:
+    TimeStretcher();
+
+    bool init(int sampleRate, int channels);
+    // drops everything taken in; the next window starts at full gain
+    void reset();
+
+    // from any thread, clamped to the supported range; the next window
+    // taken uses it
+    void setSpeed(float speed);
+    float speed() const { return speed_.load(std::memory_order_relaxed); }
+
+    // stretches up to inFrames of in into at most outFrames of out. Returns
+    // the frames written and sets *consumed to the input frames used; input
+    // not consumed has to be passed again on the next call. Only takes in
+    // what the next window needs, so heldFrames() stays small.
+    size_t process(const short *in, size_t inFrames, size_t *consumed, short *out,
+                   size_t outFrames);
+
+    // input frames taken in but not played out yet, about a window and the
+    // seek range
+    size_t heldFrames() const;
+    // input frames of silence to feed at the end to get the tail out
+    size_t latencyFrames() const { return window_ + seek_; }
+    bool active() const { return channels_ > 0; }
+
+    // overrides PcmKernels::best(), for comparing sets
+    void setKernels(const PcmKernels &kernels) { kernels_ = &kernels; }
+
+private:
+    // overlap-adds the next window into the output
+    void step();
+
+    int channels_;
+    // N, N / 2 and S in frames
+    unsigned window_;
+    unsigned hop_;
+    unsigned seek_;
+    std::atomic<float> speed_;
+    const PcmKernels *kernels_;
+    std::vector<float> hann_;
+
+    // input frames from base_ on as floats, interleaved and mono
+    std::vector<float> input_;
+    std::vector<float> mono_;
+    unsigned long long base_;
+    size_t frames_;
+    // where the next window would start without a search
+    double nominal_;
+    // where the last window would have gone on from, -1 before the first
+    long long continuation_;
+
+    // window_ frames of output being added up, the first hop_ of them due
+    std::vector<float> accum_;
+    // a finished hop waiting to be read out
+    std::vector<short> ready_;
+    size_t readyHead_;
+    size_t readyFrames_;
+    std::vector<float> scores_;
+
+    TimeStretcher(const TimeStretcher &);
+    TimeStretcher &operator=(const TimeStretcher &);
+};
+
+#endif //NATIVEFEEDBACK_TIMESTRETCHER_H
@@ -0,0 +1,314 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "VoiceActivity.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+VadConfig::VadConfig()
+        : enabled(false),
+          thresholdDb(9.0f),
+          hangoverMs(300),
+          preRollMs(50),
+          maxGapMs(0),
+          spectralFlatness(false) {
+}
+
+VoiceActivityDetector::VoiceActivityDetector()
+        : channels_(1),
+          windowFrames_(0),
+          thresholdDb_(0),
+          floorRiseDb_(0),
+          haveFloor_(false),
+          levelDb_(-120.0f),
+          floorDb_(-120.0f),
+          zcr_(0),
+          flatness_(0),
+          spectral_(false) {
+}
+
+bool VoiceActivityDetector::init(int sampleRate, int channels, float thresholdDb,
+                                 bool spectralFlatness) {
+    if (sampleRate <= 0 || channels <= 0) {
+        return false;
+    }
+    channels_ = channels;
+    windowFrames_ = std::max(1, sampleRate * VAD_WINDOW_MS / 1000);
+    thresholdDb_ = thresholdDb;
+    floorRiseDb_ = VAD_FLOOR_RISE_DB_PER_S * VAD_WINDOW_MS / 1000;
+    spectral_ = spectralFlatness;
+    if (spectral_) {
+        if (!fft_.init(Fft::sizeFor(std::max(2u, windowFrames_)))) {
+            return false;
+        }
+        re_.assign(fft_.size(), 0);
+        im_.assign(fft_.size(), 0);
+    }
+    reset();
+    return true;
+}
+
+void VoiceActivityDetector::reset() {
+    haveFloor_ = false;
+    levelDb_ = -120.0f;
+    floorDb_ = -120.0f;
+    zcr_ = 0;
+    flatness_ = 0;
+}
+
+bool VoiceActivityDetector::process(const short *window) {
+    // one pass: mono downmix, energy and sign changes
+    double energy = 0;
+    unsigned crossings = 0;
+    bool positive = true;
+    const float scale = 1.0f / (32768.0f * channels_);
+    for (unsigned i = 0; i < windowFrames_; i++) {
+        int sum = 0;
+        for (int c = 0; c < channels_; c++) {
+            sum += window[i * channels_ + c];
+        }
+        float x = sum * scale;
+        energy += x * x;
+        bool sign = x >= 0;
+        crossings += i > 0 && sign != positive;
+        positive = sign;
+        if (spectral_) {
+            re_[i] = x;
+        }
+    }
+    levelDb_ = 10.0f * log10f(static_cast<float>(energy / windowFrames_) + 1e-12f);
+    zcr_ = static_cast<float>(crossings) / windowFrames_;
+    if (!haveFloor_) {
+        // no higher than the quietest voice, so talk from the first window
+        // on isn't taken for the room; a noisier room takes a few seconds
+        floorDb_ = std::min(levelDb_, VAD_MIN_LEVEL_DB);
+        haveFloor_ = true;
+    }
+
+    float above = levelDb_ - floorDb_;
+    bool voice = levelDb_ > VAD_MIN_LEVEL_DB
+                 && (above > thresholdDb_
+                     || (above > thresholdDb_ / 2 && zcr_ > VAD_FRICATIVE_ZCR));
+    if (spectral_) {
+        flatness_ = measureFlatness();
+        // noise that got louder isn't voice unless it's much louder
+        if (voice && flatness_ > VAD_NOISE_FLATNESS && above < 2 * thresholdDb_) {
+            voice = false;
+        }
+    }
+
+    // down at once, up slowly, so speech barely moves it but a noisier
+    // room is learned within seconds
+    floorDb_ = levelDb_ < floorDb_ ? levelDb_ : std::min(levelDb_, floorDb_ + floorRiseDb_);
+    return voice;
+}
+
+float VoiceActivityDetector::measureFlatness() {
+    std::fill(re_.begin() + windowFrames_, re_.end(), 0.0f);
+    std::fill(im_.begin(), im_.end(), 0.0f);
+    fft_.forward(&re_[0], &im_[0]);
+    // geometric over arithmetic mean of the power spectrum, DC left out
+    unsigned bins = fft_.size() / 2;
+    double logSum = 0;
+    double sum = 0;
+    for (unsigned k = 1; k < bins; k++) {
+        double power = re_[k] * re_[k] + im_[k] * im_[k] + 1e-12;
+        logSum += log(power);
+        sum += power;
+    }
+    unsigned n = bins - 1;
+    return n > 0 ? static_cast<float>(exp(logSum / n) / (sum / n)) : 0.0f;
+}
+
+SilenceTrimmer::SilenceTrimmer()
+        : sink_(NULL),
+          context_(NULL),
+          index_(NULL),
+          indexFailed_(false),
+          channels_(1),
+          windowSamples_(0),
+          hangoverWindows_(0),
+          gapWindows_(0),
+          windowFill_(0),
+          preRollWindows_(0),
+          preRollHead_(0),
+          preRollCount_(0),
+          captureFrame_(0),
+          fileFrame_(0),
+          hangover_(0),
+          gap_(0),
+          lastKept_(false),
+          inRun_(false),
+          runCapture_(0),
+          runFile_(0),
+          runEnd_(0),
+          keptFrames_(0),
+          droppedFrames_(0) {
+}
+
+SilenceTrimmer::~SilenceTrimmer() {
+    close();
+}
+
+static unsigned windowsFor(unsigned ms) {
+    return (ms + VAD_WINDOW_MS - 1) / VAD_WINDOW_MS;
+}
+
+bool SilenceTrimmer::open(const char *indexPath, int sampleRate, int channels,
+                          const VadConfig &config, Sink sink, void *context) {
+    close();
+    if (sink == NULL
+        || !detector_.init(sampleRate, channels, config.thresholdDb, config.spectralFlatness)) {
+        return false;
+    }
+    if (indexPath != NULL) {
+        index_ = fopen(indexPath, "w");
+        if (index_ == NULL) {
+            return false;
+        }
+        fprintf(index_, "nfvad 1 %d %d\n", sampleRate, channels);
+    }
+    sink_ = sink;
+    context_ = context;
+    indexFailed_ = false;
+    channels_ = channels;
+    windowSamples_ = detector_.windowFrames() * channels;
+    hangoverWindows_ = windowsFor(config.hangoverMs);
+    gapWindows_ = windowsFor(config.maxGapMs);
+    preRollWindows_ = windowsFor(config.preRollMs);
+    window_.assign(windowSamples_, 0);
+    preRoll_.assign(preRollWindows_ * windowSamples_, 0);
+    windowFill_ = 0;
+    preRollHead_ = 0;
+    preRollCount_ = 0;
+    captureFrame_ = 0;
+    fileFrame_ = 0;
+    hangover_ = 0;
+    // whatever comes before the first voice is a gap already past its limit
+    gap_ = gapWindows_;
+    lastKept_ = false;
+    inRun_ = false;
+    keptFrames_.store(0, std::memory_order_relaxed);
+    droppedFrames_.store(0, std::memory_order_relaxed);
+    return true;
+}
+
+void SilenceTrimmer::write(const short *samples, size_t frames) {
+    unsigned windowFrames = detector_.windowFrames();
+    while (frames > 0) {
+        size_t n = std::min<size_t>(frames, windowFrames - windowFill_);
+        memcpy(&window_[windowFill_ * channels_], samples, n * channels_ * sizeof(short));
+        windowFill_ += n;
+        samples += n * channels_;
+        frames -= n;
+        if (windowFill_ == windowFrames) {
+            onWindow(&window_[0], detector_.process(&window_[0]));
+            captureFrame_ += windowFrames;
+            windowFill_ = 0;
+        }
+    }
+}
+
+void SilenceTrimmer::onWindow(const short *window, bool voice) {
+    unsigned windowFrames = detector_.windowFrames();
+    if (voice) {
+        hangover_ = hangoverWindows_;
+    } else if (hangover_ > 0) {
+        hangover_--;
+        voice = true;
+    }
+
+    if (voice) {
+        // an onset: the pre-roll goes out first, in order
+        unsigned long long start = captureFrame_ - preRollCount_ * windowFrames;
+        for (unsigned i = 0; i < preRollCount_; i++) {
+            unsigned slot = (preRollHead_ + i) % preRollWindows_;
+            emit(&preRoll_[slot * windowSamples_], windowFrames, start + i * windowFrames);
+        }
+        preRollHead_ = 0;
+        preRollCount_ = 0;
+        emit(window, windowFrames, captureFrame_);
+        gap_ = 0;
+        lastKept_ = true;
+        return;
+    }
+    if (gap_ < gapWindows_) {
+        gap_++;
+        emit(window, windowFrames, captureFrame_);
+        lastKept_ = true;
+        return;
+    }
+
+    lastKept_ = false;
+    if (preRollWindows_ == 0) {
+        droppedFrames_.fetch_add(windowFrames, std::memory_order_relaxed);
+        endRun();
+        return;
+    }
+    if (preRollCount_ == preRollWindows_) {
+        // the oldest window of the pre-roll is the one that goes
+        preRollHead_ = (preRollHead_ + 1) % preRollWindows_;
+        preRollCount_--;
+        droppedFrames_.fetch_add(windowFrames, std::memory_order_relaxed);
+        endRun();
+    }
+    unsigned slot = (preRollHead_ + preRollCount_) % preRollWindows_;
+    memcpy(&preRoll_[slot * windowSamples_], window, windowSamples_ * sizeof(short));
+    preRollCount_++;
+}
+
+void SilenceTrimmer::emit(const short *samples, size_t frames, unsigned long long captureFrame) {
+    if (!inRun_ || captureFrame != runEnd_) {
+        endRun();
+        inRun_ = true;
+        runCapture_ = captureFrame;
+        runFile_ = fileFrame_;
+        runEnd_ = captureFrame;
+    }
+    sink_(samples, frames, context_);
+    runEnd_ += frames;
+    fileFrame_ += frames;
+    keptFrames_.fetch_add(frames, std::memory_order_relaxed);
+}
+
+void SilenceTrimmer::endRun() {
+    if (!inRun_) {
+        return;
+    }
+    inRun_ = false;
+    if (index_ != NULL
+        && (fprintf(index_, "%llu %llu %llu\n", runCapture_, runFile_, runEnd_ - runCapture_) < 0
+            || fflush(index_) != 0)) {
+        indexFailed_ = true;
+    }
+}
+
+bool SilenceTrimmer::close() {
+    if (sink_ == NULL) {
+        return true;
+    }
+    if (windowFill_ > 0) {
+        if (lastKept_) {
+            emit(&window_[0], windowFill_, captureFrame_);
+        } else {
+            droppedFrames_.fetch_add(windowFill_, std::memory_order_relaxed);
+        }
+        windowFill_ = 0;
+    }
+    droppedFrames_.fetch_add(preRollCount_ * detector_.windowFrames(), std::memory_order_relaxed);
+    preRollCount_ = 0;
+    endRun();
+    bool ok = !indexFailed_;
+    if (index_ != NULL) {
+        ok = fclose(index_) == 0 && ok;
+        index_ = NULL;
+    }
+    sink_ = NULL;
+    return ok;
+}
+
+std::string SilenceTrimmer::indexPathFor(const char *path) {
+    return std::string(path) + ".vad";
+}
@@ -0,0 +1,166 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_VOICEACTIVITY_H
+#define NATIVEFEEDBACK_VOICEACTIVITY_H
+
+#include <cstdio>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "Fft.h"
+
+// the detector decides on windows of this length
+#define VAD_WINDOW_MS 10
+// windows quieter than this, in dBFS, are never voice
+#define VAD_MIN_LEVEL_DB -55.0f
+// the noise floor follows the level down at once and up this fast
+#define VAD_FLOOR_RISE_DB_PER_S 3.0f
+// zero crossings per sample above which a quieter window still counts, for
+// fricatives like "s" and "f" that have little energy
+#define VAD_FRICATIVE_ZCR 0.3f
+// spectral flatness above which a window is taken for noise
+#define VAD_NOISE_FLATNESS 0.5f
+
+struct VadConfig {
+    bool enabled;
+    // how far above the noise floor, in dB, a window has to be for voice
+    float thresholdDb;
+    // the gate stays open this long after the last voice
+    unsigned hangoverMs;
+    // silence kept ahead of each onset, so its attack isn't clipped
+    unsigned preRollMs;
+    // silence kept at the start of each gap, after the hangover: 0 drops
+    // gaps, anything else compacts every pause to at most hangoverMs +
+    // maxGapMs + preRollMs
+    unsigned maxGapMs;
+    // also rejects noise-like windows by their spectral flatness, at the
+    // cost of an FFT per window
+    bool spectralFlatness;
+
+    VadConfig();
+};
+
+// Streaming voice activity detector: energy and zero-crossing rate against
+// an adaptive noise floor, optionally spectral flatness.
+//
+// Every window costs the same, a pass over its samples plus, with flatness
+// on, one FFT of VAD_WINDOW_MS, so the work per burst is small and fixed.
+// process() allocates nothing; init() does.
+class VoiceActivityDetector {
+public:
+    VoiceActivityDetector();
+
+    bool init(int sampleRate, int channels, float thresholdDb, bool spectralFlatness);
+    // forgets the noise floor
+    void reset();
+    unsigned windowFrames() const { return windowFrames_; }
+
+    // classifies one window of windowFrames() interleaved frames; true for
+    // voice. Hangover is left to the caller.
+    bool process(const short *window);
+
+    // features of the last window
+    float levelDb() const { return levelDb_; }
+    float noiseFloorDb() const { return floorDb_; }
+    float zeroCrossingRate() const { return zcr_; }
+    // 0 for a pure tone up to 1 for white noise; 0 with flatness off
+    float flatness() const { return flatness_; }
+
+private:
+    float measureFlatness();
+
+    int channels_;
+    unsigned windowFrames_;
+    float thresholdDb_;
+    float floorRiseDb_;
+    bool haveFloor_;
+    float levelDb_;
+    float floorDb_;
+    float zcr_;
+    float flatness_;
+
+    bool spectral_;
+    Fft fft_;
+    // the window downmixed to mono, zero padded to the FFT size
+    std::vector<float> re_;
+    std::vector<float> im_;
+};
+
+// Drops or compacts the silence in a stream of PCM before it reaches a file,
+// and writes a sidecar index from which the original timestamps can be
+// rebuilt.
+//
+// Frames go through write() in any amount and come out of the sink in
+// windows of the detector, delayed by at most a window plus the pre-roll.
+// The index is text: a line "nfvad 1 <rate> <channels>", then one line
+// "<capture frame> <file frame> <frames>" per contiguous run of kept frames,
+// so file frame f of a run was captured at capture frame + (f - file frame).
+// Each line is flushed as its run ends, so an index cut short by a crash
+// still covers everything but the last run.
+class SilenceTrimmer {
+public:
+    typedef void (*Sink)(const short *samples, size_t frames, void *context);
+
+    SilenceTrimmer();
+    ~SilenceTrimmer();
+
+    // indexPath may be NULL for no index
+    bool open(const char *indexPath, int sampleRate, int channels, const VadConfig &config,
+              Sink sink, void *context);
+    void write(const short *samples, size_t frames);
+    // passes on the partial last window if the gate is open and finishes
+    // the index; false if the index didn't make it to disk
+    bool close();
+
+    // sidecar index of a recording at path
+    static std::string indexPathFor(const char *path);
+
+    // from any thread
+    unsigned long long keptFrames() const { return keptFrames_.load(std::memory_order_relaxed); }
+    unsigned long long droppedFrames() const { return droppedFrames_.load(std::memory_order_relaxed); }
+
+private:
+    void onWindow(const short *window, bool voice);
+    void emit(const short *samples, size_t frames, unsigned long long captureFrame);
+    void endRun();
+
+    VoiceActivityDetector detector_;
+    Sink sink_;
+    void *context_;
+    FILE *index_;
+    bool indexFailed_;
+    int channels_;
+    unsigned windowSamples_;
+    unsigned hangoverWindows_;
+    unsigned gapWindows_;
+
+    std::vector<short> window_;
+    unsigned windowFill_;
+    // the last silent windows, the pre-roll, oldest first from preRollHead_
+    std::vector<short> preRoll_;
+    unsigned preRollWindows_;
+    unsigned preRollHead_;
+    unsigned preRollCount_;
+
+    // capture frame of the start of window_
+    unsigned long long captureFrame_;
+    unsigned long long fileFrame_;
+    unsigned hangover_;
+    unsigned gap_;
+    // the last window went to the sink
+    bool lastKept_;
+    // the run being written: where it started and where it ends so far
+    bool inRun_;
+    unsigned long long runCapture_;
+    unsigned long long runFile_;
+    unsigned long long runEnd_;
+
+    std::atomic<unsigned long long> keptFrames_;
+    std::atomic<unsigned long long> droppedFrames_;
+};
+
+#endif //NATIVEFEEDBACK_VOICEACTIVITY_H
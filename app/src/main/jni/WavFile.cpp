@@ -0,0 +1,340 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "WavFile.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#define LOG_TAG "NativeWavFile"
+
+#include "Log.h"
+
+static const unsigned WAVE_FORMAT_PCM = 1;
+static const unsigned WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+// riffSize, dataSize and sampleCount, then an empty table
+static const unsigned DS64_BYTES = 28;
+// where the writer's chunks sit in its header
+static const int DS64_OFFSET = 12;
+static const int FMT_OFFSET = 48;
+static const int DATA_OFFSET = 72;
+
+static void putLe(unsigned char *p, unsigned long long value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        p[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+static unsigned long long getLe(const unsigned char *p, int bytes) {
+    unsigned long long value = 0;
+    for (int i = bytes - 1; i >= 0; i--) {
+        value = value << 8 | p[i];
+    }
+    return value;
+}
+
+static bool writeFully(int fd, const unsigned char *data, size_t bytes, unsigned long long offset) {
+    while (bytes > 0) {
+        ssize_t n = pwrite(fd, data, bytes, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        bytes -= n;
+        offset += n;
+    }
+    return true;
+}
+
+static bool readFully(int fd, unsigned char *data, size_t bytes, unsigned long long offset) {
+    while (bytes > 0) {
+        ssize_t n = pread(fd, data, bytes, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        data += n;
+        bytes -= n;
+        offset += n;
+    }
+    return true;
+}
+
+WavWriter::WavWriter()
+        : fd_(-1), container_(true), sampleRate_(0), channels_(0), staging_(NULL), staged_(0),
+          stagingOffset_(0), dataBytes_(0), riffLimit_(WAV_RIFF_LIMIT), failed_(false) {}
+
+WavWriter::~WavWriter() {
+    close();
+    free(staging_);
+}
+
+bool WavWriter::isWavPath(const char *path) {
+    size_t length = strlen(path);
+    return length > 4 && strcmp(path + length - 4, ".wav") == 0;
+}
+
+bool WavWriter::open(const char *path, int sampleRate, int channels, bool container) {
+    close();
+    if (staging_ == NULL) {
+        void *memory;
+        if (posix_memalign(&memory, 4096, WAV_WRITE_CHUNK_BYTES) != 0) {
+            return false;
+        }
+        staging_ = static_cast<unsigned char *>(memory);
+    }
+    fd_ = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        LOGI("can't create %s", path);
+        return false;
+    }
+    container_ = container;
+    sampleRate_ = sampleRate;
+    channels_ = channels;
+    stagingOffset_ = 0;
+    dataBytes_ = 0;
+    failed_ = false;
+    staged_ = 0;
+    if (container_) {
+        // goes out with the first chunk, patched in place from then on
+        buildHeader(staging_);
+        staged_ = HEADER_BYTES;
+    }
+    return true;
+}
+
+bool WavWriter::write(const void *data, size_t bytes) {
+    if (fd_ < 0) {
+        return false;
+    }
+    const unsigned char *in = static_cast<const unsigned char *>(data);
+    while (bytes > 0) {
+        size_t n = WAV_WRITE_CHUNK_BYTES - staged_;
+        if (n > bytes) {
+            n = bytes;
+        }
+        memcpy(staging_ + staged_, in, n);
+        staged_ += n;
+        dataBytes_ += n;
+        in += n;
+        bytes -= n;
+        if (staged_ == WAV_WRITE_CHUNK_BYTES) {
+            flushStaged(staged_);
+            patchHeader();
+        }
+    }
+    return !failed_;
+}
+
+bool WavWriter::flushStaged(size_t bytes) {
+    if (!writeFully(fd_, staging_, bytes, stagingOffset_)) {
+        LOGI("write failed: %s", strerror(errno));
+        failed_ = true;
+    }
+    stagingOffset_ += bytes;
+    staged_ = 0;
+    return !failed_;
+}
+
+bool WavWriter::patchHeader() {
+    if (!container_) {
+        return true;
+    }
+    unsigned char header[HEADER_BYTES];
+    buildHeader(header);
+    if (stagingOffset_ == 0) {
+        // still staged, nothing on disk to patch yet
+        memcpy(staging_, header, HEADER_BYTES);
+        return true;
+    }
+    if (!writeFully(fd_, header, HEADER_BYTES, 0)) {
+        failed_ = true;
+    }
+    return !failed_;
+}
+
+bool WavWriter::close() {
+    if (fd_ < 0) {
+        return true;
+    }
+    if (container_ && (dataBytes_ & 1) != 0) {
+        // chunks are padded to an even size; 16-bit frames never need it
+        staging_[staged_++] = 0;
+    }
+    if (staged_ > 0) {
+        flushStaged(staged_);
+    }
+    patchHeader();
+    bool ok = !failed_;
+    if (::close(fd_) != 0) {
+        ok = false;
+    }
+    fd_ = -1;
+    return ok;
+}
+
+void WavWriter::buildHeader(unsigned char *header) const {
+    unsigned long long riffSize = HEADER_BYTES - 8 + dataBytes_ + (dataBytes_ & 1);
+    bool rf64 = riffSize > riffLimit_;
+    unsigned blockAlign = channels_ * sizeof(short);
+    memset(header, 0, HEADER_BYTES);
+
+    memcpy(header, rf64 ? "RF64" : "RIFF", 4);
+    putLe(header + 4, rf64 ? 0xFFFFFFFFULL : riffSize, 4);
+    memcpy(header + 8, "WAVE", 4);
+
+    // the room a ds64 chunk needs, skipped by readers as JUNK until then
+    memcpy(header + DS64_OFFSET, rf64 ? "ds64" : "JUNK", 4);
+    putLe(header + DS64_OFFSET + 4, DS64_BYTES, 4);
+    if (rf64) {
+        putLe(header + DS64_OFFSET + 8, riffSize, 8);
+        putLe(header + DS64_OFFSET + 16, dataBytes_, 8);
+        putLe(header + DS64_OFFSET + 24, blockAlign > 0 ? dataBytes_ / blockAlign : 0, 8);
+    }
+
+    memcpy(header + FMT_OFFSET, "fmt ", 4);
+    putLe(header + FMT_OFFSET + 4, 16, 4);
+    putLe(header + FMT_OFFSET + 8, WAVE_FORMAT_PCM, 2);
+    putLe(header + FMT_OFFSET + 10, channels_, 2);
+    putLe(header + FMT_OFFSET + 12, sampleRate_, 4);
+    putLe(header + FMT_OFFSET + 16, static_cast<unsigned long long>(sampleRate_) * blockAlign, 4);
+    putLe(header + FMT_OFFSET + 20, blockAlign, 2);
+    putLe(header + FMT_OFFSET + 22, 16, 2);
+
+    memcpy(header + DATA_OFFSET, "data", 4);
+    putLe(header + DATA_OFFSET + 4, rf64 ? 0xFFFFFFFFULL : dataBytes_, 4);
+}
+
+bool WavWriter::repair(const char *path) {
+    int fd = ::open(path, O_RDWR);
+    if (fd < 0) {
+        return false;
+    }
+    WavInfo info;
+    struct stat st;
+    if (WavReader::probe(fd, &info) != WAV_PCM16 || fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    bool ok = true;
+    unsigned long long fileSize = static_cast<unsigned long long>(st.st_size);
+    unsigned long long end = info.dataOffset + info.dataBytes;
+    if (fileSize - end < info.channels * sizeof(short)) {
+        // the data runs to the end of the file: drop a torn last frame
+        ok = fileSize == end || ftruncate(fd, static_cast<off_t>(end)) == 0;
+        fileSize = end;
+    }
+    unsigned long long riffSize = fileSize - 8;
+    unsigned char size[4];
+    if (info.rf64 || riffSize > WAV_RIFF_LIMIT) {
+        // only possible with room for ds64 straight after WAVE
+        unsigned char chunk[8];
+        ok = ok && readFully(fd, chunk, sizeof(chunk), DS64_OFFSET)
+             && (memcmp(chunk, "ds64", 4) == 0 || memcmp(chunk, "JUNK", 4) == 0)
+             && getLe(chunk + 4, 4) >= 24;
+        if (ok) {
+            unsigned char ds64[8 + 24];
+            memcpy(ds64, "ds64", 4);
+            memcpy(ds64 + 4, chunk + 4, 4);
+            putLe(ds64 + 8, riffSize, 8);
+            putLe(ds64 + 16, info.dataBytes, 8);
+            putLe(ds64 + 24, info.dataBytes / (info.channels * sizeof(short)), 8);
+            putLe(size, 0xFFFFFFFFULL, 4);
+            ok = writeFully(fd, ds64, sizeof(ds64), DS64_OFFSET)
+                 && writeFully(fd, reinterpret_cast<const unsigned char *>("RF64"), 4, 0)
+                 && writeFully(fd, size, 4, 4)
+                 && writeFully(fd, size, 4, info.dataOffset - 4);
+        }
+    } else {
+        putLe(size, riffSize, 4);
+        ok = ok && writeFully(fd, size, 4, 4);
+        putLe(size, info.dataBytes, 4);
+        ok = ok && writeFully(fd, size, 4, info.dataOffset - 4);
+    }
+    return ::close(fd) == 0 && ok;
+}
+
+WavProbeResult WavReader::probe(const char *path, WavInfo *info) {
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return WAV_NONE;
+    }
+    WavProbeResult result = probe(fd, info);
+    ::close(fd);
+    return result;
+}
+
+WavProbeResult WavReader::probe(int fd, WavInfo *info) {
+    memset(info, 0, sizeof(*info));
+    struct stat st;
+    unsigned char riff[12];
+    if (fstat(fd, &st) != 0 || !readFully(fd, riff, sizeof(riff), 0)
+        || (memcmp(riff, "RIFF", 4) != 0 && memcmp(riff, "RF64", 4) != 0)
+        || memcmp(riff + 8, "WAVE", 4) != 0) {
+        return WAV_NONE;
+    }
+    unsigned long long fileSize = static_cast<unsigned long long>(st.st_size);
+    info->rf64 = memcmp(riff, "RF64", 4) == 0;
+    unsigned long long ds64Data = 0;
+    bool haveFormat = false;
+    unsigned formatTag = 0;
+    unsigned long long offset = sizeof(riff);
+    unsigned char chunk[8];
+    while (readFully(fd, chunk, sizeof(chunk), offset)) {
+        unsigned long long size = getLe(chunk + 4, 4);
+        unsigned long long body = offset + sizeof(chunk);
+        if (memcmp(chunk, "ds64", 4) == 0 && size >= 24) {
+            unsigned char ds64[24];
+            if (!readFully(fd, ds64, sizeof(ds64), body)) {
+                return WAV_UNSUPPORTED;
+            }
+            ds64Data = getLe(ds64 + 8, 8);
+        } else if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+            unsigned char fmt[40];
+            size_t n = size < sizeof(fmt) ? static_cast<size_t>(size) : sizeof(fmt);
+            if (!readFully(fd, fmt, n, body)) {
+                return WAV_UNSUPPORTED;
+            }
+            formatTag = static_cast<unsigned>(getLe(fmt, 2));
+            info->channels = static_cast<int>(getLe(fmt + 2, 2));
+            info->sampleRate = static_cast<int>(getLe(fmt + 4, 4));
+            info->bitsPerSample = static_cast<int>(getLe(fmt + 14, 2));
+            if (formatTag == WAVE_FORMAT_EXTENSIBLE && n >= 26) {
+                // the sub-format GUID starts with the actual tag
+                formatTag = static_cast<unsigned>(getLe(fmt + 24, 2));
+            }
+            haveFormat = true;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            if (!haveFormat || formatTag != WAVE_FORMAT_PCM || info->bitsPerSample != 16
+                || info->channels <= 0 || info->sampleRate <= 0) {
+                return WAV_UNSUPPORTED;
+            }
+            if (info->rf64 && size == 0xFFFFFFFFULL) {
+                size = ds64Data;
+            }
+            unsigned long long available = fileSize > body ? fileSize - body : 0;
+            // a streaming writer that never patched its header leaves 0
+            // here, or a size past the end of what it managed to write
+            if (size == 0 || size > available) {
+                size = available;
+            }
+            unsigned blockAlign = info->channels * sizeof(short);
+            info->dataOffset = body;
+            info->dataBytes = size / blockAlign * blockAlign;
+            return WAV_PCM16;
+        }
+        // chunks are padded to an even size
+        offset = body + size + (size & 1);
+    }
+    return WAV_UNSUPPORTED;
+}
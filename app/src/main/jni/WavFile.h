@@ -0,0 +1,102 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_WAVFILE_H
+#define NATIVEFEEDBACK_WAVFILE_H
+
+#include <cstddef>
+
+// the writer hands the file audio in chunks of this many bytes, each at an
+// offset that's a multiple of it, so the kernel never sees a partial page
+#define WAV_WRITE_CHUNK_BYTES (256 * 1024)
+// RIFF sizes are 32 bits; past this the file is rewritten as RF64 (EBU
+// Tech 3306), with the real sizes in a ds64 chunk
+#define WAV_RIFF_LIMIT 0xFFFFFFFFULL
+
+// what WavReader::probe() found
+enum WavProbeResult {
+    // no RIFF/RF64 WAVE header: raw PCM
+    WAV_NONE = 0,
+    // 16-bit integer PCM, the only layout the pipeline plays
+    WAV_PCM16,
+    // a WAV file, but of another sample format or too damaged to play
+    WAV_UNSUPPORTED,
+};
+
+struct WavInfo {
+    int sampleRate;
+    int channels;
+    int bitsPerSample;
+    bool rf64;
+    // the samples, whole frames only: a writer that died before patching
+    // the header leaves a data chunk that runs to the end of the file
+    unsigned long long dataOffset;
+    unsigned long long dataBytes;
+};
+
+// Streaming WAV writer for recordings of any length.
+//
+// open() reserves an 80 byte header: RIFF, a JUNK chunk big enough to turn
+// into a ds64 chunk later, fmt and the data chunk header. The audio goes
+// through a page aligned staging buffer and reaches the file with one
+// write per WAV_WRITE_CHUNK_BYTES. After every chunk the RIFF and data sizes
+// are patched in place, so if the process dies the header still covers
+// everything that made it to disk, and repair() can account for the rest.
+// Once the file outgrows WAV_RIFF_LIMIT the header becomes RF64.
+//
+// Without the container (open(..., false)) the same writer produces raw
+// headerless PCM, the engine's original file format.
+class WavWriter {
+public:
+    WavWriter();
+    ~WavWriter();
+
+    bool open(const char *path, int sampleRate, int channels, bool container = true);
+    bool write(const void *data, size_t bytes);
+    // writes out what's staged and patches the header; false if any write
+    // since open() failed
+    bool close();
+    bool isOpen() const { return fd_ >= 0; }
+    unsigned long long dataBytes() const { return dataBytes_; }
+
+    // lowers the RF64 threshold, so tests don't have to write 4 GB
+    void setRiffLimit(unsigned long long limit) { riffLimit_ = limit; }
+
+    // true when path ends in .wav
+    static bool isWavPath(const char *path);
+    // sets the sizes of a WAV file from its length, for one whose writer
+    // never got to close it
+    static bool repair(const char *path);
+
+private:
+    WavWriter(const WavWriter &);
+    WavWriter &operator=(const WavWriter &);
+
+    static const int HEADER_BYTES = 80;
+    void buildHeader(unsigned char *header) const;
+    bool flushStaged(size_t bytes);
+    bool patchHeader();
+
+    int fd_;
+    bool container_;
+    int sampleRate_;
+    int channels_;
+    unsigned char *staging_;
+    size_t staged_;
+    // file offset of staging_[0]
+    unsigned long long stagingOffset_;
+    unsigned long long dataBytes_;
+    unsigned long long riffLimit_;
+    bool failed_;
+};
+
+// Finds the fmt and data chunks of a RIFF or RF64 WAVE file.
+class WavReader {
+public:
+    static WavProbeResult probe(const char *path, WavInfo *info);
+    // the same on a file that's already open, from its start
+    static WavProbeResult probe(int fd, WavInfo *info);
+};
+
+#endif //NATIVEFEEDBACK_WAVFILE_H
@@ -0,0 +1,119 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+
+// which pool's worker the current thread is, if any
+static thread_local const WorkStealingPool *currentPool = NULL;
+static thread_local int currentIndex = -1;
+
+WorkStealingPool::WorkStealingPool(unsigned threads)
+        : nextWorker_(0),
+          queued_(0),
+          pending_(0),
+          steals_(0),
+          stopping_(false) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        workers_.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+    // every deque exists before any worker looks for something to steal
+    for (unsigned i = 0; i < threads; i++) {
+        workers_[i]->thread = std::thread(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(idleLock_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (size_t i = 0; i < workers_.size(); i++) {
+        workers_[i]->thread.join();
+    }
+}
+
+int WorkStealingPool::currentWorker() const {
+    return currentPool == this ? currentIndex : -1;
+}
+
+void WorkStealingPool::submit(Task task, void *context, size_t begin, size_t end) {
+    Item item = {task, context, begin, end};
+    int self = currentWorker();
+    unsigned index = self >= 0 ? static_cast<unsigned>(self)
+                               : nextWorker_.fetch_add(1, std::memory_order_relaxed)
+                                 % workers_.size();
+    // counted before it can possibly finish
+    pending_.fetch_add(1, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(workers_[index]->lock);
+        workers_[index]->tasks.push_back(item);
+    }
+    queued_.fetch_add(1, std::memory_order_release);
+    // an idle worker checks queued_ under idleLock_, so it can't miss this
+    {
+        std::lock_guard<std::mutex> lock(idleLock_);
+    }
+    wake_.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(idleLock_);
+    while (pending_.load(std::memory_order_acquire) > 0) {
+        done_.wait(lock);
+    }
+}
+
+bool WorkStealingPool::take(unsigned index, Item *item) {
+    {
+        Worker &own = *workers_[index];
+        std::lock_guard<std::mutex> lock(own.lock);
+        if (!own.tasks.empty()) {
+            *item = own.tasks.back();
+            own.tasks.pop_back();
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    for (size_t i = 1; i < workers_.size(); i++) {
+        Worker &victim = *workers_[(index + i) % workers_.size()];
+        std::lock_guard<std::mutex> lock(victim.lock);
+        if (!victim.tasks.empty()) {
+            *item = victim.tasks.front();
+            victim.tasks.pop_front();
+            queued_.fetch_sub(1, std::memory_order_relaxed);
+            steals_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(unsigned index) {
+    currentPool = this;
+    currentIndex = static_cast<int>(index);
+    for (;;) {
+        Item item;
+        if (take(index, &item)) {
+            item.task(item.context, item.begin, item.end);
+            if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                std::lock_guard<std::mutex> lock(idleLock_);
+                done_.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(idleLock_);
+        while (!stopping_ && queued_.load(std::memory_order_acquire) == 0) {
+            wake_.wait(lock);
+        }
+        if (stopping_ && queued_.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
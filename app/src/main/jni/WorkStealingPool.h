@@ -0,0 +1,84 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_WORKSTEALINGPOOL_H
+#define NATIVEFEEDBACK_WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Thread pool for offline work, where tasks are whole files and chunks of
+// them rather than audio callbacks.
+//
+// Every worker has its own deque. A task submitted from a worker goes on
+// the bottom of that worker's deque and the worker takes its next task from
+// the bottom too, so it keeps working on what it just split off while the
+// data is still in cache. A worker whose deque is empty steals from the top
+// of another's, which is where the oldest and, for a task that splits its
+// range in halves, the biggest pieces are. Tasks submitted from outside the
+// pool are dealt round robin. Deques are guarded by a mutex each; tasks are
+// meant to be milliseconds long, so it's never contended for long.
+class WorkStealingPool {
+public:
+    // runs [begin, end) of whatever context describes
+    typedef void (*Task)(void *context, size_t begin, size_t end);
+
+    // threads 0 is one per core
+    explicit WorkStealingPool(unsigned threads = 0);
+    // waits for everything submitted, then stops the workers
+    ~WorkStealingPool();
+
+    // from any thread, workers included
+    void submit(Task task, void *context, size_t begin, size_t end);
+    // blocks until every task submitted so far, and every task they
+    // submitted, has run; not from a worker
+    void wait();
+
+    unsigned threads() const { return static_cast<unsigned>(workers_.size()); }
+    // tasks a worker took off another's deque
+    unsigned long long steals() const { return steals_.load(std::memory_order_relaxed); }
+    // the index of the calling worker, -1 off the pool
+    int currentWorker() const;
+
+private:
+    WorkStealingPool(const WorkStealingPool &);
+    WorkStealingPool &operator=(const WorkStealingPool &);
+
+    struct Item {
+        Task task;
+        void *context;
+        size_t begin;
+        size_t end;
+    };
+
+    struct Worker {
+        std::mutex lock;
+        std::deque<Item> tasks;
+        std::thread thread;
+    };
+
+    void workerLoop(unsigned index);
+    // the bottom of the worker's own deque, or the top of someone else's
+    bool take(unsigned index, Item *item);
+
+    std::vector<std::unique_ptr<Worker> > workers_;
+    std::atomic<unsigned> nextWorker_;
+    // items sitting in deques, and items submitted but not finished
+    std::atomic<size_t> queued_;
+    std::atomic<size_t> pending_;
+    std::atomic<unsigned long long> steals_;
+
+    std::mutex idleLock_;
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    bool stopping_;
+};
+
+#endif //NATIVEFEEDBACK_WORKSTEALINGPOOL_H
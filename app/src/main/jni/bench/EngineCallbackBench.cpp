@@ -0,0 +1,92 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+// Runs record and playback sessions through AudioEngine on a freewheeling
+// HostBackend and reports what the buffer queue callbacks cost and how much
+// faster than real time the engine moves audio. "dropped" counts the buffers
+// the reader or writer thread could not turn around in time for the device:
+// silence played or input lost.
+//
+// usage: EngineCallbackBench [seconds of audio] [framesPerBurst]
+//
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "HostBackend.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static void report(const char *name, const HostCallbackStats &stats, double audioSeconds,
+                   double wallSeconds, unsigned dropped) {
+    printf("%-16s %9llu %10.0f %10.0f %8llu %8u %9.1fx\n", name, stats.callbacks,
+           stats.callbacks ? static_cast<double>(stats.totalNs) / stats.callbacks : 0.0,
+           static_cast<double>(stats.maxNs), stats.starvedBursts, dropped,
+           audioSeconds / wallSeconds);
+}
+
+static void benchPlay(const char *name, const char *path, bool mapped, int framesPerBurst,
+                      double audioSeconds) {
+    HostBackend *backend = new HostBackend(framesPerBurst, 0);
+    AudioEngine engine(backend);
+    engine.setMappedPlayback(mapped);
+    engine.configure(FILE_SAMPLE_RATE, framesPerBurst);
+    Clock::time_point begin = Clock::now();
+    engine.startPlay(path);
+    while (!engine.playFinished()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    double wall = std::chrono::duration<double>(Clock::now() - begin).count();
+    report(name, backend->playerStats(), audioSeconds, wall, engine.playback().underruns());
+}
+
+static void benchRecord(const char *path, const std::vector<short> &input, int framesPerBurst,
+                        double audioSeconds) {
+    MemoryPcmSource source(input.data(), input.size() * sizeof(short));
+    HostBackend *backend = new HostBackend(framesPerBurst, 0);
+    backend->setInput(&source);
+    AudioEngine engine(backend);
+    engine.configure(FILE_SAMPLE_RATE, framesPerBurst);
+    engine.createAudioRecorder();
+    Clock::time_point begin = Clock::now();
+    engine.startRecord(path);
+    // stop once the device has pulled the whole input
+    double callbacks = audioSeconds * FILE_SAMPLE_RATE / engine.recorderFramesPerBuffer();
+    while (backend->recorderStats().callbacks < callbacks) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    engine.stopRecord();
+    double wall = std::chrono::duration<double>(Clock::now() - begin).count();
+    HostCallbackStats stats = backend->recorderStats();
+    double recorded = stats.callbacks * engine.recorderFramesPerBuffer() / double(FILE_SAMPLE_RATE);
+    report("record", stats, recorded, wall, engine.capture().overruns());
+}
+
+int main(int argc, char **argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 60;
+    int framesPerBurst = argc > 2 ? atoi(argv[2]) : 192;
+    const char *path = "/tmp/EngineCallbackBench.pcm";
+
+    std::vector<short> audio(static_cast<size_t>(seconds * 44100));
+    for (size_t i = 0; i < audio.size(); i++) {
+        audio[i] = static_cast<short>((i * 7919) & 0x7fff);
+    }
+    FILE *out = fopen(path, "wb");
+    fwrite(audio.data(), sizeof(short), audio.size(), out);
+    fclose(out);
+
+    printf("%.0fs of 44.1 kHz mono, %d frames per burst, freewheeling host device\n", seconds,
+           framesPerBurst);
+    printf("%-16s %9s %10s %10s %8s %8s %10s\n", "session", "callbacks", "mean ns", "max ns",
+           "starved", "dropped", "speed");
+    benchPlay("play mapped", path, true, framesPerBurst, seconds);
+    benchPlay("play streamed", path, false, framesPerBurst, seconds);
+    benchRecord(path, audio, framesPerBurst, seconds);
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,96 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+// What feedback suppression costs on the monitor's recorder callback.
+//
+// The first table is the notch bank alone, all eight notches, in each kernel
+// set this CPU runs, per burst and as a share of the burst's duration. The
+// second runs the whole suppressor on a howling mic, eight notches placed
+// and the analysis running every hop, and reports the mean and the worst
+// burst: the worst is a burst that ends a hop and pays for the FFT.
+//
+// usage: FeedbackSuppressorBench [framesPerBurst] [sample rate] [seconds]
+//
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "FeedbackSuppressor.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static void benchBank(const PcmKernels &k, int burst, int rate, double seconds) {
+    float coefs[5 * PCM_BIQUAD_STAGES];
+    float state[2 * PCM_BIQUAD_STAGES] = {0};
+    for (int s = 0; s < PCM_BIQUAD_STAGES; s++) {
+        // -12 dB cuts of Q 30 from 500 Hz up, as the suppressor designs them
+        double a = pow(10.0, -12 / 40.0), w0 = 2 * M_PI * 500 * (s + 1) / rate;
+        double alpha = sin(w0) / 60, a0 = 1 + alpha / a;
+        coefs[s] = static_cast<float>((1 + alpha * a) / a0);
+        coefs[PCM_BIQUAD_STAGES + s] = static_cast<float>(-2 * cos(w0) / a0);
+        coefs[2 * PCM_BIQUAD_STAGES + s] = static_cast<float>((1 - alpha * a) / a0);
+        coefs[3 * PCM_BIQUAD_STAGES + s] = coefs[PCM_BIQUAD_STAGES + s];
+        coefs[4 * PCM_BIQUAD_STAGES + s] = static_cast<float>((1 - alpha / a) / a0);
+    }
+    std::vector<float> samples(burst);
+    size_t bursts = static_cast<size_t>(seconds * rate / burst);
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < bursts; i++) {
+        for (int j = 0; j < burst; j++) {
+            samples[j] = 0.25f * sinf(0.05f * (i * burst + j));
+        }
+        k.biquadCascade(&samples[0], burst, coefs, state);
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / bursts;
+    double budget = 1e9 * burst / rate;
+    printf("%-10s %12.0f %11.2f%%\n", k.name, ns, 100 * ns / budget);
+}
+
+int main(int argc, char **argv) {
+    int burst = argc > 1 ? atoi(argv[1]) : 192;
+    int rate = argc > 2 ? atoi(argv[2]) : 48000;
+    double seconds = argc > 3 ? atof(argv[3]) : 20;
+    printf("burst %d frames at %d Hz: %.0f us\n\n", burst, rate, 1e6 * burst / rate);
+
+    printf("%-10s %12s %12s\n", "notches", "ns/burst", "of burst");
+    const PcmKernels::Set sets[] = {PcmKernels::SET_SCALAR, PcmKernels::SET_SSE,
+                                    PcmKernels::SET_NEON};
+    for (size_t i = 0; i < sizeof(sets) / sizeof(sets[0]); i++) {
+        if (PcmKernels::get(sets[i]) != NULL) {
+            benchBank(*PcmKernels::get(sets[i]), burst, rate, seconds);
+        }
+    }
+
+    // eight tones ringing up at once fill the bank within the first second
+    FeedbackSuppressor suppressor;
+    suppressor.init(rate, 1);
+    size_t bursts = static_cast<size_t>(seconds * rate / burst);
+    std::vector<short> samples(burst);
+    double total = 0, worst = 0;
+    size_t frame = 0;
+    for (size_t i = 0; i < bursts; i++) {
+        double t = static_cast<double>(frame) / rate;
+        double level = std::min(1.0, 0.01 * pow(10.0, t));
+        for (int j = 0; j < burst; j++, frame++) {
+            double v = 0;
+            for (int s = 1; s <= FEEDBACK_MAX_NOTCHES; s++) {
+                v += sin(2 * M_PI * (313.0 * s + 7) * frame / rate);
+            }
+            samples[j] = static_cast<short>(3000 * level * v);
+        }
+        Clock::time_point start = Clock::now();
+        suppressor.process(&samples[0], burst);
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        total += ns;
+        worst = std::max(worst, ns);
+    }
+    double budget = 1e9 * burst / rate;
+    printf("\n%-10s %12s %12s %12s %9s\n", "process", "mean ns", "worst ns", "worst/burst",
+           "notches");
+    printf("%-10s %12.0f %12.0f %11.2f%% %9u\n", PcmKernels::best().name, total / bursts, worst,
+           100 * worst / budget, suppressor.activeNotches());
+    return 0;
+}
@@ -0,0 +1,87 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+// Offline throughput against the number of workers. Writes a batch of
+// synthetic 44.1 kHz stereo WAV files to /tmp and converts them to 48 kHz,
+// first as many files as workers with the default chunking, then one long
+// file that only chunking can spread over the workers. Reports the batch's
+// multiple of real time for each thread count and the steals it took.
+//
+// usage: OfflineBench [files] [seconds per file] [max threads]
+//
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "OfflineEngine.h"
+#include "WavFile.h"
+
+static const int RATE = 44100;
+
+static bool writeInput(const char *path, double seconds, unsigned seed) {
+    size_t frames = static_cast<size_t>(seconds * RATE);
+    std::vector<short> data(frames * 2);
+    for (size_t i = 0; i < frames; i++) {
+        seed = seed * 1103515245 + 12345;
+        double noise = static_cast<int>(seed >> 16 & 0x3FF) - 512;
+        data[2 * i] = static_cast<short>(8000 * sin(2 * M_PI * 440 * i / RATE) + noise);
+        data[2 * i + 1] = static_cast<short>(8000 * sin(2 * M_PI * 660 * i / RATE) + noise);
+    }
+    WavWriter writer;
+    return writer.open(path, RATE, 2, true) && writer.write(data.data(), data.size() * sizeof(short))
+           && writer.close();
+}
+
+static void benchBatch(const char *name, const std::vector<std::string> &inputs,
+                       unsigned maxThreads) {
+    std::vector<std::string> outputs;
+    for (size_t i = 0; i < inputs.size(); i++) {
+        outputs.push_back(inputs[i] + ".out.wav");
+    }
+    printf("\n%s\n%-8s %10s %10s %10s %8s %8s\n", name, "threads", "audio s", "wall s",
+           "x real", "chunks", "steals");
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+        OfflineConfig config;
+        config.sampleRate = 48000;
+        config.threads = threads;
+        OfflineEngine engine(config);
+        OfflineReport report;
+        engine.run(inputs, outputs, &report, NULL);
+        printf("%-8u %10.1f %10.3f %10.1f %8u %8llu\n", threads, report.audioSeconds,
+               report.wallSeconds, report.realtimeFactor, report.chunks, report.steals);
+    }
+    for (size_t i = 0; i < outputs.size(); i++) {
+        unlink(outputs[i].c_str());
+    }
+}
+
+int main(int argc, char **argv) {
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    unsigned files = argc > 1 ? static_cast<unsigned>(atoi(argv[1])) : cores;
+    double seconds = argc > 2 ? atof(argv[2]) : 60;
+    unsigned maxThreads = argc > 3 ? static_cast<unsigned>(atoi(argv[3])) : cores;
+    printf("%u cores, %u files of %.0f s, 44.1 kHz stereo to 48 kHz\n", cores, files, seconds);
+
+    std::vector<std::string> inputs;
+    for (unsigned i = 0; i < files; i++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/tmp/OfflineBench_%u.wav", i);
+        if (!writeInput(path, seconds, i + 1)) {
+            printf("can't write %s\n", path);
+            return 1;
+        }
+        inputs.push_back(path);
+    }
+    benchBatch("a file per worker", inputs, maxThreads);
+    benchBatch("one file in chunks", std::vector<std::string>(1, inputs[0]), maxThreads);
+    for (size_t i = 0; i < inputs.size(); i++) {
+        unlink(inputs[i].c_str());
+    }
+    return 0;
+}
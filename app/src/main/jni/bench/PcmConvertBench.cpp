@@ -0,0 +1,222 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+// Throughput of every PcmConvert kernel in each kernel set this CPU runs, in
+// GB/s of input plus output touched. Buffers are burst sized by default so
+// they stay in cache like they do on the stream paths; pass a bigger count
+// to measure memory bound throughput instead.
+//
+// usage: PcmConvertBench [samples per call] [milliseconds per kernel]
+//
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "PcmConvert.h"
+
+typedef std::chrono::steady_clock Clock;
+
+struct Buffers {
+    std::vector<short> s16;
+    std::vector<short> s16Stereo;
+    std::vector<unsigned char> s24;
+    std::vector<int> s32;
+    std::vector<float> f;
+    std::vector<float> fRight;
+    std::vector<float> fStereo;
+
+    explicit Buffers(size_t n)
+            : s16(n), s16Stereo(n * 2), s24(n * 3), s32(n), f(n), fRight(n), fStereo(n * 2) {
+        for (size_t i = 0; i < n; i++) {
+            f[i] = static_cast<float>((i * 7919) % 2000) / 1000.0f - 1.0f;
+            fRight[i] = -f[i];
+            s16[i] = static_cast<short>(f[i] * 30000);
+        }
+    }
+};
+
+// one kernel call on the buffers, returning the bytes it read and wrote
+typedef size_t (*Op)(const PcmKernels &k, Buffers &b, size_t n);
+
+static size_t s16ToFloat(const PcmKernels &k, Buffers &b, size_t n) {
+    k.s16ToFloat(&b.s16[0], &b.f[0], n);
+    return n * (2 + 4);
+}
+static size_t floatToS16(const PcmKernels &k, Buffers &b, size_t n) {
+    k.floatToS16(&b.f[0], &b.s16[0], n);
+    return n * (4 + 2);
+}
+static size_t floatToS16Dither(const PcmKernels &k, Buffers &b, size_t n) {
+    static PcmDither dither;
+    k.floatToS16Dither(&b.f[0], &b.s16[0], n, &dither);
+    return n * (4 + 2);
+}
+static size_t s24ToFloat(const PcmKernels &k, Buffers &b, size_t n) {
+    k.s24ToFloat(&b.s24[0], &b.f[0], n);
+    return n * (3 + 4);
+}
+static size_t floatToS24(const PcmKernels &k, Buffers &b, size_t n) {
+    k.floatToS24(&b.f[0], &b.s24[0], n);
+    return n * (4 + 3);
+}
+static size_t s32ToFloat(const PcmKernels &k, Buffers &b, size_t n) {
+    k.s32ToFloat(&b.s32[0], &b.f[0], n);
+    return n * (4 + 4);
+}
+static size_t floatToS32(const PcmKernels &k, Buffers &b, size_t n) {
+    k.floatToS32(&b.f[0], &b.s32[0], n);
+    return n * (4 + 4);
+}
+static size_t monoToStereo(const PcmKernels &k, Buffers &b, size_t n) {
+    k.monoToStereo(&b.s16[0], &b.s16Stereo[0], n);
+    return n * (2 + 4);
+}
+static size_t stereoToMono(const PcmKernels &k, Buffers &b, size_t n) {
+    k.stereoToMono(&b.s16Stereo[0], &b.s16[0], n);
+    return n * (4 + 2);
+}
+static size_t interleave(const PcmKernels &k, Buffers &b, size_t n) {
+    k.interleave(&b.f[0], &b.fRight[0], &b.fStereo[0], n);
+    return n * (8 + 8);
+}
+static size_t deinterleave(const PcmKernels &k, Buffers &b, size_t n) {
+    k.deinterleave(&b.fStereo[0], &b.f[0], &b.fRight[0], n);
+    return n * (8 + 8);
+}
+static size_t applyGainMono(const PcmKernels &k, Buffers &b, size_t n) {
+    static const float gain = 0.999f;
+    k.applyGain(&b.s16[0], n, 1, &gain);
+    return n * (2 + 2);
+}
+static size_t applyGainStereo(const PcmKernels &k, Buffers &b, size_t n) {
+    static const float gains[2] = {0.999f, 1.001f};
+    k.applyGain(&b.s16Stereo[0], n, 2, gains);
+    return n * (4 + 4);
+}
+static size_t mixMono(const PcmKernels &k, Buffers &b, size_t n) {
+    static const float gains[2] = {0.5f, 0.7f};
+    static const float steps[2] = {1e-6f, -1e-6f};
+    k.mixToStereo(&b.s16[0], 1, &b.fStereo[0], n, gains, steps);
+    return n * (2 + 8 + 8);
+}
+static size_t mixStereo(const PcmKernels &k, Buffers &b, size_t n) {
+    static const float gains[2] = {0.5f, 0.7f};
+    static const float steps[2] = {1e-6f, -1e-6f};
+    k.mixToStereo(&b.s16Stereo[0], 2, &b.fStereo[0], n, gains, steps);
+    return n * (4 + 8 + 8);
+}
+// every stage of a complex FFT over the largest power of two that fits
+static size_t fftStages(const PcmKernels &k, Buffers &b, size_t n) {
+    size_t size = 2;
+    while (size * 2 <= n) {
+        size *= 2;
+    }
+    float *re = &b.fStereo[0];
+    float *im = &b.fStereo[size];
+    size_t bytes = 0;
+    for (unsigned half = 1; half < size; half *= 2) {
+        k.fftStage(re, im, size, half, &b.f[0], &b.fRight[0], 1.0f);
+        bytes += size * (8 + 8) + half * 8;
+    }
+    return bytes;
+}
+
+// eight notches in series, mono, state carried from call to call
+static size_t biquadCascade(const PcmKernels &k, Buffers &b, size_t n) {
+    static float coefs[5 * PCM_BIQUAD_STAGES];
+    static float state[2 * PCM_BIQUAD_STAGES];
+    if (coefs[0] == 0) {
+        for (int s = 0; s < PCM_BIQUAD_STAGES; s++) {
+            // poles at radius 0.99, zeros on the unit circle at the same angle
+            float c = static_cast<float>(cos(0.1 + 0.3 * s));
+            coefs[s] = 1;
+            coefs[PCM_BIQUAD_STAGES + s] = -2 * c;
+            coefs[2 * PCM_BIQUAD_STAGES + s] = 1;
+            coefs[3 * PCM_BIQUAD_STAGES + s] = -2 * 0.99f * c;
+            coefs[4 * PCM_BIQUAD_STAGES + s] = 0.99f * 0.99f;
+        }
+    }
+    k.biquadCascade(&b.f[0], n, coefs, state);
+    return n * (4 + 4);
+}
+
+// a correlation search as the time stretcher runs it: a quarter of the
+// block against every lag over the rest
+static size_t crossCorrelate(const PcmKernels &k, Buffers &b, size_t n) {
+    size_t length = n / 4;
+    size_t lags = n - length + 1;
+    k.crossCorrelate(&b.f[0], &b.fRight[0], length, lags, &b.fStereo[0]);
+    return length * lags * 8 + lags * 4;
+}
+
+struct Case {
+    const char *name;
+    Op op;
+};
+
+static const Case CASES[] = {
+        {"s16ToFloat", s16ToFloat},
+        {"floatToS16", floatToS16},
+        {"floatToS16Dither", floatToS16Dither},
+        {"s24ToFloat", s24ToFloat},
+        {"floatToS24", floatToS24},
+        {"s32ToFloat", s32ToFloat},
+        {"floatToS32", floatToS32},
+        {"monoToStereo", monoToStereo},
+        {"stereoToMono", stereoToMono},
+        {"interleave", interleave},
+        {"deinterleave", deinterleave},
+        {"applyGain 1ch", applyGainMono},
+        {"applyGain 2ch", applyGainStereo},
+        {"mixToStereo 1ch", mixMono},
+        {"mixToStereo 2ch", mixStereo},
+        {"fftStage", fftStages},
+        {"biquadCascade", biquadCascade},
+        {"crossCorrelate", crossCorrelate},
+};
+
+static double gbPerSec(const PcmKernels &k, const Case &c, Buffers &b, size_t n, double ms) {
+    size_t bytes = 0;
+    Clock::time_point start = Clock::now();
+    Clock::time_point end = start + std::chrono::microseconds(static_cast<long long>(ms * 1000));
+    Clock::time_point now;
+    do {
+        // enough calls between clock reads that reading it costs nothing
+        for (int i = 0; i < 64; i++) {
+            bytes += c.op(k, b, n);
+        }
+        now = Clock::now();
+    } while (now < end);
+    return bytes / std::chrono::duration<double>(now - start).count() / 1e9;
+}
+
+int main(int argc, char **argv) {
+    size_t n = argc > 1 ? atoi(argv[1]) : 1024;
+    double ms = argc > 2 ? atof(argv[2]) : 200;
+
+    std::vector<const PcmKernels *> sets;
+    for (int s = PcmKernels::SET_SCALAR; s <= PcmKernels::SET_NEON; s++) {
+        const PcmKernels *k = PcmKernels::get(static_cast<PcmKernels::Set>(s));
+        if (k != NULL) {
+            sets.push_back(k);
+        }
+    }
+
+    Buffers buffers(n);
+    printf("%zu samples per call, best set %s, GB/s\n", n, PcmKernels::best().name);
+    printf("%-18s", "kernel");
+    for (size_t s = 0; s < sets.size(); s++) {
+        printf("%10s", sets[s]->name);
+    }
+    printf("\n");
+    for (size_t c = 0; c < sizeof(CASES) / sizeof(CASES[0]); c++) {
+        printf("%-18s", CASES[c].name);
+        for (size_t s = 0; s < sets.size(); s++) {
+            printf("%10.2f", gbPerSec(*sets[s], CASES[c], buffers, n, ms));
+        }
+        printf("\n");
+    }
+    return 0;
+}
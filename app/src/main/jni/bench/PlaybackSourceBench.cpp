@@ -0,0 +1,158 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+// Compares the cost of getting each player buffer out of a PCM file through
+// std::ifstream reads, through copies out of a mapping, and through the
+// zero-copy mapped PlaybackStream that enqueues slices of the mapping in place.
+//
+// usage: PlaybackSourceBench [file] [megabytes] [framesPerBuffer]
+//
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "MappedPcmSource.h"
+#include "PcmSource.h"
+#include "PlaybackStream.h"
+
+typedef std::chrono::steady_clock Clock;
+
+struct Result {
+    double meanNs;
+    double p99Ns;
+    double maxNs;
+    double mbPerSec;
+    long long checksum;
+};
+
+static long long consume(const short *samples, unsigned count) {
+    long long sum = 0;
+    for (unsigned i = 0; i < count; i++) {
+        sum += samples[i];
+    }
+    return sum;
+}
+
+static Result summarize(std::vector<double> &ns, double seconds, size_t bytes, long long checksum) {
+    Result r;
+    double total = 0;
+    for (size_t i = 0; i < ns.size(); i++) {
+        total += ns[i];
+    }
+    std::sort(ns.begin(), ns.end());
+    r.meanNs = ns.empty() ? 0 : total / ns.size();
+    r.p99Ns = ns.empty() ? 0 : ns[ns.size() * 99 / 100];
+    r.maxNs = ns.empty() ? 0 : ns.back();
+    r.mbPerSec = bytes / seconds / (1024.0 * 1024.0);
+    r.checksum = checksum;
+    return r;
+}
+
+// drops the file from the page cache so the next run reads from flash
+static void evict(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+static Result runSource(PcmSource &source, unsigned bufferBytes) {
+    std::vector<short> buffer(bufferBytes / sizeof(short));
+    std::vector<double> ns;
+    long long checksum = 0;
+    size_t total = 0;
+    Clock::time_point begin = Clock::now();
+    for (;;) {
+        Clock::time_point t0 = Clock::now();
+        size_t n = source.read(&buffer[0], bufferBytes);
+        checksum += consume(&buffer[0], n / sizeof(short));
+        ns.push_back(std::chrono::duration<double, std::nano>(Clock::now() - t0).count());
+        if (n == 0) {
+            break;
+        }
+        total += n;
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    return summarize(ns, seconds, total, checksum);
+}
+
+static Result runZeroCopy(const char *path, int framesPerBuffer) {
+    PlaybackStream stream(1, 64);
+    stream.open(path, framesPerBuffer, PlaybackStream::SOURCE_MAPPED);
+    std::vector<double> ns;
+    long long checksum = 0;
+    size_t total = 0;
+    Clock::time_point begin = Clock::now();
+    for (;;) {
+        Clock::time_point t0 = Clock::now();
+        stream.onBufferPlayed();
+        unsigned bytes;
+        const short *buffer = stream.nextBuffer(&bytes);
+        if (buffer == NULL) {
+            break;
+        }
+        checksum += consume(buffer, bytes / sizeof(short));
+        ns.push_back(std::chrono::duration<double, std::nano>(Clock::now() - t0).count());
+        total += bytes;
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - begin).count();
+    stream.close();
+    return summarize(ns, seconds, total, checksum);
+}
+
+static void print(const char *name, const Result &r) {
+    printf("%-22s %10.0f %10.0f %10.0f %10.1f   %lld\n", name, r.meanNs, r.p99Ns, r.maxNs,
+           r.mbPerSec, r.checksum);
+}
+
+int main(int argc, char **argv) {
+    const char *path = argc > 1 ? argv[1] : "/tmp/PlaybackSourceBench.pcm";
+    size_t megabytes = argc > 2 ? strtoul(argv[2], NULL, 10) : 64;
+    int framesPerBuffer = argc > 3 ? atoi(argv[3]) : 256;
+    unsigned bufferBytes = framesPerBuffer * sizeof(short);
+
+    std::vector<short> chunk(1 << 16);
+    for (size_t i = 0; i < chunk.size(); i++) {
+        chunk[i] = static_cast<short>((i * 7919) & 0x7fff);
+    }
+    FILE *out = fopen(path, "wb");
+    if (out == NULL) {
+        fprintf(stderr, "cannot create %s\n", path);
+        return 1;
+    }
+    size_t bytes = megabytes << 20;
+    for (size_t written = 0; written < bytes; written += chunk.size() * sizeof(short)) {
+        fwrite(&chunk[0], sizeof(short), chunk.size(), out);
+    }
+    fclose(out);
+
+    printf("%zu MB, %d frames per buffer\n", megabytes, framesPerBuffer);
+    printf("%-22s %10s %10s %10s %10s   %s\n", "source", "mean ns", "p99 ns", "max ns", "MB/s",
+           "checksum");
+    for (int cold = 1; cold >= 0; cold--) {
+        printf("-- %s page cache\n", cold ? "cold" : "warm");
+        if (cold) evict(path);
+        FilePcmSource fileSource;
+        fileSource.open(path);
+        print("fstream read", runSource(fileSource, bufferBytes));
+        fileSource.close();
+
+        if (cold) evict(path);
+        MappedPcmSource mappedSource;
+        mappedSource.open(path);
+        print("mmap copy", runSource(mappedSource, bufferBytes));
+        mappedSource.close();
+
+        if (cold) evict(path);
+        print("mmap zero-copy", runZeroCopy(path, framesPerBuffer));
+    }
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,76 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+// Cost of the polyphase resampler per output frame, for every kernel this CPU
+// can run, on the conversions the streams actually do, and of the low quality
+// filter the CPU budget falls back to. Input is processed in burst-sized
+// chunks like the reader and writer threads feed it.
+//
+// usage: ResamplerBench [seconds of audio] [framesPerBurst]
+//
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "Resampler.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static void run(int inRate, int outRate, int channels, Resampler::Kernel kernel,
+                Resampler::Quality quality, double seconds, size_t burst) {
+    Resampler resampler;
+    if (!resampler.init(inRate, outRate, channels) || !resampler.setKernel(kernel)) {
+        return;
+    }
+    resampler.setQuality(quality);
+    size_t inFrames = static_cast<size_t>(seconds * inRate);
+    std::vector<short> in(inFrames * channels);
+    for (size_t i = 0; i < in.size(); i++) {
+        in[i] = static_cast<short>(12000 * std::sin(i * 0.05));
+    }
+    std::vector<short> out(resampler.outputFramesFor(burst) * channels);
+
+    long long checksum = 0;
+    size_t produced = 0;
+    Clock::time_point start = Clock::now();
+    for (size_t pos = 0; pos < inFrames;) {
+        size_t n = std::min(burst, inFrames - pos);
+        size_t consumed;
+        size_t written = resampler.process(&in[pos * channels], n, &consumed, &out[0],
+                                           out.size() / channels);
+        checksum += out[0];
+        produced += written;
+        pos += consumed;
+    }
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+    // how much of a real-time second the conversion takes
+    double load = ns / 1e9 / (produced / static_cast<double>(outRate)) * 100;
+    printf("%5d -> %5d  %dch  %-6s %-4s  %7.2f ns/frame  %6.3f%% of real time  (%lld)\n", inRate,
+           outRate, channels, Resampler::kernelName(kernel),
+           quality == Resampler::QUALITY_LOW ? "low" : "high", ns / produced, load, checksum);
+}
+
+int main(int argc, char **argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 30;
+    size_t burst = argc > 2 ? atoi(argv[2]) : 192;
+
+    static const int rates[][2] = {{44100, 48000}, {48000, 44100}};
+    static const Resampler::Kernel kernels[] = {Resampler::KERNEL_SCALAR, Resampler::KERNEL_SSE,
+                                                Resampler::KERNEL_AVX, Resampler::KERNEL_NEON};
+    printf("%d taps per phase (%d low), %zu-frame chunks, best kernel %s\n", RESAMPLER_TAPS,
+           RESAMPLER_LOW_TAPS, burst, Resampler::kernelName(Resampler::bestKernel()));
+    for (int r = 0; r < 2; r++) {
+        for (int channels = 1; channels <= 2; channels++) {
+            for (int k = 0; k < 4; k++) {
+                run(rates[r][0], rates[r][1], channels, kernels[k], Resampler::QUALITY_HIGH,
+                    seconds, burst);
+            }
+            run(rates[r][0], rates[r][1], channels, Resampler::bestKernel(), Resampler::QUALITY_LOW,
+                seconds, burst);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+// What time stretching costs the playback reader, per burst of output.
+//
+// For each kernel set this CPU runs and each speed, a TimeStretcher is
+// drained a burst at a time over a few seconds of a busy stereo signal,
+// and the mean, the 99th percentile and the worst burst are reported as a
+// share of the burst's duration. Most bursts only copy a finished hop out;
+// the percentile is a burst that has to take the next window and pays for
+// its correlation search, the worst usually the thread being preempted.
+//
+// usage: TimeStretchBench [framesPerBurst] [sample rate] [seconds]
+//
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "TimeStretcher.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// two voices gliding over noise, nothing periodic for the search to settle on
+static std::vector<short> signal(size_t frames, int rate) {
+    std::vector<short> samples(frames * 2);
+    unsigned seed = 1;
+    double phaseA = 0, phaseB = 0;
+    for (size_t i = 0; i < frames; i++) {
+        double t = static_cast<double>(i) / rate;
+        phaseA += 2 * M_PI * (180 + 60 * sin(2 * M_PI * 0.7 * t)) / rate;
+        phaseB += 2 * M_PI * (1100 + 400 * sin(2 * M_PI * 0.3 * t)) / rate;
+        seed = seed * 1664525u + 1013904223u;
+        double noise = static_cast<int>(seed >> 22) - 512;
+        samples[2 * i] = static_cast<short>(9000 * sin(phaseA) + 3000 * sin(phaseB) + noise);
+        samples[2 * i + 1] = static_cast<short>(7000 * sin(phaseA) + 5000 * sin(phaseB) - noise);
+    }
+    return samples;
+}
+
+static void bench(const PcmKernels &k, float speed, const std::vector<short> &in, int burst,
+                  int rate, double seconds) {
+    TimeStretcher stretcher;
+    stretcher.init(rate, 2);
+    stretcher.setKernels(k);
+    stretcher.setSpeed(speed);
+    size_t inFrames = in.size() / 2;
+    size_t bursts = static_cast<size_t>(seconds * rate / burst);
+    std::vector<short> out(burst * 2);
+    size_t inPos = 0;
+    std::vector<double> times(bursts);
+    double total = 0;
+    for (size_t i = 0; i < bursts; i++) {
+        size_t written = 0;
+        Clock::time_point start = Clock::now();
+        while (written < static_cast<size_t>(burst)) {
+            if (inPos == inFrames) {
+                inPos = 0;
+            }
+            size_t consumed;
+            written += stretcher.process(&in[inPos * 2], inFrames - inPos, &consumed,
+                                         &out[written * 2], burst - written);
+            inPos += consumed;
+        }
+        double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        total += ns;
+        times[i] = ns;
+    }
+    std::sort(times.begin(), times.end());
+    double budget = 1e9 * burst / rate;
+    printf("%-10s %6.2fx %10.0f %10.2f%% %10.2f%% %10.2f%%\n", k.name, speed, total / bursts,
+           100 * total / bursts / budget, 100 * times[bursts * 99 / 100] / budget,
+           100 * times[bursts - 1] / budget);
+}
+
+int main(int argc, char **argv) {
+    int burst = argc > 1 ? atoi(argv[1]) : 192;
+    int rate = argc > 2 ? atoi(argv[2]) : 48000;
+    double seconds = argc > 3 ? atof(argv[3]) : 10;
+    printf("burst %d frames at %d Hz stereo: %.0f us, windows of %d ms searched +-%d ms\n\n",
+           burst, rate, 1e6 * burst / rate, STRETCH_WINDOW_MS, STRETCH_SEEK_MS);
+
+    // enough input that the top speed doesn't loop it every second
+    std::vector<short> in = signal(static_cast<size_t>(rate * 8), rate);
+    static const float speeds[] = {0.5f, 1.0f, 1.5f, 2.0f, 3.0f};
+    printf("%-10s %7s %10s %11s %11s %11s\n", "kernels", "speed", "mean ns", "mean",
+           "p99", "worst");
+    const PcmKernels::Set sets[] = {PcmKernels::SET_SCALAR, PcmKernels::SET_SSE,
+                                    PcmKernels::SET_NEON};
+    for (size_t s = 0; s < sizeof(sets) / sizeof(sets[0]); s++) {
+        const PcmKernels *k = PcmKernels::get(sets[s]);
+        if (k == NULL) {
+            continue;
+        }
+        for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+            bench(*k, speeds[i], in, burst, rate, seconds);
+        }
+    }
+    return 0;
+}
@@ -42,10 +42,13 @@ JNIEXPORT jint JNICALL Java_com_darrenyuan_nativefeedback_OpenSLRecorder_nativeR
 /*
  * Class:     com_darrenyuan_nativefeedback_OpenSLRecorder
  * Method:    nativeSetMicVolume
- * Signature: ()I
+ * Signature: (I)I
  */
 JNIEXPORT jint JNICALL Java_com_darrenyuan_nativefeedback_OpenSLRecorder_nativeSetMicVolume
-  (JNIEnv *, jobject);
+  (JNIEnv *, jobject, jint);
+
+JNIEXPORT jboolean JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_configure(JNIEnv *env, jobject thiz, jint sampleRate, jint framesPerBurst);
 
 JNIEXPORT jboolean JNICALL
 Java_com_darrenyuan_nativefeedback_OpenSLEngine_createAudioRecorder(JNIEnv *env, jobject thiz);
@@ -65,6 +68,126 @@ Java_com_darrenyuan_nativefeedback_OpenSLEngine_startPlay(JNIEnv *env, jobject t
 JNIEXPORT void JNICALL
 Java_com_darrenyuan_nativefeedback_OpenSLEngine_stopPlay(JNIEnv *env, jobject thiz);
 
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_startPlayAt(JNIEnv *env, jobject thiz, jstring srcFilePath,
+                                                            jlong frame);
+
+JNIEXPORT jboolean JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_seekPlay(JNIEnv *env, jobject thiz, jlong frame);
+
+JNIEXPORT jboolean JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setPlayLoop(JNIEnv *env, jobject thiz, jlong start, jlong end);
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setPlaySpeed(JNIEnv *env, jobject thiz, jfloat speed);
+
+JNIEXPORT jfloat JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getPlaySpeed(JNIEnv *env, jobject thiz);
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_queuePlay(JNIEnv *env, jobject thiz, jstring srcFilePath);
+
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getPlayTrack(JNIEnv *env, jobject thiz);
+
+JNIEXPORT jlong JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getPlayPosition(JNIEnv *env, jobject thiz);
+
+JNIEXPORT jlongArray JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getPlayLength(JNIEnv *env, jobject thiz);
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setMappedPlayback(JNIEnv *env, jobject thiz, jboolean mapped);
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setSilenceTrimming(JNIEnv *env, jobject thiz, jboolean enabled,
+                                                                   jint maxGapMs);
+
+JNIEXPORT jlongArray JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getStats(JNIEnv *env, jobject thiz);
+
+JNIEXPORT jboolean JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_startMonitor(JNIEnv *env, jobject thiz);
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_stopMonitor(JNIEnv *env, jobject thiz);
+
+JNIEXPORT jfloat JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getMonitorLatencyMs(JNIEnv *env, jobject thiz);
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setFeedbackSuppression(JNIEnv *env, jobject thiz,
+                                                                       jboolean enabled);
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getFeedbackNotches(JNIEnv *env, jobject thiz);
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setThreadPolicy(JNIEnv *env, jobject thiz, jint role,
+                                                                jint nice, jint cores);
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setCpuBudget(JNIEnv *env, jobject thiz, jfloat fraction);
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getCpuBudget(JNIEnv *env, jobject thiz);
+
+JNIEXPORT jboolean JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_measureLatency(JNIEnv *env, jobject thiz);
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getLatencyResult(JNIEnv *env, jobject thiz);
+
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_getState(JNIEnv *env, jobject thiz);
+
+JNIEXPORT jboolean JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_startMixer(JNIEnv *env, jobject thiz);
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_stopMixer(JNIEnv *env, jobject thiz);
+
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_addMixerFile(JNIEnv *env, jobject thiz, jstring path,
+                                                             jfloat gain, jfloat pan, jint delayMs);
+
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_addMixerBuffer(JNIEnv *env, jobject thiz, jobject buffer,
+                                                               jint channels, jfloat gain, jfloat pan,
+                                                               jint delayMs);
+
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_addMixerMic(JNIEnv *env, jobject thiz, jfloat gain,
+                                                            jfloat pan, jint delayMs);
+
+JNIEXPORT jboolean JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_removeMixerSource(JNIEnv *env, jobject thiz, jint id);
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setMixerGain(JNIEnv *env, jobject thiz, jint id, jfloat gain);
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_setMixerPan(JNIEnv *env, jobject thiz, jint id, jfloat pan);
+
+JNIEXPORT jboolean JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_isMixerSourceFinished(JNIEnv *env, jobject thiz, jint id);
+
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_analysisBufferBytes(JNIEnv *env, jobject thiz, jint fftSize);
+
+JNIEXPORT jint JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_startAnalysis(JNIEnv *env, jobject thiz, jint tap, jobject buffer,
+                                                              jint fftSize);
+
+JNIEXPORT void JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_stopAnalysis(JNIEnv *env, jobject thiz, jint tap);
+
+JNIEXPORT jfloatArray JNICALL
+Java_com_darrenyuan_nativefeedback_OpenSLEngine_processOffline(JNIEnv *env, jobject thiz, jobjectArray inputs,
+                                                               jobjectArray outputs, jint sampleRate,
+                                                               jfloat gain, jboolean trimSilence,
+                                                               jboolean suppressFeedback);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,226 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "HostBackend.h"
+#include "TestHarness.h"
+
+static std::vector<short> ramp(size_t samples) {
+    std::vector<short> data(samples);
+    for (size_t i = 0; i < samples; i++) {
+        data[i] = static_cast<short>(i * 13);
+    }
+    return data;
+}
+
+static void writeFile(const char *path, const std::vector<short> &data) {
+    FILE *out = fopen(path, "wb");
+    fwrite(data.data(), sizeof(short), data.size(), out);
+    fclose(out);
+}
+
+static std::vector<short> readFile(const char *path) {
+    std::vector<short> data;
+    FILE *in = fopen(path, "rb");
+    short sample;
+    while (in != NULL && fread(&sample, sizeof(short), 1, in) == 1) {
+        data.push_back(sample);
+    }
+    if (in != NULL) {
+        fclose(in);
+    }
+    return data;
+}
+
+static bool waitForPlayback(const AudioEngine &engine) {
+    for (int i = 0; i < 1000 && !engine.playFinished(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return engine.playFinished();
+}
+
+// everything the device played must be the file, followed by nothing but silence
+static void expectPlayed(const std::vector<short> &played, const std::vector<short> &file) {
+    EXPECT_TRUE(played.size() >= file.size());
+    bool same = true;
+    for (size_t i = 0; i < played.size(); i++) {
+        short expected = i < file.size() ? file[i] : 0;
+        same = same && played[i] == expected;
+    }
+    EXPECT_TRUE(same);
+}
+
+static void playOnHost(bool mapped, double clockSpeed) {
+    const char *path = "/tmp/AudioEngineTest_play.pcm";
+    std::vector<short> file = ramp(44100 + 77);
+    writeFile(path, file);
+
+    HostBackend *backend = new HostBackend(192, clockSpeed);
+    AudioEngine engine(backend);
+    engine.setMappedPlayback(mapped);
+    EXPECT_TRUE(engine.startPlay(path));
+    EXPECT_TRUE(waitForPlayback(engine));
+    expectPlayed(backend->output(), file);
+    EXPECT_EQ(0u, engine.playback().underruns());
+    unlink(path);
+}
+
+TEST(playsMappedFileThroughHostDevice) {
+    playOnHost(true, 0);
+}
+
+TEST(playsStreamedFileThroughHostDevice) {
+    playOnHost(false, 20);
+}
+
+TEST(recordsHostInputWithoutGaps) {
+    const char *path = "/tmp/AudioEngineTest_record.pcm";
+    std::vector<short> input = ramp(44100 * 4);
+    MemoryPcmSource source(input.data(), input.size() * sizeof(short));
+
+    HostBackend *backend = new HostBackend(192, 20);
+    backend->setInput(&source);
+    AudioEngine engine(backend);
+    EXPECT_TRUE(engine.createAudioRecorder());
+    EXPECT_TRUE(engine.startRecord(path));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    engine.stopRecord();
+
+    std::vector<short> recorded = readFile(path);
+    size_t bufferFrames = engine.recorderFramesPerBuffer();
+    EXPECT_TRUE(recorded.size() >= bufferFrames);
+    EXPECT_EQ(0u, recorded.size() % bufferFrames);
+    bool same = recorded.size() <= input.size();
+    for (size_t i = 0; same && i < recorded.size(); i++) {
+        same = recorded[i] == input[i];
+    }
+    EXPECT_TRUE(same);
+    EXPECT_EQ(0u, engine.capture().overruns());
+    unlink(path);
+}
+
+TEST(configureSizesBuffersFromDeviceBurst) {
+    AudioEngine engine(new HostBackend(192, 0));
+    EXPECT_EQ(DEFAULT_FRAMES_PER_BURST, engine.framesPerBurst());
+    EXPECT_TRUE(!engine.configure(0, 192));
+
+    // a rate the resampler won't take: platform resamples, deeper queue
+    EXPECT_TRUE(!engine.configure(47999, 192));
+    EXPECT_EQ(FILE_SAMPLE_RATE, engine.sampleRate());
+    EXPECT_EQ(PLAYER_QUEUE_DEPTH, engine.playerQueueDepth());
+    EXPECT_EQ(960, engine.recorderFramesPerBuffer());
+
+    EXPECT_TRUE(engine.configure(48000, 240));
+    EXPECT_EQ(48000, engine.sampleRate());
+    EXPECT_TRUE(engine.fastPath());
+    EXPECT_EQ(PLAYER_QUEUE_DEPTH_FAST, engine.playerQueueDepth());
+    EXPECT_EQ(960, engine.recorderFramesPerBuffer());
+    engine.configure(FILE_SAMPLE_RATE, 2048);
+    EXPECT_EQ(2048, engine.recorderFramesPerBuffer());
+
+    const char *path = "/tmp/AudioEngineTest_configure.pcm";
+    engine.configure(FILE_SAMPLE_RATE, 192);
+    EXPECT_TRUE(engine.createAudioRecorder());
+    EXPECT_TRUE(engine.startRecord(path));
+    EXPECT_EQ(192u * 5 * sizeof(short), engine.capture().bufferBytes());
+    engine.stopRecord();
+    unlink(path);
+}
+
+TEST(resamplesFilesToNativeRate) {
+    const char *path = "/tmp/AudioEngineTest_native.pcm";
+    std::vector<short> file(44100, 1000);
+    writeFile(path, file);
+
+    HostBackend *backend = new HostBackend(240, 20);
+    AudioEngine engine(backend);
+    EXPECT_TRUE(engine.configure(48000, 240));
+    EXPECT_TRUE(engine.startPlay(path));
+    EXPECT_TRUE(waitForPlayback(engine));
+    // a second of file is a second at the device rate; past the filter's
+    // start-up a constant stays constant
+    const std::vector<short> &played = backend->output();
+    EXPECT_TRUE(played.size() >= 48000);
+    bool flat = true;
+    for (size_t i = RESAMPLER_TAPS; i < 48000 - RESAMPLER_TAPS; i++) {
+        flat = flat && std::abs(played[i] - 1000) <= 1;
+    }
+    EXPECT_TRUE(flat);
+    unlink(path);
+
+    // and recordings come back at the file rate
+    std::vector<short> input(48000 * 2, -500);
+    MemoryPcmSource source(input.data(), input.size() * sizeof(short));
+    backend->setInput(&source);
+    EXPECT_TRUE(engine.createAudioRecorder());
+    EXPECT_TRUE(engine.startRecord(path));
+    for (int i = 0; i < 1000 && engine.capture().bytesWritten() < 44100 * sizeof(short); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    engine.stopRecord();
+    std::vector<short> recorded = readFile(path);
+    size_t bufferFrames = engine.recorderFramesPerBuffer();
+    size_t frames = recorded.size();
+    // whole recorder buffers at 48k plus the flushed filter tail
+    double captured = frames * 48000.0 / 44100 - RESAMPLER_TAPS / 2;
+    double buffers = std::floor(captured / bufferFrames + 0.5);
+    EXPECT_TRUE(buffers >= 1);
+    EXPECT_NEAR(buffers * bufferFrames, captured, 3.0);
+    bool constant = frames > 2 * RESAMPLER_TAPS;
+    for (size_t i = RESAMPLER_TAPS; constant && i < frames - RESAMPLER_TAPS; i++) {
+        constant = std::abs(recorded[i] + 500) <= 1;
+    }
+    EXPECT_TRUE(constant);
+    unlink(path);
+}
+
+TEST(recordGainAppliesOnTheWriter) {
+    const char *path = "/tmp/AudioEngineTest_gain.pcm";
+    std::vector<short> input(44100, 20000);
+    MemoryPcmSource source(input.data(), input.size() * sizeof(short));
+
+    HostBackend *backend = new HostBackend(192, 20);
+    backend->setInput(&source);
+    AudioEngine engine(backend);
+    engine.setRecordGain(2.0f);
+    EXPECT_TRUE(engine.createAudioRecorder());
+    EXPECT_TRUE(engine.startRecord(path));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    engine.stopRecord();
+
+    std::vector<short> recorded = readFile(path);
+    EXPECT_TRUE(!recorded.empty());
+    bool clipped = true;
+    for (size_t i = 0; i < recorded.size() && i < input.size(); i++) {
+        clipped = clipped && recorded[i] == 32767;
+    }
+    EXPECT_TRUE(clipped);
+    unlink(path);
+}
+
+TEST(monitorExcludesRecording) {
+    const char *path = "/tmp/AudioEngineTest_monitor.pcm";
+    AudioEngine engine(new HostBackend(192, 20));
+    EXPECT_TRUE(engine.configure(48000, 192));
+    EXPECT_TRUE(engine.createAudioRecorder());
+
+    EXPECT_TRUE(engine.startMonitor());
+    EXPECT_TRUE(engine.monitor().running());
+    EXPECT_TRUE(!engine.startMonitor());
+    EXPECT_TRUE(!engine.startRecord(path));
+    engine.stopMonitor();
+    EXPECT_TRUE(!engine.monitor().running());
+
+    EXPECT_TRUE(engine.startRecord(path));
+    EXPECT_TRUE(!engine.startMonitor());
+    engine.stopRecord();
+    unlink(path);
+}
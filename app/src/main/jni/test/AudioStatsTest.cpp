@@ -0,0 +1,67 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "AudioStats.h"
+#include "HostBackend.h"
+#include "TestHarness.h"
+
+TEST(callbackStatsCountsDeadlineMissesAndDepth) {
+    CallbackStats stats;
+    // 1ms period: a 3ms callback misses its deadline
+    stats.reset(1000000);
+    unsigned long long begin = stats.begin();
+    stats.end(begin, 5);
+    begin = stats.begin();
+    std::this_thread::sleep_for(std::chrono::milliseconds(3));
+    stats.end(begin, 2);
+
+    long long fields[STATS_FIELD_COUNT];
+    stats.snapshot(fields);
+    EXPECT_EQ(2, fields[STATS_CALLBACKS]);
+    EXPECT_EQ(1, fields[STATS_DEADLINE_MISSES]);
+    EXPECT_TRUE(fields[STATS_MAX_NS] >= 3000000);
+    EXPECT_EQ(2, fields[STATS_QUEUE_DEPTH]);
+    EXPECT_EQ(2, fields[STATS_QUEUE_DEPTH_MIN]);
+    EXPECT_EQ(5, fields[STATS_QUEUE_DEPTH_MAX]);
+    // 3ms is 2929 1024ns-units, bucket 12 covers 2048-4095
+    EXPECT_EQ(1, fields[STATS_DURATION_HISTOGRAM + 12]);
+    long long jitters = 0;
+    for (int i = 0; i < STATS_HISTOGRAM_BUCKETS; i++) {
+        jitters += fields[STATS_JITTER_HISTOGRAM + i];
+    }
+    EXPECT_EQ(1, jitters);
+}
+
+TEST(engineStatsCoverPlayback) {
+    const char *path = "/tmp/AudioStatsTest.pcm";
+    std::vector<short> file(44100);
+    FILE *out = fopen(path, "wb");
+    fwrite(file.data(), sizeof(short), file.size(), out);
+    fclose(out);
+
+    HostBackend *backend = new HostBackend(256, 0);
+    AudioEngine engine(backend);
+    engine.configure(FILE_SAMPLE_RATE, 256);
+    engine.startPlay(path);
+    for (int i = 0; i < 1000 && !engine.playFinished(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    long long snapshot[AudioEngine::STATS_SNAPSHOT_SIZE];
+    engine.getStats(snapshot);
+    const long long *player = snapshot + STATS_FIELD_COUNT;
+    // one callback per 256-frame buffer, the last one partial
+    EXPECT_EQ((44100 + 255) / 256, player[STATS_CALLBACKS]);
+    EXPECT_EQ(static_cast<long long>(file.size() * sizeof(short)), player[STATS_BYTES]);
+    EXPECT_EQ(0, player[STATS_UNDERRUNS]);
+    EXPECT_EQ(0, snapshot[STATS_CALLBACKS]);
+    unlink(path);
+}
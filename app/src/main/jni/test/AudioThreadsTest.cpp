@@ -0,0 +1,133 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <pthread.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "AudioThreads.h"
+#include "TestHarness.h"
+
+static const char *ROOT = "/tmp/AudioThreadsTest_cpu";
+
+// a sysfs cpu directory with a cpufreq maximum per CPU, 0 for none
+static void writeTopology(const unsigned long *khz, int cpus) {
+    mkdir(ROOT, 0755);
+    for (int cpu = 0; cpu < cpus; cpu++) {
+        std::string dir = std::string(ROOT) + "/cpu" + std::to_string(cpu);
+        mkdir(dir.c_str(), 0755);
+        if (khz[cpu] != 0) {
+            mkdir((dir + "/cpufreq").c_str(), 0755);
+            FILE *file = fopen((dir + "/cpufreq/cpuinfo_max_freq").c_str(), "w");
+            fprintf(file, "%lu\n", khz[cpu]);
+            fclose(file);
+        }
+    }
+}
+
+static void removeTopology(int cpus) {
+    for (int cpu = 0; cpu < cpus; cpu++) {
+        std::string dir = std::string(ROOT) + "/cpu" + std::to_string(cpu);
+        unlink((dir + "/cpufreq/cpuinfo_max_freq").c_str());
+        rmdir((dir + "/cpufreq").c_str());
+        rmdir(dir.c_str());
+    }
+    rmdir(ROOT);
+}
+
+TEST(cpuTopologySplitsBigAndLittleCores) {
+    // four little cores, two mid ones and two big ones
+    static const unsigned long khz[] = {1800000, 1800000, 1800000, 1800000,
+                                        2400000, 2400000, 3000000, 3000000};
+    writeTopology(khz, 8);
+    CpuTopology topology;
+    EXPECT_TRUE(topology.load(ROOT));
+    EXPECT_EQ(8, topology.cpus());
+    EXPECT_EQ(3000000ul, topology.maxFreqKhz(7));
+    cpu_set_t set;
+    EXPECT_TRUE(topology.mask(CORES_BIG, &set));
+    EXPECT_EQ(2, CPU_COUNT(&set));
+    EXPECT_TRUE(CPU_ISSET(6, &set) && CPU_ISSET(7, &set));
+    EXPECT_TRUE(topology.mask(CORES_LITTLE, &set));
+    EXPECT_EQ(4, CPU_COUNT(&set));
+    EXPECT_TRUE(CPU_ISSET(0, &set) && !CPU_ISSET(4, &set));
+    EXPECT_TRUE(topology.mask(CORES_ANY, &set));
+    EXPECT_EQ(8, CPU_COUNT(&set));
+    removeTopology(8);
+
+    // no cpufreq at all: every core is both
+    static const unsigned long none[] = {0, 0};
+    writeTopology(none, 2);
+    EXPECT_TRUE(topology.load(ROOT));
+    EXPECT_EQ(2, topology.cpus());
+    EXPECT_TRUE(topology.big(1) && topology.little(1));
+    EXPECT_TRUE(topology.mask(CORES_BIG, &set));
+    EXPECT_EQ(2, CPU_COUNT(&set));
+    removeTopology(2);
+
+    EXPECT_TRUE(!topology.load(ROOT));
+    EXPECT_TRUE(!topology.mask(CORES_ANY, &set));
+}
+
+// what enter() left the thread with
+struct Applied {
+    bool entered;
+    int nice;
+    cpu_set_t affinity;
+    char name[16];
+};
+
+static void enterAndLook(ThreadRole role, Applied *applied) {
+    applied->entered = AudioThreads::enter(role);
+    applied->nice = getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)));
+    sched_getaffinity(0, sizeof(applied->affinity), &applied->affinity);
+    pthread_getname_np(pthread_self(), applied->name, sizeof(applied->name));
+}
+
+TEST(threadEnteringItsRoleTakesThePolicy) {
+    ThreadPolicy savedAnalysis = AudioThreads::policy(THREAD_ANALYSIS);
+    ThreadPolicy savedWriter = AudioThreads::policy(THREAD_WRITER);
+    // a higher nice value needs no permission
+    ThreadPolicy policy;
+    policy.nice = 5;
+    policy.cores = CORES_BIG;
+    AudioThreads::setPolicy(THREAD_ANALYSIS, policy);
+    EXPECT_EQ(5, AudioThreads::policy(THREAD_ANALYSIS).nice);
+
+    int before = getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)));
+    Applied applied;
+    std::thread thread(enterAndLook, THREAD_ANALYSIS, &applied);
+    thread.join();
+    EXPECT_TRUE(applied.entered);
+    EXPECT_EQ(5, applied.nice);
+    EXPECT_EQ(0, strcmp("nf-analysis", applied.name));
+    // only big cores, as far as the process may run on them
+    cpu_set_t big;
+    EXPECT_TRUE(AudioThreads::topology().mask(CORES_BIG, &big));
+    EXPECT_TRUE(CPU_COUNT(&applied.affinity) > 0);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        EXPECT_TRUE(!CPU_ISSET(cpu, &applied.affinity) || CPU_ISSET(cpu, &big));
+    }
+    // the thread that started it is untouched
+    EXPECT_EQ(before, getpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid))));
+
+    // CORES_ANY keeps what the thread inherited
+    policy.cores = CORES_ANY;
+    AudioThreads::setPolicy(THREAD_WRITER, policy);
+    cpu_set_t inherited;
+    sched_getaffinity(0, sizeof(inherited), &inherited);
+    thread = std::thread(enterAndLook, THREAD_WRITER, &applied);
+    thread.join();
+    EXPECT_TRUE(CPU_EQUAL(&inherited, &applied.affinity));
+    EXPECT_EQ(0, strcmp("nf-writer", applied.name));
+
+    AudioThreads::setPolicy(THREAD_ANALYSIS, savedAnalysis);
+    AudioThreads::setPolicy(THREAD_WRITER, savedWriter);
+}
@@ -0,0 +1,111 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "AudioStats.h"
+#include "CpuBudget.h"
+#include "HostBackend.h"
+#include "TestHarness.h"
+
+static const unsigned long long PERIOD_NS = 1000000;
+
+static void bursts(CpuBudget *budget, int count, unsigned long long busyNs) {
+    for (int i = 0; i < count; i++) {
+        budget->record(busyNs);
+    }
+}
+
+TEST(cpuBudgetDegradesAtOnceAndRecoversSlowly) {
+    CpuBudget budget;
+    budget.configure(0.5, 4);
+    budget.reset(PERIOD_NS);
+    EXPECT_EQ(0, budget.level());
+
+    // one slow burst in a window of fast ones averages out
+    budget.record(900000);
+    bursts(&budget, 3, 100000);
+    EXPECT_EQ(0, budget.level());
+    EXPECT_EQ(1ull, budget.overBudget());
+    EXPECT_NEAR(0.3, budget.load(), 1e-9);
+
+    // a window over budget is a level, once per window, up to the last
+    bursts(&budget, 3, 800000);
+    EXPECT_EQ(0, budget.level());
+    budget.record(800000);
+    EXPECT_EQ(1, budget.level());
+    EXPECT_NEAR(0.8, budget.load(), 1e-9);
+    bursts(&budget, 4 * 4, 800000);
+    EXPECT_EQ(CPU_BUDGET_MAX_LEVEL, budget.level());
+    EXPECT_EQ(static_cast<unsigned>(CPU_BUDGET_MAX_LEVEL), budget.degradations());
+
+    // under the budget but not under half of it holds the level; it takes
+    // CPU_BUDGET_RECOVER_WINDOWS quiet windows in a row to give one back
+    bursts(&budget, 4 * 8, 400000);
+    EXPECT_EQ(CPU_BUDGET_MAX_LEVEL, budget.level());
+    bursts(&budget, 4 * (CPU_BUDGET_RECOVER_WINDOWS - 1), 100000);
+    bursts(&budget, 4, 400000);
+    bursts(&budget, 4 * (CPU_BUDGET_RECOVER_WINDOWS - 1), 100000);
+    EXPECT_EQ(CPU_BUDGET_MAX_LEVEL, budget.level());
+    bursts(&budget, 4, 100000);
+    EXPECT_EQ(CPU_BUDGET_MAX_LEVEL - 1, budget.level());
+    bursts(&budget, 4 * CPU_BUDGET_RECOVER_WINDOWS * CPU_BUDGET_MAX_LEVEL, 100000);
+    EXPECT_EQ(0, budget.level());
+    EXPECT_EQ(static_cast<unsigned>(CPU_BUDGET_MAX_LEVEL), budget.recoveries());
+
+    budget.setLevel(CPU_BUDGET_MAX_LEVEL + 5);
+    EXPECT_EQ(CPU_BUDGET_MAX_LEVEL, budget.level());
+    budget.reset(PERIOD_NS);
+    EXPECT_EQ(0, budget.level());
+    EXPECT_EQ(0ull, budget.overBudget());
+    EXPECT_EQ(0u, budget.degradations());
+
+    // nothing is measured against a period of 0
+    budget.reset(0);
+    bursts(&budget, 64, 800000);
+    EXPECT_EQ(0, budget.level());
+}
+
+// a monitor processor that spins for the share of a burst it's given
+static void spin(short *samples, unsigned frames, int channels, void *context) {
+    unsigned long long ns = static_cast<std::atomic<unsigned long long> *>(context)->load();
+    unsigned long long until = CallbackStats::nowNs() + ns;
+    while (CallbackStats::nowNs() < until) {
+    }
+}
+
+TEST(engineDegradesUnderSyntheticLoadAndRecovers) {
+    static const int BURST = 192;
+    const unsigned long long periodNs = 1000000000ULL * BURST / FILE_SAMPLE_RATE;
+    std::vector<short> input(FILE_SAMPLE_RATE * 10, 1000);
+    MemoryPcmSource source(input.data(), input.size() * sizeof(short));
+    HostBackend *backend = new HostBackend(BURST, 1);
+    backend->setInput(&source);
+    AudioEngine engine(backend);
+    engine.budget().configure(0.5, 8);
+
+    // three quarters of every burst in the monitor's recorder callback
+    std::atomic<unsigned long long> load(periodNs * 3 / 4);
+    engine.setMonitorProcessor(spin, &load);
+    EXPECT_TRUE(engine.startMonitor());
+    for (int tries = 0; tries < 300 && engine.budget().level() < CPU_BUDGET_MAX_LEVEL; tries++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(CPU_BUDGET_MAX_LEVEL, engine.budget().level());
+    EXPECT_TRUE(engine.budget().load() > 0.5);
+    EXPECT_TRUE(engine.budget().overBudget() > 0);
+
+    // the load goes away, the levels come back one at a time
+    load.store(0);
+    for (int tries = 0; tries < 500 && engine.budget().level() > 0; tries++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    engine.stopMonitor();
+    EXPECT_EQ(0, engine.budget().level());
+    EXPECT_TRUE(engine.budget().load() < 0.25);
+    EXPECT_EQ(static_cast<unsigned>(CPU_BUDGET_MAX_LEVEL), engine.budget().recoveries());
+}
@@ -0,0 +1,98 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "DuplexMonitor.h"
+#include "HostBackend.h"
+#include "PcmSource.h"
+#include "TestHarness.h"
+
+static void invert(short *samples, unsigned frames, int channels, void *context) {
+    for (unsigned i = 0; i < frames * channels; i++) {
+        samples[i] = static_cast<short>(-samples[i]);
+    }
+}
+
+// never zero, so the start of the monitored signal is easy to find
+static std::vector<short> nonZeroRamp(size_t samples) {
+    std::vector<short> data(samples);
+    for (size_t i = 0; i < samples; i++) {
+        data[i] = static_cast<short>(i % 1000 + 1);
+    }
+    return data;
+}
+
+// fraction of neighbouring samples in the monitored part of the output that
+// step like the inverted ramp; underruns and drift corrections each break a
+// step or two
+static double invertedRampSteps(const std::vector<short> &output) {
+    size_t first = 0;
+    while (first < output.size() && output[first] == 0) {
+        first++;
+    }
+    size_t steps = 0, matching = 0;
+    for (size_t i = first + 1; i < output.size(); i++) {
+        short expected = output[i - 1] == -1000 ? -1 : static_cast<short>(output[i - 1] - 1);
+        steps++;
+        matching += output[i] == expected;
+    }
+    return steps > 0 ? static_cast<double>(matching) / steps : 0;
+}
+
+TEST(monitorPlaysProcessedMicAfterJitterBuffer) {
+    std::vector<short> input = nonZeroRamp(48000);
+    MemoryPcmSource source(input.data(), input.size() * sizeof(short));
+    HostBackend backend(192, 2);
+    backend.setInput(&source);
+    backend.startTogether(2);
+
+    DuplexMonitor monitor(&backend);
+    monitor.setProcessor(invert, NULL);
+    StreamFormat format = {48000, 1};
+    EXPECT_TRUE(monitor.start(format, 192, 2, 1));
+    // 0.8s of the 1s input at 2x
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    monitor.stop();
+
+    // silence while the jitter buffer fills, then the mic went through the
+    // processor and came out in order
+    std::vector<short> output = backend.output();
+    EXPECT_TRUE(output.size() >= input.size() / 2);
+    bool inverted = true;
+    for (size_t i = 0; i < output.size(); i++) {
+        inverted = inverted && output[i] <= 0;
+    }
+    EXPECT_TRUE(inverted);
+    EXPECT_TRUE(invertedRampSteps(output) > 0.99);
+
+    // a player buffer, a burst of jitter and up to a burst of phase between
+    // the clocks: 8 to 12ms at 48 kHz, a little less with the host clock
+    // running fast
+    MonitorStats stats = monitor.stats();
+    EXPECT_TRUE(stats.latencyMs > 2 && stats.latencyMs < 25);
+    EXPECT_TRUE(stats.maxLatencyMs >= stats.latencyMs);
+}
+
+TEST(monitorAbsorbsClockDrift) {
+    std::vector<short> input = nonZeroRamp(3 * 48000);
+    MemoryPcmSource source(input.data(), input.size() * sizeof(short));
+    HostBackend backend(192, 2);
+    backend.setInput(&source);
+    // far worse than real hardware, so the test doesn't take minutes
+    backend.setRecorderDrift(4000);
+
+    DuplexMonitor monitor(&backend);
+    StreamFormat format = {48000, 1};
+    EXPECT_TRUE(monitor.start(format, 192, 2, 1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1400));
+    monitor.stop();
+
+    // ~540 surplus frames: without corrections they pile up as latency,
+    // with them the level stays where it settled
+    MonitorStats stats = monitor.stats();
+    EXPECT_TRUE(stats.framesDropped >= stats.framesInserted + 300);
+    EXPECT_TRUE(stats.jitterFrames <= 2 * 192 + 192 / 2);
+}
@@ -0,0 +1,125 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "HostBackend.h"
+#include "MpscQueue.h"
+#include "TestHarness.h"
+
+static bool waitForState(const AudioEngine &engine, EngineState state) {
+    for (int i = 0; i < 1000 && engine.state() != state; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    return engine.state() == state;
+}
+
+TEST(mpscQueueKeepsEveryProducersOrder) {
+    MpscQueue<unsigned> queue(64);
+    const unsigned producers = 4, perProducer = 20000;
+    std::vector<std::thread> threads;
+    for (unsigned p = 0; p < producers; p++) {
+        threads.push_back(std::thread([&queue, p] {
+            for (unsigned i = 0; i < perProducer;) {
+                if (queue.push(p << 24 | i)) {
+                    i++;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+    std::vector<unsigned> next(producers, 0);
+    bool ordered = true;
+    for (unsigned received = 0; received < producers * perProducer;) {
+        unsigned value;
+        if (!queue.pop(&value)) {
+            std::this_thread::yield();
+            continue;
+        }
+        unsigned p = value >> 24;
+        ordered = ordered && p < producers && (value & 0xffffff) == next[p];
+        next[p]++;
+        received++;
+    }
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i].join();
+    }
+    EXPECT_TRUE(ordered);
+    unsigned value;
+    EXPECT_TRUE(!queue.pop(&value));
+}
+
+TEST(postedSessionsRunOnControlThread) {
+    const char *path = "/tmp/EngineControlTest.pcm";
+    std::vector<short> file(44100 / 2, 123);
+    FILE *out = fopen(path, "wb");
+    fwrite(file.data(), sizeof(short), file.size(), out);
+    fclose(out);
+
+    HostBackend *backend = new HostBackend(192, 20);
+    AudioEngine engine(backend);
+    EXPECT_EQ(STATE_IDLE, engine.state());
+    EXPECT_TRUE(engine.post(COMMAND_START_PLAY, path));
+    EXPECT_TRUE(waitForState(engine, STATE_PLAYING));
+    // sessions exclude each other without anyone blocking
+    EXPECT_TRUE(!engine.startRecord(path));
+    EXPECT_TRUE(!engine.startMonitor());
+    EXPECT_TRUE(!engine.configure(48000, 192));
+
+    // the player callback ends the session when the file has played out
+    EXPECT_TRUE(waitForState(engine, STATE_IDLE));
+    EXPECT_TRUE(engine.playFinished());
+    EXPECT_TRUE(backend->output().size() >= file.size());
+
+    EXPECT_TRUE(engine.post(COMMAND_START_MONITOR));
+    EXPECT_TRUE(waitForState(engine, STATE_DUPLEX));
+    EXPECT_TRUE(engine.post(COMMAND_STOP_MONITOR));
+    EXPECT_TRUE(waitForState(engine, STATE_IDLE));
+
+    std::vector<char> longPath(ENGINE_PATH_MAX + 1, 'a');
+    longPath.back() = '\0';
+    EXPECT_TRUE(!engine.post(COMMAND_START_RECORD, &longPath[0]));
+    unlink(path);
+}
+
+TEST(postedConfigurationRunsBeforeTheSessionsBehindIt) {
+    const char *path = "/tmp/EngineControlTest_configure.pcm";
+    AudioEngine engine(new HostBackend(192, 20));
+    EXPECT_TRUE(engine.post(COMMAND_CONFIGURE, NULL, 48000, 192));
+    EXPECT_TRUE(engine.post(COMMAND_CREATE_RECORDER));
+    EXPECT_TRUE(engine.post(COMMAND_START_RECORD, path));
+    EXPECT_TRUE(waitForState(engine, STATE_RECORDING));
+    EXPECT_EQ(48000, engine.sampleRate());
+    EXPECT_EQ(192, engine.framesPerBurst());
+    EXPECT_TRUE(engine.post(COMMAND_STOP_RECORD));
+    EXPECT_TRUE(waitForState(engine, STATE_IDLE));
+    unlink(path);
+}
+
+TEST(staleEndOfPlaybackLeavesNextSessionAlone) {
+    const char *path = "/tmp/EngineControlTest_stale.pcm";
+    std::vector<short> file(44100, 5);
+    FILE *out = fopen(path, "wb");
+    fwrite(file.data(), sizeof(short), file.size(), out);
+    fclose(out);
+
+    AudioEngine engine(new HostBackend(192, 1));
+    EXPECT_TRUE(engine.startPlay(path));
+    engine.stopPlay();
+    EXPECT_TRUE(engine.startPlay(path));
+    // an end of playback for an earlier session, as a callback racing the
+    // stop would post it
+    EXPECT_TRUE(engine.post(COMMAND_PLAY_DONE));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(STATE_PLAYING, engine.state());
+    engine.stopPlay();
+    EXPECT_EQ(STATE_IDLE, engine.state());
+    unlink(path);
+}
@@ -0,0 +1,188 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "FeedbackSuppressor.h"
+#include "HostBackend.h"
+#include "TestHarness.h"
+
+static const int RATE = 48000;
+static const unsigned BURST = 192;
+
+static double rmsDb(const short *samples, size_t count) {
+    double sum = 0;
+    for (size_t i = 0; i < count; i++) {
+        sum += static_cast<double>(samples[i]) * samples[i];
+    }
+    return 10 * log10(sum / count / (32768.0 * 32768.0) + 1e-12);
+}
+
+// A room: the speaker comes back into the mic 10 ms later through a
+// resonance at 2 kHz with a loop gain of 1.2, which no other frequency
+// reaches, on top of room noise around -50 dBFS. Runs seconds of it a burst
+// at a time, through the suppressor if there is one, and returns the output.
+static std::vector<short> feedbackLoop(FeedbackSuppressor *suppressor, double seconds) {
+    const size_t delay = RATE / 100;
+    const double f0 = 2000, q = 10, gain = 1.2;
+    // bandpass, 0 dB at f0
+    double w0 = 2 * M_PI * f0 / RATE, alpha = sin(w0) / (2 * q), a0 = 1 + alpha;
+    double b0 = alpha / a0, b2 = -alpha / a0, a1 = -2 * cos(w0) / a0, a2 = (1 - alpha) / a0;
+    double x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+
+    size_t total = static_cast<size_t>(seconds * RATE) / BURST * BURST;
+    std::vector<short> out(total + delay, 0);
+    unsigned seed = 2024;
+    for (size_t at = 0; at < total; at += BURST) {
+        short *burst = &out[delay + at];
+        for (size_t i = 0; i < BURST; i++) {
+            double x = out[at + i];
+            double y = b0 * x + b2 * x2 - a1 * y1 - a2 * y2;
+            x2 = x1, x1 = x, y2 = y1, y1 = y;
+            seed = seed * 1103515245 + 12345;
+            double v = gain * y + static_cast<int>(seed >> 16 & 0x1FF) - 256;
+            burst[i] = static_cast<short>(std::max(-32768.0, std::min(32767.0, v)));
+        }
+        if (suppressor != NULL) {
+            FeedbackSuppressor::processor(burst, BURST, 1, suppressor);
+        }
+    }
+    return std::vector<short>(out.begin() + delay, out.end());
+}
+
+TEST(feedbackHowlIsNotchedOut) {
+    // the loop on its own rings up to clipping
+    std::vector<short> open = feedbackLoop(NULL, 2);
+    EXPECT_TRUE(rmsDb(&open[open.size() - RATE / 2], RATE / 2) > -6);
+
+    FeedbackSuppressor suppressor;
+    EXPECT_TRUE(suppressor.init(RATE, 1));
+    std::vector<short> out = feedbackLoop(&suppressor, 3);
+    EXPECT_TRUE(suppressor.detections() > 0);
+    EXPECT_TRUE(suppressor.activeNotches() >= 1);
+    // a notch sits on the howl, within the loop's resonance
+    bool onHowl = false;
+    for (unsigned i = 0; i < FEEDBACK_MAX_NOTCHES; i++) {
+        float hz, depthDb;
+        suppressor.notch(i, &hz, &depthDb);
+        if (depthDb < 0) {
+            EXPECT_TRUE(depthDb <= FEEDBACK_FIRST_DEPTH_DB);
+            onHowl = onHowl || fabs(hz - 2000) < 150;
+        }
+    }
+    EXPECT_TRUE(onHowl);
+    // caught within half a second, never loud after that, and back down
+    // to the room noise
+    double loudest = -120;
+    for (size_t at = RATE / 2 / BURST * BURST; at + BURST <= out.size(); at += BURST) {
+        loudest = std::max(loudest, rmsDb(&out[at], BURST));
+    }
+    EXPECT_TRUE(loudest < -12);
+    EXPECT_TRUE(rmsDb(&out[out.size() - RATE], RATE) < -40);
+}
+
+TEST(feedbackSuppressorLeavesVoiceAndNoiseAlone) {
+    // voiced syllables, each a pitch glide from 120 to 220 Hz with twenty
+    // harmonics under a raised cosine, over noise
+    const size_t total = 4 * RATE;
+    std::vector<short> voice(total);
+    unsigned seed = 99;
+    double phase = 0;
+    for (size_t i = 0; i < total; i++) {
+        double t = static_cast<double>(i) / RATE;
+        double syllable = fmod(t, 0.4) / 0.3;
+        double envelope = syllable < 1 ? 0.5 - 0.5 * cos(2 * M_PI * syllable) : 0;
+        phase += 2 * M_PI * (120 + 100 * std::min(syllable, 1.0)) / RATE;
+        double v = 0;
+        for (int h = 1; h <= 20; h++) {
+            v += sin(h * phase) / h;
+        }
+        seed = seed * 1103515245 + 12345;
+        v = 8000 * envelope * v + (static_cast<int>(seed >> 16 & 0x3FF) - 512);
+        voice[i] = static_cast<short>(v);
+    }
+    std::vector<short> in(voice);
+
+    FeedbackSuppressor suppressor;
+    EXPECT_TRUE(suppressor.init(RATE, 1));
+    for (size_t at = 0; at + BURST <= total; at += BURST) {
+        suppressor.process(&voice[at], BURST);
+    }
+    EXPECT_EQ(0u, suppressor.detections());
+    EXPECT_EQ(0u, suppressor.activeNotches());
+    // with no notches the bank passes the audio through
+    int diff = 0;
+    for (size_t i = 0; i < total; i++) {
+        diff = std::max(diff, abs(voice[i] - in[i]));
+    }
+    EXPECT_TRUE(diff <= 1);
+}
+
+TEST(feedbackNotchesDeepenAndRelease) {
+    // a steady tone at 1 kHz that won't go away: the sustain rule notches
+    // it, and each time it's still there the notch goes deeper
+    FeedbackSuppressor suppressor;
+    EXPECT_TRUE(suppressor.init(RATE, 2));
+    std::vector<short> tone(BURST * 2);
+    size_t frame = 0;
+    for (int burst = 0; burst < 4 * RATE / static_cast<int>(BURST); burst++) {
+        for (unsigned i = 0; i < BURST; i++, frame++) {
+            short v = static_cast<short>(16000 * sin(2 * M_PI * 1000 * frame / RATE));
+            tone[2 * i] = v;
+            tone[2 * i + 1] = v;
+        }
+        suppressor.process(&tone[0], BURST);
+    }
+    float hz, depthDb;
+    suppressor.notch(0, &hz, &depthDb);
+    EXPECT_EQ(1u, suppressor.activeNotches());
+    EXPECT_NEAR(1000.0f, hz, 10.0f);
+    EXPECT_TRUE(depthDb < FEEDBACK_FIRST_DEPTH_DB);
+    EXPECT_TRUE(suppressor.detections() >= 2);
+
+    // silence past the hold: it relaxes a dB a second and goes
+    std::vector<short> silence(BURST * 2, 0);
+    float before = depthDb;
+    size_t bursts = static_cast<size_t>((FEEDBACK_HOLD_MS / 1000.0 + 2) * RATE / BURST);
+    for (size_t i = 0; i < bursts; i++) {
+        suppressor.process(&silence[0], BURST);
+    }
+    suppressor.notch(0, &hz, &depthDb);
+    EXPECT_TRUE(depthDb > before && depthDb < before + 3);
+    suppressor.reset();
+    EXPECT_EQ(0u, suppressor.activeNotches());
+}
+
+static void countBursts(short *samples, unsigned frames, int channels, void *context) {
+    static_cast<std::atomic<unsigned> *>(context)->fetch_add(1);
+}
+
+TEST(engineSuppressesFeedbackAfterTheMonitorProcessor) {
+    // a mic that won't stop ringing at 1 kHz, 3 s of it at 20x
+    std::vector<short> input(3 * FILE_SAMPLE_RATE);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = static_cast<short>(12000 * sin(2 * M_PI * 1000 * i / FILE_SAMPLE_RATE));
+    }
+    MemoryPcmSource source(input.data(), input.size() * sizeof(short));
+    HostBackend *backend = new HostBackend(BURST, 20);
+    backend->setInput(&source);
+    AudioEngine engine(backend);
+    std::atomic<unsigned> bursts(0);
+    engine.setMonitorProcessor(countBursts, &bursts);
+    engine.setFeedbackSuppression(true);
+    EXPECT_TRUE(engine.startMonitor());
+    for (int tries = 0; tries < 100 && engine.feedbackSuppressor().activeNotches() == 0; tries++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    engine.stopMonitor();
+    EXPECT_TRUE(bursts.load() > 0);
+    EXPECT_EQ(1u, engine.feedbackSuppressor().activeNotches());
+    float hz, depthDb;
+    engine.feedbackSuppressor().notch(0, &hz, &depthDb);
+    EXPECT_NEAR(1000.0f, hz, 10.0f);
+}
@@ -0,0 +1,70 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "Fft.h"
+#include "TestHarness.h"
+
+TEST(fftMatchesDirectTransform) {
+    Fft fft;
+    EXPECT_TRUE(!fft.init(48));
+    EXPECT_TRUE(fft.init(64));
+    std::vector<float> re(64), im(64);
+    for (int i = 0; i < 64; i++) {
+        re[i] = static_cast<float>(sin(i * 0.37) + 0.25 * (i % 5));
+        im[i] = static_cast<float>(cos(i * 1.1));
+    }
+    std::vector<float> inRe = re, inIm = im;
+    fft.forward(&re[0], &im[0]);
+
+    double maxError = 0;
+    for (int k = 0; k < 64; k++) {
+        double sumRe = 0, sumIm = 0;
+        for (int n = 0; n < 64; n++) {
+            double angle = -2 * M_PI * k * n / 64;
+            sumRe += inRe[n] * cos(angle) - inIm[n] * sin(angle);
+            sumIm += inRe[n] * sin(angle) + inIm[n] * cos(angle);
+        }
+        maxError = std::max(maxError, std::max(fabs(sumRe - re[k]), fabs(sumIm - im[k])));
+    }
+    EXPECT_TRUE(maxError < 1e-4);
+
+    fft.inverse(&re[0], &im[0]);
+    for (int i = 0; i < 64; i++) {
+        EXPECT_NEAR(inRe[i], re[i], 1e-5);
+        EXPECT_NEAR(inIm[i], im[i], 1e-5);
+    }
+    EXPECT_EQ(2u, Fft::sizeFor(1));
+    EXPECT_EQ(1024u, Fft::sizeFor(1000));
+    EXPECT_EQ(1024u, Fft::sizeFor(1024));
+}
+
+TEST(realFftMatchesTheComplexTransform) {
+    RealFft real;
+    EXPECT_TRUE(!real.init(2));
+    EXPECT_TRUE(!real.init(96));
+    for (unsigned size = 4; size <= 1024; size *= 4) {
+        EXPECT_TRUE(real.init(size));
+        EXPECT_EQ(size / 2 + 1, real.bins());
+        std::vector<float> input(size);
+        for (unsigned i = 0; i < size; i++) {
+            input[i] = static_cast<float>(sin(i * 0.37) + 0.25 * (i % 5) - 0.3);
+        }
+        std::vector<float> re(real.bins()), im(real.bins());
+        real.forward(&input[0], &re[0], &im[0]);
+
+        Fft fft;
+        EXPECT_TRUE(fft.init(size));
+        std::vector<float> cre(input), cim(size, 0.0f);
+        fft.forward(&cre[0], &cim[0]);
+        double maxError = 0;
+        for (unsigned k = 0; k < real.bins(); k++) {
+            maxError = std::max(maxError, static_cast<double>(fabsf(cre[k] - re[k])));
+            maxError = std::max(maxError, static_cast<double>(fabsf(cim[k] - im[k])));
+        }
+        EXPECT_TRUE(maxError < 1e-4 * size);
+    }
+}
@@ -0,0 +1,211 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "HostBackend.h"
+#include "LosslessFile.h"
+#include "PlaybackStream.h"
+#include "TestHarness.h"
+#include "WavFile.h"
+
+// three files in three formats, lengths no multiple of a buffer, each
+// counting in its own range and never 0
+static const char *RAW_PATH = "/tmp/GaplessPlaylistTest_a.pcm";
+static const char *WAV_PATH = "/tmp/GaplessPlaylistTest_b.wav";
+static const char *NFLA_PATH = "/tmp/GaplessPlaylistTest_c.nfla";
+static const size_t RAW_FRAMES = 10037;
+static const size_t WAV_FRAMES = 7001;
+static const size_t NFLA_FRAMES = 12345;
+
+static std::vector<short> counting(size_t frames, int from, int span) {
+    std::vector<short> data(frames);
+    for (size_t i = 0; i < frames; i++) {
+        data[i] = static_cast<short>(from + static_cast<int>(i % span));
+    }
+    return data;
+}
+
+// what the three play as, one after the other, on a mono player
+static std::vector<short> writeFiles() {
+    std::vector<short> raw = counting(RAW_FRAMES, 1, 20000);
+    FILE *out = fopen(RAW_PATH, "wb");
+    fwrite(raw.data(), sizeof(short), raw.size(), out);
+    fclose(out);
+
+    std::vector<short> wav = counting(WAV_FRAMES, -30000, 20000);
+    WavWriter wavWriter;
+    wavWriter.open(WAV_PATH, FILE_SAMPLE_RATE, 1, true);
+    wavWriter.write(wav.data(), wav.size() * sizeof(short));
+    wavWriter.close();
+
+    // stereo with both sides the same, which mixes down to itself
+    std::vector<short> nfla = counting(NFLA_FRAMES, 21000, 10000);
+    std::vector<short> stereo(nfla.size() * 2);
+    for (size_t i = 0; i < nfla.size(); i++) {
+        stereo[2 * i] = nfla[i];
+        stereo[2 * i + 1] = nfla[i];
+    }
+    LosslessWriter losslessWriter;
+    losslessWriter.open(NFLA_PATH, FILE_SAMPLE_RATE, 2);
+    losslessWriter.write(stereo.data(), nfla.size());
+    losslessWriter.close();
+
+    std::vector<short> all(raw);
+    all.insert(all.end(), wav.begin(), wav.end());
+    all.insert(all.end(), nfla.begin(), nfla.end());
+    return all;
+}
+
+static void removeFiles() {
+    unlink(RAW_PATH);
+    unlink(WAV_PATH);
+    unlink(NFLA_PATH);
+    unlink(LosslessIndex::indexPathFor(NFLA_PATH).c_str());
+}
+
+TEST(queuedFilesSpliceOnTheExactFrame) {
+    std::vector<short> expected = writeFiles();
+    PlaybackStream stream(1, 8);
+    stream.setSampleRates(FILE_SAMPLE_RATE, FILE_SAMPLE_RATE);
+    EXPECT_TRUE(stream.open(RAW_PATH, 256, PlaybackStream::SOURCE_STREAM));
+    EXPECT_TRUE(stream.enqueue(WAV_PATH));
+    EXPECT_TRUE(stream.enqueue("/tmp/GaplessPlaylistTest_missing.pcm"));
+    EXPECT_TRUE(stream.enqueue(NFLA_PATH));
+    EXPECT_EQ(0u, stream.track());
+
+    // every buffer but the very last is whole, across both switches
+    std::vector<short> played;
+    std::vector<unsigned> tracks;
+    unsigned bytes, shortBuffers = 0;
+    const short *buffer;
+    while ((buffer = stream.nextBuffer(&bytes)) != NULL) {
+        played.insert(played.end(), buffer, buffer + bytes / sizeof(short));
+        shortBuffers += bytes < stream.bufferBytes();
+        stream.onBufferPlayed();
+        tracks.push_back(stream.track());
+        std::this_thread::sleep_for(std::chrono::microseconds(300));
+    }
+    stream.onBufferPlayed();
+    EXPECT_TRUE(stream.drained());
+    EXPECT_EQ(0u, stream.underruns());
+    EXPECT_EQ(1u, shortBuffers);
+    EXPECT_EQ(expected.size(), played.size());
+    EXPECT_TRUE(played == expected);
+    EXPECT_EQ(0u, tracks.front());
+    EXPECT_EQ(2u, tracks.back());
+    EXPECT_TRUE(std::is_sorted(tracks.begin(), tracks.end()));
+    EXPECT_EQ(NFLA_FRAMES, static_cast<size_t>(stream.position()));
+    EXPECT_EQ(NFLA_FRAMES, static_cast<size_t>(stream.frames()));
+
+    // nothing plays after the last file has been read
+    EXPECT_TRUE(!stream.enqueue(RAW_PATH));
+    stream.close();
+
+    // the mapping itself takes no queue
+    EXPECT_TRUE(stream.open(WAV_PATH, 256, PlaybackStream::SOURCE_MAPPED));
+    EXPECT_TRUE(stream.zeroCopy());
+    EXPECT_TRUE(!stream.enqueue(RAW_PATH));
+    stream.close();
+    removeFiles();
+}
+
+TEST(fileQueuedAfterTheLastWasReadStillSplices) {
+    std::vector<short> expected = writeFiles();
+    // the pool holds all of the WAV, so the reader is done with it at open
+    PlaybackStream stream(1, 32);
+    stream.setSampleRates(FILE_SAMPLE_RATE, FILE_SAMPLE_RATE);
+    EXPECT_TRUE(stream.open(WAV_PATH, 256, PlaybackStream::SOURCE_STREAM));
+    std::vector<short> played;
+    unsigned bytes;
+    const short *buffer;
+    for (int i = 0; i < 5 && (buffer = stream.nextBuffer(&bytes)) != NULL; i++) {
+        played.insert(played.end(), buffer, buffer + bytes / sizeof(short));
+        stream.onBufferPlayed();
+    }
+    EXPECT_TRUE(stream.enqueue(RAW_PATH));
+    while ((buffer = stream.nextBuffer(&bytes)) != NULL) {
+        played.insert(played.end(), buffer, buffer + bytes / sizeof(short));
+        stream.onBufferPlayed();
+        std::this_thread::sleep_for(std::chrono::microseconds(300));
+    }
+    EXPECT_EQ(0u, stream.underruns());
+    EXPECT_EQ(1u, stream.track());
+    EXPECT_TRUE(std::equal(played.begin(), played.begin() + WAV_FRAMES, expected.begin() + RAW_FRAMES));
+    EXPECT_TRUE(std::equal(played.begin() + WAV_FRAMES, played.end(), expected.begin()));
+    EXPECT_EQ(WAV_FRAMES + RAW_FRAMES, played.size());
+    stream.close();
+    removeFiles();
+}
+
+TEST(queuedFileAtAnotherRateIsResampledInPlace) {
+    writeFiles();
+    const char *slow = "/tmp/GaplessPlaylistTest_slow.wav";
+    std::vector<short> half = counting(FILE_SAMPLE_RATE / 4, 100, 50);
+    WavWriter writer;
+    writer.open(slow, FILE_SAMPLE_RATE / 2, 1, true);
+    writer.write(half.data(), half.size() * sizeof(short));
+    writer.close();
+
+    PlaybackStream stream(1, 8);
+    stream.setSampleRates(FILE_SAMPLE_RATE, FILE_SAMPLE_RATE);
+    EXPECT_TRUE(stream.open(RAW_PATH, 256, PlaybackStream::SOURCE_STREAM));
+    EXPECT_TRUE(stream.enqueue(slow));
+    EXPECT_TRUE(stream.enqueue(WAV_PATH));
+    std::vector<short> played;
+    unsigned bytes;
+    const short *buffer;
+    while ((buffer = stream.nextBuffer(&bytes)) != NULL) {
+        played.insert(played.end(), buffer, buffer + bytes / sizeof(short));
+        stream.onBufferPlayed();
+        std::this_thread::sleep_for(std::chrono::microseconds(300));
+    }
+    EXPECT_EQ(0u, stream.underruns());
+    EXPECT_EQ(FILE_SAMPLE_RATE, stream.fileRate());
+    EXPECT_EQ(WAV_FRAMES, static_cast<size_t>(stream.frames()));
+    // the first file as it was, the slow one twice as long with its filter
+    // flushed, then the last file as it was
+    size_t resampled = played.size() - RAW_FRAMES - WAV_FRAMES;
+    EXPECT_TRUE(std::equal(played.begin(), played.begin() + RAW_FRAMES,
+                           counting(RAW_FRAMES, 1, 20000).begin()));
+    EXPECT_TRUE(resampled >= 2 * half.size() && resampled <= 2 * half.size() + 2 * RESAMPLER_TAPS);
+    EXPECT_TRUE(std::equal(played.end() - WAV_FRAMES, played.end(), counting(WAV_FRAMES, -30000, 20000).begin()));
+    stream.close();
+    unlink(slow);
+    removeFiles();
+}
+
+TEST(engineQueuesPromptsOnOnePlayer) {
+    std::vector<short> expected = writeFiles();
+    HostBackend *backend = new HostBackend(192, 4);
+    AudioEngine engine(backend);
+    EXPECT_TRUE(engine.queuePlay(RAW_PATH));
+    EXPECT_TRUE(engine.queuePlay(WAV_PATH));
+    EXPECT_TRUE(engine.queuePlay(NFLA_PATH));
+    EXPECT_TRUE(!engine.playback().zeroCopy());
+    for (int i = 0; i < 1000 && !engine.playFinished(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_TRUE(engine.playFinished());
+    EXPECT_EQ(2u, engine.playTrack());
+    // whatever silence the player got while the reader caught up,
+    // the files themselves are back to back
+    std::vector<short> output = backend->output();
+    output.erase(std::remove(output.begin(), output.end(), 0), output.end());
+    EXPECT_EQ(expected.size(), output.size());
+    EXPECT_TRUE(output == expected);
+
+    // a playback that can't be queued behind
+    engine.setMappedPlayback(true);
+    EXPECT_TRUE(engine.startPlay(WAV_PATH));
+    EXPECT_TRUE(!engine.playback().zeroCopy() || !engine.queuePlay(RAW_PATH));
+    engine.stopPlay();
+    removeFiles();
+}
@@ -0,0 +1,65 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <cstdlib>
+#include <vector>
+
+#include "HostBackend.h"
+#include "LatencyProbe.h"
+#include "PcmSource.h"
+#include "TestHarness.h"
+
+TEST(probeFindsSequenceInNoise) {
+    std::vector<float> mls = LatencyProbe::sequence(10);
+    EXPECT_EQ(1023u, mls.size());
+
+    // a quiet copy 3000 frames in, under noise louder than it
+    srand(7);
+    std::vector<float> captured(8000);
+    for (size_t i = 0; i < captured.size(); i++) {
+        captured[i] = (rand() % 2001 - 1000) / 1000.0f;
+    }
+    for (size_t i = 0; i < mls.size(); i++) {
+        captured[3000 + i] += 0.5f * mls[i];
+    }
+    int delay = 0;
+    double confidence = 0;
+    EXPECT_TRUE(LatencyProbe::findDelay(&mls[0], mls.size(), &captured[0], captured.size(),
+                                        &delay, &confidence));
+    EXPECT_EQ(3000, delay);
+    EXPECT_TRUE(confidence > 0.3 && confidence < 1);
+
+    std::vector<float> silence(8000, 0.0f);
+    EXPECT_TRUE(!LatencyProbe::findDelay(&mls[0], mls.size(), &silence[0], silence.size(),
+                                         &delay, &confidence));
+}
+
+TEST(probeMeasuresHostLoopbackDelay) {
+    HostBackend backend(192, 10);
+    backend.setLoopback(1234, 0.25f);
+    backend.startTogether(2);
+    LatencyProbe probe(&backend);
+    StreamFormat format = {48000, 1};
+    LatencyResult result;
+    EXPECT_TRUE(probe.measure(format, 192, 2, &result));
+    EXPECT_TRUE(result.valid);
+    EXPECT_EQ(1234, result.frames);
+    EXPECT_NEAR(1234 / 48.0, result.latencyMs, 1e-6);
+    EXPECT_TRUE(result.confidence > 0.99);
+}
+
+TEST(probeReportsLowConfidenceWithoutLoopback) {
+    std::vector<short> noise(48000);
+    srand(11);
+    for (size_t i = 0; i < noise.size(); i++) {
+        noise[i] = static_cast<short>(rand() % 8001 - 4000);
+    }
+    MemoryPcmSource source(noise.data(), noise.size() * sizeof(short));
+    HostBackend backend(192, 10);
+    backend.setInput(&source);
+    LatencyProbe probe(&backend);
+    StreamFormat format = {48000, 1};
+    LatencyResult result;
+    EXPECT_TRUE(probe.measure(format, 192, 2, &result));
+    EXPECT_TRUE(result.confidence < 0.1);
+}
@@ -0,0 +1,84 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "HostBackend.h"
+#include "LiveCapture.h"
+#include "PcmSource.h"
+#include "SharedPcmRing.h"
+#include "TestHarness.h"
+
+TEST(sharedRingWrapsAndDropsWholeChunks) {
+    std::vector<unsigned> memory((SharedPcmRing::HEADER_BYTES + 100) / sizeof(unsigned));
+    SharedPcmRing ring;
+    EXPECT_EQ(64u, ring.attach(&memory[0], memory.size() * sizeof(unsigned)));
+
+    unsigned char chunk[40], out[64];
+    for (int i = 0; i < 40; i++) {
+        chunk[i] = static_cast<unsigned char>(i);
+    }
+    EXPECT_TRUE(ring.write(chunk, 40));
+    // doesn't fit: dropped whole, nothing partial lands in the ring
+    EXPECT_TRUE(!ring.write(chunk, 40));
+    EXPECT_EQ(1u, ring.dropped());
+    EXPECT_EQ(40u, ring.available());
+
+    EXPECT_EQ(30u, ring.read(out, 30));
+    EXPECT_TRUE(ring.write(chunk, 40)); // wraps around the end
+    EXPECT_EQ(50u, ring.read(out, sizeof(out)));
+    bool same = true;
+    for (int i = 0; i < 10; i++) {
+        same = same && out[i] == 30 + i;
+    }
+    for (int i = 0; i < 40; i++) {
+        same = same && out[10 + i] == i;
+    }
+    EXPECT_TRUE(same);
+    EXPECT_EQ(0u, ring.available());
+
+    // the header is what Java sees
+    const unsigned char *header = reinterpret_cast<const unsigned char *>(&memory[0]);
+    EXPECT_EQ(80u, *reinterpret_cast<const unsigned *>(header + SharedPcmRing::WRITE_OFFSET));
+    EXPECT_EQ(80u, *reinterpret_cast<const unsigned *>(header + SharedPcmRing::READ_OFFSET));
+    EXPECT_EQ(64u, *reinterpret_cast<const unsigned *>(header + SharedPcmRing::CAPACITY_OFFSET));
+}
+
+TEST(liveCaptureStreamsMicrophoneThroughRing) {
+    std::vector<short> input(48000);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = static_cast<short>(i * 7);
+    }
+    MemoryPcmSource source(input.data(), input.size() * sizeof(short));
+    HostBackend backend(192, 20);
+    backend.setInput(&source);
+
+    // small enough that the consumer has to keep up
+    std::vector<unsigned> memory((SharedPcmRing::HEADER_BYTES + 8192) / sizeof(unsigned));
+    LiveCapture capture(&backend);
+    StreamFormat format = {48000, 1};
+    EXPECT_EQ(8192u, capture.init(format, 192, &memory[0], memory.size() * sizeof(unsigned)));
+    EXPECT_TRUE(capture.start());
+
+    // the consumer side, as the Java reader would run it
+    std::vector<short> received;
+    short chunk[512];
+    for (int i = 0; i < 2000 && received.size() < input.size() / 2; i++) {
+        size_t n;
+        while ((n = capture.ring().read(chunk, sizeof(chunk))) > 0) {
+            received.insert(received.end(), chunk, chunk + n / sizeof(short));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    capture.stop();
+
+    EXPECT_TRUE(received.size() >= input.size() / 2);
+    bool same = true;
+    for (size_t i = 0; i < received.size() && i < input.size(); i++) {
+        same = same && received[i] == input[i];
+    }
+    EXPECT_TRUE(same);
+    EXPECT_EQ(0u, capture.ring().dropped());
+}
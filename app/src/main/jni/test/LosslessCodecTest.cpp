@@ -0,0 +1,172 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "HostBackend.h"
+#include "LosslessFile.h"
+#include "PlaybackStream.h"
+#include "TestHarness.h"
+
+static std::vector<short> noise(size_t samples, int amplitude) {
+    std::vector<short> data(samples);
+    unsigned seed = 1;
+    for (size_t i = 0; i < samples; i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = static_cast<short>(static_cast<int>(seed >> 8) % amplitude);
+    }
+    return data;
+}
+
+static std::vector<short> sine(size_t samples, int channels) {
+    std::vector<short> data(samples);
+    for (size_t i = 0; i < samples; i++) {
+        data[i] = static_cast<short>(20000 * sin(0.02 * (i / channels) + i % channels));
+    }
+    return data;
+}
+
+// encodes samples block by block and decodes them again; returns the
+// compressed size, 0 if anything came back different
+static size_t roundTrip(const std::vector<short> &samples, int channels) {
+    LosslessEncoder encoder(channels);
+    LosslessDecoder decoder(channels);
+    std::vector<unsigned char> coded;
+    std::vector<short> decoded(LOSSLESS_BLOCK_FRAMES * channels);
+    size_t total = 0;
+    size_t frames = samples.size() / channels;
+    for (size_t i = 0; i < frames; i += LOSSLESS_BLOCK_FRAMES) {
+        unsigned n = static_cast<unsigned>(std::min<size_t>(LOSSLESS_BLOCK_FRAMES, frames - i));
+        coded.clear();
+        encoder.encode(&samples[i * channels], n, &coded);
+        total += coded.size();
+        if (!decoder.decode(coded.data(), coded.size(), n, &decoded[0])
+            || !std::equal(decoded.begin(), decoded.begin() + n * channels,
+                           samples.begin() + i * channels)) {
+            return 0;
+        }
+    }
+    return total;
+}
+
+TEST(losslessCodecRoundTripsEveryKindOfBlock) {
+    std::vector<short> silence(LOSSLESS_BLOCK_FRAMES, 0);
+    EXPECT_TRUE(roundTrip(silence, 1) > 0);
+    EXPECT_TRUE(roundTrip(silence, 1) < 8);
+    EXPECT_TRUE(roundTrip(std::vector<short>(1000, -1234), 1) > 0);
+
+    // the extremes, alternating: the fixed predictors overflow 16 bits
+    std::vector<short> extremes(LOSSLESS_BLOCK_FRAMES);
+    for (size_t i = 0; i < extremes.size(); i++) {
+        extremes[i] = i % 2 ? 32767 : -32768;
+    }
+    EXPECT_TRUE(roundTrip(extremes, 1) > 0);
+
+    // full-scale noise can't shrink, and mustn't grow by more than the headers
+    std::vector<short> loud = noise(LOSSLESS_BLOCK_FRAMES * 3, 65536);
+    size_t loudBytes = roundTrip(loud, 1);
+    EXPECT_TRUE(loudBytes > 0);
+    EXPECT_TRUE(loudBytes <= loud.size() * sizeof(short) + 3 * 8);
+
+    // blocks shorter than the predictors, and a short last block
+    for (unsigned n = 1; n < 40; n += 3) {
+        EXPECT_TRUE(roundTrip(noise(n, 200), 1) > 0);
+    }
+    EXPECT_TRUE(roundTrip(sine(LOSSLESS_BLOCK_FRAMES * 2 + 77, 1), 1) > 0);
+}
+
+TEST(losslessCodecShrinksPredictableAudio) {
+    std::vector<short> mono = sine(LOSSLESS_BLOCK_FRAMES * 4, 1);
+    size_t monoBytes = roundTrip(mono, 1);
+    EXPECT_TRUE(monoBytes > 0);
+    EXPECT_TRUE(monoBytes < mono.size() * sizeof(short) / 2);
+
+    std::vector<short> stereo = sine(LOSSLESS_BLOCK_FRAMES * 4 * 2, 2);
+    size_t stereoBytes = roundTrip(stereo, 2);
+    EXPECT_TRUE(stereoBytes > 0);
+    EXPECT_TRUE(stereoBytes < stereo.size() * sizeof(short) / 2);
+
+    // quiet noise costs about its own width: 8 of 16 bits
+    std::vector<short> quiet = noise(LOSSLESS_BLOCK_FRAMES * 4, 256);
+    size_t quietBytes = roundTrip(quiet, 1);
+    EXPECT_TRUE(quietBytes > 0);
+    EXPECT_TRUE(quietBytes < quiet.size() * sizeof(short) * 6 / 10);
+}
+
+TEST(losslessFilePlaysBackUpToATornFrame) {
+    const char *path = "/tmp/LosslessCodecTest_play.nfla";
+    std::vector<short> samples = sine(LOSSLESS_BLOCK_FRAMES * 5 / 2 * 2, 2);
+    LosslessWriter writer;
+    EXPECT_TRUE(writer.open(path, 44100, 2));
+    EXPECT_TRUE(writer.write(samples.data(), samples.size() / 2));
+    EXPECT_TRUE(writer.close());
+    EXPECT_TRUE(writer.fileBytes() < samples.size() * sizeof(short) / 2);
+
+    LosslessInfo info;
+    EXPECT_TRUE(LosslessPcmSource::probe(path, &info));
+    EXPECT_EQ(44100, info.sampleRate);
+    EXPECT_EQ(2, info.channels);
+
+    // the file's rate and layout win over the raw PCM settings
+    PlaybackStream stream(2, 8);
+    stream.setSampleRates(48000, 44100);
+    EXPECT_TRUE(stream.open(path, 256, PlaybackStream::SOURCE_MAPPED));
+    EXPECT_TRUE(!stream.zeroCopy());
+    std::vector<short> played;
+    unsigned bytes;
+    const short *buffer;
+    unsigned underruns = 0;
+    while ((buffer = stream.nextBuffer(&bytes)) != NULL) {
+        // silence while the reader thread catches up
+        if (stream.underruns() == underruns) {
+            played.insert(played.end(), buffer, buffer + bytes / sizeof(short));
+        }
+        underruns = stream.underruns();
+        stream.onBufferPlayed();
+    }
+    stream.close();
+    EXPECT_TRUE(played == samples);
+
+    // what a crash mid-frame leaves: the whole frames before it still play
+    truncate(path, static_cast<off_t>(writer.fileBytes() - 10));
+    LosslessPcmSource source;
+    EXPECT_TRUE(source.open(path));
+    std::vector<short> decoded(samples.size());
+    size_t n = source.read(&decoded[0], decoded.size() * sizeof(short));
+    EXPECT_EQ(LOSSLESS_BLOCK_FRAMES * 2 * 2 * sizeof(short), n);
+    EXPECT_TRUE(std::equal(samples.begin(), samples.begin() + n / sizeof(short), decoded.begin()));
+    source.close();
+    unlink(path);
+    unlink(LosslessIndex::indexPathFor(path).c_str());
+}
+
+TEST(engineRecordsLosslessWhenAskedTo) {
+    const char *path = "/tmp/LosslessCodecTest_record.nfla";
+    std::vector<short> input = sine(44100, 1);
+    MemoryPcmSource source(input.data(), input.size() * sizeof(short));
+    HostBackend *backend = new HostBackend(192, 20);
+    backend->setInput(&source);
+    AudioEngine engine(backend);
+    EXPECT_TRUE(engine.createAudioRecorder());
+    EXPECT_TRUE(engine.startRecord(path));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    engine.stopRecord();
+
+    size_t recorded = engine.capture().bytesWritten() / sizeof(short);
+    EXPECT_TRUE(recorded > 0);
+    LosslessPcmSource file;
+    EXPECT_TRUE(file.open(path));
+    std::vector<short> decoded(input.size());
+    EXPECT_EQ(recorded * sizeof(short), file.read(&decoded[0], decoded.size() * sizeof(short)));
+    EXPECT_TRUE(std::equal(input.begin(), input.begin() + recorded, decoded.begin()));
+    file.close();
+    unlink(path);
+    unlink(LosslessIndex::indexPathFor(path).c_str());
+}
@@ -0,0 +1,213 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "HostBackend.h"
+#include "Mixer.h"
+#include "TestHarness.h"
+#include "WavFile.h"
+
+static const int RATE = 48000;
+static const int BURST = 64;
+
+// waits for the sources to play out, false after a few seconds
+static bool waitFinished(const Mixer &mixer, const int *ids, int count) {
+    for (int tries = 0; tries < 3000; tries++) {
+        bool all = true;
+        for (int i = 0; i < count; i++) {
+            all = all && mixer.finished(ids[i]);
+        }
+        if (all) {
+            // their last bursts are still in the player queue
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+// the non-zero samples of one side of the stereo output
+static std::vector<short> side(const std::vector<short> &output, int channel) {
+    std::vector<short> samples;
+    for (size_t i = channel; i < output.size(); i += 2) {
+        if (output[i] != 0) {
+            samples.push_back(output[i]);
+        }
+    }
+    return samples;
+}
+
+TEST(mixerSumsSourcesWithTheirGainAndPan) {
+    HostBackend backend(BURST, 20);
+    Mixer mixer(&backend);
+    EXPECT_TRUE(mixer.start(RATE, BURST, 2));
+    std::vector<short> left(4800, 8192);
+    std::vector<short> right(2400, 4096);
+    int ids[2];
+    ids[0] = mixer.addMemory(left.data(), left.size(), 1, 1.0f, -1.0f, 0);
+    ids[1] = mixer.addMemory(right.data(), right.size(), 1, 0.5f, 1.0f, 0);
+    EXPECT_TRUE(ids[0] >= 0 && ids[1] >= 0 && ids[0] != ids[1]);
+    EXPECT_TRUE(waitFinished(mixer, ids, 2));
+    mixer.stop();
+
+    std::vector<short> output = backend.output();
+    std::vector<short> l = side(output, 0);
+    std::vector<short> r = side(output, 1);
+    EXPECT_EQ(left.size(), l.size());
+    EXPECT_EQ(right.size(), r.size());
+    EXPECT_TRUE(l == std::vector<short>(left.size(), 8192));
+    EXPECT_TRUE(r == std::vector<short>(right.size(), 2048));
+}
+
+TEST(mixerStartsASourceAfterItsDelay) {
+    HostBackend backend(BURST, 20);
+    Mixer mixer(&backend);
+    EXPECT_TRUE(mixer.start(RATE, BURST, 2));
+    std::vector<short> click(100, 10000);
+    const unsigned delay = 4000 + 17;
+    // everything already played comes before the source, whenever the
+    // callback picks it up
+    size_t before = backend.output().size() / 2;
+    int id = mixer.addMemory(click.data(), click.size(), 1, 1.0f, 0.0f, delay);
+    EXPECT_TRUE(waitFinished(mixer, &id, 1));
+    mixer.stop();
+
+    std::vector<short> output = backend.output();
+    size_t first = 0;
+    while (first < output.size() && output[first] == 0) {
+        first++;
+    }
+    first /= 2;
+    EXPECT_TRUE(first >= before + delay);
+    // the queue ahead of it, plus slack for a slow host
+    EXPECT_TRUE(first < before + delay + RATE / 10);
+    EXPECT_EQ(click.size() * 2, side(output, 0).size() + side(output, 1).size());
+}
+
+TEST(mixerLimitsTheBusBelowFullScale) {
+    HostBackend backend(BURST, 20);
+    Mixer mixer(&backend);
+    EXPECT_TRUE(mixer.start(RATE, BURST, 2));
+    std::vector<short> loud(4800, 30000);
+    int ids[2];
+    ids[0] = mixer.addMemory(loud.data(), loud.size(), 1, 1.0f, 0.0f, 0);
+    ids[1] = mixer.addMemory(loud.data(), loud.size(), 1, 1.0f, 0.0f, 0);
+    EXPECT_TRUE(waitFinished(mixer, ids, 2));
+    MixerStats stats = mixer.stats();
+    mixer.stop();
+
+    EXPECT_TRUE(stats.limitedBursts > 0);
+    std::vector<short> output = backend.output();
+    int peak = 0;
+    for (size_t i = 0; i < output.size(); i++) {
+        peak = std::max(peak, std::abs(static_cast<int>(output[i])));
+    }
+    EXPECT_TRUE(peak <= static_cast<int>(MIXER_LIMITER_THRESHOLD * 32768) + 1);
+    // the sum is held at the threshold, not clipped below it
+    EXPECT_TRUE(peak >= static_cast<int>(MIXER_LIMITER_THRESHOLD * 32768) - 1);
+}
+
+TEST(mixerRemovesSourcesWithoutStopping) {
+    HostBackend backend(BURST, 20);
+    Mixer mixer(&backend);
+    EXPECT_TRUE(mixer.start(RATE, BURST, 2));
+    std::vector<short> tone(RATE * 10, 1000);
+    int id = mixer.addMemory(tone.data(), tone.size(), 1, 1.0f, 0.0f, 0);
+    EXPECT_TRUE(id >= 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(1u, mixer.stats().sources);
+    EXPECT_TRUE(mixer.remove(id));
+    EXPECT_TRUE(!mixer.remove(id));
+    EXPECT_TRUE(!mixer.finished(id));
+    EXPECT_EQ(0u, mixer.stats().sources);
+    EXPECT_TRUE(mixer.running());
+
+    // once the queue ahead of the removal has played, only silence follows
+    size_t removedAt = backend.output().size() + 4 * BURST * 2;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::vector<short> output = backend.output();
+    EXPECT_TRUE(output.size() > removedAt);
+    bool silent = true;
+    for (size_t i = removedAt; i < output.size(); i++) {
+        silent = silent && output[i] == 0;
+    }
+    EXPECT_TRUE(silent);
+
+    // every slot can be taken, and no more
+    std::vector<int> ids;
+    for (int i = 0; i < MIXER_MAX_SOURCES; i++) {
+        ids.push_back(mixer.addMemory(tone.data(), tone.size(), 1, 0.01f, 0.0f, 0));
+        EXPECT_TRUE(ids.back() >= 0);
+    }
+    EXPECT_EQ(-1, mixer.addMemory(tone.data(), tone.size(), 1, 1.0f, 0.0f, 0));
+    mixer.stop();
+    EXPECT_TRUE(!mixer.running());
+    EXPECT_EQ(-1, mixer.addMemory(tone.data(), tone.size(), 1, 1.0f, 0.0f, 0));
+}
+
+TEST(mixerPlaysFilesAndTheMic) {
+    const char *path = "/tmp/MixerTest_source.wav";
+    std::vector<short> ramp(6000);
+    for (size_t i = 0; i < ramp.size(); i++) {
+        ramp[i] = static_cast<short>(1000 + i);
+    }
+    WavWriter writer;
+    EXPECT_TRUE(writer.open(path, RATE, 1, true));
+    writer.write(ramp.data(), ramp.size() * sizeof(short));
+    EXPECT_TRUE(writer.close());
+
+    std::vector<short> mic(RATE, -3000);
+    MemoryPcmSource input(mic.data(), mic.size() * sizeof(short));
+    HostBackend backend(BURST, 20);
+    backend.setInput(&input);
+    Mixer mixer(&backend);
+    EXPECT_TRUE(mixer.start(RATE, BURST, 2));
+    // the file goes left, the mic right
+    int file = mixer.addFile(path, RATE, 1.0f, -1.0f, 0);
+    int micId = mixer.addMic(1.0f, 1.0f, 0);
+    EXPECT_TRUE(file >= 0 && micId >= 0);
+    EXPECT_EQ(-1, mixer.addMic(1.0f, 0.0f, 0));
+    EXPECT_TRUE(waitFinished(mixer, &file, 1));
+    EXPECT_TRUE(!mixer.finished(micId));
+    mixer.stop();
+
+    std::vector<short> output = backend.output();
+    // underruns of the file play as silence, which side() leaves out
+    EXPECT_TRUE(side(output, 0) == ramp);
+    std::vector<short> heard = side(output, 1);
+    EXPECT_TRUE(heard.size() > 0);
+    EXPECT_TRUE(heard == std::vector<short>(heard.size(), -3000));
+    unlink(path);
+}
+
+static void countStops(void *context) {
+    (*static_cast<int *>(context))++;
+}
+
+TEST(engineRunsTheMixerAsASession) {
+    AudioEngine engine(new HostBackend(BURST, 20));
+    int stops = 0;
+    engine.setMixerStopped(countStops, &stops);
+    EXPECT_TRUE(engine.startMixer());
+    EXPECT_EQ(STATE_MIXING, engine.state());
+    EXPECT_TRUE(!engine.startMonitor());
+    std::vector<short> tone(RATE / 10, 500);
+    int id = engine.mixer().addMemory(tone.data(), tone.size(), 1, 1.0f, 0.0f, 0);
+    EXPECT_TRUE(id >= 0);
+    EXPECT_TRUE(waitFinished(engine.mixer(), &id, 1));
+    engine.stopMixer();
+    EXPECT_EQ(STATE_IDLE, engine.state());
+    EXPECT_TRUE(!engine.mixer().running());
+    // once per stop, after the sources are gone
+    EXPECT_EQ(1, stops);
+    engine.stopMixer();
+    EXPECT_EQ(1, stops);
+}
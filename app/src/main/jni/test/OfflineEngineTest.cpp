@@ -0,0 +1,276 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "LosslessFile.h"
+#include "OfflineEngine.h"
+#include "Resampler.h"
+#include "TestHarness.h"
+#include "WavFile.h"
+
+// a sine per channel over a little noise, so no two chunks look alike
+static std::vector<short> tones(size_t frames, int channels, int rate) {
+    std::vector<short> data(frames * channels);
+    unsigned seed = 7;
+    for (size_t i = 0; i < frames; i++) {
+        for (int c = 0; c < channels; c++) {
+            seed = seed * 1103515245 + 12345;
+            double v = 9000 * sin(2 * M_PI * (440 + 220 * c) * i / rate)
+                       + static_cast<int>(seed >> 16 & 0x7FF) - 1024;
+            data[i * channels + c] = static_cast<short>(v);
+        }
+    }
+    return data;
+}
+
+static bool writePcm(const char *path, const std::vector<short> &data, int rate, int channels,
+                     bool container) {
+    WavWriter writer;
+    return writer.open(path, rate, channels, container)
+           && writer.write(data.data(), data.size() * sizeof(short)) && writer.close();
+}
+
+static std::vector<short> readWav(const char *path, WavInfo *info) {
+    std::vector<short> data;
+    if (WavReader::probe(path, info) != WAV_PCM16) {
+        return data;
+    }
+    FILE *file = fopen(path, "rb");
+    data.resize(info->dataBytes / sizeof(short));
+    fseek(file, static_cast<long>(info->dataOffset), SEEK_SET);
+    size_t n = fread(data.data(), sizeof(short), data.size(), file);
+    data.resize(n);
+    fclose(file);
+    return data;
+}
+
+static std::vector<short> readLossless(const char *path) {
+    std::vector<short> data;
+    LosslessPcmSource source;
+    if (!source.open(path)) {
+        return data;
+    }
+    short block[1024];
+    size_t bytes;
+    while ((bytes = source.read(block, sizeof(block))) > 0) {
+        data.insert(data.end(), block, block + bytes / sizeof(short));
+    }
+    source.close();
+    return data;
+}
+
+struct Hits {
+    std::vector<std::atomic<int> > counts;
+    WorkStealingPool *pool;
+
+    explicit Hits(size_t n) : counts(n), pool(NULL) {
+        for (size_t i = 0; i < n; i++) {
+            counts[i].store(0);
+        }
+    }
+};
+
+static void hitRange(void *context, size_t begin, size_t end) {
+    Hits *hits = static_cast<Hits *>(context);
+    while (end - begin > 16) {
+        size_t mid = begin + (end - begin) / 2;
+        hits->pool->submit(hitRange, hits, mid, end);
+        end = mid;
+    }
+    for (size_t i = begin; i < end; i++) {
+        hits->counts[i].fetch_add(1);
+    }
+}
+
+TEST(workStealingPoolRunsEveryTaskOnce) {
+    WorkStealingPool pool(4);
+    EXPECT_EQ(4u, pool.threads());
+    EXPECT_EQ(-1, pool.currentWorker());
+    for (int round = 0; round < 3; round++) {
+        Hits hits(100000);
+        hits.pool = &pool;
+        for (size_t at = 0; at < hits.counts.size(); at += 25000) {
+            pool.submit(hitRange, &hits, at, at + 25000);
+        }
+        pool.wait();
+        int wrong = 0;
+        for (size_t i = 0; i < hits.counts.size(); i++) {
+            wrong += hits.counts[i].load() != 1;
+        }
+        EXPECT_EQ(0, wrong);
+    }
+}
+
+TEST(offlineChunksJoinIntoOnePass) {
+    // 44.1 to 48 kHz steps 147 input frames at a time; chunks of about
+    // 5000 frames cut 3 s into 27 of them
+    const int inRate = 44100, outRate = 48000, channels = 2;
+    const size_t frames = 3 * inRate + 101;
+    std::vector<short> input = tones(frames, channels, inRate);
+    const char *in = "/tmp/OfflineEngineTest_in.wav";
+    const char *out = "/tmp/OfflineEngineTest_out.wav";
+    EXPECT_TRUE(writePcm(in, input, inRate, channels, true));
+
+    // everything at once through one resampler, then its tail
+    Resampler resampler;
+    EXPECT_TRUE(resampler.init(inRate, outRate, channels));
+    std::vector<short> silence(resampler.latencyFrames() * channels, 0);
+    std::vector<short> expected(resampler.outputFramesFor(frames + silence.size()) * channels);
+    size_t consumed, made = resampler.process(input.data(), frames, &consumed, &expected[0],
+                                              expected.size() / channels);
+    EXPECT_EQ(frames, consumed);
+    made += resampler.process(silence.data(), silence.size() / channels, &consumed,
+                              &expected[made * channels], expected.size() / channels - made);
+    expected.resize(made * channels);
+
+    OfflineConfig config;
+    config.sampleRate = outRate;
+    config.threads = 3;
+    config.chunkFrames = 5000;
+    OfflineEngine engine(config);
+    OfflineReport report;
+    std::vector<OfflineFileResult> results;
+    EXPECT_TRUE(engine.run(std::vector<std::string>(1, in), std::vector<std::string>(1, out),
+                           &report, &results));
+    EXPECT_EQ(1u, report.files);
+    EXPECT_EQ(0u, report.failed);
+    EXPECT_TRUE(report.chunks > 20);
+    EXPECT_TRUE(report.realtimeFactor > 1);
+    EXPECT_NEAR(1.0, engine.progress(), 1e-9);
+    EXPECT_EQ(frames, static_cast<size_t>(results[0].inputFrames));
+    EXPECT_EQ(made, static_cast<size_t>(results[0].outputFrames));
+
+    WavInfo info;
+    std::vector<short> written = readWav(out, &info);
+    EXPECT_EQ(outRate, info.sampleRate);
+    EXPECT_EQ(channels, info.channels);
+    EXPECT_EQ(expected.size(), written.size());
+    EXPECT_TRUE(written == expected);
+    unlink(in);
+    unlink(out);
+}
+
+TEST(offlineConvertsBetweenFormats) {
+    // raw mono to stereo WAV, WAV to .nfla and that .nfla back to raw, at
+    // the input's rate with 6 dB less gain
+    const int rate = 16000;
+    const size_t frames = 40000;
+    std::vector<short> mono = tones(frames, 1, rate);
+    const char *raw = "/tmp/OfflineEngineTest_in.pcm";
+    const char *wav = "/tmp/OfflineEngineTest_stereo.wav";
+    const char *nfla = "/tmp/OfflineEngineTest_stereo.nfla";
+    const char *back = "/tmp/OfflineEngineTest_back.pcm";
+    EXPECT_TRUE(writePcm(raw, mono, rate, 1, false));
+
+    OfflineConfig config;
+    config.rawSampleRate = rate;
+    config.channels = 2;
+    config.gain = 0.5f;
+    config.threads = 2;
+    config.chunkFrames = 8192;
+    {
+        OfflineEngine engine(config);
+        std::vector<OfflineFileResult> results;
+        EXPECT_TRUE(engine.run(std::vector<std::string>(1, raw), std::vector<std::string>(1, wav),
+                               NULL, &results));
+        EXPECT_EQ(5u, results[0].chunks);
+    }
+    WavInfo info;
+    std::vector<short> stereo = readWav(wav, &info);
+    EXPECT_EQ(rate, info.sampleRate);
+    EXPECT_EQ(frames * 2, stereo.size());
+    int wrong = 0;
+    for (size_t i = 0; i < frames && stereo.size() == frames * 2; i++) {
+        int half = static_cast<int>(lrintf(mono[i] * 0.5f));
+        wrong += abs(stereo[2 * i] - half) > 1 || stereo[2 * i + 1] != stereo[2 * i];
+    }
+    EXPECT_EQ(0, wrong);
+
+    config.gain = 1.0f;
+    std::vector<std::string> inputs, outputs;
+    inputs.push_back(wav);
+    outputs.push_back(nfla);
+    OfflineEngine engine(config);
+    EXPECT_TRUE(engine.run(inputs, outputs, NULL, NULL));
+    EXPECT_TRUE(readLossless(nfla) == stereo);
+
+    // .nfla decodes front to back, so it's one task
+    OfflineReport report;
+    std::vector<OfflineFileResult> results;
+    inputs[0] = nfla;
+    outputs[0] = back;
+    EXPECT_TRUE(engine.run(inputs, outputs, &report, &results));
+    EXPECT_EQ(1u, report.chunks);
+    EXPECT_EQ(frames, static_cast<size_t>(results[0].inputFrames));
+    EXPECT_EQ(rate, results[0].inputRate);
+    std::vector<unsigned char> bytes(frames * 4 + 1);
+    FILE *file = fopen(back, "rb");
+    size_t n = file != NULL ? fread(bytes.data(), 1, bytes.size(), file) : 0;
+    if (file != NULL) {
+        fclose(file);
+    }
+    EXPECT_EQ(frames * 4, n);
+    EXPECT_TRUE(memcmp(bytes.data(), stereo.data(), frames * 4) == 0);
+    unlink(raw);
+    unlink(wav);
+    unlink(nfla);
+    unlink(LosslessIndex::indexPathFor(nfla).c_str());
+    unlink(back);
+}
+
+TEST(offlineTrimsWholeFilesAndReportsFailures) {
+    // a second of silence, a second of tones, a second of silence
+    const int rate = 48000;
+    std::vector<short> input(3 * rate, 0);
+    std::vector<short> voice = tones(rate, 1, rate);
+    std::copy(voice.begin(), voice.end(), input.begin() + rate);
+    const char *in = "/tmp/OfflineEngineTest_gap.wav";
+    const char *out = "/tmp/OfflineEngineTest_trimmed.wav";
+    std::string index = SilenceTrimmer::indexPathFor(out);
+    EXPECT_TRUE(writePcm(in, input, rate, 1, true));
+
+    OfflineConfig config;
+    config.vad.enabled = true;
+    config.vad.maxGapMs = 0;
+    config.threads = 2;
+    config.chunkFrames = 4096;
+    OfflineEngine engine(config);
+    std::vector<std::string> inputs, outputs;
+    inputs.push_back(in);
+    outputs.push_back(out);
+    inputs.push_back("/tmp/OfflineEngineTest_missing.wav");
+    outputs.push_back("/tmp/OfflineEngineTest_missing_out.wav");
+    inputs.push_back(in);
+    outputs.push_back(in);
+    OfflineReport report;
+    std::vector<OfflineFileResult> results;
+    EXPECT_TRUE(!engine.run(inputs, outputs, &report, &results));
+    EXPECT_EQ(3u, report.files);
+    EXPECT_EQ(2u, report.failed);
+    EXPECT_TRUE(results[0].ok);
+    EXPECT_TRUE(!results[1].ok);
+    EXPECT_TRUE(!results[2].ok);
+
+    // the silence is gone but the tones are all there
+    EXPECT_EQ(1u, results[0].chunks);
+    EXPECT_TRUE(results[0].outputFrames >= static_cast<unsigned long long>(rate));
+    EXPECT_TRUE(results[0].outputFrames < static_cast<unsigned long long>(rate) * 3 / 2);
+    WavInfo info;
+    EXPECT_EQ(results[0].outputFrames, readWav(out, &info).size());
+    EXPECT_EQ(0, access(index.c_str(), F_OK));
+    // the input that was also the output is untouched
+    EXPECT_TRUE(readWav(in, &info) == input);
+    unlink(in);
+    unlink(out);
+    unlink(index.c_str());
+}
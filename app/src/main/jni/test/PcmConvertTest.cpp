@@ -0,0 +1,262 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "PcmConvert.h"
+#include "TestHarness.h"
+
+// odd length so every SIMD variant runs its scalar tail too
+static const size_t SAMPLES = 1000 + 7;
+
+static std::vector<float> noise(size_t samples, float peak) {
+    std::vector<float> data(samples);
+    unsigned seed = 12345;
+    for (size_t i = 0; i < samples; i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = peak * ((seed >> 8) / 8388608.0f - 1.0f);
+    }
+    // full scale, clipped and exact halfway values
+    data[0] = 1.0f;
+    data[1] = -1.0f;
+    data[2] = 1.5f;
+    data[3] = -1.5f;
+    data[4] = 0.5f / 32768;
+    return data;
+}
+
+template <typename T>
+static int maxDiff(const std::vector<T> &a, const std::vector<T> &b) {
+    int worst = a.size() == b.size() ? 0 : 1 << 30;
+    for (size_t i = 0; i < a.size() && i < b.size(); i++) {
+        int d = std::abs(static_cast<int>(a[i]) - static_cast<int>(b[i]));
+        worst = d > worst ? d : worst;
+    }
+    return worst;
+}
+
+static std::vector<const PcmKernels *> simdSets() {
+    std::vector<const PcmKernels *> sets;
+    if (PcmKernels::get(PcmKernels::SET_SSE) != NULL) {
+        sets.push_back(PcmKernels::get(PcmKernels::SET_SSE));
+    }
+    if (PcmKernels::get(PcmKernels::SET_NEON) != NULL) {
+        sets.push_back(PcmKernels::get(PcmKernels::SET_NEON));
+    }
+    return sets;
+}
+
+TEST(pcmKernelsMatchScalarReference) {
+    const PcmKernels &ref = *PcmKernels::get(PcmKernels::SET_SCALAR);
+    std::vector<float> f = noise(SAMPLES, 1.2f);
+    std::vector<const PcmKernels *> sets = simdSets();
+    for (size_t s = 0; s < sets.size(); s++) {
+        const PcmKernels &k = *sets[s];
+
+        // float -> int may differ by one on ties where the rounding differs
+        std::vector<short> a16(SAMPLES), b16(SAMPLES);
+        ref.floatToS16(&f[0], &a16[0], SAMPLES);
+        k.floatToS16(&f[0], &b16[0], SAMPLES);
+        EXPECT_TRUE(maxDiff(a16, b16) <= 1);
+
+        PcmDither da, db;
+        ref.floatToS16Dither(&f[0], &a16[0], SAMPLES, &da);
+        k.floatToS16Dither(&f[0], &b16[0], SAMPLES, &db);
+        EXPECT_TRUE(maxDiff(a16, b16) <= 1);
+
+        std::vector<float> af(SAMPLES), bf(SAMPLES);
+        ref.s16ToFloat(&a16[0], &af[0], SAMPLES);
+        k.s16ToFloat(&a16[0], &bf[0], SAMPLES);
+        EXPECT_TRUE(af == bf);
+
+        std::vector<unsigned char> a24(SAMPLES * 3), b24(SAMPLES * 3);
+        ref.floatToS24(&f[0], &a24[0], SAMPLES);
+        k.floatToS24(&f[0], &b24[0], SAMPLES);
+        ref.s24ToFloat(&a24[0], &af[0], SAMPLES);
+        k.s24ToFloat(&a24[0], &bf[0], SAMPLES);
+        EXPECT_TRUE(af == bf);
+        k.s24ToFloat(&b24[0], &bf[0], SAMPLES);
+        for (size_t i = 0; i < SAMPLES; i++) {
+            EXPECT_NEAR(af[i], bf[i], 1.0f / 8388608);
+        }
+
+        std::vector<int> a32(SAMPLES), b32(SAMPLES);
+        ref.floatToS32(&f[0], &a32[0], SAMPLES);
+        k.floatToS32(&f[0], &b32[0], SAMPLES);
+        EXPECT_TRUE(a32 == b32);
+        ref.s32ToFloat(&a32[0], &af[0], SAMPLES);
+        k.s32ToFloat(&a32[0], &bf[0], SAMPLES);
+        EXPECT_TRUE(af == bf);
+
+        std::vector<short> stereoA(SAMPLES * 2), stereoB(SAMPLES * 2);
+        ref.monoToStereo(&a16[0], &stereoA[0], SAMPLES);
+        k.monoToStereo(&a16[0], &stereoB[0], SAMPLES);
+        EXPECT_TRUE(stereoA == stereoB);
+        ref.floatToS16(&f[0], &stereoA[0], SAMPLES);
+        ref.floatToS16(&f[0], &stereoA[SAMPLES], SAMPLES);
+        std::reverse(stereoA.begin() + SAMPLES, stereoA.end());
+        ref.stereoToMono(&stereoA[0], &a16[0], SAMPLES);
+        k.stereoToMono(&stereoA[0], &b16[0], SAMPLES);
+        EXPECT_TRUE(a16 == b16);
+
+        std::vector<float> right(f.rbegin(), f.rend());
+        std::vector<float> ai(SAMPLES * 2), bi(SAMPLES * 2);
+        ref.interleave(&f[0], &right[0], &ai[0], SAMPLES);
+        k.interleave(&f[0], &right[0], &bi[0], SAMPLES);
+        EXPECT_TRUE(ai == bi);
+        std::vector<float> l(SAMPLES), r(SAMPLES);
+        k.deinterleave(&bi[0], &l[0], &r[0], SAMPLES);
+        EXPECT_TRUE(l == f);
+        EXPECT_TRUE(r == right);
+
+        for (int channels = 1; channels <= 3; channels++) {
+            const float gains[3] = {0.5f, 3.0f, -1.0f};
+            size_t frames = SAMPLES / channels;
+            std::vector<short> ga(stereoA.begin(), stereoA.begin() + frames * channels);
+            std::vector<short> gb(ga);
+            ref.applyGain(&ga[0], frames, channels, gains);
+            k.applyGain(&gb[0], frames, channels, gains);
+            EXPECT_TRUE(maxDiff(ga, gb) <= 1);
+        }
+
+        for (int channels = 1; channels <= 2; channels++) {
+            const float gains[2] = {0.25f, 1.5f};
+            const float steps[2] = {0.001f, -0.002f};
+            size_t frames = SAMPLES / channels;
+            std::vector<float> busA(f.begin(), f.begin() + 2 * (SAMPLES / 2));
+            busA.resize(frames * 2, 0.5f);
+            std::vector<float> busB(busA);
+            ref.mixToStereo(&stereoA[0], channels, &busA[0], frames, gains, steps);
+            k.mixToStereo(&stereoA[0], channels, &busB[0], frames, gains, steps);
+            for (size_t i = 0; i < busA.size(); i++) {
+                EXPECT_NEAR(busA[i], busB[i], 1e-5f);
+            }
+        }
+
+        for (unsigned half = 1; half <= 64; half *= 2) {
+            const size_t size = 128;
+            std::vector<float> wr(f.begin(), f.begin() + half), wi(f.rbegin(), f.rbegin() + half);
+            std::vector<float> reA(f.begin(), f.begin() + size), imA(f.rbegin(), f.rbegin() + size);
+            std::vector<float> reB(reA), imB(imA);
+            ref.fftStage(&reA[0], &imA[0], size, half, &wr[0], &wi[0], -1.0f);
+            k.fftStage(&reB[0], &imB[0], size, half, &wr[0], &wi[0], -1.0f);
+            for (size_t i = 0; i < size; i++) {
+                EXPECT_NEAR(reA[i], reB[i], 1e-5f);
+                EXPECT_NEAR(imA[i], imB[i], 1e-5f);
+            }
+        }
+
+        // resonances of pole radius 0.95 and one stage passing through; the
+        // calls are of every size around the pipeline depth, state carried
+        const int n = PCM_BIQUAD_STAGES;
+        float coefs[5 * PCM_BIQUAD_STAGES];
+        for (int stage = 0; stage < n; stage++) {
+            bool flat = stage == 3;
+            double angle = 0.2 + 0.3 * stage;
+            coefs[stage] = flat ? 1.0f : 0.5f + 0.1f * f[stage];
+            coefs[n + stage] = flat ? 0.0f : 0.3f * f[n + stage];
+            coefs[2 * n + stage] = flat ? 0.0f : 0.2f * f[2 * n + stage];
+            coefs[3 * n + stage] = flat ? 0.0f : static_cast<float>(-2 * 0.95 * cos(angle));
+            coefs[4 * n + stage] = flat ? 0.0f : 0.95f * 0.95f;
+        }
+        float stateA[2 * PCM_BIQUAD_STAGES] = {0}, stateB[2 * PCM_BIQUAD_STAGES] = {0};
+        std::vector<float> cascadeA(f), cascadeB(f);
+        const size_t calls[] = {1, 3, 7, 8, 9, 192, SAMPLES - 220};
+        for (size_t c = 0, at = 0; c < sizeof(calls) / sizeof(calls[0]); at += calls[c++]) {
+            ref.biquadCascade(&cascadeA[at], calls[c], coefs, stateA);
+            k.biquadCascade(&cascadeB[at], calls[c], coefs, stateB);
+        }
+        for (size_t i = 0; i < cascadeA.size(); i++) {
+            EXPECT_NEAR(cascadeA[i], cascadeB[i], 1e-4f);
+        }
+        for (int i = 0; i < 2 * n; i++) {
+            EXPECT_NEAR(stateA[i], stateB[i], 1e-4f);
+        }
+
+        // lag counts around the sixteen a SIMD pass takes
+        for (size_t lags = 1; lags <= 40; lags += 13) {
+            const size_t length = 96;
+            std::vector<float> x(f.rbegin(), f.rbegin() + lags + length - 1);
+            std::vector<float> scoresA(lags), scoresB(lags);
+            ref.crossCorrelate(&f[0], &x[0], length, lags, &scoresA[0]);
+            k.crossCorrelate(&f[0], &x[0], length, lags, &scoresB[0]);
+            for (size_t d = 0; d < lags; d++) {
+                EXPECT_NEAR(scoresA[d], scoresB[d], 1e-4f);
+            }
+        }
+    }
+}
+
+TEST(pcmMixRampsTheGainsAcrossTheCall) {
+    const PcmKernels &k = PcmKernels::best();
+    std::vector<short> mono(101, 16384);
+    std::vector<float> bus(202, 0.25f);
+    const float gains[2] = {1.0f, 0.0f};
+    const float steps[2] = {-0.01f, 0.01f};
+    k.mixToStereo(&mono[0], 1, &bus[0], mono.size(), gains, steps);
+    for (size_t i = 0; i < mono.size(); i++) {
+        EXPECT_NEAR(0.25f + 0.5f * (1.0f - 0.01f * i), bus[2 * i], 1e-5f);
+        EXPECT_NEAR(0.25f + 0.5f * 0.01f * i, bus[2 * i + 1], 1e-5f);
+    }
+}
+
+TEST(pcmConversionsRoundTripAndClip) {
+    const PcmKernels &k = PcmKernels::best();
+    std::vector<short> s16(65536);
+    for (size_t i = 0; i < s16.size(); i++) {
+        s16[i] = static_cast<short>(i - 32768);
+    }
+    std::vector<float> f(s16.size());
+    std::vector<short> back(s16.size());
+    k.s16ToFloat(&s16[0], &f[0], s16.size());
+    k.floatToS16(&f[0], &back[0], f.size());
+    EXPECT_TRUE(back == s16);
+    EXPECT_EQ(-1.0f, f[0]);
+
+    std::vector<unsigned char> s24(s16.size() * 3);
+    k.floatToS24(&f[0], &s24[0], f.size());
+    std::vector<float> f24(f.size());
+    k.s24ToFloat(&s24[0], &f24[0], f.size());
+    EXPECT_TRUE(f24 == f);
+
+    float over[4] = {2.0f, -2.0f, 1.0f, -1.0f};
+    short clipped[4];
+    k.floatToS16(over, clipped, 4);
+    EXPECT_EQ(32767, clipped[0]);
+    EXPECT_EQ(-32768, clipped[1]);
+    EXPECT_EQ(32767, clipped[2]);
+    int clipped32[4];
+    k.floatToS32(over, clipped32, 4);
+    EXPECT_EQ(2147483520, clipped32[0]);
+    EXPECT_EQ(-2147483647 - 1, clipped32[1]);
+
+    short loud[16];
+    for (int i = 0; i < 16; i++) {
+        loud[i] = i % 2 ? -20000 : 20000;
+    }
+    float gain = 2.0f;
+    k.applyGain(loud, 16, 1, &gain);
+    EXPECT_EQ(32767, loud[0]);
+    EXPECT_EQ(-32768, loud[1]);
+}
+
+TEST(pcmDitherIsTriangularAndUnbiased) {
+    const PcmKernels &k = PcmKernels::best();
+    // a quarter LSB below zero: without dither every sample rounds to 0,
+    // with it the mean follows the signal and the error stays within a LSB
+    std::vector<float> f(40000, -0.25f / 32768);
+    std::vector<short> out(f.size());
+    PcmDither dither;
+    k.floatToS16Dither(&f[0], &out[0], f.size(), &dither);
+    double sum = 0;
+    int outside = 0;
+    for (size_t i = 0; i < out.size(); i++) {
+        sum += out[i];
+        outside += out[i] < -2 || out[i] > 1;
+    }
+    EXPECT_NEAR(-0.25, sum / out.size(), 0.02);
+    EXPECT_EQ(0, outside);
+}
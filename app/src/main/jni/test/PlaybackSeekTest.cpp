@@ -0,0 +1,278 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "HostBackend.h"
+#include "LosslessFile.h"
+#include "PlaybackStream.h"
+#include "TestHarness.h"
+#include "WavFile.h"
+
+static const unsigned BUFFER_FRAMES = 256;
+
+// never 0, so silence stands out, and every frame says where it's from
+static std::vector<short> numbered(size_t frames) {
+    std::vector<short> data(frames);
+    for (size_t i = 0; i < frames; i++) {
+        data[i] = static_cast<short>(1 + i % 30000);
+    }
+    return data;
+}
+
+static void writeRaw(const char *path, const std::vector<short> &data) {
+    FILE *out = fopen(path, "wb");
+    fwrite(data.data(), sizeof(short), data.size(), out);
+    fclose(out);
+}
+
+static void writeWav(const char *path, const std::vector<short> &data) {
+    WavWriter writer;
+    writer.open(path, FILE_SAMPLE_RATE, 1, true);
+    writer.write(data.data(), data.size() * sizeof(short));
+    writer.close();
+}
+
+static void writeLossless(const char *path, const std::vector<short> &data) {
+    LosslessWriter writer;
+    writer.open(path, FILE_SAMPLE_RATE, 1);
+    writer.write(data.data(), data.size());
+    writer.close();
+}
+
+static bool silent(const std::vector<short> &buffer) {
+    return std::count(buffer.begin(), buffer.end(), 0) == static_cast<long>(buffer.size());
+}
+
+// the file frame a buffer starts at if it's exactly the file from there,
+// otherwise -1: silence, or faded on a jump. The numbers repeat every
+// 30000 frames, so of the places it could be, the one nearest near
+static long where(const std::vector<short> &data, const short *buffer, unsigned samples, long near) {
+    // the file numbers its frames from 1, so nothing of it starts there
+    if (buffer[0] <= 0) {
+        return -1;
+    }
+    long found = -1;
+    for (long base = buffer[0] - 1; base + samples <= static_cast<long>(data.size()); base += 30000) {
+        if (std::equal(buffer, buffer + samples, data.begin() + base)
+            && (found < 0 || labs(base - near) < labs(found - near))) {
+            found = base;
+        }
+    }
+    return found;
+}
+
+// the next buffer the way the player callback would see it, copied out
+// before it goes back to the reader, which gets a little time between
+// callbacks
+static bool play(PlaybackStream *stream, std::vector<short> *out) {
+    unsigned bytes;
+    const short *buffer = stream->nextBuffer(&bytes);
+    if (buffer == NULL) {
+        return false;
+    }
+    out->assign(buffer, buffer + bytes / sizeof(short));
+    stream->onBufferPlayed();
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+    return true;
+}
+
+// plays count buffers and keeps their contents
+static std::vector<std::vector<short> > pull(PlaybackStream *stream, size_t count) {
+    std::vector<std::vector<short> > buffers;
+    std::vector<short> buffer;
+    while (buffers.size() < count && play(stream, &buffer)) {
+        buffers.push_back(buffer);
+    }
+    return buffers;
+}
+
+static void seekAndLoop(const char *path, PlaybackStream::SourceMode mode, bool direct) {
+    const size_t frames = 5 * FILE_SAMPLE_RATE;
+    std::vector<short> data = numbered(frames);
+    PlaybackStream stream(1, 8);
+    stream.setSampleRates(FILE_SAMPLE_RATE, FILE_SAMPLE_RATE);
+
+    // from frame 10000: the first buffer fades in, then it's the file
+    EXPECT_TRUE(stream.open(path, BUFFER_FRAMES, mode, 0, 10000));
+    EXPECT_EQ(direct, stream.zeroCopy());
+    EXPECT_EQ(frames, static_cast<size_t>(stream.frames()));
+    EXPECT_EQ(10000u, static_cast<unsigned>(stream.position()));
+    std::vector<std::vector<short> > played = pull(&stream, 4);
+    EXPECT_EQ(4u, played.size());
+    if (!direct) {
+        EXPECT_TRUE(played[0][0] == 0 && played[0][BUFFER_FRAMES - 1] > 0);
+        EXPECT_EQ(10000 + static_cast<long>(BUFFER_FRAMES), where(data, &played[1][0], BUFFER_FRAMES, 10000));
+    }
+    EXPECT_EQ(10000u + 4 * BUFFER_FRAMES, static_cast<unsigned>(stream.position()));
+
+    // far ahead: whatever was read before is faded out or dropped, then the
+    // target fades in and the file goes on from it
+    EXPECT_TRUE(stream.seek(3 * FILE_SAMPLE_RATE));
+    EXPECT_EQ(3u * FILE_SAMPLE_RATE, static_cast<unsigned>(stream.position()));
+    played = pull(&stream, 30);
+    long expected = -1;
+    int exact = 0, stale = 0;
+    for (size_t i = 0; i < played.size(); i++) {
+        long at = where(data, &played[i][0], static_cast<unsigned>(played[i].size()), 3 * FILE_SAMPLE_RATE);
+        if (at < 0) {
+            // only before the first exact one
+            EXPECT_EQ(-1, expected);
+            continue;
+        }
+        if (expected < 0) {
+            EXPECT_EQ(3 * FILE_SAMPLE_RATE + static_cast<long>(BUFFER_FRAMES), at);
+        } else {
+            EXPECT_EQ(expected, at);
+        }
+        stale += at < 3 * FILE_SAMPLE_RATE;
+        exact++;
+        expected = at + static_cast<long>(played[i].size());
+    }
+    EXPECT_TRUE(exact > 20);
+    EXPECT_EQ(0, stale);
+    EXPECT_EQ(0u, stream.underruns());
+    EXPECT_TRUE(stream.lastSeekLatencyNs() > 0);
+
+    // back to the start and loop a second between 1 s and 2 s
+    EXPECT_TRUE(stream.seek(0));
+    stream.setLoop(FILE_SAMPLE_RATE, 2 * FILE_SAMPLE_RATE);
+    std::vector<short> heard;
+    size_t skipped = 0;
+    std::vector<short> buffer;
+    while (heard.size() < 4 * FILE_SAMPLE_RATE && play(&stream, &buffer)) {
+        // up to the faded in start of the seek
+        if (heard.empty() && (silent(buffer) || buffer[0] != 0 || buffer.back() > 300)) {
+            skipped++;
+        } else {
+            heard.insert(heard.end(), buffer.begin(), buffer.end());
+        }
+    }
+    EXPECT_TRUE(skipped < 20);
+    int wrong = 0;
+    for (size_t i = BUFFER_FRAMES; i < heard.size(); i++) {
+        size_t frame = i < 2 * FILE_SAMPLE_RATE ? i : FILE_SAMPLE_RATE + (i - FILE_SAMPLE_RATE) % FILE_SAMPLE_RATE;
+        wrong += heard[i] != data[frame];
+    }
+    EXPECT_EQ(0, wrong);
+    EXPECT_TRUE(stream.position() >= FILE_SAMPLE_RATE && stream.position() <= 2u * FILE_SAMPLE_RATE);
+
+    // with the loop cleared, a seek near the end plays out and drains
+    stream.setLoop(0, 0);
+    EXPECT_TRUE(stream.seek(frames - 1000));
+    size_t left = 0;
+    while (play(&stream, &buffer)) {
+        left += silent(buffer) ? 0 : buffer.size();
+    }
+    stream.onBufferPlayed();
+    EXPECT_TRUE(stream.drained());
+    EXPECT_TRUE(left >= 1000 && left < 1000 + 16 * BUFFER_FRAMES);
+    EXPECT_EQ(frames, static_cast<size_t>(stream.position()));
+    stream.close();
+}
+
+TEST(rawPcmSeeksAndLoops) {
+    const char *path = "/tmp/PlaybackSeekTest.pcm";
+    writeRaw(path, numbered(5 * FILE_SAMPLE_RATE));
+    seekAndLoop(path, PlaybackStream::SOURCE_STREAM, false);
+    unlink(path);
+}
+
+TEST(mappedWavSeeksAndLoopsWithoutCopies) {
+    const char *path = "/tmp/PlaybackSeekTest.wav";
+    writeWav(path, numbered(5 * FILE_SAMPLE_RATE));
+    seekAndLoop(path, PlaybackStream::SOURCE_MAPPED, true);
+    unlink(path);
+}
+
+TEST(losslessSeeksAndLoopsThroughItsIndex) {
+    const char *path = "/tmp/PlaybackSeekTest.nfla";
+    std::string index = LosslessIndex::indexPathFor(path);
+    writeLossless(path, numbered(5 * FILE_SAMPLE_RATE));
+    EXPECT_EQ(0, access(index.c_str(), F_OK));
+    seekAndLoop(path, PlaybackStream::SOURCE_STREAM, false);
+
+    // the writer's index is what a scan finds
+    LosslessIndex written, scanned;
+    FILE *file = fopen(path, "rb");
+    fseek(file, 0, SEEK_END);
+    unsigned long long fileBytes = static_cast<unsigned long long>(ftell(file));
+    fclose(file);
+    EXPECT_TRUE(written.load(index.c_str(), fileBytes));
+    EXPECT_TRUE(scanned.scan(path));
+    EXPECT_EQ(scanned.blocks(), written.blocks());
+    EXPECT_EQ(5ULL * FILE_SAMPLE_RATE, written.frames());
+    EXPECT_EQ(written.frames(), scanned.frames());
+    bool same = scanned.blocks() == written.blocks();
+    for (size_t i = 0; same && i < written.blocks(); i++) {
+        same = written.offset(i) == scanned.offset(i);
+    }
+    EXPECT_TRUE(same);
+    // and one of another file is ignored
+    EXPECT_TRUE(!written.load(index.c_str(), fileBytes + 1));
+
+    // without it the source scans, and still lands on the frame
+    unlink(index.c_str());
+    std::vector<short> data = numbered(5 * FILE_SAMPLE_RATE);
+    LosslessPcmSource source;
+    EXPECT_TRUE(source.open(path));
+    EXPECT_EQ(data.size() * sizeof(short), static_cast<size_t>(source.size()));
+    const unsigned long long targets[] = {123457, 4096, 0, 5 * FILE_SAMPLE_RATE - 10};
+    for (size_t t = 0; t < sizeof(targets) / sizeof(targets[0]); t++) {
+        short read[10];
+        EXPECT_TRUE(source.seek(targets[t] * sizeof(short)));
+        EXPECT_EQ(sizeof(read), source.read(read, sizeof(read)));
+        EXPECT_TRUE(std::equal(read, read + 10, data.begin() + targets[t]));
+    }
+    EXPECT_TRUE(source.seek(~0ULL));
+    short past;
+    EXPECT_EQ(0u, source.read(&past, sizeof(past)));
+    source.close();
+    unlink(path);
+}
+
+TEST(engineStartsAtAnOffsetAndSeeks) {
+    const char *path = "/tmp/PlaybackSeekTest_engine.pcm";
+    std::vector<short> data = numbered(10 * FILE_SAMPLE_RATE);
+    writeRaw(path, data);
+
+    // a stopped playback resumes where it was
+    HostBackend *backend = new HostBackend(192, 0);
+    AudioEngine engine(backend);
+    EXPECT_TRUE(engine.startPlay(path, 9 * FILE_SAMPLE_RATE));
+    for (int i = 0; i < 1000 && !engine.playFinished(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_TRUE(engine.playFinished());
+    EXPECT_EQ(data.size(), static_cast<size_t>(engine.playPosition()));
+    EXPECT_EQ(data.size(), static_cast<size_t>(engine.playLength()));
+    std::vector<short> output = backend->output();
+    EXPECT_TRUE(output.size() >= FILE_SAMPLE_RATE);
+    EXPECT_TRUE(std::equal(data.begin() + 9 * FILE_SAMPLE_RATE + 192, data.end(), output.begin() + 192));
+
+    // seeking only while playing; the end comes sooner after a jump
+    EXPECT_TRUE(!engine.seekPlay(0));
+    HostBackend *slow = new HostBackend(192, 20);
+    AudioEngine playing(slow);
+    EXPECT_TRUE(playing.startPlay(path));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_TRUE(playing.seekPlay(data.size() - FILE_SAMPLE_RATE / 2));
+    EXPECT_TRUE(playing.setPlayLoop(0, 0));
+    for (int i = 0; i < 1000 && !playing.playFinished(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_TRUE(playing.playFinished());
+    EXPECT_TRUE(slow->output().size() < data.size() / 2);
+    EXPECT_TRUE(playing.playback().lastSeekLatencyNs() > 0);
+    EXPECT_EQ(data.size(), static_cast<size_t>(playing.playPosition()));
+    unlink(path);
+}
@@ -0,0 +1,171 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "Resampler.h"
+#include "TestHarness.h"
+
+static std::vector<short> sine(double frequency, int rate, size_t frames, int channels) {
+    std::vector<short> samples(frames * channels);
+    for (size_t i = 0; i < frames; i++) {
+        short v = static_cast<short>(std::lrint(16000 * std::sin(2 * M_PI * frequency * i / rate)));
+        for (int c = 0; c < channels; c++) {
+            samples[i * channels + c] = c == 0 ? v : -v;
+        }
+    }
+    return samples;
+}
+
+// feeds in through the resampler in uneven chunks, as the streams do
+static std::vector<short> resample(Resampler *resampler, const std::vector<short> &in,
+                                   int channels) {
+    std::vector<short> out(resampler->outputFramesFor(in.size() / channels) * channels);
+    static const size_t chunks[] = {1, 7, 256, 61, 1024};
+    size_t inPos = 0, outPos = 0, chunk = 0;
+    size_t inFrames = in.size() / channels;
+    while (inPos < inFrames) {
+        size_t n = std::min(chunks[chunk++ % 5], inFrames - inPos);
+        size_t consumed;
+        outPos += resampler->process(&in[inPos * channels], n, &consumed, &out[outPos * channels],
+                                     std::min<size_t>(n * 2, out.size() / channels - outPos));
+        inPos += consumed;
+    }
+    out.resize(outPos * channels);
+    return out;
+}
+
+// signal to noise ratio of channel 0 against the best fitting sine of the
+// given frequency, skipping the filter's start-up
+static double snrDb(const std::vector<short> &out, int channels, double frequency, int rate) {
+    size_t begin = 256;
+    size_t frames = out.size() / channels;
+    double ss = 0, sc = 0, cc = 0, ys = 0, yc = 0;
+    for (size_t i = begin; i < frames; i++) {
+        double s = std::sin(2 * M_PI * frequency * i / rate);
+        double c = std::cos(2 * M_PI * frequency * i / rate);
+        double y = out[i * channels];
+        ss += s * s;
+        sc += s * c;
+        cc += c * c;
+        ys += y * s;
+        yc += y * c;
+    }
+    double det = ss * cc - sc * sc;
+    double a = (ys * cc - yc * sc) / det;
+    double b = (yc * ss - ys * sc) / det;
+    double signal = 0, noise = 0;
+    for (size_t i = begin; i < frames; i++) {
+        double fit = a * std::sin(2 * M_PI * frequency * i / rate)
+                     + b * std::cos(2 * M_PI * frequency * i / rate);
+        double e = out[i * channels] - fit;
+        signal += fit * fit;
+        noise += e * e;
+    }
+    return 10 * std::log10(signal / noise);
+}
+
+TEST(resamplerKeepsSineClean) {
+    static const int rates[][2] = {{44100, 48000}, {48000, 44100}, {16000, 48000}, {44100, 22050}};
+    static const Resampler::Kernel kernels[] = {Resampler::KERNEL_SCALAR, Resampler::KERNEL_SSE,
+                                                Resampler::KERNEL_AVX, Resampler::KERNEL_NEON};
+    for (int r = 0; r < 4; r++) {
+        int inRate = rates[r][0], outRate = rates[r][1];
+        std::vector<short> in = sine(1000, inRate, inRate / 2, 2);
+        for (int k = 0; k < 4; k++) {
+            Resampler resampler;
+            EXPECT_TRUE(resampler.init(inRate, outRate, 2));
+            if (!resampler.setKernel(kernels[k])) {
+                continue;
+            }
+            std::vector<short> out = resample(&resampler, in, 2);
+            // every input frame in, length follows the ratio
+            EXPECT_NEAR(in.size() / 2.0 * outRate / inRate, out.size() / 2.0, 2.0);
+            // close to the 16-bit limit of ~90 dB
+            EXPECT_TRUE(snrDb(out, 2, 1000, outRate) > 80);
+            // the second channel is the inverse of the first
+            bool inverted = true;
+            for (size_t i = 0; inverted && i < out.size(); i += 2) {
+                inverted = std::abs(out[i] + out[i + 1]) <= 1;
+            }
+            EXPECT_TRUE(inverted);
+        }
+    }
+}
+
+TEST(resamplerKernelsMatchScalar) {
+    std::vector<short> in = sine(3000, 44100, 4096, 1);
+    Resampler reference;
+    reference.init(44100, 48000, 1);
+    reference.setKernel(Resampler::KERNEL_SCALAR);
+    std::vector<short> expected = resample(&reference, in, 1);
+
+    Resampler resampler;
+    resampler.init(44100, 48000, 1);
+    std::vector<short> out = resample(&resampler, in, 1);
+    EXPECT_EQ(expected.size(), out.size());
+    int worst = 0;
+    for (size_t i = 0; i < out.size() && i < expected.size(); i++) {
+        worst = std::max(worst, std::abs(out[i] - expected[i]));
+    }
+    // only the summation order differs
+    EXPECT_TRUE(worst <= 1);
+}
+
+TEST(resamplerRejectsUnreasonableRatios) {
+    Resampler resampler;
+    EXPECT_TRUE(!resampler.init(44100, 0, 1));
+    EXPECT_TRUE(!resampler.init(44100, 47999, 1));
+    EXPECT_TRUE(!resampler.active());
+    EXPECT_TRUE(resampler.init(8000, 48000, 1));
+    EXPECT_TRUE(resampler.active());
+}
+
+TEST(resamplerLowQualityKeepsLengthAndDelay) {
+    std::vector<short> in = sine(1000, 44100, 22050, 2);
+    Resampler high;
+    high.init(44100, 48000, 2);
+    std::vector<short> expected = resample(&high, in, 2);
+    static const Resampler::Kernel kernels[] = {Resampler::KERNEL_SCALAR, Resampler::KERNEL_SSE,
+                                                Resampler::KERNEL_AVX, Resampler::KERNEL_NEON};
+    for (int k = 0; k < 4; k++) {
+        Resampler low;
+        EXPECT_TRUE(low.init(44100, 48000, 2));
+        if (!low.setKernel(kernels[k])) {
+            continue;
+        }
+        low.setQuality(Resampler::QUALITY_LOW);
+        EXPECT_EQ(Resampler::QUALITY_LOW, low.quality());
+        std::vector<short> out = resample(&low, in, 2);
+        // same frames at the same time; the shorter filter only costs
+        // stopband, so a tone well inside the passband is still clean
+        EXPECT_EQ(expected.size(), out.size());
+        EXPECT_TRUE(snrDb(out, 2, 1000, 48000) > 75);
+        int worst = 0;
+        for (size_t i = 512; i < out.size() && i < expected.size(); i++) {
+            worst = std::max(worst, std::abs(out[i] - expected[i]));
+        }
+        EXPECT_TRUE(worst < 32);
+    }
+
+    // switching back and forth mid-stream, as the CPU budget does, leaves
+    // no click: the result stays as clean as the low quality alone
+    Resampler switching;
+    switching.init(44100, 48000, 2);
+    std::vector<short> out(expected.size() + 4);
+    size_t inPos = 0, outPos = 0;
+    for (int round = 0; inPos < in.size() / 2; round++) {
+        switching.setQuality(round % 2 == 0 ? Resampler::QUALITY_LOW : Resampler::QUALITY_HIGH);
+        size_t n = std::min<size_t>(100 + round % 3 * 37, in.size() / 2 - inPos);
+        size_t consumed;
+        outPos += switching.process(&in[inPos * 2], n, &consumed, &out[outPos * 2],
+                                    out.size() / 2 - outPos);
+        inPos += consumed;
+    }
+    out.resize(outPos * 2);
+    EXPECT_EQ(expected.size(), out.size());
+    EXPECT_TRUE(snrDb(out, 2, 1000, 48000) > 75);
+}
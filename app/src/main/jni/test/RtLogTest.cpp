@@ -0,0 +1,52 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define LOG_TAG "RtLogTest"
+
+#include "RtLog.h"
+#include "TestHarness.h"
+
+static std::vector<std::string> lines;
+
+static void collect(int level, const char *tag, const char *text) {
+    // drop the "[seconds.micros] " prefix
+    const char *message = strchr(text, ' ');
+    lines.push_back(std::string(tag) + ":" + (message != NULL ? message + 1 : text));
+}
+
+TEST(rtLogFormatsRecordsOnFlush) {
+    RtLog::flush();
+    RtLog::setSink(collect);
+    lines.clear();
+    RTLOGI("size of buffer is %lld, counter is %lld", 512u, 7);
+    RTLOGE("no args");
+    EXPECT_TRUE(lines.empty());
+    RtLog::flush();
+    RtLog::setSink(NULL);
+    EXPECT_EQ(2u, lines.size());
+    EXPECT_TRUE(lines.size() == 2 && lines[0] == "RtLogTest:size of buffer is 512, counter is 7");
+    EXPECT_TRUE(lines.size() == 2 && lines[1] == "RtLogTest:no args");
+}
+
+TEST(rtLogDropsWhenFullInsteadOfBlocking) {
+    RtLog::flush();
+    RtLog::setSink(collect);
+    lines.clear();
+    unsigned long long dropped = RtLog::dropped();
+    // two writers racing into the 1024 record ring with nobody flushing
+    std::thread other([] {
+        for (int i = 0; i < 1000; i++) RTLOGW("other %lld", i);
+    });
+    for (int i = 0; i < 1000; i++) RTLOGW("main %lld", i);
+    other.join();
+    EXPECT_EQ(2000u - 1024u, RtLog::dropped() - dropped);
+    RtLog::flush();
+    RtLog::setSink(NULL);
+    // 1024 records plus the drop report
+    EXPECT_EQ(1025u, lines.size());
+}
@@ -0,0 +1,157 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "HostBackend.h"
+#include "SpectrumAnalyzer.h"
+#include "TestHarness.h"
+
+static const int RATE = 48000;
+static const unsigned FFT_SIZE = 1024;
+
+// a sine of amplitude (of full scale) centred on the given bin
+static std::vector<short> sine(size_t frames, int channels, unsigned bin, double amplitude) {
+    std::vector<short> data(frames * channels);
+    for (size_t i = 0; i < frames; i++) {
+        double v = amplitude * 32767 * sin(2 * M_PI * bin * i / FFT_SIZE);
+        for (int c = 0; c < channels; c++) {
+            data[i * channels + c] = static_cast<short>(v);
+        }
+    }
+    return data;
+}
+
+// waits for an update covering at least frames, false after a few seconds
+static bool waitFor(const SpectrumAnalyzer &analyzer, uint32_t frames, SpectrumLevels *levels,
+                    float *bins) {
+    for (int tries = 0; tries < 3000; tries++) {
+        if (analyzer.read(levels, bins) && levels->frames >= frames) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+TEST(spectrumAnalyzerPublishesLevelsAndBins) {
+    EXPECT_EQ(0u, SpectrumAnalyzer::bytesFor(1000));
+    EXPECT_EQ(0u, SpectrumAnalyzer::bytesFor(32));
+    size_t bytes = SpectrumAnalyzer::bytesFor(FFT_SIZE);
+    EXPECT_EQ(SpectrumAnalyzer::HEADER_BYTES + (FFT_SIZE / 2 + 1) * sizeof(float), bytes);
+    std::vector<unsigned char> memory(bytes);
+
+    SpectrumAnalyzer analyzer;
+    EXPECT_TRUE(!analyzer.start(&memory[0], bytes - 1, RATE, 2, FFT_SIZE));
+    EXPECT_TRUE(analyzer.start(&memory[0], bytes, RATE, 2, FFT_SIZE));
+    SpectrumLevels levels;
+    EXPECT_TRUE(!analyzer.read(&levels, NULL));
+    const uint32_t *header = reinterpret_cast<const uint32_t *>(&memory[0]);
+    EXPECT_EQ(FFT_SIZE / 2 + 1, header[1]);
+    EXPECT_EQ(static_cast<uint32_t>(RATE), header[2]);
+    EXPECT_EQ(FFT_SIZE, header[3]);
+
+    // half scale, in bursts the way a callback feeds it, at a pace the
+    // worker keeps up with: an update every hop of FFT_SIZE / 2
+    std::vector<short> tone = sine(FFT_SIZE * 4, 2, 64, 0.5);
+    std::vector<float> bins(analyzer.bins());
+    const size_t burst = FFT_SIZE / 4;
+    for (size_t frame = 0; frame < FFT_SIZE * 4; frame += burst) {
+        analyzer.feed(&tone[frame * 2], burst);
+        if ((frame + burst) % (FFT_SIZE / 2) == 0) {
+            EXPECT_TRUE(waitFor(analyzer, static_cast<uint32_t>(frame + burst), &levels, &bins[0]));
+        }
+    }
+    EXPECT_EQ(FFT_SIZE * 4, levels.frames);
+    EXPECT_EQ(0u, levels.skipped);
+    EXPECT_EQ(8u, levels.updates);
+    EXPECT_NEAR(-6.02f, levels.peakDb, 0.1f);
+    EXPECT_NEAR(-9.03f, levels.rmsDb, 0.1f);
+    EXPECT_NEAR(-6.02f, bins[64], 0.1f);
+    // the Hann window keeps the leakage to the neighbours
+    EXPECT_TRUE(bins[62] < -60.0f && bins[66] < -60.0f);
+    EXPECT_TRUE(bins[0] < -100.0f);
+
+    // with the worker asleep, a big feed laps the ring: it jumps to the
+    // newest window and counts what it missed
+    std::vector<short> silence(FFT_SIZE * 16 * 2, 0);
+    analyzer.feed(&silence[0], FFT_SIZE * 16);
+    EXPECT_TRUE(waitFor(analyzer, FFT_SIZE * 20, &levels, &bins[0]));
+    EXPECT_EQ(FFT_SIZE * 20, levels.frames);
+    EXPECT_TRUE(levels.skipped > 0);
+    EXPECT_EQ(SPECTRUM_FLOOR_DB, levels.peakDb);
+    EXPECT_EQ(SPECTRUM_FLOOR_DB, bins[64]);
+
+    analyzer.stop();
+    EXPECT_TRUE(!analyzer.running());
+    // feeding a stopped analyzer does nothing
+    analyzer.feed(&tone[0], FFT_SIZE);
+    EXPECT_EQ(FFT_SIZE * 20, reinterpret_cast<const uint32_t *>(&memory[0])[7]);
+}
+
+TEST(engineAnalysesWhatItRecords) {
+    std::vector<short> input = sine(FILE_SAMPLE_RATE, 1, 32, 0.25);
+    MemoryPcmSource source(input.data(), input.size() * sizeof(short));
+    HostBackend *backend = new HostBackend(192, 20);
+    backend->setInput(&source);
+    AudioEngine engine(backend);
+    std::vector<unsigned char> memory(SpectrumAnalyzer::bytesFor(FFT_SIZE));
+    EXPECT_TRUE(!engine.startAnalysis(TAP_COUNT, &memory[0], memory.size(), FFT_SIZE));
+    EXPECT_TRUE(engine.startAnalysis(TAP_CAPTURE, &memory[0], memory.size(), FFT_SIZE));
+    EXPECT_TRUE(engine.createAudioRecorder());
+    EXPECT_TRUE(engine.startRecord("/tmp/SpectrumAnalyzerTest.pcm"));
+
+    SpectrumLevels levels;
+    std::vector<float> bins(engine.analyzer(TAP_CAPTURE).bins());
+    EXPECT_TRUE(waitFor(engine.analyzer(TAP_CAPTURE), FFT_SIZE * 2, &levels, &bins[0]));
+    engine.stopRecord();
+    engine.stopAnalysis(TAP_CAPTURE);
+    EXPECT_NEAR(-12.04f, levels.peakDb, 0.2f);
+    EXPECT_NEAR(-12.04f, bins[32], 0.2f);
+    EXPECT_TRUE(!engine.analyzer(TAP_PLAYBACK).running());
+    unlink("/tmp/SpectrumAnalyzerTest.pcm");
+}
+
+TEST(spectrumAnalyzerShrinksItsFftUnderCpuBudget) {
+    size_t bytes = SpectrumAnalyzer::bytesFor(FFT_SIZE);
+    std::vector<unsigned char> memory(bytes);
+    CpuBudget budget;
+    SpectrumAnalyzer analyzer;
+    analyzer.setBudget(&budget);
+    EXPECT_TRUE(analyzer.start(&memory[0], bytes, RATE, 1, FFT_SIZE));
+    const uint32_t *header = reinterpret_cast<const uint32_t *>(&memory[0]);
+    std::vector<short> tone = sine(FFT_SIZE * 16, 1, 64, 0.5);
+    std::vector<float> bins(analyzer.bins());
+    SpectrumLevels levels;
+
+    // two levels down is a quarter of the size: the tone's bin moves with it
+    budget.setLevel(2);
+    analyzer.feed(&tone[0], FFT_SIZE);
+    EXPECT_TRUE(waitFor(analyzer, FFT_SIZE, &levels, &bins[0]));
+    EXPECT_EQ(FFT_SIZE / 4, header[3]);
+    EXPECT_EQ(FFT_SIZE / 8 + 1, header[1]);
+    EXPECT_EQ(FFT_SIZE / 8 + 1, levels.bins);
+    EXPECT_EQ(FFT_SIZE / 2 + 1, analyzer.bins());
+    EXPECT_NEAR(-6.02f, levels.peakDb, 0.1f);
+    EXPECT_NEAR(-6.02f, bins[16], 0.1f);
+
+    // never below the smallest size, and back to full once it recovers
+    budget.setLevel(CPU_BUDGET_MAX_LEVEL);
+    analyzer.feed(&tone[FFT_SIZE], FFT_SIZE);
+    EXPECT_TRUE(waitFor(analyzer, FFT_SIZE * 2, &levels, &bins[0]));
+    EXPECT_EQ(std::max<unsigned>(FFT_SIZE >> CPU_BUDGET_MAX_LEVEL, SPECTRUM_MIN_FFT_SIZE), header[3]);
+    budget.setLevel(0);
+    analyzer.feed(&tone[FFT_SIZE * 2], FFT_SIZE * 2);
+    EXPECT_TRUE(waitFor(analyzer, FFT_SIZE * 4, &levels, &bins[0]));
+    EXPECT_EQ(FFT_SIZE, header[3]);
+    EXPECT_EQ(FFT_SIZE / 2 + 1, levels.bins);
+    EXPECT_NEAR(-6.02f, bins[64], 0.1f);
+    analyzer.stop();
+}
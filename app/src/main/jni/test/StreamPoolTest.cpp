@@ -0,0 +1,100 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "HostBackend.h"
+#include "StreamPool.h"
+#include "TestHarness.h"
+
+static void countCallback(AudioStream *stream, void *context) {
+    static_cast<std::atomic<int> *>(context)->fetch_add(1);
+}
+
+TEST(poolHandsBackStoppedStreamsOfTheSameKind) {
+    // real time: a starved freewheeling player would fill memory with silence
+    StreamPool pool(new HostBackend(64, 1));
+    StreamFormat format = {48000, 1};
+    std::vector<short> buffer(64);
+
+    std::atomic<int> first(0);
+    AudioStream *player = pool.createPlayer(format, 2);
+    player->registerCallback(countCallback, &first);
+    player->enqueue(&buffer[0], buffer.size() * sizeof(short));
+    player->enqueue(&buffer[0], buffer.size() * sizeof(short));
+    player->start();
+    for (int i = 0; i < 1000 && first.load() < 2; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(2, first.load());
+    // deleted with a buffer still queued: it comes back stopped and empty
+    player->enqueue(&buffer[0], buffer.size() * sizeof(short));
+    delete player;
+
+    std::atomic<int> second(0);
+    player = pool.createPlayer(format, 2);
+    player->registerCallback(countCallback, &second);
+    StreamPoolStats stats = pool.stats();
+    EXPECT_EQ(1u, stats.hits);
+    EXPECT_EQ(1u, stats.misses);
+    EXPECT_EQ(0u, stats.idle);
+    player->enqueue(&buffer[0], buffer.size() * sizeof(short));
+    player->start();
+    for (int i = 0; i < 1000 && second.load() < 1; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    // only the new owner hears about it, and only its own buffer
+    EXPECT_EQ(1, second.load());
+    EXPECT_EQ(2, first.load());
+
+    // another depth or a recorder doesn't match
+    AudioStream *deeper = pool.createPlayer(format, 4);
+    AudioStream *recorder = pool.createRecorder(format, 2);
+    stats = pool.stats();
+    EXPECT_EQ(1u, stats.hits);
+    EXPECT_EQ(3u, stats.misses);
+    delete deeper;
+    delete recorder;
+    delete player;
+    EXPECT_EQ(3u, pool.stats().idle);
+    pool.trim();
+    EXPECT_EQ(0u, pool.stats().idle);
+}
+
+TEST(engineStartsEveryPlaybackOnAPrewarmedPlayer) {
+    const char *path = "/tmp/StreamPoolTest.pcm";
+    std::vector<short> file(4096);
+    FILE *out = fopen(path, "wb");
+    fwrite(file.data(), sizeof(short), file.size(), out);
+    fclose(out);
+
+    AudioEngine engine(new HostBackend(256, 0));
+    engine.configure(FILE_SAMPLE_RATE, 256);
+    // the player and the monitor's recorder
+    EXPECT_EQ(2u, engine.backend()->stats().idle);
+    for (int session = 0; session < 3; session++) {
+        EXPECT_TRUE(engine.startPlay(path));
+        for (int i = 0; i < 1000 && !engine.playFinished(); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        EXPECT_TRUE(engine.playFinished());
+    }
+    StreamPoolStats stats = engine.backend()->stats();
+    EXPECT_EQ(3u, stats.hits);
+    EXPECT_EQ(0u, stats.misses);
+
+    long long snapshot[AudioEngine::STATS_SNAPSHOT_SIZE];
+    engine.getStats(snapshot);
+    const long long *player = snapshot + STATS_FIELD_COUNT;
+    EXPECT_TRUE(player[STATS_FIRST_CALLBACK_NS] > 0);
+    EXPECT_EQ(0, snapshot[STATS_FIRST_CALLBACK_NS]);
+    unlink(path);
+}
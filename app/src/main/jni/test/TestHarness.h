@@ -0,0 +1,40 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+
+#ifndef NATIVEFEEDBACK_TESTHARNESS_H
+#define NATIVEFEEDBACK_TESTHARNESS_H
+
+#include <cmath>
+
+// Minimal test registry for the host build, so the tests need nothing beyond
+// the toolchain. TEST(name) defines a case; the EXPECT macros record a failure
+// and carry on.
+
+typedef void (*TestFunction)();
+
+void registerTest(const char *name, TestFunction function);
+void reportFailure(const char *file, int line, const char *expression);
+
+struct TestRegistrar {
+    TestRegistrar(const char *name, TestFunction function) {
+        registerTest(name, function);
+    }
+};
+
+#define TEST(name) \
+    static void name(); \
+    static TestRegistrar name##Registrar(#name, name); \
+    static void name()
+
+#define EXPECT_TRUE(condition) \
+    do { \
+        if (!(condition)) reportFailure(__FILE__, __LINE__, #condition); \
+    } while (0)
+
+#define EXPECT_EQ(expected, actual) EXPECT_TRUE((expected) == (actual))
+
+#define EXPECT_NEAR(expected, actual, tolerance) \
+    EXPECT_TRUE(std::fabs((expected) - (actual)) <= (tolerance))
+
+#endif //NATIVEFEEDBACK_TESTHARNESS_H
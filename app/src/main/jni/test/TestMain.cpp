@@ -0,0 +1,54 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+// usage: medianative_tests [name filter]
+//
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "TestHarness.h"
+
+struct TestCase {
+    const char *name;
+    TestFunction function;
+};
+
+static std::vector<TestCase> &registry() {
+    static std::vector<TestCase> tests;
+    return tests;
+}
+
+static int failures = 0;
+
+void registerTest(const char *name, TestFunction function) {
+    TestCase test = {name, function};
+    registry().push_back(test);
+}
+
+void reportFailure(const char *file, int line, const char *expression) {
+    fprintf(stderr, "%s:%d: expected %s\n", file, line, expression);
+    failures++;
+}
+
+int main(int argc, char **argv) {
+    const char *filter = argc > 1 ? argv[1] : NULL;
+    int failed = 0;
+    int run = 0;
+    for (size_t i = 0; i < registry().size(); i++) {
+        const TestCase &test = registry()[i];
+        if (filter != NULL && strstr(test.name, filter) == NULL) {
+            continue;
+        }
+        int before = failures;
+        test.function();
+        run++;
+        bool ok = failures == before;
+        if (!ok) {
+            failed++;
+        }
+        printf("[%s] %s\n", ok ? "  OK  " : " FAIL ", test.name);
+    }
+    printf("%d tests, %d failed\n", run, failed);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,283 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "HostBackend.h"
+#include "PlaybackStream.h"
+#include "TestHarness.h"
+#include "TimeStretcher.h"
+
+static const int RATE = 48000;
+// no whole number of periods to a hop, so windows only add up in phase
+// where the search puts them
+static const double TONE = 1013;
+static const double AMPLITUDE = 16000;
+
+// the tone on the left, half of it inverted on the right, so the mono
+// downmix the search looks at isn't silent
+static std::vector<short> tone(size_t frames, int rate, double frequency) {
+    std::vector<short> samples(frames * 2);
+    for (size_t i = 0; i < frames; i++) {
+        short v = static_cast<short>(std::lrint(AMPLITUDE * std::sin(2 * M_PI * frequency * i / rate)));
+        samples[2 * i] = v;
+        samples[2 * i + 1] = static_cast<short>(-v / 2);
+    }
+    return samples;
+}
+
+// feeds in through the stretcher in uneven chunks and flushes it, as
+// the playback reader does; speeds[k] is set before chunk k if there's one
+static std::vector<short> stretch(TimeStretcher *stretcher, const std::vector<short> &in,
+                                  const std::vector<float> &speeds = std::vector<float>()) {
+    std::vector<short> input(in);
+    input.resize(input.size() + stretcher->latencyFrames() * 2, 0);
+    size_t inFrames = input.size() / 2;
+    std::vector<short> out(inFrames * 2 / STRETCH_MIN_SPEED + 4096);
+    static const size_t chunks[] = {1, 7, 256, 61, 1024, 192};
+    size_t inPos = 0, outPos = 0;
+    for (size_t chunk = 0; inPos < inFrames; chunk++) {
+        if (chunk < speeds.size()) {
+            stretcher->setSpeed(speeds[chunk]);
+        }
+        size_t n = std::min(chunks[chunk % 6], inFrames - inPos);
+        size_t consumed;
+        outPos += stretcher->process(&input[inPos * 2], n, &consumed, &out[outPos * 2],
+                                     std::min<size_t>(n * 3, out.size() / 2 - outPos));
+        inPos += consumed;
+    }
+    out.resize(outPos * 2);
+    return out;
+}
+
+// cycles per second of channel 0 from its rising zero crossings
+static double frequency(const std::vector<short> &out, int rate) {
+    size_t frames = out.size() / 2;
+    long first = -1, last = -1, crossings = 0;
+    for (size_t i = 1; i < frames; i++) {
+        if (out[2 * (i - 1)] < 0 && out[2 * i] >= 0) {
+            if (first < 0) {
+                first = static_cast<long>(i);
+            } else {
+                crossings++;
+            }
+            last = static_cast<long>(i);
+        }
+    }
+    return last > first ? static_cast<double>(crossings) * rate / (last - first) : 0;
+}
+
+// the lowest peak of channel 0 over any period of the tone, against the
+// tone's amplitude: windows added out of phase cancel into a dip
+static double steadiness(const std::vector<short> &out, int rate) {
+    size_t period = static_cast<size_t>(rate / TONE) + 1;
+    size_t frames = out.size() / 2;
+    int lowest = 1 << 16;
+    for (size_t at = 0; at + period <= frames; at += period / 4) {
+        int peak = 0;
+        for (size_t i = at; i < at + period; i++) {
+            peak = std::max(peak, std::abs(static_cast<int>(out[2 * i])));
+        }
+        lowest = std::min(lowest, peak);
+    }
+    return lowest / AMPLITUDE;
+}
+
+static std::vector<const PcmKernels *> kernelSets() {
+    std::vector<const PcmKernels *> sets;
+    for (int s = PcmKernels::SET_SCALAR; s <= PcmKernels::SET_NEON; s++) {
+        const PcmKernels *k = PcmKernels::get(static_cast<PcmKernels::Set>(s));
+        if (k != NULL) {
+            sets.push_back(k);
+        }
+    }
+    return sets;
+}
+
+TEST(timeStretcherAtSpeedOneIsTheInput) {
+    // a chord with some noise over it, nothing periodic to lock onto
+    std::vector<short> in(RATE * 2);
+    unsigned seed = 1;
+    for (size_t i = 0; i < in.size() / 2; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        double v = 6000 * std::sin(0.031 * i) + 5000 * std::sin(0.1173 * i)
+                   + static_cast<int>(seed >> 20) - 2048;
+        in[2 * i] = static_cast<short>(v);
+        in[2 * i + 1] = static_cast<short>(v / 2);
+    }
+    std::vector<const PcmKernels *> sets = kernelSets();
+    for (size_t s = 0; s < sets.size(); s++) {
+        TimeStretcher stretcher;
+        EXPECT_TRUE(stretcher.init(RATE, 2));
+        stretcher.setKernels(*sets[s]);
+        EXPECT_EQ(1.0f, stretcher.speed());
+        std::vector<short> out = stretch(&stretcher, in);
+        // every frame, from the first, as it was
+        EXPECT_TRUE(out.size() >= in.size());
+        EXPECT_TRUE(std::equal(in.begin(), in.end(), out.begin()));
+    }
+}
+
+TEST(timeStretcherKeepsThePitchAtEverySpeed) {
+    std::vector<short> in = tone(RATE * 2, RATE, TONE);
+    static const float speeds[] = {0.5f, 0.75f, 1.5f, 2.0f, 3.0f};
+    std::vector<const PcmKernels *> sets = kernelSets();
+    for (size_t s = 0; s < sets.size(); s++) {
+        for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++) {
+            TimeStretcher stretcher;
+            stretcher.init(RATE, 2);
+            stretcher.setKernels(*sets[s]);
+            stretcher.setSpeed(speeds[i]);
+            std::vector<short> out = stretch(&stretcher, in);
+            // the length follows the speed, give or take the flushed tail
+            double expected = in.size() / 2 / speeds[i];
+            double slack = stretcher.latencyFrames() / speeds[i] + RATE / 100;
+            EXPECT_NEAR(expected, out.size() / 2.0, slack);
+            // the tone is where it was and the splices are in phase, up to
+            // where the last windows reach into the flush
+            out.resize((static_cast<size_t>(expected) - stretcher.latencyFrames()) * 2);
+            EXPECT_NEAR(TONE, frequency(out, RATE), TONE * 0.005);
+            EXPECT_TRUE(steadiness(out, RATE) > 0.97);
+            // both channels from the same place
+            bool together = true;
+            for (size_t j = 0; together && j < out.size(); j += 2) {
+                together = std::abs(out[j] + 2 * out[j + 1]) <= 3;
+            }
+            EXPECT_TRUE(together);
+        }
+    }
+
+    TimeStretcher stretcher;
+    stretcher.init(RATE, 2);
+    stretcher.setSpeed(10);
+    EXPECT_EQ(STRETCH_MAX_SPEED, stretcher.speed());
+    stretcher.setSpeed(0);
+    EXPECT_EQ(STRETCH_MIN_SPEED, stretcher.speed());
+    EXPECT_TRUE(!stretcher.init(0, 2));
+    EXPECT_TRUE(!stretcher.active());
+}
+
+TEST(timeStretcherChangesSpeedWithoutASeam) {
+    std::vector<short> in = tone(RATE * 3, RATE, TONE);
+    // a new speed every few chunks, up and down the whole range
+    std::vector<float> speeds;
+    static const float steps[] = {1.0f, 2.5f, 0.5f, 3.0f, 1.25f, 0.6f};
+    for (int i = 0; i < 600; i++) {
+        speeds.push_back(steps[i / 7 % 6]);
+    }
+    TimeStretcher stretcher;
+    stretcher.init(RATE, 2);
+    std::vector<short> out = stretch(&stretcher, in, speeds);
+    size_t end = out.size() / 2 - stretcher.latencyFrames() * 3;
+    out.resize(end * 2);
+    EXPECT_NEAR(TONE, frequency(out, RATE), TONE * 0.005);
+    EXPECT_TRUE(steadiness(out, RATE) > 0.97);
+
+    // switched in on the way, as playback does
+    TimeStretcher late;
+    late.init(RATE, 2);
+    std::vector<short> head(in.begin(), in.begin() + RATE), tail(in.begin() + RATE, in.end());
+    std::vector<short> joined(head);
+    late.setSpeed(2);
+    std::vector<short> stretched = stretch(&late, tail);
+    joined.insert(joined.end(), stretched.begin(), stretched.end() - late.latencyFrames() * 2 * 2);
+    EXPECT_TRUE(steadiness(joined, RATE) > 0.97);
+}
+
+static const char *PATH = "/tmp/TimeStretchTest.pcm";
+
+// a mono tone at the engine's file rate
+static std::vector<short> writeTone(size_t frames) {
+    std::vector<short> stereo = tone(frames, FILE_SAMPLE_RATE, 441);
+    std::vector<short> mono(frames);
+    for (size_t i = 0; i < frames; i++) {
+        mono[i] = stereo[2 * i];
+    }
+    FILE *out = fopen(PATH, "wb");
+    fwrite(mono.data(), sizeof(short), mono.size(), out);
+    fclose(out);
+    return mono;
+}
+
+TEST(playbackStreamPlaysAtItsSpeed) {
+    const size_t frames = 2 * FILE_SAMPLE_RATE;
+    writeTone(frames);
+    PlaybackStream stream(1, 8);
+    stream.setSampleRates(FILE_SAMPLE_RATE, FILE_SAMPLE_RATE);
+
+    // a speed set up front reads the mapping instead of handing it out
+    stream.setSpeed(2);
+    EXPECT_TRUE(stream.open(PATH, 256, PlaybackStream::SOURCE_MAPPED));
+    EXPECT_TRUE(!stream.zeroCopy());
+    std::vector<short> played;
+    unsigned bytes;
+    const short *buffer;
+    bool halfway = false;
+    while ((buffer = stream.nextBuffer(&bytes)) != NULL) {
+        played.insert(played.end(), buffer, buffer + bytes / sizeof(short));
+        stream.onBufferPlayed();
+        if (!halfway && played.size() >= frames / 4) {
+            // the position keeps to the file, about twice what was played
+            halfway = true;
+            EXPECT_NEAR(2.0 * played.size(), static_cast<double>(stream.position()), FILE_SAMPLE_RATE / 5);
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(300));
+    }
+    EXPECT_EQ(0u, stream.underruns());
+    EXPECT_EQ(static_cast<unsigned long long>(frames), stream.position());
+    EXPECT_NEAR(frames / 2.0, static_cast<double>(played.size()), FILE_SAMPLE_RATE / 20);
+    stream.close();
+
+    // back at 1 it's the file as it was, straight from the mapping
+    stream.setSpeed(1);
+    EXPECT_TRUE(stream.open(PATH, 256, PlaybackStream::SOURCE_MAPPED));
+    EXPECT_TRUE(stream.zeroCopy());
+    stream.close();
+    unlink(PATH);
+}
+
+TEST(engineChangesPlaySpeedWhilePlaying) {
+    const size_t frames = 3 * FILE_SAMPLE_RATE;
+    std::vector<short> data = writeTone(frames);
+    HostBackend *backend = new HostBackend(192, 4);
+    AudioEngine engine(backend);
+    engine.setMappedPlayback(false);
+    EXPECT_TRUE(engine.startPlay(PATH));
+    EXPECT_EQ(1.0f, engine.playSpeed());
+    // a second in at 1, the rest at 3
+    while (engine.playPosition() < FILE_SAMPLE_RATE && !engine.playFinished()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    engine.setPlaySpeed(3);
+    EXPECT_EQ(3.0f, engine.playSpeed());
+    for (int i = 0; i < 1000 && !engine.playFinished(); i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    EXPECT_TRUE(engine.playFinished());
+    std::vector<short> output = backend->output();
+    // leading and trailing silence aside, the first second as it was,
+    // then the last two in about two thirds of a second
+    size_t first = std::find_if(output.begin(), output.end(), [](short v) { return v != 0; })
+                   - output.begin();
+    EXPECT_TRUE(first < output.size());
+    size_t last = output.size();
+    while (last > first && output[last - 1] == 0) {
+        last--;
+    }
+    size_t played = last - first;
+    EXPECT_TRUE(played > FILE_SAMPLE_RATE + FILE_SAMPLE_RATE / 2);
+    EXPECT_TRUE(played < 2 * FILE_SAMPLE_RATE);
+    EXPECT_TRUE(std::equal(data.begin() + 1, data.begin() + FILE_SAMPLE_RATE / 2,
+                           output.begin() + first));
+    engine.setPlaySpeed(1);
+    unlink(PATH);
+}
@@ -0,0 +1,224 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "HostBackend.h"
+#include "TestHarness.h"
+#include "VoiceActivity.h"
+#include "WavFile.h"
+
+static const int RATE = 16000;
+
+// appends white noise or a tone of the given peak
+static void noise(std::vector<short> *out, size_t frames, int peak) {
+    static unsigned seed = 1;
+    for (size_t i = 0; i < frames; i++) {
+        seed = seed * 1103515245 + 12345;
+        out->push_back(static_cast<short>(static_cast<int>(seed >> 8) % (2 * peak + 1) - peak));
+    }
+}
+
+static void tone(std::vector<short> *out, size_t frames, int peak) {
+    for (size_t i = 0; i < frames; i++) {
+        out->push_back(static_cast<short>(peak * sin(0.1 * i)));
+    }
+}
+
+struct Run {
+    unsigned long long capture;
+    unsigned long long file;
+    unsigned long long frames;
+};
+
+static bool readIndex(const char *path, int *rate, std::vector<Run> *runs) {
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return false;
+    }
+    int version = 0, channels = 0;
+    bool ok = fscanf(f, "nfvad %d %d %d\n", &version, rate, &channels) == 3 && version == 1;
+    Run run;
+    while (ok && fscanf(f, "%llu %llu %llu\n", &run.capture, &run.file, &run.frames) == 3) {
+        runs->push_back(run);
+    }
+    fclose(f);
+    return ok;
+}
+
+static void collect(const short *samples, size_t frames, void *context) {
+    std::vector<short> *kept = static_cast<std::vector<short> *>(context);
+    kept->insert(kept->end(), samples, samples + frames);
+}
+
+// runs signal through a trimmer in odd sized pieces; returns what it kept
+static std::vector<short> trim(const std::vector<short> &signal, const VadConfig &config,
+                               const char *indexPath, unsigned long long *dropped) {
+    std::vector<short> kept;
+    SilenceTrimmer trimmer;
+    EXPECT_TRUE(trimmer.open(indexPath, RATE, 1, config, collect, &kept));
+    for (size_t i = 0; i < signal.size(); i += 333) {
+        trimmer.write(&signal[i], std::min<size_t>(333, signal.size() - i));
+    }
+    EXPECT_TRUE(trimmer.close());
+    EXPECT_EQ(signal.size(), trimmer.keptFrames() + trimmer.droppedFrames());
+    EXPECT_EQ(kept.size(), trimmer.keptFrames());
+    *dropped = trimmer.droppedFrames();
+    return kept;
+}
+
+TEST(vadTellsVoiceFromTheNoiseFloor) {
+    VoiceActivityDetector vad;
+    EXPECT_TRUE(vad.init(RATE, 1, 9.0f, true));
+    EXPECT_EQ(RATE / 100u, vad.windowFrames());
+    std::vector<short> window;
+    bool any = false;
+    for (int i = 0; i < 50; i++) {
+        window.clear();
+        noise(&window, vad.windowFrames(), 100);
+        any = vad.process(&window[0]) || any;
+    }
+    EXPECT_TRUE(!any);
+    EXPECT_TRUE(vad.noiseFloorDb() < -45.0f);
+    EXPECT_TRUE(vad.flatness() > VAD_NOISE_FLATNESS);
+
+    window.clear();
+    tone(&window, vad.windowFrames(), 8000);
+    EXPECT_TRUE(vad.process(&window[0]));
+    EXPECT_TRUE(vad.flatness() < 0.1f);
+    EXPECT_TRUE(vad.zeroCrossingRate() < 0.1f);
+
+    // the same noise 12 dB up: louder, but flat, so not voice
+    window.clear();
+    noise(&window, vad.windowFrames(), 400);
+    EXPECT_TRUE(!vad.process(&window[0]));
+
+    // without the flatness check it passes on its zero crossings
+    VoiceActivityDetector plain;
+    EXPECT_TRUE(plain.init(RATE, 1, 9.0f, false));
+    for (int i = 0; i < 50; i++) {
+        window.clear();
+        noise(&window, plain.windowFrames(), 100);
+        plain.process(&window[0]);
+    }
+    window.clear();
+    noise(&window, plain.windowFrames(), 200);
+    EXPECT_TRUE(plain.zeroCrossingRate() > VAD_FRICATIVE_ZCR);
+    EXPECT_TRUE(plain.process(&window[0]));
+    EXPECT_EQ(0.0f, plain.flatness());
+
+    // digital silence is never voice, however far above the floor
+    window.assign(plain.windowFrames(), 0);
+    plain.process(&window[0]);
+    window.assign(plain.windowFrames(), 20);
+    EXPECT_TRUE(!plain.process(&window[0]));
+}
+
+TEST(silenceTrimmerKeepsVoiceAndIndexesIt) {
+    const char *indexPath = "/tmp/VoiceActivityTest_trim.vad";
+    std::vector<short> signal;
+    noise(&signal, RATE, 60);
+    size_t firstTone = signal.size();
+    tone(&signal, RATE / 2, 6000);
+    noise(&signal, RATE * 2, 60);
+    size_t secondTone = signal.size();
+    tone(&signal, RATE / 4 + 57, 6000);
+    noise(&signal, RATE / 2, 60);
+
+    VadConfig config;
+    config.enabled = true;
+    unsigned long long dropped;
+    std::vector<short> kept = trim(signal, config, indexPath, &dropped);
+    // two talk spurts, each with its pre-roll and hangover
+    EXPECT_TRUE(dropped > signal.size() / 2);
+    EXPECT_TRUE(kept.size() < (RATE / 2 + RATE / 4 + 57) * 2);
+
+    int rate;
+    std::vector<Run> runs;
+    EXPECT_TRUE(readIndex(indexPath, &rate, &runs));
+    EXPECT_EQ(RATE, rate);
+    EXPECT_EQ(2u, runs.size());
+    unsigned long long file = 0;
+    for (size_t r = 0; r < runs.size(); r++) {
+        // the runs tile the file and map every frame back to its capture time
+        EXPECT_EQ(file, runs[r].file);
+        for (unsigned long long i = 0; i < runs[r].frames; i++) {
+            if (kept[runs[r].file + i] != signal[runs[r].capture + i]) {
+                EXPECT_TRUE(false);
+                break;
+            }
+        }
+        file += runs[r].frames;
+    }
+    EXPECT_EQ(kept.size(), file);
+    // each tone is inside its run, onset included
+    EXPECT_TRUE(runs[0].capture < firstTone);
+    EXPECT_TRUE(runs[0].capture + runs[0].frames >= firstTone + RATE / 2);
+    EXPECT_TRUE(runs[1].capture < secondTone);
+    EXPECT_TRUE(runs[1].capture + runs[1].frames >= secondTone + RATE / 4 + 57);
+    unlink(indexPath);
+}
+
+TEST(silenceTrimmerCompactsPausesToTheMaximumGap) {
+    std::vector<short> signal;
+    for (int i = 0; i < 5; i++) {
+        tone(&signal, RATE / 5, 6000);
+        noise(&signal, RATE * 2, 30);
+    }
+    VadConfig config;
+    config.enabled = true;
+    config.hangoverMs = 100;
+    config.preRollMs = 20;
+    config.maxGapMs = 200;
+    unsigned long long dropped;
+    std::vector<short> kept = trim(signal, config, NULL, &dropped);
+    // every pause shrinks to about hangover + gap + pre-roll, the last one,
+    // trailing, to hangover + gap
+    size_t talk = 5 * RATE / 5;
+    size_t pauses = 4 * RATE * 320 / 1000 + RATE * 300 / 1000;
+    EXPECT_TRUE(kept.size() >= talk + pauses - RATE / 50);
+    EXPECT_TRUE(kept.size() <= talk + pauses + RATE / 50);
+}
+
+TEST(engineRecordsOnlyTheVoice) {
+    const char *path = "/tmp/VoiceActivityTest_record.wav";
+    std::string indexPath = SilenceTrimmer::indexPathFor(path);
+    std::vector<short> input;
+    noise(&input, FILE_SAMPLE_RATE / 10, 50);
+    tone(&input, FILE_SAMPLE_RATE / 10, 5000);
+    noise(&input, FILE_SAMPLE_RATE * 5, 50);
+    MemoryPcmSource source(input.data(), input.size() * sizeof(short));
+    HostBackend *backend = new HostBackend(192, 20);
+    backend->setInput(&source);
+    AudioEngine engine(backend);
+    VadConfig config;
+    config.enabled = true;
+    engine.setSilenceTrimming(config);
+    EXPECT_TRUE(engine.createAudioRecorder());
+    EXPECT_TRUE(engine.startRecord(path));
+    std::this_thread::sleep_for(std::chrono::milliseconds(400));
+    engine.stopRecord();
+
+    // about the tone and its hangover made it, the rest is in trimmedFrames
+    unsigned long long written = engine.capture().bytesWritten() / sizeof(short);
+    EXPECT_TRUE(written >= FILE_SAMPLE_RATE / 10);
+    EXPECT_TRUE(written < FILE_SAMPLE_RATE / 2);
+    EXPECT_TRUE(engine.capture().trimmedFrames() > written);
+    int rate;
+    std::vector<Run> runs;
+    EXPECT_TRUE(readIndex(indexPath.c_str(), &rate, &runs));
+    EXPECT_EQ(1u, runs.size());
+    EXPECT_EQ(written, runs.empty() ? 0 : runs[0].frames);
+    WavInfo info;
+    EXPECT_EQ(WAV_PCM16, WavReader::probe(path, &info));
+    EXPECT_EQ(written * sizeof(short), info.dataBytes);
+    unlink(path);
+    unlink(indexPath.c_str());
+}
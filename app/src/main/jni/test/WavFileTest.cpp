@@ -0,0 +1,212 @@
+//
+// Created by darrenyuan on 2026/10/16.
+//
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "HostBackend.h"
+#include "PlaybackStream.h"
+#include "TestHarness.h"
+#include "WavFile.h"
+
+static std::vector<short> ramp(size_t samples) {
+    std::vector<short> data(samples);
+    for (size_t i = 0; i < samples; i++) {
+        data[i] = static_cast<short>(i * 7);
+    }
+    return data;
+}
+
+static std::vector<unsigned char> readBytes(const char *path) {
+    std::vector<unsigned char> bytes;
+    FILE *in = fopen(path, "rb");
+    int c;
+    while (in != NULL && (c = fgetc(in)) != EOF) {
+        bytes.push_back(static_cast<unsigned char>(c));
+    }
+    if (in != NULL) {
+        fclose(in);
+    }
+    return bytes;
+}
+
+static unsigned le32(const std::vector<unsigned char> &bytes, size_t offset) {
+    return bytes[offset] | bytes[offset + 1] << 8 | bytes[offset + 2] << 16
+           | static_cast<unsigned>(bytes[offset + 3]) << 24;
+}
+
+static bool samplesAt(const std::vector<unsigned char> &bytes, unsigned long long offset,
+                      const std::vector<short> &expected) {
+    return bytes.size() >= offset + expected.size() * sizeof(short)
+           && memcmp(&bytes[offset], expected.data(), expected.size() * sizeof(short)) == 0;
+}
+
+TEST(wavWriterKeepsTheHeaderCurrentWhileWriting) {
+    const char *path = "/tmp/WavFileTest_stream.wav";
+    std::vector<short> samples = ramp(200000);
+    WavWriter writer;
+    EXPECT_TRUE(writer.open(path, 44100, 2, true));
+    EXPECT_TRUE(writer.write(samples.data(), samples.size() * sizeof(short)));
+
+    // one chunk on disk, header and all: readable as it stands
+    WavInfo info;
+    EXPECT_EQ(WAV_PCM16, WavReader::probe(path, &info));
+    EXPECT_EQ(44100, info.sampleRate);
+    EXPECT_EQ(2, info.channels);
+    EXPECT_EQ(80ull, info.dataOffset);
+    EXPECT_EQ(static_cast<unsigned long long>(WAV_WRITE_CHUNK_BYTES - 80), info.dataBytes);
+    std::vector<unsigned char> bytes = readBytes(path);
+    EXPECT_EQ(static_cast<size_t>(WAV_WRITE_CHUNK_BYTES), bytes.size());
+    EXPECT_EQ(WAV_WRITE_CHUNK_BYTES - 80u, le32(bytes, 76));
+
+    EXPECT_TRUE(writer.close());
+    bytes = readBytes(path);
+    EXPECT_EQ(WAV_PCM16, WavReader::probe(path, &info));
+    EXPECT_TRUE(!info.rf64);
+    EXPECT_EQ(samples.size() * sizeof(short), info.dataBytes);
+    EXPECT_EQ(0, memcmp(&bytes[0], "RIFF", 4));
+    EXPECT_EQ(bytes.size() - 8, le32(bytes, 4));
+    EXPECT_TRUE(samplesAt(bytes, info.dataOffset, samples));
+    unlink(path);
+}
+
+TEST(wavWriterTurnsIntoRf64PastTheRiffLimit) {
+    const char *path = "/tmp/WavFileTest_rf64.wav";
+    std::vector<short> samples = ramp(300000);
+    WavWriter writer;
+    writer.setRiffLimit(400000);
+    EXPECT_TRUE(writer.open(path, 48000, 1, true));
+    EXPECT_TRUE(writer.write(samples.data(), samples.size() * sizeof(short)));
+    EXPECT_TRUE(writer.close());
+
+    std::vector<unsigned char> bytes = readBytes(path);
+    EXPECT_EQ(0, memcmp(&bytes[0], "RF64", 4));
+    EXPECT_EQ(0xFFFFFFFFu, le32(bytes, 4));
+    EXPECT_EQ(0, memcmp(&bytes[12], "ds64", 4));
+    EXPECT_EQ(0xFFFFFFFFu, le32(bytes, 76));
+    WavInfo info;
+    EXPECT_EQ(WAV_PCM16, WavReader::probe(path, &info));
+    EXPECT_TRUE(info.rf64);
+    EXPECT_EQ(samples.size() * sizeof(short), info.dataBytes);
+    EXPECT_TRUE(samplesAt(bytes, info.dataOffset, samples));
+    unlink(path);
+}
+
+TEST(wavRepairFixesTheSizesOfAnUnfinishedFile) {
+    const char *path = "/tmp/WavFileTest_repair.wav";
+    std::vector<short> samples = ramp(1000);
+    WavWriter writer;
+    EXPECT_TRUE(writer.open(path, 16000, 1, true));
+    EXPECT_TRUE(writer.write(samples.data(), samples.size() * sizeof(short)));
+    EXPECT_TRUE(writer.close());
+    // what a writer killed before its first patch leaves: zero sizes and
+    // a torn last frame
+    FILE *file = fopen(path, "r+b");
+    unsigned char zero[4] = {0, 0, 0, 0};
+    fseek(file, 4, SEEK_SET);
+    fwrite(zero, 1, 4, file);
+    fseek(file, 76, SEEK_SET);
+    fwrite(zero, 1, 4, file);
+    fseek(file, 0, SEEK_END);
+    fputc(0x55, file);
+    fclose(file);
+
+    WavInfo info;
+    EXPECT_EQ(WAV_PCM16, WavReader::probe(path, &info));
+    EXPECT_EQ(samples.size() * sizeof(short), info.dataBytes);
+    EXPECT_TRUE(WavWriter::repair(path));
+    std::vector<unsigned char> bytes = readBytes(path);
+    EXPECT_EQ(80 + samples.size() * sizeof(short), bytes.size());
+    EXPECT_EQ(bytes.size() - 8, le32(bytes, 4));
+    EXPECT_EQ(samples.size() * sizeof(short), le32(bytes, 76));
+    unlink(path);
+}
+
+TEST(wavReaderRejectsOtherSampleFormats) {
+    const char *path = "/tmp/WavFileTest_float.wav";
+    WavWriter writer;
+    EXPECT_TRUE(writer.open(path, 48000, 1, true));
+    float samples[64] = {0};
+    writer.write(samples, sizeof(samples));
+    EXPECT_TRUE(writer.close());
+    // relabel it 32-bit float
+    FILE *file = fopen(path, "r+b");
+    unsigned char tag[2] = {3, 0}, bits[2] = {32, 0};
+    fseek(file, 56, SEEK_SET);
+    fwrite(tag, 1, 2, file);
+    fseek(file, 70, SEEK_SET);
+    fwrite(bits, 1, 2, file);
+    fclose(file);
+
+    WavInfo info;
+    EXPECT_EQ(WAV_UNSUPPORTED, WavReader::probe(path, &info));
+    PlaybackStream stream(1, 4);
+    stream.setSampleRates(48000, 48000);
+    EXPECT_TRUE(!stream.open(path, 64));
+    unlink(path);
+    EXPECT_EQ(WAV_NONE, WavReader::probe(path, &info));
+}
+
+static void playWav(PlaybackStream::SourceMode mode) {
+    const char *path = "/tmp/WavFileTest_play.wav";
+    std::vector<short> samples = ramp(5000);
+    WavWriter writer;
+    EXPECT_TRUE(writer.open(path, 44100, 1, true));
+    writer.write(samples.data(), samples.size() * sizeof(short));
+    EXPECT_TRUE(writer.close());
+
+    // raw files would play at 48k and get resampled; the header says 44.1k
+    PlaybackStream stream(1, 8);
+    stream.setSampleRates(48000, 44100);
+    EXPECT_TRUE(stream.open(path, 256, mode));
+    std::vector<short> played;
+    unsigned bytes;
+    const short *buffer;
+    unsigned underruns = 0;
+    while ((buffer = stream.nextBuffer(&bytes)) != NULL) {
+        // silence while the reader thread catches up
+        if (stream.underruns() == underruns) {
+            played.insert(played.end(), buffer, buffer + bytes / sizeof(short));
+        }
+        underruns = stream.underruns();
+        stream.onBufferPlayed();
+    }
+    stream.close();
+    EXPECT_EQ(samples.size(), played.size());
+    EXPECT_TRUE(played == samples);
+    unlink(path);
+}
+
+TEST(playbackStreamPlaysTheDataChunkOfAWav) {
+    playWav(PlaybackStream::SOURCE_STREAM);
+    playWav(PlaybackStream::SOURCE_MAPPED);
+}
+
+TEST(engineRecordsWavWhenAskedTo) {
+    const char *path = "/tmp/WavFileTest_record.wav";
+    std::vector<short> input = ramp(44100);
+    MemoryPcmSource source(input.data(), input.size() * sizeof(short));
+    HostBackend *backend = new HostBackend(192, 20);
+    backend->setInput(&source);
+    AudioEngine engine(backend);
+    EXPECT_TRUE(engine.createAudioRecorder());
+    EXPECT_TRUE(engine.startRecord(path));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    engine.stopRecord();
+
+    WavInfo info;
+    EXPECT_EQ(WAV_PCM16, WavReader::probe(path, &info));
+    EXPECT_EQ(FILE_SAMPLE_RATE, info.sampleRate);
+    EXPECT_EQ(1, info.channels);
+    EXPECT_EQ(engine.capture().bytesWritten(), info.dataBytes);
+    EXPECT_TRUE(info.dataBytes > 0);
+    std::vector<short> head(input.begin(), input.begin() + info.dataBytes / sizeof(short));
+    EXPECT_TRUE(samplesAt(readBytes(path), info.dataOffset, head));
+    unlink(path);
+}